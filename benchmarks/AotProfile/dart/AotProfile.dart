@@ -0,0 +1,157 @@
+// Copyright (c) 2019, the Dart project authors.  Please see the AUTHORS file
+// for details. All rights reserved. Use of this source code is governed by a
+// BSD-style license that can be found in the LICENSE file.
+
+// Micro-benchmarks for profile guided AOT compilation.
+//
+// These micro benchmarks contain call sites that are polymorphic in the
+// program but dominated by one receiver class at run time, and branches that
+// are almost always taken one way. To measure the effect of a profile,
+// record one with a training run of this file
+//
+//   dart --save-aot-profile=AotProfile.profile AotProfile.dart
+//
+// and compare the AOT snapshot built with
+// `gen_snapshot --load-aot-profile=AotProfile.profile` against one built
+// without it.
+
+import 'package:benchmark_harness/benchmark_harness.dart';
+
+const N = 1000;
+
+//
+// Shapes with a dominant receiver class.
+//
+
+abstract class Shape {
+  int area();
+}
+
+class Square extends Shape {
+  final int side;
+  Square(this.side);
+  int area() => side * side;
+}
+
+class Rectangle extends Shape {
+  final int width;
+  final int height;
+  Rectangle(this.width, this.height);
+  int area() => width * height;
+}
+
+class Triangle extends Shape {
+  final int base;
+  final int height;
+  Triangle(this.base, this.height);
+  int area() => base * height ~/ 2;
+}
+
+class Circle extends Shape {
+  final int radius;
+  Circle(this.radius);
+  int area() => 3 * radius * radius;
+}
+
+List<Shape> makeShapes() {
+  final shapes = <Shape>[];
+  for (int i = 0; i < N; i++) {
+    // One in a hundred shapes is not a square.
+    switch (i % 100) {
+      case 1:
+        shapes.add(Rectangle(i, 2));
+        break;
+      case 2:
+        shapes.add(Triangle(i, 2));
+        break;
+      case 3:
+        shapes.add(Circle(i));
+        break;
+      default:
+        shapes.add(Square(i & 7));
+    }
+  }
+  return shapes;
+}
+
+int doTotalArea(List<Shape> shapes) {
+  int sum = 0;
+  for (int i = 0; i < shapes.length; i++) {
+    sum += shapes[i].area();
+  }
+  return sum;
+}
+
+//
+// Rarely taken branches.
+//
+
+int doClassify(List<int> values) {
+  int small = 0;
+  int large = 0;
+  int negative = 0;
+  for (int i = 0; i < values.length; i++) {
+    final int v = values[i];
+    if (v < 0) {
+      negative += v;
+    } else if (v > 1000000) {
+      large += v ~/ 1000;
+    } else {
+      small += v & 0xFF;
+    }
+  }
+  return small + large - negative;
+}
+
+//
+// Benchmark fixtures.
+//
+
+class PolymorphicCall extends BenchmarkBase {
+  final List<Shape> shapes = makeShapes();
+  int expected;
+  PolymorphicCall() : super("AotProfile.PolymorphicCall");
+
+  void setup() {
+    expected = doTotalArea(shapes);
+  }
+
+  void run() {
+    final int x = doTotalArea(shapes);
+    if (x != expected) {
+      throw Exception("$name: Unexpected result: $x");
+    }
+  }
+}
+
+class SkewedBranches extends BenchmarkBase {
+  final List<int> values = List<int>(N);
+  int expected;
+  SkewedBranches() : super("AotProfile.SkewedBranches");
+
+  void setup() {
+    for (int i = 0; i < N; i++) {
+      values[i] = (i % 250 == 0) ? -i : ((i % 333 == 0) ? 2000000 + i : i);
+    }
+    expected = doClassify(values);
+  }
+
+  void run() {
+    final int x = doClassify(values);
+    if (x != expected) {
+      throw Exception("$name: Unexpected result: $x");
+    }
+  }
+}
+
+//
+// Main driver.
+//
+
+main() {
+  final benchmarks = [
+    () => PolymorphicCall(),
+    () => SkewedBranches(),
+  ];
+  benchmarks.forEach((benchmark) => benchmark().report());
+}
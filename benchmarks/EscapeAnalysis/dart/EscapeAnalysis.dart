@@ -0,0 +1,133 @@
+// Copyright (c) 2019, the Dart project authors.  Please see the AUTHORS file
+// for details. All rights reserved. Use of this source code is governed by a
+// BSD-style license that can be found in the LICENSE file.
+
+// Micro-benchmarks for short-lived objects passed to calls.
+//
+// These micro benchmarks allocate small objects in their loops that are only
+// passed to a method that reads them. Once the method is inlined, the
+// allocations are removed (see --inlining-non-escaping-size-threshold),
+// which shows up as fewer scavenges when run with --verbose-gc.
+
+import 'package:benchmark_harness/benchmark_harness.dart';
+
+const N = 1000;
+
+//
+// Points passed to a medium sized method.
+//
+
+class Point {
+  final double x;
+  final double y;
+  Point(this.x, this.y);
+}
+
+class Box {
+  double minX = double.infinity;
+  double minY = double.infinity;
+  double maxX = -double.infinity;
+  double maxY = -double.infinity;
+
+  void extend(Point p) {
+    if (p.x < minX) minX = p.x;
+    if (p.y < minY) minY = p.y;
+    if (p.x > maxX) maxX = p.x;
+    if (p.y > maxY) maxY = p.y;
+  }
+
+  double get area => (maxX - minX) * (maxY - minY);
+}
+
+double doBoundingBox(List<double> xs, List<double> ys) {
+  final box = Box();
+  for (int i = 0; i < xs.length; i++) {
+    box.extend(Point(xs[i], ys[i]));
+  }
+  return box.area;
+}
+
+//
+// Hand written iterators.
+//
+
+class RangeCursor {
+  int current;
+  final int end;
+  RangeCursor(this.current, this.end);
+}
+
+int sumRange(RangeCursor cursor, List<int> values) {
+  int sum = 0;
+  while (cursor.current < cursor.end) {
+    sum += values[cursor.current];
+    cursor.current++;
+  }
+  return sum;
+}
+
+int doSumRanges(List<int> values) {
+  int sum = 0;
+  for (int i = 0; i + 10 <= values.length; i += 10) {
+    sum += sumRange(RangeCursor(i, i + 10), values);
+  }
+  return sum;
+}
+
+//
+// Benchmark fixtures.
+//
+
+class BoundingBox extends BenchmarkBase {
+  final List<double> xs = List<double>(N);
+  final List<double> ys = List<double>(N);
+  double expected;
+  BoundingBox() : super("EscapeAnalysis.BoundingBox");
+
+  void setup() {
+    for (int i = 0; i < N; i++) {
+      xs[i] = (i * 7 % 101).toDouble();
+      ys[i] = (i * 13 % 97).toDouble();
+    }
+    expected = doBoundingBox(xs, ys);
+  }
+
+  void run() {
+    final double x = doBoundingBox(xs, ys);
+    if (x != expected) {
+      throw Exception("$name: Unexpected result: $x");
+    }
+  }
+}
+
+class RangeIterator extends BenchmarkBase {
+  final List<int> values = List<int>(N);
+  int expected;
+  RangeIterator() : super("EscapeAnalysis.RangeIterator");
+
+  void setup() {
+    for (int i = 0; i < N; i++) {
+      values[i] = i & 0xFF;
+    }
+    expected = doSumRanges(values);
+  }
+
+  void run() {
+    final int x = doSumRanges(values);
+    if (x != expected) {
+      throw Exception("$name: Unexpected result: $x");
+    }
+  }
+}
+
+//
+// Main driver.
+//
+
+main() {
+  final benchmarks = [
+    () => BoundingBox(),
+    () => RangeIterator(),
+  ];
+  benchmarks.forEach((benchmark) => benchmark().report());
+}
@@ -36,6 +36,32 @@ class SendReceiveBytes extends AsyncBenchmarkBase {
   SendReceiveHelper helper;
 }
 
+// Measures how long it takes until a newly spawned isolate has sent its first
+// message. Run with --enable-isolate-groups and --isolate-template to spawn
+// from the main isolate's template.
+class SpawnLatency extends AsyncBenchmarkBase {
+  SpawnLatency(String name) : super(name);
+
+  @override
+  Future<void> run() async {
+    final port = ReceivePort();
+    final exitPort = ReceivePort();
+    await Isolate.spawn(spawnee, port.sendPort, onExit: exitPort.sendPort);
+    await port.first;
+    await exitPort.first;
+  }
+
+  @override
+  Future<void> setup() async {}
+
+  @override
+  Future<void> teardown() async {}
+}
+
+void spawnee(SendPort sendPort) {
+  sendPort.send(null);
+}
+
 // Identical to BenchmarkBase from package:benchmark_harness but async.
 abstract class AsyncBenchmarkBase {
   final String name;
@@ -173,6 +199,7 @@ final List<SizeName> sizes = <SizeName>[
 ];
 
 Future<void> main() async {
+  await SpawnLatency("Isolate.SpawnLatency").report();
   for (SizeName sizeName in sizes) {
     await SendReceiveBytes("Isolate.SendReceiveBytes${sizeName.name}",
             size: sizeName.size, useTransferable: false)
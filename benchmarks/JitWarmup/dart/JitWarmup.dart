@@ -0,0 +1,395 @@
+// Copyright (c) 2019, the Dart project authors.  Please see the AUTHORS file
+// for details. All rights reserved. Use of this source code is governed by a
+// BSD-style license that can be found in the LICENSE file.
+
+// Measures how long it takes JIT code to reach peak performance.
+//
+// Many functions in this benchmark become hot at the same time and are
+// queued for background optimization together. The benchmark runs rounds
+// that call all of them and reports the time from start until a round is
+// within 10% of the fastest round seen, compare runs with different
+// --background-compiler-tasks values.
+
+import 'package:benchmark_harness/benchmark_harness.dart'
+    show PrintEmitter, ScoreEmitter;
+
+const N = 100;
+const Rounds = 20000;
+
+int kernel0(List<int> values) {
+  int sum = 0;
+  for (int i = 0; i < values.length; i++) {
+    final int v = values[i];
+    sum += v;
+  }
+  return sum;
+}
+
+int kernel1(List<int> values) {
+  int sum = 1;
+  for (int i = 0; i < values.length; i++) {
+    final int v = values[i];
+    sum ^= v * 3;
+  }
+  return sum;
+}
+
+int kernel2(List<int> values) {
+  int sum = 2;
+  for (int i = 0; i < values.length; i++) {
+    final int v = values[i];
+    sum += v & 0xF;
+  }
+  return sum;
+}
+
+int kernel3(List<int> values) {
+  int sum = 3;
+  for (int i = 0; i < values.length; i++) {
+    final int v = values[i];
+    if (v.isEven) sum += v;
+  }
+  return sum;
+}
+
+int kernel4(List<int> values) {
+  int sum = 4;
+  for (int i = 0; i < values.length; i++) {
+    final int v = values[i];
+    sum += v ~/ 3;
+  }
+  return sum;
+}
+
+int kernel5(List<int> values) {
+  int sum = 5;
+  for (int i = 0; i < values.length; i++) {
+    final int v = values[i];
+    sum = (sum + v) & 0xFFFFFF;
+  }
+  return sum;
+}
+
+int kernel6(List<int> values) {
+  int sum = 6;
+  for (int i = 0; i < values.length; i++) {
+    final int v = values[i];
+    sum += v % 7;
+  }
+  return sum;
+}
+
+int kernel7(List<int> values) {
+  int sum = 7;
+  for (int i = 0; i < values.length; i++) {
+    final int v = values[i];
+    if (v > 128) sum -= v;
+  }
+  return sum;
+}
+
+int kernel8(List<int> values) {
+  int sum = 8;
+  for (int i = 0; i < values.length; i++) {
+    final int v = values[i] + 1;
+    sum += v;
+  }
+  return sum;
+}
+
+int kernel9(List<int> values) {
+  int sum = 9;
+  for (int i = 0; i < values.length; i++) {
+    final int v = values[i] + 1;
+    sum ^= v * 3;
+  }
+  return sum;
+}
+
+int kernel10(List<int> values) {
+  int sum = 10;
+  for (int i = 0; i < values.length; i++) {
+    final int v = values[i] + 1;
+    sum += v & 0xF;
+  }
+  return sum;
+}
+
+int kernel11(List<int> values) {
+  int sum = 11;
+  for (int i = 0; i < values.length; i++) {
+    final int v = values[i] + 1;
+    if (v.isEven) sum += v;
+  }
+  return sum;
+}
+
+int kernel12(List<int> values) {
+  int sum = 12;
+  for (int i = 0; i < values.length; i++) {
+    final int v = values[i] + 1;
+    sum += v ~/ 3;
+  }
+  return sum;
+}
+
+int kernel13(List<int> values) {
+  int sum = 13;
+  for (int i = 0; i < values.length; i++) {
+    final int v = values[i] + 1;
+    sum = (sum + v) & 0xFFFFFF;
+  }
+  return sum;
+}
+
+int kernel14(List<int> values) {
+  int sum = 14;
+  for (int i = 0; i < values.length; i++) {
+    final int v = values[i] + 1;
+    sum += v % 7;
+  }
+  return sum;
+}
+
+int kernel15(List<int> values) {
+  int sum = 15;
+  for (int i = 0; i < values.length; i++) {
+    final int v = values[i] + 1;
+    if (v > 128) sum -= v;
+  }
+  return sum;
+}
+
+int kernel16(List<int> values) {
+  int sum = 16;
+  for (int i = 0; i < values.length; i++) {
+    final int v = values[i] + 2;
+    sum += v;
+  }
+  return sum;
+}
+
+int kernel17(List<int> values) {
+  int sum = 17;
+  for (int i = 0; i < values.length; i++) {
+    final int v = values[i] + 2;
+    sum ^= v * 3;
+  }
+  return sum;
+}
+
+int kernel18(List<int> values) {
+  int sum = 18;
+  for (int i = 0; i < values.length; i++) {
+    final int v = values[i] + 2;
+    sum += v & 0xF;
+  }
+  return sum;
+}
+
+int kernel19(List<int> values) {
+  int sum = 19;
+  for (int i = 0; i < values.length; i++) {
+    final int v = values[i] + 2;
+    if (v.isEven) sum += v;
+  }
+  return sum;
+}
+
+int kernel20(List<int> values) {
+  int sum = 20;
+  for (int i = 0; i < values.length; i++) {
+    final int v = values[i] + 2;
+    sum += v ~/ 3;
+  }
+  return sum;
+}
+
+int kernel21(List<int> values) {
+  int sum = 21;
+  for (int i = 0; i < values.length; i++) {
+    final int v = values[i] + 2;
+    sum = (sum + v) & 0xFFFFFF;
+  }
+  return sum;
+}
+
+int kernel22(List<int> values) {
+  int sum = 22;
+  for (int i = 0; i < values.length; i++) {
+    final int v = values[i] + 2;
+    sum += v % 7;
+  }
+  return sum;
+}
+
+int kernel23(List<int> values) {
+  int sum = 23;
+  for (int i = 0; i < values.length; i++) {
+    final int v = values[i] + 2;
+    if (v > 128) sum -= v;
+  }
+  return sum;
+}
+
+int kernel24(List<int> values) {
+  int sum = 24;
+  for (int i = 0; i < values.length; i++) {
+    final int v = values[i] + 3;
+    sum += v;
+  }
+  return sum;
+}
+
+int kernel25(List<int> values) {
+  int sum = 25;
+  for (int i = 0; i < values.length; i++) {
+    final int v = values[i] + 3;
+    sum ^= v * 3;
+  }
+  return sum;
+}
+
+int kernel26(List<int> values) {
+  int sum = 26;
+  for (int i = 0; i < values.length; i++) {
+    final int v = values[i] + 3;
+    sum += v & 0xF;
+  }
+  return sum;
+}
+
+int kernel27(List<int> values) {
+  int sum = 27;
+  for (int i = 0; i < values.length; i++) {
+    final int v = values[i] + 3;
+    if (v.isEven) sum += v;
+  }
+  return sum;
+}
+
+int kernel28(List<int> values) {
+  int sum = 28;
+  for (int i = 0; i < values.length; i++) {
+    final int v = values[i] + 3;
+    sum += v ~/ 3;
+  }
+  return sum;
+}
+
+int kernel29(List<int> values) {
+  int sum = 29;
+  for (int i = 0; i < values.length; i++) {
+    final int v = values[i] + 3;
+    sum = (sum + v) & 0xFFFFFF;
+  }
+  return sum;
+}
+
+int kernel30(List<int> values) {
+  int sum = 30;
+  for (int i = 0; i < values.length; i++) {
+    final int v = values[i] + 3;
+    sum += v % 7;
+  }
+  return sum;
+}
+
+int kernel31(List<int> values) {
+  int sum = 31;
+  for (int i = 0; i < values.length; i++) {
+    final int v = values[i] + 3;
+    if (v > 128) sum -= v;
+  }
+  return sum;
+}
+
+final List<int Function(List<int>)> kernels = [
+  kernel0,
+  kernel1,
+  kernel2,
+  kernel3,
+  kernel4,
+  kernel5,
+  kernel6,
+  kernel7,
+  kernel8,
+  kernel9,
+  kernel10,
+  kernel11,
+  kernel12,
+  kernel13,
+  kernel14,
+  kernel15,
+  kernel16,
+  kernel17,
+  kernel18,
+  kernel19,
+  kernel20,
+  kernel21,
+  kernel22,
+  kernel23,
+  kernel24,
+  kernel25,
+  kernel26,
+  kernel27,
+  kernel28,
+  kernel29,
+  kernel30,
+  kernel31,
+];
+
+class TimeToPeak {
+  final String name;
+  final ScoreEmitter emitter;
+  final List<int> values = List<int>(N);
+
+  TimeToPeak(this.name, {this.emitter = const PrintEmitter()}) {
+    for (int i = 0; i < N; i++) {
+      values[i] = (i * 37) & 0xFF;
+    }
+  }
+
+  int round() {
+    int sum = 0;
+    for (int k = 0; k < kernels.length; k++) {
+      sum += kernels[k](values);
+    }
+    return sum;
+  }
+
+  // Returns the number of microseconds until a round runs at peak speed.
+  double measure() {
+    final List<int> ends = List<int>(Rounds);
+    final List<int> durations = List<int>(Rounds);
+    final watch = Stopwatch()..start();
+    int expected;
+    int start = 0;
+    for (int r = 0; r < Rounds; r++) {
+      final int x = round();
+      expected ??= x;
+      if (x != expected) {
+        throw Exception("$name: Unexpected result: $x");
+      }
+      final int end = watch.elapsedMicroseconds;
+      ends[r] = end;
+      durations[r] = end - start;
+      start = end;
+    }
+    final int best = durations.reduce((a, b) => a < b ? a : b);
+    for (int r = 0; r < Rounds; r++) {
+      if (durations[r] * 10 <= best * 11) {
+        return ends[r].toDouble();
+      }
+    }
+    return ends.last.toDouble();
+  }
+
+  void report() {
+    emitter.emit(name, measure());
+  }
+}
+
+main() {
+  TimeToPeak("JitWarmup.TimeToPeak").report();
+}
@@ -0,0 +1,137 @@
+// Copyright (c) 2019, the Dart project authors.  Please see the AUTHORS file
+// for details. All rights reserved. Use of this source code is governed by a
+// BSD-style license that can be found in the LICENSE file.
+
+// Micro-benchmarks for loop unrolling and vectorization.
+//
+// These micro benchmarks track the speed of simple counted loops over typed
+// data. The lengths are not a multiple of the vector width or unroll factor,
+// so the scalar epilogue loops are exercised as well.
+
+import 'dart:typed_data';
+
+import 'package:benchmark_harness/benchmark_harness.dart';
+
+const N = 1001;
+
+//
+// Loops.
+//
+
+void doAddFloat64(Float64List a, Float64List b, Float64List c) {
+  for (int i = 0; i < c.length; i++) {
+    c[i] = a[i] + b[i];
+  }
+}
+
+void doScaleFloat64(Float64List a, double factor) {
+  for (int i = 0; i < a.length; i++) {
+    a[i] = a[i] * factor;
+  }
+}
+
+void doAddFloat32(Float32List a, Float32List b, Float32List c) {
+  for (int i = 0; i < c.length; i++) {
+    c[i] = a[i] + b[i];
+  }
+}
+
+int doChecksumUint8(Uint8List a) {
+  int sum = 0;
+  for (int i = 0; i < a.length; i++) {
+    sum = (sum + a[i]) & 0xFFFFFFF;
+  }
+  return sum;
+}
+
+//
+// Benchmark fixtures.
+//
+
+class AddFloat64 extends BenchmarkBase {
+  final Float64List a = Float64List(N);
+  final Float64List b = Float64List(N);
+  final Float64List c = Float64List(N);
+  AddFloat64() : super("LoopVectorization.AddFloat64");
+
+  void setup() {
+    for (int i = 0; i < N; i++) {
+      a[i] = i.toDouble();
+      b[i] = 1.0;
+    }
+  }
+
+  void run() {
+    doAddFloat64(a, b, c);
+    if (c[N - 1] != N.toDouble()) {
+      throw Exception("$name: Unexpected result: ${c[N - 1]}");
+    }
+  }
+}
+
+class ScaleFloat64 extends BenchmarkBase {
+  final Float64List a = Float64List(N);
+  ScaleFloat64() : super("LoopVectorization.ScaleFloat64");
+
+  void run() {
+    a.fillRange(0, N, 1.0);
+    doScaleFloat64(a, 2.0);
+    if (a[N - 1] != 2.0) {
+      throw Exception("$name: Unexpected result: ${a[N - 1]}");
+    }
+  }
+}
+
+class AddFloat32 extends BenchmarkBase {
+  final Float32List a = Float32List(N);
+  final Float32List b = Float32List(N);
+  final Float32List c = Float32List(N);
+  AddFloat32() : super("LoopVectorization.AddFloat32");
+
+  void setup() {
+    for (int i = 0; i < N; i++) {
+      a[i] = i.toDouble();
+      b[i] = 1.0;
+    }
+  }
+
+  void run() {
+    doAddFloat32(a, b, c);
+    if (c[N - 1] != N.toDouble()) {
+      throw Exception("$name: Unexpected result: ${c[N - 1]}");
+    }
+  }
+}
+
+class ChecksumUint8 extends BenchmarkBase {
+  final Uint8List a = Uint8List(N);
+  ChecksumUint8() : super("LoopVectorization.ChecksumUint8");
+
+  void setup() {
+    for (int i = 0; i < N; i++) {
+      a[i] = i;
+    }
+  }
+
+  void run() {
+    final int x = doChecksumUint8(a);
+    // Three full cycles of 0..255 followed by 0..232.
+    if (x != 3 * 255 * 256 ~/ 2 + 232 * 233 ~/ 2) {
+      throw Exception("$name: Unexpected result: $x");
+    }
+  }
+}
+
+//
+// Main driver.
+//
+
+main() {
+  final benchmarks = [
+    () => AddFloat64(),
+    () => ScaleFloat64(),
+    () => AddFloat32(),
+    () => ChecksumUint8(),
+  ];
+  benchmarks.forEach((benchmark) => benchmark().report());
+}
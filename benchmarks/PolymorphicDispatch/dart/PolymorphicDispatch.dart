@@ -0,0 +1,257 @@
+// Copyright (c) 2019, the Dart project authors.  Please see the AUTHORS file
+// for details. All rights reserved. Use of this source code is governed by a
+// BSD-style license that can be found in the LICENSE file.
+
+// Micro-benchmarks for call sites with many receiver classes.
+//
+// A visitor walks a small expression tree whose nodes are of ten classes.
+// The hottest of them are inlined at the accept call and reached through a
+// tree of class id tests (see --inlining-dispatch-tree-threshold), the
+// others are called directly.
+
+import 'package:benchmark_harness/benchmark_harness.dart';
+
+const N = 1000;
+
+//
+// Expression tree with a visitor.
+//
+
+abstract class Node {
+  int accept(Visitor v);
+}
+
+class Literal extends Node {
+  final int value;
+  Literal(this.value);
+  int accept(Visitor v) => v.visitLiteral(this);
+}
+
+class Variable extends Node {
+  final int index;
+  Variable(this.index);
+  int accept(Visitor v) => v.visitVariable(this);
+}
+
+class Negate extends Node {
+  final Node operand;
+  Negate(this.operand);
+  int accept(Visitor v) => v.visitNegate(this);
+}
+
+class Not extends Node {
+  final Node operand;
+  Not(this.operand);
+  int accept(Visitor v) => v.visitNot(this);
+}
+
+class Add extends Node {
+  final Node left;
+  final Node right;
+  Add(this.left, this.right);
+  int accept(Visitor v) => v.visitAdd(this);
+}
+
+class Sub extends Node {
+  final Node left;
+  final Node right;
+  Sub(this.left, this.right);
+  int accept(Visitor v) => v.visitSub(this);
+}
+
+class Mul extends Node {
+  final Node left;
+  final Node right;
+  Mul(this.left, this.right);
+  int accept(Visitor v) => v.visitMul(this);
+}
+
+class Less extends Node {
+  final Node left;
+  final Node right;
+  Less(this.left, this.right);
+  int accept(Visitor v) => v.visitLess(this);
+}
+
+class Conditional extends Node {
+  final Node condition;
+  final Node then;
+  final Node otherwise;
+  Conditional(this.condition, this.then, this.otherwise);
+  int accept(Visitor v) => v.visitConditional(this);
+}
+
+class Sequence extends Node {
+  final List<Node> nodes;
+  Sequence(this.nodes);
+  int accept(Visitor v) => v.visitSequence(this);
+}
+
+abstract class Visitor {
+  int visit(Node node) => node.accept(this);
+
+  int visitLiteral(Literal node);
+  int visitVariable(Variable node);
+  int visitNegate(Negate node);
+  int visitNot(Not node);
+  int visitAdd(Add node);
+  int visitSub(Sub node);
+  int visitMul(Mul node);
+  int visitLess(Less node);
+  int visitConditional(Conditional node);
+  int visitSequence(Sequence node);
+}
+
+class Evaluator extends Visitor {
+  final List<int> variables;
+  Evaluator(this.variables);
+
+  int visitLiteral(Literal node) => node.value;
+  int visitVariable(Variable node) => variables[node.index];
+  int visitNegate(Negate node) => -visit(node.operand);
+  int visitNot(Not node) => visit(node.operand) == 0 ? 1 : 0;
+  int visitAdd(Add node) => (visit(node.left) + visit(node.right)) & 0xFFFF;
+  int visitSub(Sub node) => (visit(node.left) - visit(node.right)) & 0xFFFF;
+  int visitMul(Mul node) => (visit(node.left) * visit(node.right)) & 0xFFFF;
+  int visitLess(Less node) => visit(node.left) < visit(node.right) ? 1 : 0;
+  int visitConditional(Conditional node) =>
+      visit(node.condition) != 0 ? visit(node.then) : visit(node.otherwise);
+  int visitSequence(Sequence node) {
+    int result = 0;
+    for (int i = 0; i < node.nodes.length; i++) {
+      result = visit(node.nodes[i]);
+    }
+    return result;
+  }
+}
+
+class NodeCounter extends Visitor {
+  int visitLiteral(Literal node) => 1;
+  int visitVariable(Variable node) => 1;
+  int visitNegate(Negate node) => 1 + visit(node.operand);
+  int visitNot(Not node) => 1 + visit(node.operand);
+  int visitAdd(Add node) => 1 + visit(node.left) + visit(node.right);
+  int visitSub(Sub node) => 1 + visit(node.left) + visit(node.right);
+  int visitMul(Mul node) => 1 + visit(node.left) + visit(node.right);
+  int visitLess(Less node) => 1 + visit(node.left) + visit(node.right);
+  int visitConditional(Conditional node) =>
+      1 + visit(node.condition) + visit(node.then) + visit(node.otherwise);
+  int visitSequence(Sequence node) {
+    int result = 1;
+    for (int i = 0; i < node.nodes.length; i++) {
+      result += visit(node.nodes[i]);
+    }
+    return result;
+  }
+}
+
+// Builds a deterministic pseudo random expression of the given depth.
+class TreeBuilder {
+  int seed = 17;
+
+  int next(int bound) {
+    seed = (seed * 1103515245 + 12345) & 0x7FFFFFFF;
+    return seed % bound;
+  }
+
+  Node build(int depth) {
+    if (depth == 0) {
+      return next(2) == 0 ? Literal(next(100)) : Variable(next(4));
+    }
+    switch (next(8)) {
+      case 0:
+        return Negate(build(depth - 1));
+      case 1:
+        return Not(build(depth - 1));
+      case 2:
+        return Add(build(depth - 1), build(depth - 1));
+      case 3:
+        return Sub(build(depth - 1), build(depth - 1));
+      case 4:
+        return Mul(build(depth - 1), build(depth - 1));
+      case 5:
+        return Less(build(depth - 1), build(depth - 1));
+      case 6:
+        return Conditional(
+            build(depth - 1), build(depth - 1), build(depth - 1));
+      default:
+        return Sequence([build(depth - 1), build(depth - 1)]);
+    }
+  }
+}
+
+//
+// Benchmark fixtures.
+//
+
+class Evaluate extends BenchmarkBase {
+  final List<Node> trees = List<Node>(N);
+  final Evaluator evaluator = Evaluator([3, 5, 7, 11]);
+  int expected;
+  Evaluate() : super("PolymorphicDispatch.Evaluate");
+
+  void setup() {
+    final builder = TreeBuilder();
+    for (int i = 0; i < N; i++) {
+      trees[i] = builder.build(5);
+    }
+    expected = doEvaluate();
+  }
+
+  int doEvaluate() {
+    int sum = 0;
+    for (int i = 0; i < N; i++) {
+      sum = (sum + evaluator.visit(trees[i])) & 0xFFFFFFF;
+    }
+    return sum;
+  }
+
+  void run() {
+    final int x = doEvaluate();
+    if (x != expected) {
+      throw Exception("$name: Unexpected result: $x");
+    }
+  }
+}
+
+class CountNodes extends BenchmarkBase {
+  final List<Node> trees = List<Node>(N);
+  final NodeCounter counter = NodeCounter();
+  int expected;
+  CountNodes() : super("PolymorphicDispatch.CountNodes");
+
+  void setup() {
+    final builder = TreeBuilder();
+    for (int i = 0; i < N; i++) {
+      trees[i] = builder.build(5);
+    }
+    expected = doCount();
+  }
+
+  int doCount() {
+    int sum = 0;
+    for (int i = 0; i < N; i++) {
+      sum += counter.visit(trees[i]);
+    }
+    return sum;
+  }
+
+  void run() {
+    final int x = doCount();
+    if (x != expected) {
+      throw Exception("$name: Unexpected result: $x");
+    }
+  }
+}
+
+//
+// Main driver.
+//
+
+main() {
+  final benchmarks = [
+    () => Evaluate(),
+    () => CountNodes(),
+  ];
+  benchmarks.forEach((benchmark) => benchmark().report());
+}
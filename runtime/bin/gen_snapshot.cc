@@ -122,6 +122,7 @@ static const char* kSnapshotKindNames[] = {
   V(elf, elf_filename)                                                         \
   V(load_compilation_trace, load_compilation_trace_filename)                   \
   V(load_type_feedback, load_type_feedback_filename)                           \
+  V(load_aot_profile, load_aot_profile_filename)                               \
   V(save_obfuscation_map, obfuscation_map_filename)
 
 #define BOOL_OPTIONS_LIST(V)                                                   \
@@ -204,6 +205,10 @@ static void PrintUsage() {
 "using --save-obfuscation-map=<filename> option. See dartbug.com/30524       \n"
 "for implementation details and limitations of the obfuscation pass.         \n"
 "                                                                            \n"
+"AOT snapshots can be optimized for a profile recorded by running the        \n"
+"program with `dart --save-aot-profile=<filename>` on a representative       \n"
+"workload, using the --load-aot-profile=<filename> option.                   \n"
+"                                                                            \n"
 "\n");
   if (verbose) {
     Syslog::PrintErr(
@@ -458,6 +463,16 @@ static void MaybeLoadCode() {
     free(buffer);
     CHECK_RESULT(result);
   }
+
+  if ((load_aot_profile_filename != NULL) &&
+      IsSnapshottingForPrecompilation()) {
+    uint8_t* buffer = NULL;
+    intptr_t size = 0;
+    ReadFile(load_aot_profile_filename, &buffer, &size);
+    Dart_Handle result = Dart_LoadAotProfile(buffer, size);
+    free(buffer);
+    CHECK_RESULT(result);
+  }
 }
 
 static void CreateAndWriteCoreSnapshot() {
@@ -952,13 +952,38 @@ bool RunMainIsolate(const char* script_name, CommandLineOptions* dart_options) {
       CHECK_RESULT(result);
     }
     if (Options::load_type_feedback_filename() != NULL) {
-      uint8_t* buffer = NULL;
-      intptr_t size = 0;
-      ReadFile(Options::load_type_feedback_filename(), &buffer, &size);
-      result = Dart_LoadTypeFeedback(buffer, size);
-      free(buffer);
+      // Feedback that is loaded from and saved to the same file is used as a
+      // persistent cache: it may not exist yet, and feedback left behind by a
+      // different VM is rewritten on exit. A cache is applied lazily, as
+      // functions are first compiled, to keep its cost off startup.
+      const bool is_cache =
+          (Options::save_type_feedback_filename() != NULL) &&
+          (strcmp(Options::load_type_feedback_filename(),
+                  Options::save_type_feedback_filename()) == 0);
+      if (!is_cache ||
+          File::Exists(NULL, Options::load_type_feedback_filename())) {
+        uint8_t* buffer = NULL;
+        intptr_t size = 0;
+        ReadFile(Options::load_type_feedback_filename(), &buffer, &size);
+        result = is_cache ? Dart_LoadTypeFeedbackLazily(buffer, size)
+                          : Dart_LoadTypeFeedback(buffer, size);
+        free(buffer);
+        if (is_cache && Dart_IsError(result)) {
+          Syslog::PrintErr("Ignoring type feedback: %s\n",
+                           Dart_GetError(result));
+        } else {
+          CHECK_RESULT(result);
+        }
+      }
+    }
+#if !defined(DART_PRECOMPILED_RUNTIME)
+    if (Options::isolate_template()) {
+      // Isolates spawned into the main isolate's group start from its
+      // loaded program instead of reading the kernel program again.
+      result = Dart_SetIsolateGroupTemplate();
       CHECK_RESULT(result);
     }
+#endif  // !defined(DART_PRECOMPILED_RUNTIME)
 
     // Create a closure for the main entry point which is in the exported
     // namespace of the root library or invoke a getter of the same name
@@ -1009,6 +1034,13 @@ bool RunMainIsolate(const char* script_name, CommandLineOptions* dart_options) {
       CHECK_RESULT(result);
       WriteFile(Options::save_type_feedback_filename(), buffer, size);
     }
+    if (Options::save_aot_profile_filename() != NULL) {
+      uint8_t* buffer = NULL;
+      intptr_t size = 0;
+      result = Dart_SaveAotProfile(&buffer, &size);
+      CHECK_RESULT(result);
+      WriteFile(Options::save_aot_profile_filename(), buffer, size);
+    }
   }
 
   WriteDepsFile(isolate);
@@ -28,6 +28,7 @@ namespace bin {
   V(load_compilation_trace, load_compilation_trace_filename)                   \
   V(save_type_feedback, save_type_feedback_filename)                           \
   V(load_type_feedback, load_type_feedback_filename)                           \
+  V(save_aot_profile, save_aot_profile_filename)                               \
   V(root_certs_file, root_certs_file)                                          \
   V(root_certs_cache, root_certs_cache)                                        \
   V(namespace, namespc)
@@ -45,7 +46,8 @@ namespace bin {
   V(short_socket_write, short_socket_write)                                    \
   V(disable_exit, exit_disabled)                                               \
   V(preview_dart_2, nop_option)                                                \
-  V(suppress_core_dump, suppress_core_dump)
+  V(suppress_core_dump, suppress_core_dump)                                    \
+  V(isolate_template, isolate_template)
 
 // Boolean flags that have a short form.
 #define SHORT_BOOL_OPTIONS_LIST(V)                                             \
@@ -1050,6 +1050,18 @@ DART_EXPORT void Dart_NotifyIdle(int64_t deadline);
  */
 DART_EXPORT void Dart_NotifyLowMemory();
 
+/**
+ * Sets a goal for the duration of garbage collection pauses of the current
+ * isolate, in microseconds. The VM then sizes new space, promotes objects and
+ * grows old space so that pauses stay below the goal where it can, trading
+ * memory usage and throughput for latency. A goal of 0 restores the default
+ * policies. The current state of these policies is available through the
+ * service protocol.
+ *
+ * Requires there to be a current isolate.
+ */
+DART_EXPORT void Dart_SetGCPauseTimeGoal(int64_t micros);
+
 /**
  * Starts the CPU sampling profiler.
  */
@@ -1128,6 +1140,21 @@ Dart_CreateSnapshot(uint8_t** vm_snapshot_data_buffer,
                     uint8_t** isolate_snapshot_data_buffer,
                     intptr_t* isolate_snapshot_data_size);
 
+/**
+ * Makes the current isolate the template of its isolate group.
+ *
+ * Isolates spawned into the group afterwards (with --enable-isolate-groups)
+ * are created from a snapshot of the program loaded into the current isolate
+ * instead of loading the group's kernel program again. Their static fields
+ * start out with their initial values.
+ *
+ * Requires there to be a current isolate with a root library. Not supported
+ * in the precompiled runtime.
+ *
+ * \return A valid handle if no error occurs during the operation.
+ */
+DART_EXPORT DART_WARN_UNUSED_RESULT Dart_Handle Dart_SetIsolateGroupTemplate();
+
 /**
  * Returns whether the buffer contains a kernel file.
  *
@@ -3330,7 +3357,9 @@ Dart_SaveTypeFeedback(uint8_t** buffer, intptr_t* buffer_length);
 
 /**
  * Compile functions using data from Dart_SaveTypeFeedback. The data must from a
- * VM with the same version and compiler flags.
+ * VM with the same version and compiler flags. Feedback of functions whose
+ * source changed, or whose optimized code relied on classes that have since
+ * gained subclasses or implementors, is ignored.
  *
  * \return Returns an error handle if a compilation error was encountered or a
  *   version mismatch is detected.
@@ -3338,6 +3367,44 @@ Dart_SaveTypeFeedback(uint8_t** buffer, intptr_t* buffer_length);
 DART_EXPORT DART_WARN_UNUSED_RESULT Dart_Handle
 Dart_LoadTypeFeedback(uint8_t* buffer, intptr_t buffer_length);
 
+/**
+ * Like Dart_LoadTypeFeedback, but compiles nothing. The feedback of a function
+ * is applied when the function is first compiled, and a function that was
+ * optimized when the feedback was saved is then optimized on its first call.
+ * This keeps the cost of the feedback off startup.
+ *
+ * \return Returns an error handle if a version mismatch is detected.
+ */
+DART_EXPORT DART_WARN_UNUSED_RESULT Dart_Handle
+Dart_LoadTypeFeedbackLazily(uint8_t* buffer, intptr_t buffer_length);
+
+/**
+ * Record how often call sites and branches of unoptimized code were executed
+ * in the current isolate, and which receiver classes the calls saw, as a
+ * profile for Dart_LoadAotProfile.
+ *
+ * \param buffer Returns a pointer to a buffer containing the profile.
+ *   This buffer is scope allocated and is only valid  until the next call to
+ *   Dart_ExitScope.
+ * \param size Returns the size of the buffer.
+ * \return Returns an valid handle upon success.
+ */
+DART_EXPORT DART_WARN_UNUSED_RESULT Dart_Handle
+Dart_SaveAotProfile(uint8_t** buffer, intptr_t* buffer_length);
+
+/**
+ * Use data from Dart_SaveAotProfile to guide the next Dart_Precompile:
+ * inlining decisions follow the recorded call counts, calls dispatch
+ * speculatively to the recorded receiver classes and blocks are laid out
+ * along the hot paths. The data must be from a VM with the same version.
+ * Functions that no longer exist are ignored.
+ *
+ * \return Returns an error handle if the data is not a profile or a version
+ *   mismatch is detected.
+ */
+DART_EXPORT DART_WARN_UNUSED_RESULT Dart_Handle
+Dart_LoadAotProfile(uint8_t* buffer, intptr_t buffer_length);
+
 /*
  * ==============
  * Precompilation
@@ -100,12 +100,17 @@ DEFINE_NATIVE_ENTRY(SendPortImpl_sendInternal_, 0, 2) {
 
   const Dart_Port destination_port_id = port.Id();
   const bool can_send_any_object = isolate->origin_id() == port.origin_id();
+  // Isolates of a group share the read-only data of its snapshot.
+  const bool can_share_read_only_objects =
+      PortMap::IsPortInIsolateGroup(destination_port_id, isolate->group());
 
-  if (ApiObjectConverter::CanConvert(obj.raw())) {
+  if (ApiObjectConverter::CanConvert(obj.raw()) ||
+      (can_share_read_only_objects &&
+       MessageWriter::IsSharedReadOnlyObject(isolate, obj.raw()))) {
     PortMap::PostMessage(
         Message::New(destination_port_id, obj.raw(), Message::kNormalPriority));
   } else {
-    MessageWriter writer(can_send_any_object);
+    MessageWriter writer(can_send_any_object, can_share_read_only_objects);
     // TODO(turnidge): Throw an exception when the return value is false?
     PortMap::PostMessage(writer.WriteMessage(obj, destination_port_id,
                                              Message::kNormalPriority));
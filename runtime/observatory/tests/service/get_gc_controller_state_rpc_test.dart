@@ -0,0 +1,24 @@
+// Copyright (c) 2019, the Dart project authors.  Please see the AUTHORS file
+// for details. All rights reserved. Use of this source code is governed by a
+// BSD-style license that can be found in the LICENSE file.
+
+import 'package:observatory/service_io.dart';
+import 'package:unittest/unittest.dart';
+
+import 'test_helper.dart';
+
+var tests = <IsolateTest>[
+  (Isolate isolate) async {
+    var result =
+        await isolate.invokeRpcNoUpgrade('_getGCControllerState', {});
+    expect(result['type'], equals('_GCControllerState'));
+    expect(result['new']['pauseTimeGoalMicros'], equals(0));
+    expect(result['new']['semiSpaceCapacity'], isPositive);
+    expect(result['new']['maxSemiSpaceCapacity'],
+        greaterThanOrEqualTo(result['new']['semiSpaceCapacity']));
+    expect(result['old']['pauseTimeGoalMicros'], equals(0));
+    expect(result['old']['threshold'], isPositive);
+  },
+];
+
+main(args) async => runIsolateTests(args, tests);
@@ -0,0 +1,67 @@
+// Copyright (c) 2019, the Dart project authors.  Please see the AUTHORS file
+// for details. All rights reserved. Use of this source code is governed by a
+// BSD-style license that can be found in the LICENSE file.
+
+import 'package:observatory/service_io.dart';
+import 'package:unittest/unittest.dart';
+import 'test_helper.dart';
+
+class Holder {
+  Holder next;
+  List<String> strings;
+}
+
+Holder holder;
+
+void script() {
+  // A chain of holders, each retaining its own strings.
+  for (int i = 0; i < 10; i++) {
+    holder = new Holder()
+      ..next = holder
+      ..strings = new List<String>.generate(100, (j) => '$i:$j');
+  }
+}
+
+var tests = <IsolateTest>[
+  (Isolate isolate) async {
+    var params = {
+      'limit': '100000',
+    };
+    var result = await isolate.invokeRpcNoUpgrade('_getTopRetainers', params);
+    expect(result['type'], equals('_TopRetainers'));
+    expect(result['objectCount'], isPositive);
+    expect(result['size'], isPositive);
+
+    var members = result['members'];
+    var previous = result['size'];
+    Map holderRetainers;
+    for (var member in members) {
+      expect(member['type'], equals('_ClassRetainers'));
+      expect(member['class']['type'], equals('@Class'));
+      expect(member['retainedSize'], lessThanOrEqualTo(previous));
+      expect(member['retainedSize'],
+          greaterThanOrEqualTo(member['shallowSize']));
+      previous = member['retainedSize'];
+      if (member['class']['name'] == 'Holder') {
+        holderRetainers = member;
+      }
+    }
+    expect(holderRetainers, isNotNull);
+    expect(holderRetainers['instanceCount'], equals(10));
+
+    // Holders retain their lists and strings too, each counted once. A
+    // string takes at least 16 bytes.
+    var strings = 10 * 100;
+    expect(holderRetainers['retainedSize'],
+        greaterThan(holderRetainers['shallowSize'] + strings * 16));
+    expect(holderRetainers['retainedSize'], lessThan(result['size']));
+
+    params = {
+      'limit': '1',
+    };
+    result = await isolate.invokeRpcNoUpgrade('_getTopRetainers', params);
+    expect(result['members'].length, equals(1));
+  },
+];
+
+main(args) => runIsolateTests(args, tests, testeeBefore: script);
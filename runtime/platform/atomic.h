@@ -5,6 +5,8 @@
 #ifndef RUNTIME_PLATFORM_ATOMIC_H_
 #define RUNTIME_PLATFORM_ATOMIC_H_
 
+#include <atomic>
+
 #include "platform/globals.h"
 
 #include "platform/allocation.h"
@@ -62,6 +64,29 @@ class AtomicOperations : public AllStatic {
   }
 };
 
+// A value that several threads may read and write at the same time, without
+// any ordering with respect to other memory accesses.
+template <typename T>
+class RelaxedAtomic {
+ public:
+  constexpr RelaxedAtomic() : value_() {}
+  constexpr RelaxedAtomic(T value) : value_(value) {}  // NOLINT
+
+  T load() const { return value_.load(std::memory_order_relaxed); }
+  void store(T value) { value_.store(value, std::memory_order_relaxed); }
+
+  operator T() const { return load(); }
+  T operator=(T value) {
+    store(value);
+    return value;
+  }
+
+ private:
+  std::atomic<T> value_;
+
+  DISALLOW_COPY_AND_ASSIGN(RelaxedAtomic);
+};
+
 }  // namespace dart
 
 #if defined(HOST_OS_ANDROID)
@@ -17,12 +17,16 @@
 #include "vm/clustered_snapshot.h"
 #include "vm/dart_api_impl.h"
 #include "vm/stack_frame.h"
+#include "vm/symbols.h"
 #include "vm/timer.h"
 
 using dart::bin::File;
 
 namespace dart {
 
+DECLARE_FLAG(bool, compress_snapshot_data);
+DECLARE_FLAG(int, deserialization_tasks);
+
 Benchmark* Benchmark::first_ = NULL;
 Benchmark* Benchmark::tail_ = NULL;
 const char* Benchmark::executable_ = NULL;
@@ -196,9 +200,11 @@ BENCHMARK(GenKernelKernelMaxRSS) {
 //
 // Measure creation of core isolate from a snapshot.
 //
-BENCHMARK(CorelibIsolateStartup) {
+static void RunCorelibIsolateStartup(Thread* thread,
+                                     Benchmark* benchmark,
+                                     const char* name) {
   const int kNumIterations = 1000;
-  Timer timer(true, "CorelibIsolateStartup");
+  Timer timer(true, name);
   Isolate* isolate = thread->isolate();
   Dart_ExitIsolate();
   for (int i = 0; i < kNumIterations; i++) {
@@ -211,6 +217,18 @@ BENCHMARK(CorelibIsolateStartup) {
   Dart_EnterIsolate(reinterpret_cast<Dart_Isolate>(isolate));
 }
 
+BENCHMARK(CorelibIsolateStartup) {
+  RunCorelibIsolateStartup(thread, benchmark, "CorelibIsolateStartup");
+}
+
+// As CorelibIsolateStartup, but reading the snapshot on the starting thread
+// only, for comparison.
+BENCHMARK(CorelibIsolateStartupSequentialFill) {
+  SetFlagScope<int> sfs(&FLAG_deserialization_tasks, 1);
+  RunCorelibIsolateStartup(thread, benchmark,
+                           "CorelibIsolateStartupSequentialFill");
+}
+
 //
 // Measure invocation of Dart API functions.
 //
@@ -511,7 +529,7 @@ static uint8_t* malloc_allocator(uint8_t* ptr,
   return reinterpret_cast<uint8_t*>(realloc(ptr, new_size));
 }
 
-BENCHMARK_SIZE(CoreSnapshotSize) {
+static void RunCoreSnapshotSize(Thread* thread, Benchmark* benchmark) {
   const char* kScriptChars =
       "import 'dart:async';\n"
       "import 'dart:core';\n"
@@ -550,6 +568,57 @@ BENCHMARK_SIZE(CoreSnapshotSize) {
   free(isolate_snapshot_data_buffer);
 }
 
+BENCHMARK_SIZE(CoreSnapshotSize) {
+  RunCoreSnapshotSize(thread, benchmark);
+}
+
+BENCHMARK_SIZE(CoreSnapshotCompressedSize) {
+  SetFlagScope<bool> sfs(&FLAG_compress_snapshot_data, true);
+  RunCoreSnapshotSize(thread, benchmark);
+}
+
+//
+// Measure creation of an isolate from a full snapshot of the core libraries,
+// for the cold-start cost of --compress_snapshot_data.
+//
+static void RunCoreSnapshotStartup(Thread* thread,
+                                   Benchmark* benchmark,
+                                   const char* name) {
+  uint8_t* isolate_snapshot_data_buffer;
+  {
+    TransitionNativeToVM transition(thread);
+    StackZone zone(thread);
+    HANDLESCOPE(thread);
+    FullSnapshotWriter writer(Snapshot::kFull, NULL,
+                              &isolate_snapshot_data_buffer, &malloc_allocator,
+                              NULL, NULL /* image_writer */);
+    writer.WriteFullSnapshot();
+  }
+
+  const int kNumIterations = 100;
+  Timer timer(true, name);
+  Isolate* isolate = thread->isolate();
+  Dart_ExitIsolate();
+  for (int i = 0; i < kNumIterations; i++) {
+    timer.Start();
+    TestCase::CreateTestIsolateFromSnapshot(isolate_snapshot_data_buffer);
+    timer.Stop();
+    Dart_ShutdownIsolate();
+  }
+  benchmark->set_score(timer.TotalElapsedTime() / kNumIterations);
+  Dart_EnterIsolate(reinterpret_cast<Dart_Isolate>(isolate));
+  free(isolate_snapshot_data_buffer);
+}
+
+BENCHMARK(CoreSnapshotStartup) {
+  RunCoreSnapshotStartup(thread, benchmark, "CoreSnapshotStartup");
+}
+
+BENCHMARK(CoreSnapshotCompressedStartup) {
+  SetFlagScope<bool> sfs(&FLAG_compress_snapshot_data, true);
+  RunCoreSnapshotStartup(thread, benchmark, "CoreSnapshotCompressedStartup");
+}
+
 BENCHMARK_SIZE(StandaloneSnapshotSize) {
   const char* kScriptChars =
       "import 'dart:async';\n"
@@ -705,6 +774,44 @@ BENCHMARK(SimpleMessage) {
   benchmark->set_score(elapsed_time);
 }
 
+//
+// Measure messages of strings from the VM isolate heap, which are serialized
+// or, between isolates of a group, passed by reference.
+//
+static int64_t ReadOnlyStringsMessage(Thread* thread, bool share) {
+  TransitionNativeToVM transition(thread);
+  StackZone zone(thread);
+  HANDLESCOPE(thread);
+  const intptr_t kNumStrings = Symbols::kNullCharId - 1;
+  const Array& array_object = Array::Handle(Array::New(kNumStrings));
+  for (intptr_t i = 0; i < kNumStrings; i++) {
+    array_object.SetAt(i, Symbols::Symbol(i + 1));
+  }
+  const intptr_t kLoopCount = 1000;
+  Timer timer(true, "Read-only Strings Message");
+  timer.Start();
+  for (intptr_t i = 0; i < kLoopCount; i++) {
+    StackZone zone(thread);
+    MessageWriter writer(true, share);
+    std::unique_ptr<Message> message = writer.WriteMessage(
+        array_object, ILLEGAL_PORT, Message::kNormalPriority);
+
+    // Read object back from the snapshot.
+    MessageSnapshotReader reader(message.get(), thread);
+    reader.ReadObject();
+  }
+  timer.Stop();
+  return timer.TotalElapsedTime();
+}
+
+BENCHMARK(ReadOnlyStringsMessage) {
+  benchmark->set_score(ReadOnlyStringsMessage(thread, /*share=*/false));
+}
+
+BENCHMARK(SharedReadOnlyStringsMessage) {
+  benchmark->set_score(ReadOnlyStringsMessage(thread, /*share=*/true));
+}
+
 BENCHMARK(LargeMap) {
   const char* kScript =
       "makeMap() {\n"
@@ -739,6 +846,207 @@ BENCHMARK(LargeMap) {
   benchmark->set_score(elapsed_time);
 }
 
+//
+// Measure scavenges of a young object graph with the given number of scavenger
+// tasks (0 scavenges on the main thread).
+//
+static int64_t ScavengeBenchmark(Thread* thread, intptr_t num_tasks) {
+  TransitionNativeToVM transition(thread);
+  StackZone zone(thread);
+  HANDLESCOPE(thread);
+  const intptr_t saved_scavenger_tasks = FLAG_scavenger_tasks;
+  FLAG_scavenger_tasks = num_tasks;
+  Heap* heap = thread->heap();
+  const intptr_t kNumLists = 16;
+  const intptr_t kListLength = 500;
+  const intptr_t kLoopCount = 20;
+  Array& lists = Array::Handle();
+  Array& list = Array::Handle();
+  Timer timer(true, "Scavenge");
+  for (intptr_t i = 0; i < kLoopCount; i++) {
+    // Build a fresh graph each time so that it is copied rather than promoted.
+    lists = Array::New(kNumLists, Heap::kNew);
+    for (intptr_t j = 0; j < kNumLists; j++) {
+      list = Array::New(kListLength, Heap::kNew);
+      for (intptr_t k = 0; k < kListLength; k++) {
+        list.SetAt(k, Array::Handle(Array::New(1, Heap::kNew)));
+      }
+      lists.SetAt(j, list);
+    }
+    list = Array::null();
+    timer.Start();
+    heap->CollectGarbage(Heap::kNew);
+    timer.Stop();
+  }
+  FLAG_scavenger_tasks = saved_scavenger_tasks;
+  return timer.TotalElapsedTime();
+}
+
+BENCHMARK(ScavengeSerial) {
+  benchmark->set_score(ScavengeBenchmark(thread, 0));
+}
+
+BENCHMARK(ScavengeParallel1) {
+  benchmark->set_score(ScavengeBenchmark(thread, 1));
+}
+
+BENCHMARK(ScavengeParallel2) {
+  benchmark->set_score(ScavengeBenchmark(thread, 2));
+}
+
+BENCHMARK(ScavengeParallel4) {
+  benchmark->set_score(ScavengeBenchmark(thread, 4));
+}
+
+BENCHMARK(ScavengeParallel8) {
+  benchmark->set_score(ScavengeBenchmark(thread, 8));
+}
+
+//
+// Measure allocation of small old-space objects of mixed sizes, with or
+// without thread-local old-space allocation buffers.
+//
+static int64_t OldSpaceAllocationBenchmark(Thread* thread,
+                                           intptr_t tlab_size) {
+  TransitionNativeToVM transition(thread);
+  StackZone zone(thread);
+  HANDLESCOPE(thread);
+  const intptr_t saved_old_gen_tlab_size = FLAG_old_gen_tlab_size;
+  FLAG_old_gen_tlab_size = tlab_size;
+  Heap* heap = thread->heap();
+  const intptr_t kNumObjects = 100000;
+  const intptr_t kLoopCount = 10;
+  Array& list = Array::Handle();
+  Timer timer(true, "OldSpaceAllocation");
+  for (intptr_t i = 0; i < kLoopCount; i++) {
+    heap->CollectAllGarbage();
+    list = Array::New(kNumObjects, Heap::kOld);
+    timer.Start();
+    for (intptr_t j = 0; j < kNumObjects; j++) {
+      list.SetAt(j, Array::Handle(Array::New(j % 8, Heap::kOld)));
+    }
+    timer.Stop();
+  }
+  list = Array::null();
+  FLAG_old_gen_tlab_size = saved_old_gen_tlab_size;
+  return timer.TotalElapsedTime();
+}
+
+BENCHMARK(OldSpaceAllocation) {
+  benchmark->set_score(OldSpaceAllocationBenchmark(thread, 32));
+}
+
+BENCHMARK(OldSpaceAllocationNoTLAB) {
+  benchmark->set_score(OldSpaceAllocationBenchmark(thread, 0));
+}
+
+//
+// Measure parallel scavenges that promote a young object graph, with or
+// without thread-local promotion buffers.
+//
+static int64_t PromotionBenchmark(Thread* thread, intptr_t tlab_size) {
+  TransitionNativeToVM transition(thread);
+  StackZone zone(thread);
+  HANDLESCOPE(thread);
+  const intptr_t saved_scavenger_tasks = FLAG_scavenger_tasks;
+  const intptr_t saved_old_gen_tlab_size = FLAG_old_gen_tlab_size;
+  FLAG_scavenger_tasks = 4;
+  FLAG_old_gen_tlab_size = tlab_size;
+  Heap* heap = thread->heap();
+  const intptr_t kNumLists = 16;
+  const intptr_t kListLength = 500;
+  const intptr_t kLoopCount = 20;
+  Array& lists = Array::Handle();
+  Array& list = Array::Handle();
+  Timer timer(true, "Promotion");
+  for (intptr_t i = 0; i < kLoopCount; i++) {
+    lists = Array::New(kNumLists, Heap::kNew);
+    for (intptr_t j = 0; j < kNumLists; j++) {
+      list = Array::New(kListLength, Heap::kNew);
+      for (intptr_t k = 0; k < kListLength; k++) {
+        list.SetAt(k, Array::Handle(Array::New(1, Heap::kNew)));
+      }
+      lists.SetAt(j, list);
+    }
+    list = Array::null();
+    // The first scavenge copies the graph, the second one promotes it.
+    heap->CollectGarbage(Heap::kNew);
+    timer.Start();
+    heap->CollectGarbage(Heap::kNew);
+    timer.Stop();
+  }
+  FLAG_scavenger_tasks = saved_scavenger_tasks;
+  FLAG_old_gen_tlab_size = saved_old_gen_tlab_size;
+  return timer.TotalElapsedTime();
+}
+
+BENCHMARK(PromotionParallel) {
+  benchmark->set_score(PromotionBenchmark(thread, 32));
+}
+
+BENCHMARK(PromotionParallelNoTLAB) {
+  benchmark->set_score(PromotionBenchmark(thread, 0));
+}
+
+//
+// Measure the old-space collection work done per millisecond of idle time,
+// when a collection is performed in slices by idle notifications with the
+// given budget.
+//
+static int64_t IdleGCSliceBenchmark(Thread* thread, int64_t budget_micros) {
+  TransitionNativeToVM transition(thread);
+  StackZone zone(thread);
+  HANDLESCOPE(thread);
+  Heap* heap = thread->heap();
+  PageSpace* old_space = heap->old_space();
+  if (!old_space->enable_concurrent_mark() || (FLAG_marker_tasks == 0)) {
+    return 0;
+  }
+  const intptr_t kNumObjects = 200000;
+  heap->CollectAllGarbage();
+  const Array& live = Array::Handle(Array::New(kNumObjects / 2, Heap::kOld));
+  for (intptr_t i = 0; i < kNumObjects; i++) {
+    const Array& obj = Array::Handle(Array::New(8, Heap::kOld));
+    if ((i % 2) == 0) {
+      live.SetAt(i / 2, obj);
+    }
+  }
+  const int64_t used_kb = old_space->UsedInWords() / KBInWords;
+
+  heap->StartConcurrentMarking(thread);
+  const intptr_t kMaxSlices = 100000;
+  intptr_t slices = 0;
+  while (slices < kMaxSlices) {
+    {
+      MonitorLocker ml(old_space->tasks_lock());
+      if ((old_space->phase() == PageSpace::kDone) &&
+          (old_space->tasks() == 0)) {
+        break;
+      }
+    }
+    const int64_t deadline = OS::GetCurrentMonotonicMicros() + budget_micros;
+    heap->NotifyIdle(deadline);
+    // The embedder stays idle until the deadline in any case.
+    const int64_t remaining = deadline - OS::GetCurrentMonotonicMicros();
+    if (remaining > 0) {
+      OS::SleepMicros(remaining);
+    }
+    slices++;
+  }
+  const int64_t idle_millis =
+      Utils::Maximum(static_cast<int64_t>(1),
+                     slices * budget_micros / kMicrosecondsPerMillisecond);
+  return used_kb / idle_millis;
+}
+
+BENCHMARK(IdleGCSlice1ms) {
+  benchmark->set_score(IdleGCSliceBenchmark(thread, 1000));
+}
+
+BENCHMARK(IdleGCSlice4ms) {
+  benchmark->set_score(IdleGCSliceBenchmark(thread, 4000));
+}
+
 BENCHMARK_MEMORY(InitialRSS) {
   benchmark->set_score(bin::Process::MaxRSS());
 }
@@ -533,11 +533,13 @@ void ClassHeapStats::PrintToJSONObject(const Class& cls,
   obj->AddProperty64("bytesCurrent", bytes_current);
 }
 
-void SharedClassTable::UpdateAllocatedOldGC(intptr_t cid, intptr_t size) {
+void SharedClassTable::UpdateAllocatedOldGC(intptr_t cid,
+                                            intptr_t size,
+                                            intptr_t count) {
   ClassHeapStats* stats = PreliminaryStatsAt(cid);
   ASSERT(stats != NULL);
   ASSERT(size != 0);
-  stats->recent.AddOldGC(size);
+  stats->recent.AddOldGC(size, count);
 }
 
 void SharedClassTable::UpdateAllocatedExternalNew(intptr_t cid, intptr_t size) {
@@ -693,11 +695,14 @@ void SharedClassTable::UpdateLiveNew(intptr_t cid, intptr_t size) {
   stats->post_gc.AddNew(size);
 }
 
-void SharedClassTable::UpdateLiveNewGC(intptr_t cid, intptr_t size) {
+void SharedClassTable::UpdateLiveNewGC(intptr_t cid,
+                                       intptr_t size,
+                                       intptr_t count) {
   ClassHeapStats* stats = PreliminaryStatsAt(cid);
   ASSERT(stats != NULL);
   ASSERT(size >= 0);
-  stats->post_gc.AddNewGC(size);
+  ASSERT(count >= 0);
+  stats->post_gc.AddNewGC(size, count);
 }
 
 void SharedClassTable::UpdateLiveOldExternal(intptr_t cid, intptr_t size) {
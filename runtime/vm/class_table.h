@@ -66,8 +66,8 @@ class AllocStats {
     AtomicOperations::IncrementBy(&new_size, size);
   }
 
-  void AddNewGC(T size) {
-    new_count += 1;
+  void AddNewGC(T size, T count = 1) {
+    new_count += count;
     new_size += size;
   }
 
@@ -250,7 +250,7 @@ class SharedClassTable {
     ASSERT(size != 0);
     stats->recent.AddOld(size);
   }
-  void UpdateAllocatedOldGC(intptr_t cid, intptr_t size);
+  void UpdateAllocatedOldGC(intptr_t cid, intptr_t size, intptr_t count = 1);
   void UpdateAllocatedExternalNew(intptr_t cid, intptr_t size);
   void UpdateAllocatedExternalOld(intptr_t cid, intptr_t size);
 
@@ -321,7 +321,7 @@ class SharedClassTable {
   }
   void UpdateLiveOld(intptr_t cid, intptr_t size, intptr_t count = 1);
   void UpdateLiveNew(intptr_t cid, intptr_t size);
-  void UpdateLiveNewGC(intptr_t cid, intptr_t size);
+  void UpdateLiveNewGC(intptr_t cid, intptr_t size, intptr_t count = 1);
   void UpdateLiveOldExternal(intptr_t cid, intptr_t size);
   void UpdateLiveNewExternal(intptr_t cid, intptr_t size);
 
@@ -5,6 +5,7 @@
 #include "vm/clustered_snapshot.h"
 
 #include "platform/assert.h"
+#include "platform/atomic.h"
 #include "vm/bootstrap.h"
 #include "vm/class_id.h"
 #include "vm/code_observers.h"
@@ -13,12 +14,14 @@
 #include "vm/dart.h"
 #include "vm/heap/heap.h"
 #include "vm/image_snapshot.h"
+#include "vm/lz4.h"
 #include "vm/native_entry.h"
 #include "vm/object.h"
 #include "vm/object_store.h"
 #include "vm/program_visitor.h"
 #include "vm/stub_code.h"
 #include "vm/symbols.h"
+#include "vm/thread_pool.h"
 #include "vm/timeline.h"
 #include "vm/version.h"
 
@@ -26,6 +29,31 @@
 
 namespace dart {
 
+DEFINE_FLAG(int,
+            deserialization_tasks,
+            4,
+            "Maximum number of threads reading the fills of the clusters of "
+            "an isolate snapshot. 1 reads them on the starting thread only.");
+
+// Below this many bytes of fills that can be read concurrently, starting
+// helper threads does not pay off.
+static const intptr_t kMinConcurrentFillSize = 256 * KB;
+
+DEFINE_FLAG(bool,
+            compress_snapshot_data,
+            false,
+            "Compress the clustered data of isolate snapshots. Trades a "
+            "smaller snapshot for decompressing it at isolate startup.");
+
+#if defined(DART_PRECOMPILER)
+DEFINE_FLAG(bool,
+            lazy_exception_handlers,
+            false,
+            "Leave the exception handler tables of AOT snapshots in the mapped "
+            "read-only image instead of copying them into the heap at "
+            "startup.");
+#endif
+
 #if defined(DART_PRECOMPILER) && !defined(TARGET_ARCH_IA32) &&                 \
     !defined(TARGET_ARCH_DBC)
 
@@ -376,6 +404,8 @@ class TypeArgumentsDeserializationCluster : public DeserializationCluster {
       }
     }
   }
+
+  bool CanFillConcurrently() const { return true; }
 };
 
 #if !defined(DART_PRECOMPILED_RUNTIME)
@@ -584,6 +614,8 @@ class FunctionDeserializationCluster : public DeserializationCluster {
     }
   }
 
+  bool CanFillConcurrently() const { return true; }
+
   void PostLoad(const Array& refs, Snapshot::Kind kind, Zone* zone) {
     if (kind == Snapshot::kFullAOT) {
       Function& func = Function::Handle(zone);
@@ -1143,6 +1175,8 @@ class ScriptDeserializationCluster : public DeserializationCluster {
       script->ptr()->load_timestamp_ = 0;
     }
   }
+
+  bool CanFillConcurrently() const { return true; }
 };
 
 #if !defined(DART_PRECOMPILED_RUNTIME)
@@ -1829,7 +1863,7 @@ class ObjectPoolDeserializationCluster : public DeserializationCluster {
 };
 
 #if !defined(DART_PRECOMPILED_RUNTIME)
-// PcDescriptor, StackMap, OneByteString, TwoByteString
+// PcDescriptor, StackMap, OneByteString, TwoByteString, ExceptionHandlers
 class RODataSerializationCluster : public SerializationCluster {
  public:
   RODataSerializationCluster(const char* name, intptr_t cid)
@@ -1858,6 +1892,9 @@ class RODataSerializationCluster : public SerializationCluster {
 
   void WriteAlloc(Serializer* s) {
     s->WriteCid(cid_);
+    if (cid_ == kExceptionHandlersCid) {
+      s->Write<bool>(/*read_only=*/true);
+    }
     intptr_t count = shared_objects_.length();
     s->WriteUnsigned(count);
     for (intptr_t i = 0; i < count; i++) {
@@ -1946,6 +1983,7 @@ class ExceptionHandlersSerializationCluster : public SerializationCluster {
 
   void WriteAlloc(Serializer* s) {
     s->WriteCid(kExceptionHandlersCid);
+    s->Write<bool>(/*read_only=*/false);
     intptr_t count = objects_.length();
     s->WriteUnsigned(count);
     for (intptr_t i = 0; i < count; i++) {
@@ -2099,6 +2137,8 @@ class ContextDeserializationCluster : public DeserializationCluster {
       }
     }
   }
+
+  bool CanFillConcurrently() const { return true; }
 };
 
 #if !defined(DART_PRECOMPILED_RUNTIME)
@@ -2368,6 +2408,8 @@ class ICDataDeserializationCluster : public DeserializationCluster {
       ic->ptr()->state_bits_ = d->Read<int32_t>();
     }
   }
+
+  bool CanFillConcurrently() const { return true; }
 };
 
 #if !defined(DART_PRECOMPILED_RUNTIME)
@@ -2770,6 +2812,8 @@ class InstanceDeserializationCluster : public DeserializationCluster {
     }
   }
 
+  bool CanFillConcurrently() const { return true; }
+
  private:
   const intptr_t cid_;
   intptr_t next_field_offset_in_words_;
@@ -2956,6 +3000,8 @@ class TypeDeserializationCluster : public DeserializationCluster {
     }
   }
 
+  bool CanFillConcurrently() const { return true; }
+
   void PostLoad(const Array& refs, Snapshot::Kind kind, Zone* zone) {
     Type& type = Type::Handle(zone);
     Code& stub = Code::Handle(zone);
@@ -3052,6 +3098,8 @@ class TypeRefDeserializationCluster : public DeserializationCluster {
     }
   }
 
+  bool CanFillConcurrently() const { return true; }
+
   void PostLoad(const Array& refs, Snapshot::Kind kind, Zone* zone) {
     TypeRef& type_ref = TypeRef::Handle(zone);
     Code& stub = Code::Handle(zone);
@@ -3144,6 +3192,8 @@ class TypeParameterDeserializationCluster : public DeserializationCluster {
     }
   }
 
+  bool CanFillConcurrently() const { return true; }
+
   void PostLoad(const Array& refs, Snapshot::Kind kind, Zone* zone) {
     TypeParameter& type_param = TypeParameter::Handle(zone);
     Code& stub = Code::Handle(zone);
@@ -3226,6 +3276,8 @@ class ClosureDeserializationCluster : public DeserializationCluster {
       ReadFromTo(closure);
     }
   }
+
+  bool CanFillConcurrently() const { return true; }
 };
 
 #if !defined(DART_PRECOMPILED_RUNTIME)
@@ -3375,6 +3427,8 @@ class DoubleDeserializationCluster : public DeserializationCluster {
       dbl->ptr()->value_ = d->Read<double>();
     }
   }
+
+  bool CanFillConcurrently() const { return true; }
 };
 
 #if !defined(DART_PRECOMPILED_RUNTIME)
@@ -3525,6 +3579,8 @@ class TypedDataDeserializationCluster : public DeserializationCluster {
     }
   }
 
+  bool CanFillConcurrently() const { return true; }
+
  private:
   const intptr_t cid_;
 };
@@ -4089,6 +4145,8 @@ class ArrayDeserializationCluster : public DeserializationCluster {
     }
   }
 
+  bool CanFillConcurrently() const { return true; }
+
  private:
   const intptr_t cid_;
 };
@@ -4168,6 +4226,8 @@ class OneByteStringDeserializationCluster : public DeserializationCluster {
       }
     }
   }
+
+  bool CanFillConcurrently() const { return true; }
 };
 
 #if !defined(DART_PRECOMPILED_RUNTIME)
@@ -4244,6 +4304,8 @@ class TwoByteStringDeserializationCluster : public DeserializationCluster {
       d->ReadBytes(cdata, length * 2);
     }
   }
+
+  bool CanFillConcurrently() const { return true; }
 };
 
 #if !defined(DART_PRECOMPILED_RUNTIME)
@@ -4376,6 +4438,16 @@ SerializationCluster* Serializer::NewClusterForClass(intptr_t cid) {
         return new (Z) RODataSerializationCluster("(RO)OneByteString", cid);
       case kTwoByteStringCid:
         return new (Z) RODataSerializationCluster("(RO)TwoByteString", cid);
+#if defined(DART_PRECOMPILER)
+      case kExceptionHandlersCid:
+        // The handlers are only read when an exception unwinds through
+        // their code, so they stay in the image until then.
+        if ((kind_ == Snapshot::kFullAOT) && FLAG_lazy_exception_handlers) {
+          return new (Z)
+              RODataSerializationCluster("(RO)ExceptionHandlers", cid);
+        }
+        break;
+#endif
     }
   }
 
@@ -4665,6 +4737,28 @@ void Serializer::WriteVersionAndFeatures(bool is_vm_snapshot) {
   free(const_cast<char*>(expected_features));
 }
 
+void Serializer::CompressData(intptr_t start) {
+  const intptr_t size = stream_.bytes_written() - start;
+  uint8_t* data = reinterpret_cast<uint8_t*>(malloc(size));
+  memmove(data, stream_.buffer() + start, size);
+  uint8_t* chunk = reinterpret_cast<uint8_t*>(
+      malloc(LZ4::CompressBound(kCompressedChunkSize)));
+
+  stream_.SetPosition(start);
+  WriteUnsigned(size);
+  for (intptr_t offset = 0; offset < size; offset += kCompressedChunkSize) {
+    const intptr_t length =
+        Utils::Minimum(kCompressedChunkSize, size - offset);
+    const intptr_t compressed_length =
+        LZ4::Compress(data + offset, length, chunk);
+    WriteUnsigned(compressed_length);
+    WriteBytes(chunk, compressed_length);
+  }
+
+  free(chunk);
+  free(data);
+}
+
 #if defined(DEBUG)
 static const int32_t kSectionMarker = 0xABAB;
 #endif
@@ -4763,7 +4857,15 @@ void Serializer::Serialize() {
   for (intptr_t cid = 1; cid < num_cids_; cid++) {
     SerializationCluster* cluster = clusters_by_cid_[cid];
     if (cluster != NULL) {
+      // Prefix the fill with its size, which is only known once written.
+      const intptr_t size_position = stream_.Position();
+      stream_.WriteFixed<uint32_t>(0);
       cluster->WriteAndMeasureFill(this);
+      const intptr_t end_position = stream_.Position();
+      stream_.SetPosition(size_position);
+      stream_.WriteFixed<uint32_t>(end_position - size_position -
+                                   sizeof(uint32_t));
+      stream_.SetPosition(end_position);
 #if defined(DEBUG)
       Write<int32_t>(kSectionMarker);
 #endif
@@ -4973,6 +5075,22 @@ Deserializer::Deserializer(Thread* thread,
   stream_.SetPosition(offset);
 }
 
+Deserializer::Deserializer(Deserializer* parent,
+                           const uint8_t* buffer,
+                           intptr_t size)
+    : ThreadStackResource(Thread::Current()),
+      heap_(parent->heap_),
+      zone_(NULL),
+      kind_(parent->kind_),
+      stream_(buffer, size),
+      image_reader_(parent->image_reader_),
+      num_base_objects_(parent->num_base_objects_),
+      num_objects_(parent->num_objects_),
+      num_clusters_(0),
+      refs_(parent->refs_),
+      next_ref_index_(parent->next_ref_index_),
+      clusters_(NULL) {}
+
 Deserializer::~Deserializer() {
   delete[] clusters_;
 }
@@ -5034,8 +5152,14 @@ DeserializationCluster* Deserializer::ReadCluster() {
     case kCodeSourceMapCid:
     case kStackMapCid:
       return new (Z) RODataDeserializationCluster();
-    case kExceptionHandlersCid:
-      return new (Z) ExceptionHandlersDeserializationCluster();
+    case kExceptionHandlersCid: {
+      const bool read_only = Read<bool>();
+      if (read_only) {
+        return new (Z) RODataDeserializationCluster();
+      } else {
+        return new (Z) ExceptionHandlersDeserializationCluster();
+      }
+    }
     case kContextCid:
       return new (Z) ContextDeserializationCluster();
     case kContextScopeCid:
@@ -5242,7 +5366,7 @@ void Deserializer::Prepare() {
   refs_ = Array::New(num_objects_ + 1, Heap::kOld);
 }
 
-void Deserializer::Deserialize() {
+void Deserializer::Deserialize(bool concurrent_fill) {
   if (num_base_objects_ != (next_ref_index_ - 1)) {
     FATAL2("Snapshot expects %" Pd
            " base objects, but deserializer provided %" Pd,
@@ -5261,13 +5385,135 @@ void Deserializer::Deserialize() {
   // We should have completely filled the ref array.
   ASSERT((next_ref_index_ - 1) == num_objects_);
 
+  // Locate the fills, each prefixed by its size.
+  fill_positions_ = zone_->Alloc<intptr_t>(num_clusters_);
+  fill_sizes_ = zone_->Alloc<intptr_t>(num_clusters_);
+  intptr_t concurrent_fill_size = 0;
   for (intptr_t i = 0; i < num_clusters_; i++) {
-    clusters_[i]->ReadFill(this);
+    uint32_t size;
+    ReadBytes(reinterpret_cast<uint8_t*>(&size), sizeof(size));
+    fill_positions_[i] = stream_.Position();
+    fill_sizes_[i] = size;
+    Advance(size);
+    if (clusters_[i]->CanFillConcurrently()) {
+      concurrent_fill_size += size;
+    }
 #if defined(DEBUG)
     int32_t section_marker = Read<int32_t>();
     ASSERT(section_marker == kSectionMarker);
 #endif
   }
+  const intptr_t end_position = stream_.Position();
+
+  if (concurrent_fill && (FLAG_deserialization_tasks > 1) &&
+      (concurrent_fill_size >= kMinConcurrentFillSize)) {
+    ReadConcurrentFills();
+  } else {
+    for (intptr_t i = 0; i < num_clusters_; i++) {
+      ReadClusterFill(i);
+    }
+  }
+
+  stream_.SetPosition(end_position);
+}
+
+void Deserializer::ReadClusterFill(intptr_t cluster_index) {
+  stream_.SetPosition(fill_positions_[cluster_index]);
+  clusters_[cluster_index]->ReadFill(this);
+  ASSERT(stream_.Position() ==
+         fill_positions_[cluster_index] + fill_sizes_[cluster_index]);
+}
+
+class DeserializationFillTask : public ThreadPool::Task {
+ public:
+  DeserializationFillTask(Deserializer* deserializer,
+                          const uint8_t* buffer,
+                          Monitor* monitor,
+                          intptr_t* pending_tasks)
+      : deserializer_(deserializer),
+        buffer_(buffer),
+        monitor_(monitor),
+        pending_tasks_(pending_tasks) {}
+
+  virtual void Run() {
+    deserializer_->ReadNextConcurrentFills(buffer_);
+
+    MonitorLocker ml(monitor_);
+    (*pending_tasks_)--;
+    ml.Notify();
+  }
+
+ private:
+  Deserializer* deserializer_;
+  const uint8_t* buffer_;
+  Monitor* monitor_;
+  intptr_t* pending_tasks_;
+
+  DISALLOW_COPY_AND_ASSIGN(DeserializationFillTask);
+};
+
+void Deserializer::ReadConcurrentFills() {
+  // Hand out the largest fills first to balance the work of the tasks.
+  concurrent_fills_ = zone_->Alloc<intptr_t>(num_clusters_);
+  num_concurrent_fills_ = 0;
+  for (intptr_t i = 0; i < num_clusters_; i++) {
+    if (!clusters_[i]->CanFillConcurrently()) {
+      continue;
+    }
+    intptr_t j = num_concurrent_fills_++;
+    while ((j > 0) &&
+           (fill_sizes_[concurrent_fills_[j - 1]] < fill_sizes_[i])) {
+      concurrent_fills_[j] = concurrent_fills_[j - 1];
+      j--;
+    }
+    concurrent_fills_[j] = i;
+  }
+  next_concurrent_fill_ = 0;
+
+  const uint8_t* buffer = CurrentBufferAddress() - stream_.Position();
+  Monitor monitor;
+  intptr_t pending_tasks = 0;
+  const intptr_t num_tasks = Utils::Minimum<intptr_t>(
+      FLAG_deserialization_tasks - 1, num_concurrent_fills_ - 1);
+  for (intptr_t i = 0; i < num_tasks; i++) {
+    {
+      MonitorLocker ml(&monitor);
+      pending_tasks++;
+    }
+    if (!Dart::thread_pool()->Run<DeserializationFillTask>(
+            this, buffer, &monitor, &pending_tasks)) {
+      MonitorLocker ml(&monitor);
+      pending_tasks--;
+    }
+  }
+
+  // The fills that need the isolate are read here, after which this thread
+  // helps with the remaining concurrent ones.
+  for (intptr_t i = 0; i < num_clusters_; i++) {
+    if (!clusters_[i]->CanFillConcurrently()) {
+      ReadClusterFill(i);
+    }
+  }
+  ReadNextConcurrentFills(buffer);
+
+  MonitorLocker ml(&monitor);
+  while (pending_tasks > 0) {
+    ml.Wait();
+  }
+}
+
+void Deserializer::ReadNextConcurrentFills(const uint8_t* buffer) {
+  while (true) {
+    const intptr_t next =
+        AtomicOperations::FetchAndIncrement(&next_concurrent_fill_);
+    if (next >= num_concurrent_fills_) {
+      break;
+    }
+    const intptr_t i = concurrent_fills_[next];
+    Deserializer fill(this, buffer + fill_positions_[i], fill_sizes_[i]);
+    clusters_[i]->ReadFill(&fill);
+    ASSERT(fill.stream_.PendingBytes() == 0);
+  }
 }
 
 class HeapLocker : public StackResource {
@@ -5403,7 +5649,7 @@ void Deserializer::ReadIsolateSnapshot(ObjectStore* object_store) {
       AddBaseObject(base_objects.At(i));
     }
 
-    Deserialize();
+    Deserialize(/*concurrent_fill=*/true);
 
     // Read roots.
     RawObject** from = object_store->from();
@@ -5529,9 +5775,14 @@ void FullSnapshotWriter::WriteIsolateSnapshot(intptr_t num_base_objects) {
 
   serializer.ReserveHeader();
   serializer.WriteVersionAndFeatures(false);
+  serializer.stream()->WriteFixed<uint8_t>(FLAG_compress_snapshot_data);
+  const intptr_t data_start = serializer.bytes_written();
   // Isolate snapshot roots are:
   // - the object store
   serializer.WriteIsolateSnapshot(num_base_objects, object_store);
+  if (FLAG_compress_snapshot_data) {
+    serializer.CompressData(data_start);
+  }
   serializer.FillHeader(serializer.kind());
   clustered_isolate_size_ = serializer.bytes_written();
 
@@ -5681,6 +5932,64 @@ RawApiError* FullSnapshotReader::ReadVMSnapshot() {
   return ApiError::null();
 }
 
+// Reads an unsigned value like ReadStream::ReadUnsigned, but fails instead of
+// reading past the end of the stream.
+static bool ReadUnsignedInBounds(ReadStream* stream, intptr_t* value) {
+  const uint8_t* current = stream->AddressOfCurrentPosition();
+  const intptr_t pending = stream->PendingBytes();
+  for (intptr_t i = 0; i < pending; i++) {
+    if (current[i] > kMaxUnsignedDataPerByte) {
+      *value = stream->ReadUnsigned();
+      return *value >= 0;
+    }
+  }
+  return false;
+}
+
+// Decompresses the data written by Serializer::CompressData into a malloc()ed
+// buffer, one chunk at a time.
+//
+// Returns null on success and a malloc()ed error on failure.
+static char* DecompressSnapshotData(const uint8_t* buffer,
+                                    intptr_t size,
+                                    uint8_t** data,
+                                    intptr_t* data_size) {
+  ReadStream stream(buffer, size);
+  intptr_t length = 0;
+  if (!ReadUnsignedInBounds(&stream, &length) || (length == 0) ||
+      (length > LZ4::DecompressBound(stream.PendingBytes()))) {
+    return strdup("Malformed compressed snapshot data");
+  }
+  uint8_t* result = reinterpret_cast<uint8_t*>(malloc(length));
+  if (result == nullptr) {
+    return strdup("Out of memory decompressing snapshot data");
+  }
+  intptr_t offset = 0;
+  while (offset < length) {
+    intptr_t compressed_length = 0;
+    if (!ReadUnsignedInBounds(&stream, &compressed_length) ||
+        (compressed_length == 0) ||
+        (compressed_length > stream.PendingBytes())) {
+      break;
+    }
+    const intptr_t chunk_length = LZ4::Decompress(
+        stream.AddressOfCurrentPosition(), compressed_length, result + offset,
+        Utils::Minimum(Serializer::kCompressedChunkSize, length - offset));
+    if (chunk_length <= 0) {
+      break;
+    }
+    stream.Advance(compressed_length);
+    offset += chunk_length;
+  }
+  if (offset != length) {
+    free(result);
+    return strdup("Malformed compressed snapshot data");
+  }
+  *data = result;
+  *data_size = length;
+  return nullptr;
+}
+
 RawApiError* FullSnapshotReader::ReadIsolateSnapshot() {
   SnapshotHeaderReader header_reader(kind_, buffer_, size_);
   intptr_t offset = 0;
@@ -5690,7 +5999,29 @@ RawApiError* FullSnapshotReader::ReadIsolateSnapshot() {
     return ConvertToApiError(error);
   }
 
-  Deserializer deserializer(thread_, kind_, buffer_, size_, data_image_,
+  const uint8_t* buffer = buffer_;
+  intptr_t size = size_;
+  if (offset >= size_) {
+    return ConvertToApiError(strdup("Truncated snapshot data"));
+  }
+  const bool compressed = buffer_[offset++] != 0;
+  if (compressed) {
+    // The snapshot may be mapped read-only, so the data is decompressed into
+    // a buffer of the isolate: external typed data points into it.
+    uint8_t* data = nullptr;
+    intptr_t data_size = 0;
+    error = DecompressSnapshotData(buffer_ + offset, size_ - offset, &data,
+                                   &data_size);
+    if (error != nullptr) {
+      return ConvertToApiError(error);
+    }
+    thread_->isolate()->set_snapshot_data(data);
+    buffer = data;
+    size = data_size;
+    offset = 0;
+  }
+
+  Deserializer deserializer(thread_, kind_, buffer, size, data_image_,
                             instructions_image_, shared_data_image_,
                             shared_instructions_image_, offset);
   RawApiError* api_error = deserializer.VerifyImageAlignment();
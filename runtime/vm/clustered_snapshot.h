@@ -49,6 +49,12 @@ class ImageReader;
 // Finally, each cluster is given an opportunity to perform some fix-ups that
 // require the graph has been fully loaded, such as rehashing, though most
 // clusters do not require fixups.
+//
+// The fill of each cluster is prefixed by its size in bytes. Since the
+// allocation section has assigned every ref before any fill is read, and a
+// fill only writes the objects of its own cluster, the deserializer can
+// locate all fills up front and read those of clusters that need no isolate
+// state on several threads at once (see FLAG_deserialization_tasks).
 
 class SerializationCluster : public ZoneAllocated {
  public:
@@ -96,6 +102,12 @@ class DeserializationCluster : public ZoneAllocated {
   // as rehashing.
   virtual void PostLoad(const Array& refs, Snapshot::Kind kind, Zone* zone) {}
 
+  // Whether ReadFill may run on a helper thread, concurrently with the fills
+  // of other clusters. Such a fill only reads the stream and refs and stores
+  // into the raw objects of the cluster: it may not use handles, the zone,
+  // the isolate or the heap of the deserializer, nor align the stream.
+  virtual bool CanFillConcurrently() const { return false; }
+
  protected:
   // The range of the ref array that belongs to this cluster.
   intptr_t start_index_;
@@ -215,6 +227,12 @@ class Serializer : public ThreadStackResource {
 
   void WriteVersionAndFeatures(bool is_vm_snapshot);
 
+  // Replaces the bytes written since [start] by a sequence of LZ4 blocks of
+  // at most kCompressedChunkSize uncompressed bytes each, preceded by the
+  // total uncompressed size.
+  void CompressData(intptr_t start);
+  static const intptr_t kCompressedChunkSize = 256 * KB;
+
   void Serialize();
   WriteStream* stream() { return &stream_; }
   intptr_t bytes_written() { return stream_.bytes_written(); }
@@ -553,7 +571,7 @@ class Deserializer : public ThreadStackResource {
   void SkipHeader() { stream_.SetPosition(Snapshot::kHeaderSize); }
 
   void Prepare();
-  void Deserialize();
+  void Deserialize(bool concurrent_fill = false);
 
   DeserializationCluster* ReadCluster();
 
@@ -577,6 +595,16 @@ class Deserializer : public ThreadStackResource {
   intptr_t code_order_length() const { return code_order_length_; }
 
  private:
+  friend class DeserializationFillTask;
+
+  // Reads the fill of a single cluster, given in [buffer], on the current
+  // thread, which may be a helper thread without an isolate.
+  Deserializer(Deserializer* parent, const uint8_t* buffer, intptr_t size);
+
+  void ReadClusterFill(intptr_t cluster_index);
+  void ReadConcurrentFills();
+  void ReadNextConcurrentFills(const uint8_t* buffer);
+
   Heap* heap_;
   Zone* zone_;
   Snapshot::Kind kind_;
@@ -589,6 +617,15 @@ class Deserializer : public ThreadStackResource {
   RawArray* refs_;
   intptr_t next_ref_index_;
   DeserializationCluster** clusters_;
+
+  // The stream positions and sizes of the fills of the clusters, and the
+  // clusters whose fills are read concurrently in the order they are handed
+  // out to the tasks.
+  intptr_t* fill_positions_ = nullptr;
+  intptr_t* fill_sizes_ = nullptr;
+  intptr_t* concurrent_fills_ = nullptr;
+  intptr_t num_concurrent_fills_ = 0;
+  intptr_t next_concurrent_fill_ = 0;
 };
 
 #define ReadFromTo(obj, ...) d->ReadFromTo(obj, ##__VA_ARGS__);
@@ -6,6 +6,7 @@
 
 #include "vm/compiler/jit/compiler.h"
 #include "vm/globals.h"
+#include "vm/hash_table.h"
 #include "vm/log.h"
 #include "vm/longjump.h"
 #include "vm/object_store.h"
@@ -427,6 +428,84 @@ void CompilationTraceLoader::SpeculateInstanceCallTargets(
   }
 }
 
+class FunctionKeyTraits {
+ public:
+  static const char* Name() { return "FunctionKeyTraits"; }
+  static bool ReportStats() { return false; }
+
+  static bool IsMatch(const Object& a, const Object& b) {
+    return a.raw() == b.raw();
+  }
+
+  static uword Hash(const Object& key) { return Function::Cast(key).Hash(); }
+};
+
+// Maps functions to the class ids their current optimized code guards
+// through CHA.
+typedef UnorderedHashMap<FunctionKeyTraits> GuardedClassesMap;
+
+// Maps functions to their lazily loaded feedback, see
+// TypeFeedbackLoader::ApplyPendingFeedback.
+typedef UnorderedHashMap<FunctionKeyTraits> PendingFeedbackMap;
+
+// Counts the finalized subclasses of [cls], which bounds what CHA may have
+// concluded about it.
+static intptr_t NumSubclasses(const Class& cls) {
+  const GrowableObjectArray& subclasses =
+      GrowableObjectArray::Handle(cls.direct_subclasses());
+  if (subclasses.IsNull()) {
+    return 0;
+  }
+  Class& subclass = Class::Handle();
+  intptr_t count = 0;
+  for (intptr_t i = 0; i < subclasses.Length(); i++) {
+    subclass ^= subclasses.At(i);
+    count += 1 + NumSubclasses(subclass);
+  }
+  return count;
+}
+
+// Whether a class that optimized code relied on through CHA has gained
+// subclasses or implementors since the code was compiled.
+static bool HasGuardedClassChanged(const Class& cls,
+                                   intptr_t num_subclasses,
+                                   bool was_implemented) {
+  return cls.IsNull() || (NumSubclasses(cls) > num_subclasses) ||
+         (cls.is_implemented() && !was_implemented);
+}
+
+// Adds [count] calls with the argument classes [cids] to [call_site].
+static void AddFeedbackCheck(Thread* thread,
+                             const ICData& call_site,
+                             const GrowableArray<intptr_t>& cids,
+                             intptr_t count) {
+  intptr_t reuse_index = call_site.FindCheck(cids);
+  if (reuse_index != -1) {
+    call_site.IncrementCountAt(reuse_index, count);
+    return;
+  }
+  Zone* zone = thread->zone();
+  const Class& cls =
+      Class::Handle(zone, thread->isolate()->class_table()->At(cids[0]));
+  // Use target name and args descriptor from the current program instead of
+  // saved feedback to get the correct private mangling and ensure no arity
+  // mismatch crashes.
+  const String& target_name = String::Handle(zone, call_site.target_name());
+  const Array& args_desc =
+      Array::Handle(zone, call_site.arguments_descriptor());
+  const Function& target = Function::Handle(
+      zone, Resolver::ResolveDynamicForReceiverClass(
+                cls, target_name, ArgumentsDescriptor(args_desc)));
+  if (target.IsNull()) {
+    return;
+  }
+  if (cids.length() == 1) {
+    call_site.AddReceiverCheck(cids[0], target, count);
+  } else {
+    call_site.AddCheck(cids, target, count);
+  }
+}
+
 TypeFeedbackSaver::TypeFeedbackSaver(WriteStream* stream)
     : stream_(stream),
       cls_(Class::Handle()),
@@ -436,7 +515,9 @@ TypeFeedbackSaver::TypeFeedbackSaver(WriteStream* stream)
       field_(Field::Handle()),
       code_(Code::Handle()),
       call_sites_(Array::Handle()),
-      call_site_(ICData::Handle()) {}
+      call_site_(ICData::Handle()),
+      guarded_classes_(Array::Handle()),
+      guarded_cids_(GrowableObjectArray::Handle()) {}
 
 // These flags affect deopt ids.
 static char* CompilerFlags() {
@@ -533,6 +614,29 @@ void TypeFeedbackSaver::Visit(const Function& function) {
 
   WriteInt(function.inlining_depth());
 
+  WriteInt(function.SourceFingerprint());
+  WriteInt(cls_.SourceFingerprint());
+
+  guarded_cids_ = GrowableObjectArray::null();
+  if (code_.is_optimized()) {
+    if (guarded_classes_.IsNull()) {
+      CollectGuardedClasses();
+    }
+    GuardedClassesMap map(guarded_classes_.raw());
+    guarded_cids_ ^= map.GetOrNull(function);
+    map.Release();
+  }
+  ClassTable* table = Isolate::Current()->class_table();
+  const intptr_t num_guarded_classes =
+      guarded_cids_.IsNull() ? 0 : guarded_cids_.Length();
+  WriteInt(num_guarded_classes);
+  for (intptr_t i = 0; i < num_guarded_classes; i++) {
+    cls_ = table->At(Smi::Value(Smi::RawCast(guarded_cids_.At(i))));
+    WriteClassByName(cls_);
+    WriteInt(NumSubclasses(cls_));
+    WriteInt(static_cast<intptr_t>(cls_.is_implemented()));
+  }
+
   call_sites_ = function.ic_data_array();
   if (call_sites_.IsNull()) {
     call_sites_ = Object::empty_array().raw();  // Remove edge case.
@@ -567,6 +671,48 @@ void TypeFeedbackSaver::Visit(const Function& function) {
   }
 }
 
+// Inverts the CHA dependencies of the classes once, instead of searching the
+// dependent code of every class for each optimized function.
+void TypeFeedbackSaver::CollectGuardedClasses() {
+  Zone* zone = Thread::Current()->zone();
+  ClassTable* table = Isolate::Current()->class_table();
+  Array& dependent_code = Array::Handle(zone);
+  WeakProperty& weak_property = WeakProperty::Handle(zone);
+  Object& owner = Object::Handle(zone);
+
+  GuardedClassesMap map(HashTables::New<GuardedClassesMap>(16, Heap::kOld));
+  const intptr_t num_cids = table->NumCids();
+  for (intptr_t cid = kInstanceCid; cid < num_cids; cid++) {
+    if (!table->HasValidClassAt(cid)) {
+      continue;
+    }
+    cls_ = table->At(cid);
+    dependent_code = cls_.dependent_code();
+    if (dependent_code.IsNull()) {
+      continue;
+    }
+    for (intptr_t i = 0; i < dependent_code.Length(); i++) {
+      weak_property ^= dependent_code.At(i);
+      code_ ^= weak_property.key();
+      if (code_.IsNull() || !code_.is_optimized()) {
+        continue;
+      }
+      owner = code_.owner();
+      if (!owner.IsFunction() ||
+          (Function::Cast(owner).CurrentCode() != code_.raw())) {
+        continue;  // Code that was already replaced.
+      }
+      guarded_cids_ ^= map.GetOrNull(owner);
+      if (guarded_cids_.IsNull()) {
+        guarded_cids_ = GrowableObjectArray::New(Heap::kOld);
+        map.UpdateOrInsert(owner, guarded_cids_);
+      }
+      guarded_cids_.Add(Smi::Handle(zone, Smi::New(cid)), Heap::kOld);
+    }
+  }
+  guarded_classes_ = map.Release().raw();
+}
+
 void TypeFeedbackSaver::WriteClassByName(const Class& cls) {
   lib_ = cls.library();
 
@@ -602,18 +748,24 @@ TypeFeedbackLoader::TypeFeedbackLoader(Thread* thread)
       call_sites_(Array::Handle(zone_)),
       call_site_(ICData::Handle(zone_)),
       target_name_(String::Handle(zone_)),
-      target_(Function::Handle(zone_)),
-      args_desc_(Array::Handle(zone_)),
+      guarded_cls_(Class::Handle(zone_)),
       functions_to_compile_(
           GrowableObjectArray::Handle(zone_, GrowableObjectArray::New())),
-      error_(Error::Handle(zone_)) {}
+      error_(Error::Handle(zone_)),
+      lazy_(false),
+      pending_(Array::Handle(zone_)),
+      entry_(Array::Handle(zone_)),
+      guarded_classes_(Array::Handle(zone_)),
+      sites_(Array::Handle(zone_)),
+      site_(Array::Handle(zone_)) {}
 
 TypeFeedbackLoader::~TypeFeedbackLoader() {
   delete[] cid_map_;
 }
 
-RawObject* TypeFeedbackLoader::LoadFeedback(ReadStream* stream) {
+RawObject* TypeFeedbackLoader::LoadFeedback(ReadStream* stream, bool lazy) {
   stream_ = stream;
+  lazy_ = lazy;
 
   error_ = CheckHeader();
   if (error_.IsError()) {
@@ -630,6 +782,14 @@ RawObject* TypeFeedbackLoader::LoadFeedback(ReadStream* stream) {
     return error_.raw();
   }
 
+  ObjectStore* object_store = thread_->isolate()->object_store();
+  if (lazy_) {
+    pending_ = object_store->pending_type_feedback();
+    if (pending_.IsNull()) {
+      pending_ = HashTables::New<PendingFeedbackMap>(256, Heap::kOld);
+    }
+  }
+
   while (stream_->PendingBytes() > 0) {
     error_ = LoadFunction();
     if (error_.IsError()) {
@@ -637,6 +797,20 @@ RawObject* TypeFeedbackLoader::LoadFeedback(ReadStream* stream) {
     }
   }
 
+  if (lazy_) {
+    object_store->set_pending_type_feedback(pending_);
+    // Functions that were already compiled won't go through
+    // Compiler::CompileFunction again.
+    for (intptr_t i = 0; i < functions_to_compile_.Length(); i++) {
+      func_ ^= functions_to_compile_.At(i);
+      ApplyPendingFeedback(thread_, func_);
+    }
+    if (FLAG_trace_compilation_trace) {
+      THR_Print("Done loading feedback lazily\n");
+    }
+    return Error::null();
+  }
+
   while (functions_to_compile_.Length() > 0) {
     func_ ^= functions_to_compile_.RemoveLast();
 
@@ -817,7 +991,8 @@ RawObject* TypeFeedbackLoader::LoadFunction() {
   intptr_t token_pos = ReadInt();
   intptr_t usage = ReadInt();
   intptr_t inlining_depth = ReadInt();
-  intptr_t num_call_sites = ReadInt();
+  intptr_t fingerprint = ReadInt();
+  intptr_t class_fingerprint = ReadInt();
 
   if (!skip) {
     func_ = FindFunction(kind, token_pos);
@@ -827,9 +1002,53 @@ RawObject* TypeFeedbackLoader::LoadFunction() {
         THR_Print("Missing function %s %s\n", func_name_.ToCString(),
                   Function::KindToCString(kind));
       }
+    } else if (!MatchesFingerprints(fingerprint, class_fingerprint)) {
+      skip = true;
+    }
+  }
+
+  // The optimized code of the saving process would have been deoptimized if
+  // a class it relied on through CHA had gained subclasses or implementors
+  // since, and so is the feedback it was compiled with.
+  intptr_t num_guarded_classes = ReadInt();
+  if (lazy_ && !skip) {
+    // Kept to check the class hierarchy again when the feedback is applied.
+    guarded_classes_ =
+        Array::New(num_guarded_classes * kGuardedClassLength, Heap::kOld);
+  }
+  for (intptr_t i = 0; i < num_guarded_classes; i++) {
+    guarded_cls_ = ReadClassByName();
+    intptr_t num_subclasses = ReadInt();
+    intptr_t was_implemented = ReadInt();
+    if (skip) {
+      continue;
+    }
+    if (HasGuardedClassChanged(guarded_cls_, num_subclasses,
+                               was_implemented != 0)) {
+      skip = true;
+      if (FLAG_trace_compilation_trace) {
+        THR_Print("Stale feedback %s: class hierarchy changed\n",
+                  func_.ToQualifiedCString());
+      }
+    } else if (lazy_) {
+      intptr_t index = i * kGuardedClassLength;
+      guarded_classes_.SetAt(index, guarded_cls_);
+      guarded_classes_.SetAt(index + 1,
+                             Smi::Handle(zone_, Smi::New(num_subclasses)));
+      guarded_classes_.SetAt(index + 2, was_implemented != 0
+                                            ? Bool::True()
+                                            : Bool::False());
     }
   }
 
+  intptr_t num_call_sites = ReadInt();
+
+  if (lazy_) {
+    DeferFunction(skip, num_call_sites, fingerprint, class_fingerprint, usage,
+                  inlining_depth);
+    return Error::null();
+  }
+
   if (!skip) {
     error_ = Compiler::CompileFunction(thread_, func_);
     if (error_.IsError()) {
@@ -888,26 +1107,7 @@ RawObject* TypeFeedbackLoader::LoadFunction() {
         continue;
       }
 
-      intptr_t reuse_index = call_site_.FindCheck(cids);
-      if (reuse_index == -1) {
-        cls_ = thread_->isolate()->class_table()->At(cids[0]);
-        // Use target name and args descriptor from the current program
-        // instead of saved feedback to get the correct private mangling and
-        // ensure no arity mismatch crashes.
-        target_name_ = call_site_.target_name();
-        args_desc_ = call_site_.arguments_descriptor();
-        target_ = Resolver::ResolveDynamicForReceiverClass(
-            cls_, target_name_, ArgumentsDescriptor(args_desc_));
-        if (!target_.IsNull()) {
-          if (num_checked_arguments == 1) {
-            call_site_.AddReceiverCheck(cids[0], target_, entry_usage);
-          } else {
-            call_site_.AddCheck(cids, target_, entry_usage);
-          }
-        }
-      } else {
-        call_site_.IncrementCountAt(reuse_index, entry_usage);
-      }
+      AddFeedbackCheck(thread_, call_site_, cids, entry_usage);
     }
   }
 
@@ -923,6 +1123,219 @@ RawObject* TypeFeedbackLoader::LoadFunction() {
   return Error::null();
 }
 
+// Reads the call sites of the current function and, unless [skip], records
+// its feedback in [pending_] for ApplyPendingFeedback.
+void TypeFeedbackLoader::DeferFunction(bool skip,
+                                       intptr_t num_call_sites,
+                                       intptr_t fingerprint,
+                                       intptr_t class_fingerprint,
+                                       intptr_t usage,
+                                       intptr_t inlining_depth) {
+  if (!skip) {
+    sites_ = Array::New(num_call_sites, Heap::kOld);
+  }
+  GrowableArray<intptr_t> values;
+  for (intptr_t i = 0; i < num_call_sites; i++) {
+    intptr_t deopt_id = ReadInt();
+    intptr_t rebind_rule = ReadInt();
+    target_name_ = ReadString();
+    intptr_t num_checked_arguments = ReadInt();
+    intptr_t num_entries = ReadInt();
+
+    values.Clear();
+    values.Add(deopt_id);
+    values.Add(rebind_rule);
+    values.Add(num_checked_arguments);
+    for (intptr_t entry_index = 0; entry_index < num_entries; entry_index++) {
+      intptr_t entry_usage = ReadInt();
+      intptr_t entry_start = values.length();
+      bool skip_entry = false;
+      for (intptr_t argument_index = 0; argument_index < num_checked_arguments;
+           argument_index++) {
+        intptr_t cid = cid_map_[ReadInt()];
+        values.Add(cid);
+        skip_entry = skip_entry || (cid == kIllegalCid);
+      }
+      if (skip_entry) {
+        values.TruncateTo(entry_start);
+      } else {
+        values.Add(entry_usage);
+      }
+    }
+
+    if (skip) {
+      continue;
+    }
+    site_ = Array::New(values.length(), Heap::kOld);
+    for (intptr_t j = 0; j < values.length(); j++) {
+      site_.SetAt(j, Smi::Handle(zone_, Smi::New(values[j])));
+    }
+    sites_.SetAt(i, site_);
+  }
+
+  if (skip) {
+    return;
+  }
+
+  entry_ = Array::New(kPendingEntryLength, Heap::kOld);
+  entry_.SetAt(kFingerprintIndex, Smi::Handle(zone_, Smi::New(fingerprint)));
+  entry_.SetAt(kClassFingerprintIndex,
+               Smi::Handle(zone_, Smi::New(class_fingerprint)));
+  entry_.SetAt(kUsageIndex, Smi::Handle(zone_, Smi::New(usage)));
+  entry_.SetAt(kInliningDepthIndex,
+               Smi::Handle(zone_, Smi::New(inlining_depth)));
+  entry_.SetAt(kGuardedClassesIndex, guarded_classes_);
+  entry_.SetAt(kCallSitesIndex, sites_);
+
+  PendingFeedbackMap map(pending_.raw());
+  map.UpdateOrInsert(func_, entry_);
+  pending_ = map.Release().raw();
+
+  if (func_.HasCode() && !func_.HasOptimizedCode()) {
+    functions_to_compile_.Add(func_);
+  }
+}
+
+bool TypeFeedbackLoader::ApplyPendingFeedback(Thread* thread,
+                                              const Function& function) {
+  ObjectStore* object_store = thread->isolate()->object_store();
+  if (object_store->pending_type_feedback() == Array::null()) {
+    return false;
+  }
+
+  Zone* zone = thread->zone();
+  Array& entry = Array::Handle(zone);
+  {
+    PendingFeedbackMap map(object_store->pending_type_feedback());
+    entry ^= map.GetOrNull(function);
+    if (entry.IsNull()) {
+      map.Release();
+      return false;
+    }
+    map.Remove(function);
+    if (map.NumOccupied() == 0) {
+      map.Release();
+      object_store->set_pending_type_feedback(Array::null_array());
+    } else {
+      object_store->set_pending_type_feedback(map.Release());
+    }
+  }
+
+  Smi& value = Smi::Handle(zone);
+  const Class& cls = Class::Handle(zone, function.Owner());
+  value ^= entry.At(kFingerprintIndex);
+  intptr_t fingerprint = value.Value();
+  value ^= entry.At(kClassFingerprintIndex);
+  intptr_t class_fingerprint = value.Value();
+  if ((function.SourceFingerprint() != fingerprint) ||
+      (cls.SourceFingerprint() != class_fingerprint)) {
+    if (FLAG_trace_compilation_trace) {
+      THR_Print("Stale feedback %s: source changed\n",
+                function.ToQualifiedCString());
+    }
+    return false;
+  }
+
+  const Array& guarded_classes =
+      Array::Handle(zone, Array::RawCast(entry.At(kGuardedClassesIndex)));
+  Class& guarded_cls = Class::Handle(zone);
+  for (intptr_t i = 0; i < guarded_classes.Length();
+       i += kGuardedClassLength) {
+    guarded_cls ^= guarded_classes.At(i);
+    value ^= guarded_classes.At(i + 1);
+    const bool was_implemented =
+        guarded_classes.At(i + 2) == Bool::True().raw();
+    if (HasGuardedClassChanged(guarded_cls, value.Value(), was_implemented)) {
+      if (FLAG_trace_compilation_trace) {
+        THR_Print("Stale feedback %s: class hierarchy changed\n",
+                  function.ToQualifiedCString());
+      }
+      return false;
+    }
+  }
+
+  const Array& sites =
+      Array::Handle(zone, Array::RawCast(entry.At(kCallSitesIndex)));
+  Array& call_sites = Array::Handle(zone, function.ic_data_array());
+  if (call_sites.IsNull()) {
+    call_sites = Object::empty_array().raw();  // Remove edge case.
+  }
+  // First element is edge counters.
+  if (call_sites.Length() != sites.Length() + 1) {
+    if (FLAG_trace_compilation_trace) {
+      THR_Print("Mismatched call site count %s %" Pd " %" Pd "\n",
+                function.ToQualifiedCString(), call_sites.Length(),
+                sites.Length());
+    }
+    return false;
+  }
+  ICData& call_site = ICData::Handle(zone);
+  Array& site = Array::Handle(zone);
+  for (intptr_t i = 0; i < sites.Length(); i++) {
+    call_site ^= call_sites.At(i + 1);
+    site ^= sites.At(i);
+    value ^= site.At(kDeoptIdIndex);
+    intptr_t deopt_id = value.Value();
+    value ^= site.At(kRebindRuleIndex);
+    intptr_t rebind_rule = value.Value();
+    value ^= site.At(kNumArgsTestedIndex);
+    intptr_t num_checked_arguments = value.Value();
+    if ((call_site.deopt_id() != deopt_id) ||
+        (call_site.rebind_rule() != rebind_rule) ||
+        (call_site.NumArgsTested() != num_checked_arguments)) {
+      if (FLAG_trace_compilation_trace) {
+        THR_Print("Mismatched call site %s\n", call_site.ToCString());
+      }
+      return false;
+    }
+  }
+
+  GrowableArray<intptr_t> cids;
+  for (intptr_t i = 0; i < sites.Length(); i++) {
+    call_site ^= call_sites.At(i + 1);
+    site ^= sites.At(i);
+    intptr_t num_checked_arguments = call_site.NumArgsTested();
+    if (num_checked_arguments == 0) {
+      continue;
+    }
+    for (intptr_t j = kFirstEntryIndex; j < site.Length();
+         j += num_checked_arguments + 1) {
+      cids.Clear();
+      for (intptr_t k = 0; k < num_checked_arguments; k++) {
+        value ^= site.At(j + k);
+        cids.Add(value.Value());
+      }
+      value ^= site.At(j + num_checked_arguments);
+      AddFeedbackCheck(thread, call_site, cids, value.Value());
+    }
+  }
+
+  value ^= entry.At(kUsageIndex);
+  function.set_usage_counter(value.Value());
+  value ^= entry.At(kInliningDepthIndex);
+  function.set_inlining_depth(value.Value());
+
+  if (FLAG_trace_compilation_trace) {
+    THR_Print("Applied feedback %s\n", function.ToQualifiedCString());
+  }
+  return true;
+}
+
+// Feedback is only applied to the source it was recorded for. [cls_] is the
+// owner of [func_] here.
+bool TypeFeedbackLoader::MatchesFingerprints(intptr_t fingerprint,
+                                             intptr_t class_fingerprint) {
+  if ((func_.SourceFingerprint() == fingerprint) &&
+      (cls_.SourceFingerprint() == class_fingerprint)) {
+    return true;
+  }
+  if (FLAG_trace_compilation_trace) {
+    THR_Print("Stale feedback %s: source changed\n",
+              func_.ToQualifiedCString());
+  }
+  return false;
+}
+
 RawFunction* TypeFeedbackLoader::FindFunction(RawFunction::Kind kind,
                                               intptr_t token_pos) {
   if (cls_name_.Equals(Symbols::TopLevel())) {
@@ -1029,6 +1442,427 @@ RawString* TypeFeedbackLoader::ReadString() {
   return Symbols::New(thread_, cstr, len);
 }
 
+// Counts are saved as 32-bit values and loaded into Smis, which are smaller
+// than that on 32-bit hosts.
+static intptr_t ClampCount(intptr_t count) {
+  return Utils::Minimum<intptr_t>(
+      count, Utils::Minimum<intptr_t>(kMaxInt32, Smi::kMaxValue));
+}
+
+AotProfileSaver::AotProfileSaver(WriteStream* stream)
+    : TypeFeedbackSaver(stream),
+      descriptors_(PcDescriptors::Handle()),
+      edge_counters_(Array::Handle()) {}
+
+const char* AotProfile::kMagic = "dart-aot-profile";
+
+void AotProfileSaver::WriteHeader() {
+  stream_->WriteBytes(AotProfile::kMagic, strlen(AotProfile::kMagic));
+  WriteInt(AotProfile::kVersion);
+
+  // Token positions and block numbers are only meaningful to the same
+  // front end and flow graph builder.
+  const char* version = Version::SnapshotString();
+  ASSERT(version != NULL);
+  const intptr_t version_len = strlen(version);
+  stream_->WriteUnsigned(version_len);
+  stream_->WriteBytes(version, version_len);
+}
+
+void AotProfileSaver::Visit(const Function& function) {
+  call_sites_ = function.ic_data_array();
+  code_ = function.unoptimized_code();
+  if (call_sites_.IsNull() || code_.IsNull()) {
+    return;  // Never ran unoptimized.
+  }
+
+  // Map the deopt ids of the call sites to their token positions.
+  Zone* zone = Thread::Current()->zone();
+  GrowableArray<intptr_t> token_positions(zone, 16);
+  descriptors_ = code_.pc_descriptors();
+  PcDescriptors::Iterator iter(descriptors_,
+                               RawPcDescriptors::kIcCall |
+                                   RawPcDescriptors::kUnoptStaticCall);
+  while (iter.MoveNext()) {
+    const intptr_t deopt_id = iter.DeoptId();
+    if (deopt_id < 0) {
+      continue;
+    }
+    if (deopt_id >= token_positions.length()) {
+      token_positions.FillWith(TokenPosition::kNoSourcePos,
+                               token_positions.length(),
+                               deopt_id + 1 - token_positions.length());
+    }
+    token_positions[deopt_id] = iter.TokenPos().value();
+  }
+
+  // Only call sites that were reached and can be identified are saved.
+  GrowableArray<intptr_t> recorded(zone, call_sites_.Length());
+  for (intptr_t i = 1; i < call_sites_.Length(); i++) {
+    call_site_ ^= call_sites_.At(i);
+    const intptr_t deopt_id = call_site_.deopt_id();
+    if ((deopt_id < token_positions.length()) &&
+        TokenPosition(token_positions[deopt_id]).IsReal() &&
+        (call_site_.AggregateCount() > 0)) {
+      recorded.Add(i);
+    }
+  }
+
+  cls_ = function.Owner();
+  WriteClassByName(cls_);
+
+  str_ = function.name();
+  str_ = String::RemovePrivateKey(str_);
+  WriteString(str_);
+
+  WriteInt(function.kind());
+  WriteInt(function.token_pos().value());
+
+  // First element is edge counters.
+  edge_counters_ ^= call_sites_.At(0);
+  if (edge_counters_.IsNull()) {
+    WriteInt(0);
+  } else {
+    WriteInt(edge_counters_.Length());
+    for (intptr_t i = 0; i < edge_counters_.Length(); i++) {
+      WriteInt(ClampCount(Smi::Value(Smi::RawCast(edge_counters_.At(i)))));
+    }
+  }
+
+  WriteInt(recorded.length());
+  for (intptr_t i = 0; i < recorded.length(); i++) {
+    call_site_ ^= call_sites_.At(recorded[i]);
+    WriteInt(token_positions[call_site_.deopt_id()]);
+
+    str_ = call_site_.target_name();
+    if (Function::IsDynamicInvocationForwarderName(str_)) {
+      str_ = Function::DemangleDynamicInvocationForwarderName(str_);
+    }
+    str_ = String::RemovePrivateKey(str_);
+    WriteString(str_);
+
+    const intptr_t num_checked_arguments = call_site_.NumArgsTested();
+    WriteInt(num_checked_arguments);
+
+    const intptr_t num_entries = call_site_.NumberOfChecks();
+    WriteInt(num_entries);
+    for (intptr_t entry_index = 0; entry_index < num_entries; entry_index++) {
+      for (intptr_t argument_index = 0; argument_index < num_checked_arguments;
+           argument_index++) {
+        WriteInt(call_site_.GetClassIdAt(entry_index, argument_index));
+      }
+      WriteInt(ClampCount(call_site_.GetCountAt(entry_index)));
+    }
+  }
+}
+
+typedef UnorderedHashMap<FunctionKeyTraits> AotProfileMap;
+
+AotProfileLoader::AotProfileLoader(Thread* thread)
+    : TypeFeedbackLoader(thread),
+      map_(Array::Handle(zone_)),
+      profile_(Array::Handle(zone_)),
+      edge_counters_(Array::Handle(zone_)),
+      site_(Array::Handle(zone_)),
+      receiver_cls_(Class::Handle(zone_)) {}
+
+RawObject* AotProfileLoader::LoadProfile(ReadStream* stream) {
+  stream_ = stream;
+
+  error_ = CheckHeader();
+  if (error_.IsError()) {
+    return error_.raw();
+  }
+
+  error_ = LoadClasses();
+  if (error_.IsError()) {
+    return error_.raw();
+  }
+
+  ObjectStore* object_store = thread_->isolate()->object_store();
+  map_ = object_store->aot_profile();
+  if (map_.IsNull()) {
+    map_ = HashTables::New<AotProfileMap>(256, Heap::kOld);
+  }
+  while (stream_->PendingBytes() > 0) {
+    error_ = LoadFunction();
+    if (error_.IsError()) {
+      return error_.raw();
+    }
+  }
+  object_store->set_aot_profile(map_);
+
+  if (FLAG_trace_compilation_trace) {
+    THR_Print("Done loading AOT profile\n");
+  }
+
+  return Error::null();
+}
+
+RawObject* AotProfileLoader::CheckHeader() {
+  const intptr_t magic_len = strlen(AotProfile::kMagic);
+  if ((stream_->PendingBytes() <= magic_len) ||
+      (memcmp(stream_->AddressOfCurrentPosition(), AotProfile::kMagic,
+              magic_len) != 0)) {
+    const String& msg =
+        String::Handle(String::New("Not an AOT profile", Heap::kOld));
+    return ApiError::New(msg, Heap::kOld);
+  }
+  stream_->Advance(magic_len);
+
+  const intptr_t format_version = ReadInt();
+  if (format_version != AotProfile::kVersion) {
+    const String& msg = String::Handle(String::NewFormatted(
+        Heap::kOld,
+        "Wrong AOT profile format version, expected %" Pd " found %" Pd,
+        static_cast<intptr_t>(AotProfile::kVersion), format_version));
+    return ApiError::New(msg, Heap::kOld);
+  }
+
+  const char* expected_version = Version::SnapshotString();
+  ASSERT(expected_version != NULL);
+  const intptr_t expected_len = strlen(expected_version);
+  const intptr_t version_len = stream_->ReadUnsigned();
+  const char* version =
+      reinterpret_cast<const char*>(stream_->AddressOfCurrentPosition());
+  if ((version_len > stream_->PendingBytes()) ||
+      (version_len != expected_len) ||
+      (strncmp(version, expected_version, expected_len) != 0)) {
+    const String& msg = String::Handle(String::NewFormatted(
+        Heap::kOld,
+        "AOT profile not compatible with the current VM: the profile was "
+        "recorded by '%.*s' but the VM is '%s'",
+        static_cast<int>(Utils::Minimum<intptr_t>(
+            Utils::Minimum<intptr_t>(version_len, stream_->PendingBytes()),
+            1024)),
+        version, expected_version));
+    return ApiError::New(msg, Heap::kOld);
+  }
+  stream_->Advance(version_len);
+  return Error::null();
+}
+
+RawObject* AotProfileLoader::LoadFunction() {
+  bool skip = false;
+
+  cls_ = ReadClassByName();
+  if (!cls_.IsNull()) {
+    error_ = cls_.EnsureIsFinalized(thread_);
+    if (error_.IsError()) {
+      return error_.raw();
+    }
+  } else {
+    skip = true;
+  }
+
+  func_name_ = ReadString();  // Without private mangling.
+  RawFunction::Kind kind = static_cast<RawFunction::Kind>(ReadInt());
+  intptr_t token_pos = ReadInt();
+
+  if (!skip) {
+    func_ = FindFunction(kind, token_pos);
+    if (func_.IsNull()) {
+      skip = true;
+      if (FLAG_trace_compilation_trace) {
+        THR_Print("Missing function %s %s\n", func_name_.ToCString(),
+                  Function::KindToCString(kind));
+      }
+    }
+  }
+
+  const intptr_t num_counters = ReadInt();
+  edge_counters_ = skip || (num_counters == 0)
+                       ? Array::null()
+                       : Array::New(num_counters, Heap::kOld);
+  for (intptr_t i = 0; i < num_counters; i++) {
+    const intptr_t count = ClampCount(ReadInt());
+    if (!edge_counters_.IsNull()) {
+      edge_counters_.SetAt(i, Smi::Handle(zone_, Smi::New(count)));
+    }
+  }
+
+  const intptr_t num_call_sites = ReadInt();
+  if (!skip) {
+    profile_ = Array::New(AotProfile::kFirstCallSiteIndex + num_call_sites,
+                          Heap::kOld);
+    profile_.SetAt(AotProfile::kEdgeCountersIndex, edge_counters_);
+  }
+
+  for (intptr_t i = 0; i < num_call_sites; i++) {
+    const intptr_t call_token_pos = ReadInt();
+    target_name_ = ReadString();
+    const intptr_t num_checked_arguments = ReadInt();
+    const intptr_t num_entries = ReadInt();
+
+    const intptr_t entry_length = num_checked_arguments + 1;
+    if (!skip) {
+      site_ = Array::New(
+          AotProfile::kFirstEntryIndex + num_entries * entry_length,
+          Heap::kOld);
+    }
+
+    intptr_t aggregate_count = 0;
+    intptr_t next_entry = AotProfile::kFirstEntryIndex;
+    for (intptr_t entry_index = 0; entry_index < num_entries; entry_index++) {
+      // Entries with classes missing in the current program only contribute
+      // to the count of the call site.
+      bool skip_entry = skip;
+      for (intptr_t argument_index = 0; argument_index < num_checked_arguments;
+           argument_index++) {
+        const intptr_t saved_cid = ReadInt();
+        const intptr_t cid = ((saved_cid >= 0) && (saved_cid < num_cids_))
+                                 ? cid_map_[saved_cid]
+                                 : static_cast<intptr_t>(kIllegalCid);
+        if (cid == kIllegalCid) {
+          skip_entry = true;
+        } else if (!skip_entry) {
+          receiver_cls_ = thread_->isolate()->class_table()->At(cid);
+          site_.SetAt(next_entry + argument_index, receiver_cls_);
+        }
+      }
+      const intptr_t count = ClampCount(ReadInt());
+      aggregate_count = ClampCount(aggregate_count + count);
+      if (!skip_entry) {
+        site_.SetAt(next_entry + num_checked_arguments,
+                    Smi::Handle(zone_, Smi::New(count)));
+        next_entry += entry_length;
+      }
+    }
+
+    if (!skip) {
+      site_.Truncate(next_entry);
+      site_.SetAt(AotProfile::kTokenPosIndex,
+                  Smi::Handle(zone_, Smi::New(call_token_pos)));
+      site_.SetAt(AotProfile::kSelectorIndex, target_name_);
+      site_.SetAt(AotProfile::kCountIndex,
+                  Smi::Handle(zone_, Smi::New(aggregate_count)));
+      site_.SetAt(AotProfile::kNumArgsTestedIndex,
+                  Smi::Handle(zone_, Smi::New(num_checked_arguments)));
+      profile_.SetAt(AotProfile::kFirstCallSiteIndex + i, site_);
+    }
+  }
+
+  if (!skip) {
+    AotProfileMap map(map_.raw());
+    map.UpdateOrInsert(func_, profile_);
+    map_ = map.Release().raw();
+  }
+
+  return Error::null();
+}
+
+RawArray* AotProfile::FunctionProfile(const Function& function) {
+  Thread* thread = Thread::Current();
+  Zone* zone = thread->zone();
+  const Array& map_storage =
+      Array::Handle(zone, thread->isolate()->object_store()->aot_profile());
+  if (map_storage.IsNull()) {
+    return Array::null();
+  }
+  AotProfileMap map(map_storage.raw());
+  const Array& profile =
+      Array::Handle(zone, Array::RawCast(map.GetOrNull(function)));
+  map.Release();
+  return profile.raw();
+}
+
+bool AotProfile::HasProfile(const Function& function) {
+  return FunctionProfile(function) != Array::null();
+}
+
+RawArray* AotProfile::EdgeCounters(const Function& function,
+                                   intptr_t num_blocks) {
+  Zone* zone = Thread::Current()->zone();
+  const Array& profile = Array::Handle(zone, FunctionProfile(function));
+  if (profile.IsNull()) {
+    return Array::null();
+  }
+  const Array& edge_counters =
+      Array::Handle(zone, Array::RawCast(profile.At(kEdgeCountersIndex)));
+  // A different number of blocks means the flow graph differs from the one
+  // the counters were recorded for.
+  if (edge_counters.IsNull() || (edge_counters.Length() != num_blocks)) {
+    return Array::null();
+  }
+  return edge_counters.raw();
+}
+
+RawArray* AotProfile::FindCallSite(const Function& function,
+                                   TokenPosition token_pos,
+                                   const String& selector,
+                                   intptr_t num_args_tested) {
+  if (!token_pos.IsReal()) {
+    return Array::null();
+  }
+  Zone* zone = Thread::Current()->zone();
+  const Array& profile = Array::Handle(zone, FunctionProfile(function));
+  if (profile.IsNull()) {
+    return Array::null();
+  }
+  String& name = String::Handle(zone, selector.raw());
+  if (Function::IsDynamicInvocationForwarderName(name)) {
+    name = Function::DemangleDynamicInvocationForwarderName(name);
+  }
+  Array& call_site = Array::Handle(zone);
+  String& recorded_name = String::Handle(zone);
+  for (intptr_t i = kFirstCallSiteIndex; i < profile.Length(); i++) {
+    call_site ^= profile.At(i);
+    if ((Smi::Value(Smi::RawCast(call_site.At(kTokenPosIndex))) !=
+         token_pos.value()) ||
+        (Smi::Value(Smi::RawCast(call_site.At(kNumArgsTestedIndex))) !=
+         num_args_tested)) {
+      continue;
+    }
+    recorded_name ^= call_site.At(kSelectorIndex);
+    if (String::EqualsIgnoringPrivateKey(name, recorded_name)) {
+      return call_site.raw();
+    }
+  }
+  return Array::null();
+}
+
+void AotProfile::AddReceiverChecks(const Array& call_site,
+                                   const ICData& ic_data) {
+  const intptr_t num_args_tested = ic_data.NumArgsTested();
+  ASSERT(num_args_tested ==
+         Smi::Value(Smi::RawCast(call_site.At(kNumArgsTestedIndex))));
+  if (num_args_tested == 0) {
+    return;
+  }
+
+  Zone* zone = Thread::Current()->zone();
+  const String& name = String::Handle(zone, ic_data.target_name());
+  const Array& args_desc = Array::Handle(zone, ic_data.arguments_descriptor());
+  Class& cls = Class::Handle(zone);
+  Function& target = Function::Handle(zone);
+  GrowableArray<intptr_t> cids(num_args_tested);
+  for (intptr_t i = kFirstEntryIndex; i < call_site.Length();
+       i += num_args_tested + 1) {
+    cids.Clear();
+    for (intptr_t j = 0; j < num_args_tested; j++) {
+      cls ^= call_site.At(i + j);
+      cids.Add(cls.id());
+    }
+    cls ^= call_site.At(i);
+    target = Resolver::ResolveDynamicForReceiverClass(
+        cls, name, ArgumentsDescriptor(args_desc), /*allow_add=*/false);
+    // Method extractors and dispatchers are created lazily, so the lookup
+    // may find those of a superclass instead of the actual target.
+    if (target.IsNull() || target.IsMethodExtractor() ||
+        target.IsInvokeFieldDispatcher() ||
+        target.IsNoSuchMethodDispatcher()) {
+      continue;
+    }
+    const intptr_t count = Smi::Value(
+        Smi::RawCast(call_site.At(i + num_args_tested)));
+    if (num_args_tested == 1) {
+      ic_data.AddReceiverCheck(cids[0], target, count);
+    } else {
+      ic_data.AddCheck(cids, target, count);
+    }
+  }
+}
+
 #endif  // !defined(DART_PRECOMPILED_RUNTIME)
 
 }  // namespace dart
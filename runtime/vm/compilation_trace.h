@@ -65,6 +65,10 @@ class CompilationTraceLoader : public ValueObject {
   Object& error_;
 };
 
+// Saves the type feedback of the compiled functions. Each function is keyed
+// by the source fingerprints of the function and of its owner class, and
+// optimized code also records the classes it relied on through CHA, so that
+// TypeFeedbackLoader can drop feedback that no longer applies to the program.
 class TypeFeedbackSaver : public FunctionVisitor {
  public:
   explicit TypeFeedbackSaver(WriteStream* stream);
@@ -74,7 +78,8 @@ class TypeFeedbackSaver : public FunctionVisitor {
   void SaveFields();
   void Visit(const Function& function);
 
- private:
+ protected:
+  void CollectGuardedClasses();
   void WriteClassByName(const Class& cls);
   void WriteString(const String& value);
   void WriteInt(intptr_t value) { stream_->Write(static_cast<int32_t>(value)); }
@@ -88,21 +93,67 @@ class TypeFeedbackSaver : public FunctionVisitor {
   Code& code_;
   Array& call_sites_;
   ICData& call_site_;
+  Array& guarded_classes_;
+  GrowableObjectArray& guarded_cids_;
 };
 
+// Reads the output of TypeFeedbackSaver. By default, the functions are
+// compiled right away with their feedback, and optimized if they were warm
+// when the feedback was saved. When loading lazily, nothing is compiled: the
+// feedback of a function is kept in ObjectStore::pending_type_feedback until
+// the function is first compiled, and ApplyPendingFeedback then adds it.
 class TypeFeedbackLoader : public ValueObject {
  public:
   explicit TypeFeedbackLoader(Thread* thread);
   ~TypeFeedbackLoader();
 
-  RawObject* LoadFeedback(ReadStream* stream);
+  RawObject* LoadFeedback(ReadStream* stream, bool lazy = false);
+
+  // Called once the unoptimized code of [function] was compiled. If lazily
+  // loaded feedback is pending for [function], adds it to the call sites and
+  // restores the usage counter, so that the first call of a function that
+  // was optimized when the feedback was saved requests optimized code. The
+  // feedback is used at most once, and dropped if the source of the function
+  // or of its owner class changed, or if a class that its optimized code
+  // relied on through CHA has gained subclasses or implementors since.
+  static bool ApplyPendingFeedback(Thread* thread, const Function& function);
+
+ protected:
+  // A pending entry is an array of the source fingerprints the feedback was
+  // recorded for, the usage counter and inlining depth of the function, its
+  // guarded classes and its call sites.
+  static const intptr_t kFingerprintIndex = 0;
+  static const intptr_t kClassFingerprintIndex = 1;
+  static const intptr_t kUsageIndex = 2;
+  static const intptr_t kInliningDepthIndex = 3;
+  static const intptr_t kGuardedClassesIndex = 4;
+  static const intptr_t kCallSitesIndex = 5;
+  static const intptr_t kPendingEntryLength = 6;
+
+  // The guarded classes are stored as triples of the class, its number of
+  // subclasses and whether it was implemented by another class.
+  static const intptr_t kGuardedClassLength = 3;
+
+  // A call site is an array of its deopt id, its rebind rule and its number
+  // of tested arguments, followed by one entry per combination of argument
+  // class ids: the class ids and then the count of the combination.
+  static const intptr_t kDeoptIdIndex = 0;
+  static const intptr_t kRebindRuleIndex = 1;
+  static const intptr_t kNumArgsTestedIndex = 2;
+  static const intptr_t kFirstEntryIndex = 3;
 
- private:
   RawObject* CheckHeader();
   RawObject* LoadClasses();
   RawObject* LoadFields();
   RawObject* LoadFunction();
+  void DeferFunction(bool skip,
+                     intptr_t num_call_sites,
+                     intptr_t fingerprint,
+                     intptr_t class_fingerprint,
+                     intptr_t usage,
+                     intptr_t inlining_depth);
   RawFunction* FindFunction(RawFunction::Kind kind, intptr_t token_pos);
+  bool MatchesFingerprints(intptr_t fingerprint, intptr_t class_fingerprint);
 
   RawClass* ReadClassByName();
   RawString* ReadString();
@@ -125,10 +176,99 @@ class TypeFeedbackLoader : public ValueObject {
   Array& call_sites_;
   ICData& call_site_;
   String& target_name_;
-  Function& target_;
-  Array& args_desc_;
+  Class& guarded_cls_;
   GrowableObjectArray& functions_to_compile_;
   Object& error_;
+
+  // Used when loading lazily.
+  bool lazy_;
+  Array& pending_;
+  Array& entry_;
+  Array& guarded_classes_;
+  Array& sites_;
+  Array& site_;
+};
+
+// Saves the counts of unoptimized code from a training run for the
+// precompiler: the edge counters and, for each call site, the receiver
+// classes seen and how often. The deopt ids assigned by the AOT flow graph
+// builder differ from the JIT's, so call sites are identified by their token
+// position and selector instead.
+class AotProfileSaver : public TypeFeedbackSaver {
+ public:
+  explicit AotProfileSaver(WriteStream* stream);
+
+  void WriteHeader();
+  void Visit(const Function& function);
+
+ private:
+  PcDescriptors& descriptors_;
+  Array& edge_counters_;
+};
+
+// Reads the output of AotProfileSaver into ObjectStore::aot_profile for the
+// next Dart_Precompile. Receiver classes are kept as classes rather than
+// class ids, since the precompiler renumbers classes.
+class AotProfileLoader : public TypeFeedbackLoader {
+ public:
+  explicit AotProfileLoader(Thread* thread);
+
+  RawObject* LoadProfile(ReadStream* stream);
+
+ private:
+  RawObject* CheckHeader();
+  RawObject* LoadFunction();
+
+  Array& map_;
+  Array& profile_;
+  Array& edge_counters_;
+  Array& site_;
+  Class& receiver_cls_;
+};
+
+// Lookup of the profile loaded by AotProfileLoader while precompiling.
+class AotProfile : public AllStatic {
+ public:
+  static const char* kMagic;
+  static const int32_t kVersion = 1;
+
+  // The profile of a function is an array of its edge counters, indexed by
+  // block preorder number, followed by its call sites.
+  static const intptr_t kEdgeCountersIndex = 0;
+  static const intptr_t kFirstCallSiteIndex = 1;
+
+  // A call site is an array of its token position, its selector without
+  // private key, its aggregate count and its number of tested arguments,
+  // followed by one entry per combination of argument classes: the classes
+  // and then the count of the combination.
+  static const intptr_t kTokenPosIndex = 0;
+  static const intptr_t kSelectorIndex = 1;
+  static const intptr_t kCountIndex = 2;
+  static const intptr_t kNumArgsTestedIndex = 3;
+  static const intptr_t kFirstEntryIndex = 4;
+
+  static bool HasProfile(const Function& function);
+
+  // Returns null if no (or mismatched) edge counters were recorded.
+  static RawArray* EdgeCounters(const Function& function,
+                                intptr_t num_blocks);
+
+  // Returns null if the call was not recorded.
+  static RawArray* FindCallSite(const Function& function,
+                                TokenPosition token_pos,
+                                const String& selector,
+                                intptr_t num_args_tested);
+
+  static intptr_t CallCount(const Array& call_site) {
+    return Smi::Value(Smi::RawCast(call_site.At(kCountIndex)));
+  }
+
+  // Adds the recorded receiver classes of [call_site] with their targets in
+  // the current program and their counts to [ic_data].
+  static void AddReceiverChecks(const Array& call_site, const ICData& ic_data);
+
+ private:
+  static RawArray* FunctionProfile(const Function& function);
 };
 
 }  // namespace dart
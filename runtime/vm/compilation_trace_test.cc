@@ -0,0 +1,379 @@
+// Copyright (c) 2019, the Dart project authors.  Please see the AUTHORS file
+// for details. All rights reserved. Use of this source code is governed by a
+// BSD-style license that can be found in the LICENSE file.
+
+#include "vm/compilation_trace.h"
+#include "platform/assert.h"
+#include "vm/compiler/backend/il_test_helper.h"
+#include "vm/compiler/compiler_pass.h"
+#include "vm/compiler/compiler_state.h"
+#include "vm/compiler/jit/compiler.h"
+#include "vm/dart_api_impl.h"
+#include "vm/symbols.h"
+#include "vm/unit_test.h"
+
+namespace dart {
+
+#if !defined(DART_PRECOMPILED_RUNTIME)
+
+// Returns the token position of the call to [selector] in the unoptimized
+// code of [function].
+static TokenPosition CallTokenPos(const Function& function,
+                                  const String& selector) {
+  const Code& code = Code::Handle(function.unoptimized_code());
+  const Array& call_sites = Array::Handle(function.ic_data_array());
+  ICData& call_site = ICData::Handle();
+  intptr_t deopt_id = DeoptId::kNone;
+  for (intptr_t i = 1; i < call_sites.Length(); i++) {
+    call_site ^= call_sites.At(i);
+    if (call_site.target_name() == selector.raw()) {
+      deopt_id = call_site.deopt_id();
+    }
+  }
+  const PcDescriptors& descriptors =
+      PcDescriptors::Handle(code.pc_descriptors());
+  PcDescriptors::Iterator iter(descriptors, RawPcDescriptors::kIcCall);
+  while (iter.MoveNext()) {
+    if (iter.DeoptId() == deopt_id) {
+      return iter.TokenPos();
+    }
+  }
+  return TokenPosition::kNoSource;
+}
+
+static const char* kAotProfileScript =
+    "class A { foo() => 1; }\n"
+    "class B { foo() => 2; }\n"
+    "class C { foo() => 3; }\n"
+    "callFoo(x) => x.foo();\n"
+    "main() {\n"
+    "  var sum = 0;\n"
+    "  for (var i = 0; i < 10; i++) {\n"
+    "    sum += callFoo(i < 7 ? new A() : new B());\n"
+    "  }\n"
+    "  return sum;\n"
+    "}\n";
+
+TEST_CASE(AotProfile_SaveAndLoad) {
+  Dart_Handle lib = TestCase::LoadTestScript(kAotProfileScript, NULL);
+  EXPECT_VALID(lib);
+  Dart_Handle result = Dart_Invoke(lib, NewString("main"), 0, NULL);
+  EXPECT_VALID(result);
+
+  uint8_t* buffer = NULL;
+  intptr_t buffer_length = 0;
+  result = Dart_SaveAotProfile(&buffer, &buffer_length);
+  EXPECT_VALID(result);
+  EXPECT(buffer_length > 0);
+  result = Dart_LoadAotProfile(buffer, buffer_length);
+  EXPECT_VALID(result);
+
+  TransitionNativeToVM transition(thread);
+  const Library& root_lib =
+      Library::Handle(Library::RawCast(Api::UnwrapHandle(lib)));
+  const Function& call_foo = Function::Handle(root_lib.LookupLocalFunction(
+      String::Handle(Symbols::New(thread, "callFoo"))));
+  EXPECT(!call_foo.IsNull());
+  EXPECT(AotProfile::HasProfile(call_foo));
+
+  const String& selector = String::Handle(Symbols::New(thread, "foo"));
+  const TokenPosition token_pos = CallTokenPos(call_foo, selector);
+  EXPECT(token_pos.IsReal());
+  EXPECT(AotProfile::FindCallSite(call_foo, token_pos, selector, 2) ==
+         Array::null());
+  const Array& call_site = Array::Handle(
+      AotProfile::FindCallSite(call_foo, token_pos, selector, 1));
+  EXPECT(!call_site.IsNull());
+  EXPECT_EQ(10, AotProfile::CallCount(call_site));
+
+  // The receivers seen are resolved to their targets with their counts.
+  const Array& args_desc = Array::Handle(ArgumentsDescriptor::New(0, 1));
+  const ICData& ic_data = ICData::Handle(ICData::New(
+      call_foo, selector, args_desc, DeoptId::kNone, 1, ICData::kInstance));
+  AotProfile::AddReceiverChecks(call_site, ic_data);
+  EXPECT_EQ(2, ic_data.NumberOfChecks());
+  EXPECT_EQ(10, ic_data.AggregateCount());
+  const Class& cls_a = Class::Handle(
+      root_lib.LookupClass(String::Handle(Symbols::New(thread, "A"))));
+  EXPECT(ic_data.HasReceiverClassId(cls_a.id()));
+  const Class& cls_c = Class::Handle(
+      root_lib.LookupClass(String::Handle(Symbols::New(thread, "C"))));
+  EXPECT(!ic_data.HasReceiverClassId(cls_c.id()));
+}
+
+#if defined(DART_PRECOMPILER) && !defined(TARGET_ARCH_DBC)
+// Test that precompiling a call site inlines the targets a training run saw
+// there, and calls other receivers instead of deoptimizing.
+TEST_CASE(AotProfile_InlineProfiledTargets) {
+  Dart_Handle lib = TestCase::LoadTestScript(kAotProfileScript, NULL);
+  EXPECT_VALID(lib);
+  EXPECT_VALID(Dart_Invoke(lib, NewString("main"), 0, NULL));
+
+  uint8_t* buffer = NULL;
+  intptr_t buffer_length = 0;
+  EXPECT_VALID(Dart_SaveAotProfile(&buffer, &buffer_length));
+  EXPECT_VALID(Dart_LoadAotProfile(buffer, buffer_length));
+
+  TransitionNativeToVM transition(thread);
+  SetFlagScope<bool> sfs_precompiled(&FLAG_precompiled_mode, true);
+  SetFlagScope<bool> sfs_deopt(&FLAG_polymorphic_with_deopt, false);
+  const Library& root_lib =
+      Library::Handle(Library::RawCast(Api::UnwrapHandle(lib)));
+  const Function& call_foo =
+      Function::Handle(GetFunction(root_lib, "callFoo"));
+
+  TestPipeline pipeline(call_foo, CompilerPass::kAOT);
+  FlowGraph* flow_graph = pipeline.RunPasses({
+      CompilerPass::kComputeSSA,
+      CompilerPass::kApplyClassIds,
+      CompilerPass::kTypePropagation,
+      CompilerPass::kApplyICData,
+      CompilerPass::kTryOptimizePatterns,
+      CompilerPass::kSetOuterInliningId,
+      CompilerPass::kTypePropagation,
+      CompilerPass::kApplyClassIds,
+      CompilerPass::kInlining,
+  });
+
+  // A.foo and B.foo are inlined behind class id tests, and the instance call
+  // is left for the other receivers.
+  const String& selector = String::Handle(Symbols::New(thread, "foo"));
+  intptr_t class_id_loads = 0;
+  intptr_t instance_calls = 0;
+  for (BlockIterator block_it = flow_graph->reverse_postorder_iterator();
+       !block_it.Done(); block_it.Advance()) {
+    for (ForwardInstructionIterator it(block_it.Current()); !it.Done();
+         it.Advance()) {
+      Instruction* current = it.Current();
+      EXPECT(!current->IsPolymorphicInstanceCall());
+      EXPECT(!current->IsStaticCall());
+      EXPECT(!current->IsCheckClassId());
+      if (current->IsLoadClassId()) {
+        ++class_id_loads;
+      } else if (InstanceCallInstr* call = current->AsInstanceCall()) {
+        EXPECT(call->function_name().raw() == selector.raw());
+        ++instance_calls;
+      }
+    }
+  }
+  EXPECT_EQ(1, class_id_loads);
+  EXPECT_EQ(1, instance_calls);
+}
+#endif  // defined(DART_PRECOMPILER) && !defined(TARGET_ARCH_DBC)
+
+TEST_CASE(AotProfile_Malformed) {
+  uint8_t garbage[] = {'n', 'o', 't', ' ', 'a', ' ', 'p', 'r', 'o', 'f'};
+  Dart_Handle result = Dart_LoadAotProfile(garbage, sizeof(garbage));
+  EXPECT_ERROR(result, "Not an AOT profile");
+}
+
+static const char* kTypeFeedbackScript =
+    "class A { foo() => 1; }\n"
+    "class B extends A { foo() => 2; }\n"
+    "class Caller { static callFoo(x) => x.foo(); }\n"
+    "class Other { static callBar(x) => x.foo(); }\n"
+    "main() {\n"
+    "  var sum = 0;\n"
+    "  for (var i = 0; i < 10; i++) {\n"
+    "    var x = i < 7 ? new A() : new B();\n"
+    "    sum += Caller.callFoo(x) + Other.callBar(x);\n"
+    "  }\n"
+    "  return sum;\n"
+    "}\n";
+
+static RawFunction* LookupStaticFunction(Thread* thread,
+                                         Dart_Handle lib,
+                                         const char* class_name,
+                                         const char* name) {
+  const Library& root_lib =
+      Library::Handle(Library::RawCast(Api::UnwrapHandle(lib)));
+  const Class& cls = Class::Handle(
+      root_lib.LookupClass(String::Handle(Symbols::New(thread, class_name))));
+  EXPECT(!cls.IsNull());
+  const Function& function = Function::Handle(
+      cls.LookupStaticFunction(String::Handle(Symbols::New(thread, name))));
+  EXPECT(!function.IsNull());
+  return function.raw();
+}
+
+// Runs main and optimizes Caller.callFoo and Other.callBar, as a training run
+// would have.
+static void TrainTypeFeedbackScript(Thread* thread, Dart_Handle lib) {
+  Dart_Handle result = Dart_Invoke(lib, NewString("main"), 0, NULL);
+  EXPECT_VALID(result);
+
+  TransitionNativeToVM transition(thread);
+  Function& function = Function::Handle();
+  Object& code = Object::Handle();
+  function = LookupStaticFunction(thread, lib, "Caller", "callFoo");
+  code = Compiler::CompileOptimizedFunction(thread, function);
+  EXPECT(code.IsCode());
+  function = LookupStaticFunction(thread, lib, "Other", "callBar");
+  code = Compiler::CompileOptimizedFunction(thread, function);
+  EXPECT(code.IsCode());
+}
+
+TEST_CASE(TypeFeedback_SaveAndLoad) {
+  Dart_Handle lib = TestCase::LoadTestScript(kTypeFeedbackScript, NULL);
+  EXPECT_VALID(lib);
+  TrainTypeFeedbackScript(thread, lib);
+
+  uint8_t* buffer = NULL;
+  intptr_t buffer_length = 0;
+  Dart_Handle result = Dart_SaveTypeFeedback(&buffer, &buffer_length);
+  EXPECT_VALID(result);
+  EXPECT(buffer_length > 0);
+
+  // Forget the code and feedback of callFoo, as a restarted process would.
+  Function& call_foo = Function::Handle();
+  {
+    TransitionNativeToVM transition(thread);
+    call_foo = LookupStaticFunction(thread, lib, "Caller", "callFoo");
+    call_foo.ClearICDataArray();
+    call_foo.ClearCode();
+  }
+
+  result = Dart_LoadTypeFeedback(buffer, buffer_length);
+  EXPECT_VALID(result);
+
+  TransitionNativeToVM transition(thread);
+  EXPECT(call_foo.HasOptimizedCode());
+
+  const String& selector = String::Handle(Symbols::New(thread, "foo"));
+  const Array& call_sites = Array::Handle(call_foo.ic_data_array());
+  ICData& call_site = ICData::Handle();
+  bool found = false;
+  for (intptr_t i = 1; i < call_sites.Length(); i++) {
+    call_site ^= call_sites.At(i);
+    if (call_site.target_name() == selector.raw()) {
+      found = true;
+      EXPECT_EQ(2, call_site.NumberOfChecks());
+      EXPECT_EQ(10, call_site.AggregateCount());
+    }
+  }
+  EXPECT(found);
+}
+
+TEST_CASE(TypeFeedback_LoadLazily) {
+  Dart_Handle lib = TestCase::LoadTestScript(kTypeFeedbackScript, NULL);
+  EXPECT_VALID(lib);
+  TrainTypeFeedbackScript(thread, lib);
+
+  uint8_t* buffer = NULL;
+  intptr_t buffer_length = 0;
+  EXPECT_VALID(Dart_SaveTypeFeedback(&buffer, &buffer_length));
+
+  Function& call_foo = Function::Handle();
+  {
+    TransitionNativeToVM transition(thread);
+    call_foo = LookupStaticFunction(thread, lib, "Caller", "callFoo");
+    call_foo.ClearICDataArray();
+    call_foo.ClearCode();
+  }
+
+  EXPECT_VALID(Dart_LoadTypeFeedbackLazily(buffer, buffer_length));
+
+  TransitionNativeToVM transition(thread);
+  // Nothing is compiled until callFoo is needed.
+  EXPECT(!call_foo.HasCode());
+  EXPECT(Object::Handle(Compiler::CompileFunction(thread, call_foo)).IsNull());
+
+  const String& selector = String::Handle(Symbols::New(thread, "foo"));
+  const Array& call_sites = Array::Handle(call_foo.ic_data_array());
+  ICData& call_site = ICData::Handle();
+  bool found = false;
+  for (intptr_t i = 1; i < call_sites.Length(); i++) {
+    call_site ^= call_sites.At(i);
+    if (call_site.target_name() == selector.raw()) {
+      found = true;
+      EXPECT_EQ(2, call_site.NumberOfChecks());
+      EXPECT_EQ(10, call_site.AggregateCount());
+    }
+  }
+  EXPECT(found);
+  // callFoo was optimized when the feedback was saved, so its next call
+  // requests optimized code.
+  EXPECT(call_foo.usage_counter() >= FLAG_optimization_counter_threshold);
+
+  // The feedback is only applied once.
+  EXPECT(!TypeFeedbackLoader::ApplyPendingFeedback(thread, call_foo));
+}
+
+#if !defined(PRODUCT)
+TEST_CASE(TypeFeedback_StaleSource) {
+  Dart_Handle lib = TestCase::LoadTestScript(kTypeFeedbackScript, NULL);
+  EXPECT_VALID(lib);
+  TrainTypeFeedbackScript(thread, lib);
+
+  uint8_t* buffer = NULL;
+  intptr_t buffer_length = 0;
+  EXPECT_VALID(Dart_SaveTypeFeedback(&buffer, &buffer_length));
+
+  // Only the source of Caller changes.
+  const char* kReloadScript =
+      "class A { foo() => 1; }\n"
+      "class B extends A { foo() => 2; }\n"
+      "class Caller { static callFoo(x) => x.foo() + 0; }\n"
+      "class Other { static callBar(x) => x.foo(); }\n"
+      "main() => 0;\n";
+  lib = TestCase::ReloadTestScript(kReloadScript);
+  EXPECT_VALID(lib);
+
+  EXPECT_VALID(Dart_LoadTypeFeedback(buffer, buffer_length));
+
+  TransitionNativeToVM transition(thread);
+  const Function& call_foo = Function::Handle(
+      LookupStaticFunction(thread, lib, "Caller", "callFoo"));
+  EXPECT(!call_foo.HasOptimizedCode());
+  const Function& call_bar = Function::Handle(
+      LookupStaticFunction(thread, lib, "Other", "callBar"));
+  EXPECT(call_bar.HasOptimizedCode());
+}
+
+TEST_CASE(TypeFeedback_StaleClassHierarchy) {
+  Dart_Handle lib = TestCase::LoadTestScript(kTypeFeedbackScript, NULL);
+  EXPECT_VALID(lib);
+  TrainTypeFeedbackScript(thread, lib);
+
+  // Make the optimized code of callFoo depend on A through CHA.
+  {
+    TransitionNativeToVM transition(thread);
+    const Function& call_foo = Function::Handle(
+        LookupStaticFunction(thread, lib, "Caller", "callFoo"));
+    const Library& root_lib =
+        Library::Handle(Library::RawCast(Api::UnwrapHandle(lib)));
+    Class& cls_a = Class::Handle(
+        root_lib.LookupClass(String::Handle(Symbols::New(thread, "A"))));
+    cls_a.RegisterCHACode(Code::Handle(call_foo.CurrentCode()));
+  }
+
+  uint8_t* buffer = NULL;
+  intptr_t buffer_length = 0;
+  EXPECT_VALID(Dart_SaveTypeFeedback(&buffer, &buffer_length));
+
+  // A gains a subclass; the sources of Caller and Other are unchanged.
+  const char* kReloadScript =
+      "class A { foo() => 1; }\n"
+      "class B extends A { foo() => 2; }\n"
+      "class C extends A { foo() => 3; }\n"
+      "class Caller { static callFoo(x) => x.foo(); }\n"
+      "class Other { static callBar(x) => x.foo(); }\n"
+      "main() => 0;\n";
+  lib = TestCase::ReloadTestScript(kReloadScript);
+  EXPECT_VALID(lib);
+
+  EXPECT_VALID(Dart_LoadTypeFeedback(buffer, buffer_length));
+
+  TransitionNativeToVM transition(thread);
+  const Function& call_foo = Function::Handle(
+      LookupStaticFunction(thread, lib, "Caller", "callFoo"));
+  EXPECT(!call_foo.HasOptimizedCode());
+  const Function& call_bar = Function::Handle(
+      LookupStaticFunction(thread, lib, "Other", "callBar"));
+  EXPECT(call_bar.HasOptimizedCode());
+}
+#endif  // !defined(PRODUCT)
+
+#endif  // !defined(DART_PRECOMPILED_RUNTIME)
+
+}  // namespace dart
@@ -1049,6 +1049,17 @@ void AotCallSpecializer::VisitInstanceCall(InstanceCallInstr* instr) {
     instr->ReplaceWith(call, current_iterator());
     return;
   }
+
+  // Dispatch to the targets seen in a training run, if any, falling back to
+  // a regular instance call for other receivers.
+  const CallTargets* profiled_targets = instr->ProfiledTargets();
+  if (profiled_targets != nullptr) {
+    PolymorphicInstanceCallInstr* call =
+        new (Z) PolymorphicInstanceCallInstr(instr, *profiled_targets,
+                                             /* complete = */ false);
+    instr->ReplaceWith(call, current_iterator());
+    return;
+  }
 }
 
 void AotCallSpecializer::VisitStaticCall(StaticCallInstr* instr) {
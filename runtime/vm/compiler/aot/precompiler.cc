@@ -10,6 +10,7 @@
 #include "vm/compiler/aot/aot_call_specializer.h"
 #include "vm/compiler/assembler/assembler.h"
 #include "vm/compiler/assembler/disassembler.h"
+#include "vm/compiler/backend/block_scheduler.h"
 #include "vm/compiler/backend/branch_optimizer.h"
 #include "vm/compiler/backend/constant_propagator.h"
 #include "vm/compiler/backend/flow_graph.h"
@@ -32,6 +33,7 @@
 #include "vm/hash_table.h"
 #include "vm/isolate.h"
 #include "vm/kernel_loader.h"  // For kernel::ParseStaticFieldInitializer.
+#include "vm/lockers.h"
 #include "vm/log.h"
 #include "vm/longjump.h"
 #include "vm/object.h"
@@ -45,6 +47,7 @@
 #include "vm/runtime_entry.h"
 #include "vm/symbols.h"
 #include "vm/tags.h"
+#include "vm/thread_pool.h"
 #include "vm/timeline.h"
 #include "vm/timer.h"
 #include "vm/type_table.h"
@@ -60,6 +63,11 @@ namespace dart {
 DEFINE_FLAG(bool, print_unique_targets, false, "Print unique dynamic targets");
 DEFINE_FLAG(bool, print_gop, false, "Print global object pool");
 DEFINE_FLAG(bool, trace_precompiler, false, "Trace precompiler.");
+DEFINE_FLAG(int,
+            precompiler_tasks,
+            0,
+            "Number of helper tasks running register allocation while "
+            "precompiling (0 compiles on the mutator alone)");
 DEFINE_FLAG(
     int,
     max_speculative_inlining_attempts,
@@ -87,6 +95,7 @@ DECLARE_FLAG(int, inlining_caller_size_threshold);
 DECLARE_FLAG(int, inlining_constant_arguments_max_size_threshold);
 DECLARE_FLAG(int, inlining_constant_arguments_min_size_threshold);
 DECLARE_FLAG(bool, print_instruction_stats);
+DECLARE_FLAG(bool, lazy_exception_handlers);
 
 Precompiler* Precompiler::singleton_ = nullptr;
 
@@ -105,6 +114,21 @@ class PrecompileParsedFunctionHelper : public ValueObject {
 
   bool Compile(CompilationPipeline* pipeline);
 
+  // Builds the flow graph of the function and runs the optimization
+  // pipeline on it. Register allocation is left to the caller if
+  // [pass_state] defers it.
+  FlowGraph* BuildAndOptimizeGraph(
+      CompilationPipeline* pipeline,
+      ZoneGrowableArray<const ICData*>* ic_data_array,
+      CompilerPassState* pass_state);
+
+  // Generates code for the register allocated [flow_graph] and installs it.
+  void GenerateCode(CompilationPipeline* pipeline,
+                    FlowGraph* flow_graph,
+                    ZoneGrowableArray<const ICData*>* ic_data_array,
+                    CompilerPassState* pass_state,
+                    bool use_far_branches);
+
  private:
   ParsedFunction* parsed_function() const { return parsed_function_; }
   bool optimized() const { return optimized_; }
@@ -128,6 +152,16 @@ static void Jump(const Error& error) {
   Thread::Current()->long_jump_base()->Jump(1, error);
 }
 
+// Whether functions are compiled in batches whose register allocation runs
+// on helper tasks. Tracing and printing of individual compilations need the
+// functions to be compiled one by one.
+static bool CompileInBatches() {
+  return (FLAG_precompiler_tasks > 0) && !FLAG_print_flow_graph &&
+         !FLAG_print_flow_graph_optimized && !FLAG_trace_compiler &&
+         !FLAG_trace_optimizing_compiler && !FLAG_disassemble &&
+         !FLAG_disassemble_optimized && !FLAG_print_instruction_stats;
+}
+
 RawError* Precompiler::CompileAll() {
   LongJumpScope jump;
   if (setjmp(*jump.Set()) == 0) {
@@ -299,7 +333,18 @@ void Precompiler::DoCompileAll() {
 
       // Compile newly found targets and add their callees until we reach a
       // fixed point.
+      Timer compile_timer(FLAG_trace_precompiler, "Precompilation");
+      compile_timer.Start();
       Iterate();
+      compile_timer.Stop();
+      if (FLAG_trace_precompiler) {
+        const intptr_t num_tasks =
+            CompileInBatches() ? FLAG_precompiler_tasks : 0;
+        THR_Print("Compiled %" Pd " functions in %" Pd64 " us with %" Pd
+                  " helper tasks\n",
+                  function_count_, compile_timer.TotalElapsedTime(),
+                  num_tasks);
+      }
 
       // Replace the default type testing stubs installed on [Type]s with new
       // [Type]-specialized stubs.
@@ -332,6 +377,7 @@ void Precompiler::DoCompileAll() {
       // Clear these before dropping classes as they may hold onto otherwise
       // dead instances of classes we will remove or otherwise unused symbols.
       I->object_store()->set_unique_dynamic_targets(Array::null_array());
+      I->object_store()->set_aot_profile(Array::null_array());
       Class& null_class = Class::Handle(Z);
       Function& null_function = Function::Handle(Z);
       Field& null_field = Field::Handle(Z);
@@ -362,6 +408,10 @@ void Precompiler::DoCompileAll() {
 
     ProgramVisitor::Dedup();
 
+    if (FLAG_lazy_exception_handlers) {
+      MoveHandledTypes();
+    }
+
     if (il_serialization_stream() != nullptr) {
       auto file_close = Dart::file_close_callback();
       ASSERT(file_close != nullptr);
@@ -465,11 +515,16 @@ void Precompiler::AddRoots() {
 
 void Precompiler::Iterate() {
   Function& function = Function::Handle(Z);
+  const bool compile_in_batches = CompileInBatches();
 
   while (changed_) {
     changed_ = false;
 
     while (pending_functions_.Length() > 0) {
+      if (compile_in_batches) {
+        ProcessFunctionBatch();
+        continue;
+      }
       function ^= pending_functions_.RemoveLast();
       ProcessFunction(function);
     }
@@ -540,10 +595,328 @@ void Precompiler::CollectCallbackFields() {
   }
 }
 
+// A function of a batch compiled by Precompiler::ProcessFunctionBatch.
+struct BatchEntry {
+  const Function* function;
+  // The optimized graph awaiting register allocation and code generation,
+  // or NULL if the function is compiled on its own instead.
+  FlowGraph* flow_graph;
+  // The compilation state of the graph, owned by the frame of
+  // Precompiler::CompileBatch that built it.
+  DartCompilationPipeline* pipeline;
+  PrecompileParsedFunctionHelper* helper;
+  ZoneGrowableArray<const ICData*>* ic_data_array;
+  CompilerPassState* pass_state;
+  intptr_t gop_offset;
+  intptr_t gop_end;
+};
+
+// Runs register allocation for the flow graphs of a batch. The mutator
+// allocates registers for the last graph, whose zone is the current one, and
+// helper tasks allocate them for the others in their own zones. The tasks
+// keep their zones alive until Finish, when the mutator has generated code
+// for all graphs.
+class RegisterAllocationBatch : public ValueObject {
+ public:
+  RegisterAllocationBatch(Isolate* isolate, Monitor* monitor)
+      : isolate_(isolate),
+        monitor_(monitor),
+        entries_(),
+        next_entry_(0),
+        allocating_tasks_(0),
+        live_tasks_(0),
+        done_(false) {}
+
+  GrowableArray<BatchEntry>* entries() { return &entries_; }
+
+  void AllocateRegisters(Thread* thread);
+  void Finish(Thread* thread);
+
+  void RunTask();
+
+ private:
+  static void AllocateRegistersFor(Thread* thread, BatchEntry* entry);
+
+  Isolate* isolate_;
+  Monitor* monitor_;
+  GrowableArray<BatchEntry> entries_;
+
+  // Guarded by monitor_.
+  intptr_t next_entry_;
+  intptr_t allocating_tasks_;
+  intptr_t live_tasks_;
+  bool done_;
+
+  DISALLOW_COPY_AND_ASSIGN(RegisterAllocationBatch);
+};
+
+class RegisterAllocationTask : public ThreadPool::Task {
+ public:
+  explicit RegisterAllocationTask(RegisterAllocationBatch* batch)
+      : batch_(batch) {}
+
+  virtual void Run() { batch_->RunTask(); }
+
+ private:
+  RegisterAllocationBatch* batch_;
+
+  DISALLOW_COPY_AND_ASSIGN(RegisterAllocationTask);
+};
+
+void RegisterAllocationBatch::AllocateRegistersFor(Thread* thread,
+                                                   BatchEntry* entry) {
+  FlowGraph* const flow_graph = entry->flow_graph;
+  if (flow_graph == nullptr) {
+    return;
+  }
+  Thread* const owner = flow_graph->thread();
+  flow_graph->set_thread(thread);
+  LongJumpScope jump;
+  if (setjmp(*jump.Set()) == 0) {
+    CompilerPassState pass_state(thread, flow_graph, nullptr);
+    FlowGraph* result = CompilerPass::RunPipelineWithPasses(
+        &pass_state, {CompilerPass::kAllocateRegisters});
+    ASSERT(result == flow_graph);
+  } else {
+    // The bailout is reported again when the function is compiled on its
+    // own.
+    thread->ClearStickyError();
+    entry->flow_graph = nullptr;
+  }
+  flow_graph->set_thread(owner);
+}
+
+void RegisterAllocationBatch::AllocateRegisters(Thread* thread) {
+  const intptr_t length = entries_.length();
+  ASSERT(length > 0);
+  const intptr_t num_tasks =
+      Utils::Minimum<intptr_t>(FLAG_precompiler_tasks, length - 1);
+  {
+    MonitorLocker ml(monitor_);
+    allocating_tasks_ = live_tasks_ = num_tasks;
+  }
+  for (intptr_t i = 0; i < num_tasks; i++) {
+    if (!Dart::thread_pool()->Run<RegisterAllocationTask>(this)) {
+      MonitorLocker ml(monitor_);
+      allocating_tasks_--;
+      live_tasks_--;
+    }
+  }
+
+  AllocateRegistersFor(thread, &entries_[length - 1]);
+
+  MonitorLocker ml(monitor_);
+  while (allocating_tasks_ > 0) {
+    ml.WaitWithSafepointCheck(thread);
+  }
+  // Without tasks, the remaining graphs have no zone to be allocated in.
+  for (intptr_t i = next_entry_; i < length - 1; i++) {
+    entries_[i].flow_graph = nullptr;
+  }
+  next_entry_ = length - 1;
+}
+
+void RegisterAllocationBatch::Finish(Thread* thread) {
+  MonitorLocker ml(monitor_);
+  done_ = true;
+  ml.NotifyAll();
+  while (live_tasks_ > 0) {
+    ml.WaitWithSafepointCheck(thread);
+  }
+}
+
+void RegisterAllocationBatch::RunTask() {
+  bool result = Thread::EnterIsolateAsHelper(isolate_, Thread::kCompilerTask);
+  ASSERT(result);
+  {
+    Thread* thread = Thread::Current();
+    StackZone stack_zone(thread);
+    HANDLESCOPE(thread);
+    const intptr_t last = entries_.length() - 1;
+    while (true) {
+      intptr_t index = -1;
+      {
+        MonitorLocker ml(monitor_);
+        if (next_entry_ < last) {
+          index = next_entry_++;
+        }
+      }
+      if (index < 0) {
+        break;
+      }
+      AllocateRegistersFor(thread, &entries_[index]);
+    }
+
+    MonitorLocker ml(monitor_);
+    if (--allocating_tasks_ == 0) {
+      ml.NotifyAll();
+    }
+    // The allocated graphs point into this task's zone.
+    while (!done_) {
+      ml.WaitWithSafepointCheck(thread);
+    }
+  }
+  Thread::ExitIsolateAsHelper();
+  MonitorLocker ml(monitor_);
+  if (--live_tasks_ == 0) {
+    ml.NotifyAll();
+  }
+}
+
+void Precompiler::ProcessFunctionBatch() {
+  HANDLESCOPE(T);
+  // Independent of --precompiler_tasks, so that the batches and thus the
+  // generated code are the same for any number of tasks.
+  const intptr_t kFunctionsPerBatch = 16;
+
+  RegisterAllocationBatch batch(I, &batch_monitor_);
+  GrowableArray<BatchEntry>* entries = batch.entries();
+  Function& function = Function::Handle(Z);
+  while ((entries->length() < kFunctionsPerBatch) &&
+         (pending_functions_.Length() > 0)) {
+    function ^= pending_functions_.RemoveLast();
+    if (function.HasCode() || !function.IsOptimizable()) {
+      ProcessFunction(function);
+      continue;
+    }
+    function_count_++;
+    if (FLAG_trace_precompiler) {
+      THR_Print("Precompiling %" Pd " %s (%s, %s)\n", function_count_,
+                function.ToLibNamePrefixedQualifiedCString(),
+                function.token_pos().ToCString(),
+                Function::KindToCString(function.kind()));
+    }
+    ASSERT(!function.is_abstract());
+    ASSERT(!function.IsRedirectingFactory());
+    BatchEntry entry = {&Function::Handle(Z, function.raw()),
+                        nullptr,
+                        nullptr,
+                        nullptr,
+                        nullptr,
+                        nullptr,
+                        0,
+                        0};
+    entries->Add(entry);
+  }
+  if (entries->is_empty()) {
+    return;
+  }
+
+  error_ = Error::null();
+  CompileBatch(&batch, 0);
+  batch.Finish(T);
+  if (!error_.IsNull()) {
+    Jump(error_);
+  }
+
+  for (intptr_t i = 0; i < entries->length(); i++) {
+    const BatchEntry& entry = (*entries)[i];
+    AddCalleesOf(*entry.function, entry.gop_offset, entry.gop_end);
+  }
+}
+
+// Builds and optimizes the graph of the function at [index] in its own zone
+// and recurses, so that the zones of all functions of the batch are alive
+// when registers are allocated for them and code is generated, in the order
+// of the batch.
+void Precompiler::CompileBatch(RegisterAllocationBatch* batch, intptr_t index) {
+  GrowableArray<BatchEntry>* entries = batch->entries();
+  if (index == entries->length()) {
+    {
+      TIMELINE_DURATION(T, CompilerVerbose, "AllocateRegisters");
+      batch->AllocateRegisters(T);
+    }
+    for (intptr_t i = 0; i < entries->length(); i++) {
+      GenerateBatchCode(&(*entries)[i]);
+    }
+    return;
+  }
+
+  BatchEntry* entry = &(*entries)[index];
+  const Function& function = *entry->function;
+  StackZone stack_zone(T);
+  Zone* const function_zone = stack_zone.GetZone();
+  HANDLESCOPE(T);
+
+  DartCompilationPipeline pipeline;
+  ParsedFunction* parsed_function = new (function_zone) ParsedFunction(
+      T, Function::ZoneHandle(function_zone, function.raw()));
+  PrecompileParsedFunctionHelper helper(this, parsed_function,
+                                        /*optimized=*/true);
+  SpeculativeInliningPolicy speculative_policy(
+      true, FLAG_max_speculative_inlining_attempts);
+  CompilerState compiler_state(T);
+  ZoneGrowableArray<const ICData*>* ic_data_array =
+      new (function_zone) ZoneGrowableArray<const ICData*>();
+  CompilerPassState pass_state(T, nullptr, &speculative_policy, this);
+  pass_state.defer_register_allocation = true;
+
+  {
+    TIMELINE_FUNCTION_COMPILATION_DURATION(T, "CompileFunction", function);
+    LongJumpScope jump;
+    if (setjmp(*jump.Set()) == 0) {
+      {
+        HANDLESCOPE(T);
+        pipeline.ParseFunction(parsed_function);
+      }
+      entry->flow_graph =
+          helper.BuildAndOptimizeGraph(&pipeline, ic_data_array, &pass_state);
+    } else {
+      // Errors and bailouts are reported again when the function is compiled
+      // on its own.
+      T->ClearStickyError();
+      entry->flow_graph = nullptr;
+    }
+  }
+
+  entry->pipeline = &pipeline;
+  entry->helper = &helper;
+  entry->ic_data_array = ic_data_array;
+  entry->pass_state = &pass_state;
+  CompileBatch(batch, index + 1);
+  entry->pipeline = nullptr;
+  entry->helper = nullptr;
+  entry->ic_data_array = nullptr;
+  entry->pass_state = nullptr;
+}
+
+// Generates code for a function of a batch once registers are allocated for
+// its graph, or compiles the function on its own if that failed.
+void Precompiler::GenerateBatchCode(BatchEntry* entry) {
+  const Function& function = *entry->function;
+  entry->gop_offset = GlobalObjectPoolLength();
+  bool is_compiled = false;
+  if (entry->flow_graph != nullptr) {
+    TIMELINE_FUNCTION_COMPILATION_DURATION(T, "CompileFunction", function);
+    LongJumpScope jump;
+    if (setjmp(*jump.Set()) == 0) {
+      FlowGraph* flow_graph = CompilerPass::RunPipelineWithPasses(
+          entry->pass_state, {CompilerPass::kReorderBlocks});
+      entry->helper->GenerateCode(entry->pipeline, flow_graph,
+                                  entry->ic_data_array, entry->pass_state,
+                                  /*use_far_branches=*/false);
+      is_compiled = true;
+    } else {
+      // Retry far branches and failed speculation as usual.
+      T->ClearStickyError();
+    }
+  }
+  if (!is_compiled) {
+    const Error& error =
+        Error::Handle(Z, CompileFunction(this, T, zone_, function));
+    if (!error.IsNull() && error_.IsNull()) {
+      error_ = error.raw();
+    }
+  }
+  if (function.HasCode()) {
+    // Used in the JIT to save type-feedback across compilations.
+    function.ClearICDataArray();
+  }
+  entry->gop_end = GlobalObjectPoolLength();
+}
+
 void Precompiler::ProcessFunction(const Function& function) {
-  const intptr_t gop_offset =
-      FLAG_use_bare_instructions ? global_object_pool_builder()->CurrentLength()
-                                 : 0;
+  const intptr_t gop_offset = GlobalObjectPoolLength();
 
   if (!function.HasCode()) {
     function_count_++;
@@ -576,10 +949,18 @@ void Precompiler::ProcessFunction(const Function& function) {
   }
 
   ASSERT(function.HasCode());
-  AddCalleesOf(function, gop_offset);
+  AddCalleesOf(function, gop_offset, GlobalObjectPoolLength());
 }
 
-void Precompiler::AddCalleesOf(const Function& function, intptr_t gop_offset) {
+intptr_t Precompiler::GlobalObjectPoolLength() {
+  return FLAG_use_bare_instructions
+             ? global_object_pool_builder()->CurrentLength()
+             : 0;
+}
+
+void Precompiler::AddCalleesOf(const Function& function,
+                               intptr_t gop_offset,
+                               intptr_t gop_end) {
   ASSERT(function.HasCode());
 
   const Code& code = Code::Handle(Z, function.CurrentCode());
@@ -608,8 +989,7 @@ void Precompiler::AddCalleesOf(const Function& function, intptr_t gop_offset) {
 
   String& selector = String::Handle(Z);
   if (FLAG_use_bare_instructions) {
-    for (intptr_t i = gop_offset;
-         i < global_object_pool_builder()->CurrentLength(); i++) {
+    for (intptr_t i = gop_offset; i < gop_end; i++) {
       const auto& wrapper_entry = global_object_pool_builder()->EntryAt(i);
       if (wrapper_entry.type() ==
           compiler::ObjectPoolBuilderEntry::kTaggedObject) {
@@ -896,16 +1276,13 @@ void Precompiler::AddField(const Field& field) {
         if (FLAG_trace_precompiler) {
           THR_Print("Precompiling initializer for %s\n", field.ToCString());
         }
-        const intptr_t gop_offset =
-            FLAG_use_bare_instructions
-                ? global_object_pool_builder()->CurrentLength()
-                : 0;
+        const intptr_t gop_offset = GlobalObjectPoolLength();
         ASSERT(Dart::vm_snapshot_kind() != Snapshot::kFullAOT);
         const Function& initializer =
             Function::Handle(Z, CompileStaticInitializer(field));
         ASSERT(!initializer.IsNull());
         field.SetInitializerFunction(initializer);
-        AddCalleesOf(initializer, gop_offset);
+        AddCalleesOf(initializer, gop_offset, GlobalObjectPoolLength());
       }
     }
   }
@@ -2102,6 +2479,46 @@ void Precompiler::DedupUnlinkedCalls() {
 #endif
 }
 
+void Precompiler::MoveHandledTypes() {
+  class HandlersCollector : public ObjectVisitor {
+   public:
+    explicit HandlersCollector(
+        Zone* zone,
+        GrowableHandlePtrArray<const ExceptionHandlers>* handlers)
+        : handlers_(ExceptionHandlers::Handle(zone)),
+          handlers_list_(handlers) {}
+
+    void VisitObject(RawObject* obj) {
+      if (obj->GetClassId() == kExceptionHandlersCid) {
+        handlers_ ^= obj;
+        if (handlers_.num_entries() > 0) {
+          handlers_list_->Add(handlers_);
+        }
+      }
+    }
+
+   private:
+    ExceptionHandlers& handlers_;
+    GrowableHandlePtrArray<const ExceptionHandlers>* handlers_list_;
+  };
+
+  GrowableHandlePtrArray<const ExceptionHandlers> handlers(Z, 100);
+  I->heap()->CollectAllGarbage();
+  {
+    HeapIterationScope his(T);
+    HandlersCollector visitor(Z, &handlers);
+    I->heap()->VisitObjects(&visitor);
+  }
+
+  const GrowableObjectArray& table =
+      GrowableObjectArray::Handle(Z, GrowableObjectArray::New());
+  for (intptr_t i = 0; i < handlers.length(); i++) {
+    handlers.At(i).MoveHandledTypesTo(table);
+  }
+  I->object_store()->set_exception_handled_types(
+      Array::Handle(Z, Array::MakeFixedLength(table)));
+}
+
 void Precompiler::Obfuscate() {
   if (!I->obfuscate()) {
     return;
@@ -2229,6 +2646,114 @@ void PrecompileParsedFunctionHelper::FinalizeCompilation(
   }
 }
 
+FlowGraph* PrecompileParsedFunctionHelper::BuildAndOptimizeGraph(
+    CompilationPipeline* pipeline,
+    ZoneGrowableArray<const ICData*>* ic_data_array,
+    CompilerPassState* pass_state) {
+  const Function& function = parsed_function()->function();
+  Zone* const zone = thread()->zone();
+
+  FlowGraph* flow_graph = nullptr;
+  {
+    TIMELINE_DURATION(thread(), CompilerVerbose, "BuildFlowGraph");
+    flow_graph =
+        pipeline->BuildFlowGraph(zone, parsed_function(), ic_data_array,
+                                 Compiler::kNoOSRDeoptId, optimized());
+  }
+
+  if (optimized()) {
+    flow_graph->PopulateWithICData(parsed_function()->function());
+  }
+
+  const bool print_flow_graph =
+      (FLAG_print_flow_graph ||
+       (optimized() && FLAG_print_flow_graph_optimized)) &&
+      FlowGraphPrinter::ShouldPrint(function);
+
+  if (print_flow_graph && !optimized()) {
+    FlowGraphPrinter::PrintGraph("Unoptimized Compilation", flow_graph);
+  }
+
+  pass_state->flow_graph = flow_graph;
+  pass_state->reorder_blocks =
+      FlowGraph::ShouldReorderBlocks(function, optimized());
+  if (pass_state->reorder_blocks) {
+    TIMELINE_DURATION(thread(), CompilerVerbose,
+                      "BlockScheduler::AssignEdgeWeights");
+    BlockScheduler::AssignEdgeWeights(flow_graph);
+  }
+
+  if (function.ForceOptimize()) {
+    ASSERT(optimized());
+    TIMELINE_DURATION(thread(), CompilerVerbose, "OptimizationPasses");
+    flow_graph = CompilerPass::RunForceOptimizedPipeline(CompilerPass::kAOT,
+                                                         pass_state);
+  } else if (optimized()) {
+    TIMELINE_DURATION(thread(), CompilerVerbose, "OptimizationPasses");
+
+    pass_state->inline_id_to_function.Add(&function);
+    // We do not add the token position now because we don't know the
+    // position of the inlined call until later. A side effect of this
+    // is that the length of |inline_id_to_function| is always larger
+    // than the length of |inline_id_to_token_pos| by one.
+    // Top scope function has no caller (-1). We do this because we expect
+    // all token positions to be at an inlined call.
+    // Top scope function has no caller (-1).
+    pass_state->caller_inline_id.Add(-1);
+
+    AotCallSpecializer call_specializer(precompiler_, flow_graph,
+                                        pass_state->speculative_policy);
+    pass_state->call_specializer = &call_specializer;
+
+    flow_graph = CompilerPass::RunPipeline(CompilerPass::kAOT, pass_state);
+
+    pass_state->call_specializer = nullptr;
+  }
+
+  ASSERT(pass_state->inline_id_to_function.length() ==
+         pass_state->caller_inline_id.length());
+  return flow_graph;
+}
+
+void PrecompileParsedFunctionHelper::GenerateCode(
+    CompilationPipeline* pipeline,
+    FlowGraph* flow_graph,
+    ZoneGrowableArray<const ICData*>* ic_data_array,
+    CompilerPassState* pass_state,
+    bool use_far_branches) {
+  ASSERT(!FLAG_use_bare_instructions || precompiler_ != nullptr);
+
+  compiler::ObjectPoolBuilder object_pool;
+  compiler::ObjectPoolBuilder* active_object_pool_builder =
+      FLAG_use_bare_instructions ? precompiler_->global_object_pool_builder()
+                                 : &object_pool;
+  compiler::Assembler assembler(active_object_pool_builder, use_far_branches);
+
+  CodeStatistics* function_stats = NULL;
+  if (FLAG_print_instruction_stats) {
+    // At the moment we are leaking CodeStatistics objects for
+    // simplicity because this is just a development mode flag.
+    function_stats = new CodeStatistics(&assembler);
+  }
+
+  FlowGraphCompiler graph_compiler(
+      &assembler, flow_graph, *parsed_function(), optimized(),
+      pass_state->speculative_policy, pass_state->inline_id_to_function,
+      pass_state->inline_id_to_token_pos, pass_state->caller_inline_id,
+      ic_data_array, function_stats);
+  {
+    TIMELINE_DURATION(thread(), CompilerVerbose, "CompileGraph");
+    graph_compiler.CompileGraph();
+    pipeline->FinalizeCompilation(flow_graph);
+  }
+  {
+    TIMELINE_DURATION(thread(), CompilerVerbose, "FinalizeCompilation");
+    ASSERT(thread()->IsMutatorThread());
+    FinalizeCompilation(&assembler, &graph_compiler, flow_graph,
+                        function_stats);
+  }
+}
+
 // Return false if bailed out.
 // If optimized_result_code is not NULL then it is caller's responsibility
 // to install code.
@@ -2259,99 +2784,17 @@ bool PrecompileParsedFunctionHelper::Compile(CompilationPipeline* pipeline) {
     LongJumpScope jump;
     const intptr_t val = setjmp(*jump.Set());
     if (val == 0) {
-      FlowGraph* flow_graph = nullptr;
-      ZoneGrowableArray<const ICData*>* ic_data_array = nullptr;
-
       CompilerState compiler_state(thread());
 
-      {
-        ic_data_array = new (zone) ZoneGrowableArray<const ICData*>();
-
-        TIMELINE_DURATION(thread(), CompilerVerbose, "BuildFlowGraph");
-        flow_graph =
-            pipeline->BuildFlowGraph(zone, parsed_function(), ic_data_array,
-                                     Compiler::kNoOSRDeoptId, optimized());
-      }
-
-      if (optimized()) {
-        flow_graph->PopulateWithICData(parsed_function()->function());
-      }
-
-      const bool print_flow_graph =
-          (FLAG_print_flow_graph ||
-           (optimized() && FLAG_print_flow_graph_optimized)) &&
-          FlowGraphPrinter::ShouldPrint(function);
-
-      if (print_flow_graph && !optimized()) {
-        FlowGraphPrinter::PrintGraph("Unoptimized Compilation", flow_graph);
-      }
-
-      CompilerPassState pass_state(thread(), flow_graph, &speculative_policy,
+      ZoneGrowableArray<const ICData*>* ic_data_array =
+          new (zone) ZoneGrowableArray<const ICData*>();
+      CompilerPassState pass_state(thread(), nullptr, &speculative_policy,
                                    precompiler_);
-      pass_state.reorder_blocks =
-          FlowGraph::ShouldReorderBlocks(function, optimized());
-
-      if (function.ForceOptimize()) {
-        ASSERT(optimized());
-        TIMELINE_DURATION(thread(), CompilerVerbose, "OptimizationPasses");
-        flow_graph = CompilerPass::RunForceOptimizedPipeline(CompilerPass::kAOT,
-                                                             &pass_state);
-      } else if (optimized()) {
-        TIMELINE_DURATION(thread(), CompilerVerbose, "OptimizationPasses");
-
-        pass_state.inline_id_to_function.Add(&function);
-        // We do not add the token position now because we don't know the
-        // position of the inlined call until later. A side effect of this
-        // is that the length of |inline_id_to_function| is always larger
-        // than the length of |inline_id_to_token_pos| by one.
-        // Top scope function has no caller (-1). We do this because we expect
-        // all token positions to be at an inlined call.
-        // Top scope function has no caller (-1).
-        pass_state.caller_inline_id.Add(-1);
-
-        AotCallSpecializer call_specializer(precompiler_, flow_graph,
-                                            &speculative_policy);
-        pass_state.call_specializer = &call_specializer;
-
-        flow_graph = CompilerPass::RunPipeline(CompilerPass::kAOT, &pass_state);
-      }
-
-      ASSERT(pass_state.inline_id_to_function.length() ==
-             pass_state.caller_inline_id.length());
-
-      ASSERT(!FLAG_use_bare_instructions || precompiler_ != nullptr);
-
-      compiler::ObjectPoolBuilder object_pool;
-      compiler::ObjectPoolBuilder* active_object_pool_builder =
-          FLAG_use_bare_instructions
-              ? precompiler_->global_object_pool_builder()
-              : &object_pool;
-      compiler::Assembler assembler(active_object_pool_builder,
-                                    use_far_branches);
+      FlowGraph* flow_graph =
+          BuildAndOptimizeGraph(pipeline, ic_data_array, &pass_state);
+      GenerateCode(pipeline, flow_graph, ic_data_array, &pass_state,
+                   use_far_branches);
 
-      CodeStatistics* function_stats = NULL;
-      if (FLAG_print_instruction_stats) {
-        // At the moment we are leaking CodeStatistics objects for
-        // simplicity because this is just a development mode flag.
-        function_stats = new CodeStatistics(&assembler);
-      }
-
-      FlowGraphCompiler graph_compiler(
-          &assembler, flow_graph, *parsed_function(), optimized(),
-          &speculative_policy, pass_state.inline_id_to_function,
-          pass_state.inline_id_to_token_pos, pass_state.caller_inline_id,
-          ic_data_array, function_stats);
-      {
-        TIMELINE_DURATION(thread(), CompilerVerbose, "CompileGraph");
-        graph_compiler.CompileGraph();
-        pipeline->FinalizeCompilation(flow_graph);
-      }
-      {
-        TIMELINE_DURATION(thread(), CompilerVerbose, "FinalizeCompilation");
-        ASSERT(thread()->IsMutatorThread());
-        FinalizeCompilation(&assembler, &graph_compiler, flow_graph,
-                            function_stats);
-      }
       // Exit the loop and the function with the correct result value.
       is_compiled = true;
       done = true;
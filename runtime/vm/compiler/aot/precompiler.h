@@ -10,6 +10,7 @@
 #include "vm/hash_map.h"
 #include "vm/hash_table.h"
 #include "vm/object.h"
+#include "vm/os_thread.h"
 #include "vm/symbols.h"
 
 namespace dart {
@@ -28,6 +29,8 @@ class ParsedJSONArray;
 class Precompiler;
 class FlowGraph;
 class PrecompilerEntryPointsPrinter;
+class RegisterAllocationBatch;
+struct BatchEntry;
 
 class SymbolKeyValueTrait {
  public:
@@ -232,7 +235,12 @@ class Precompiler : public ValueObject {
   void AddTypesOf(const Class& cls);
   void AddTypesOf(const Function& function);
   void AddTypeArguments(const TypeArguments& args);
-  void AddCalleesOf(const Function& function, intptr_t gop_offset);
+  // Adds the callees of [function], whose entries in the global object pool
+  // are those in [gop_offset, gop_end).
+  void AddCalleesOf(const Function& function,
+                    intptr_t gop_offset,
+                    intptr_t gop_end);
+  intptr_t GlobalObjectPoolLength();
   void AddCalleesOfHelper(const Object& entry,
                           String* temp_selector,
                           Class* temp_cls);
@@ -245,6 +253,15 @@ class Precompiler : public ValueObject {
   bool IsSent(const String& selector);
 
   void ProcessFunction(const Function& function);
+
+  // Compiles a batch of pending functions, running their register
+  // allocation on --precompiler_tasks helper tasks. All other compilation
+  // work, including code generation, the global object pool and code
+  // installation, stays on the mutator and happens in a fixed order, so the
+  // result does not depend on the timing of the tasks.
+  void ProcessFunctionBatch();
+  void CompileBatch(RegisterAllocationBatch* batch, intptr_t index);
+  void GenerateBatchCode(BatchEntry* entry);
   void CheckForNewDynamicFunctions();
   void CollectCallbackFields();
 
@@ -268,6 +285,10 @@ class Precompiler : public ValueObject {
   // Deduplicate the UnlinkedCall objects in all ObjectPools to reduce snapshot
   // size.
   void DedupUnlinkedCalls();
+  // Move the handled types of all exception handlers into the object store,
+  // so that the handlers can be left in the read-only snapshot image (see
+  // --lazy-exception-handlers).
+  void MoveHandledTypes();
 
   void Obfuscate();
 
@@ -314,6 +335,7 @@ class Precompiler : public ValueObject {
   AbstractTypeSet types_to_retain_;
   InstanceSet consts_to_retain_;
   Error& error_;
+  Monitor batch_monitor_;
 
   bool get_runtime_type_is_unique_;
   void* il_serialization_stream_;
@@ -8,6 +8,7 @@
 
 #include "vm/allocation.h"
 #include "vm/code_patcher.h"
+#include "vm/compilation_trace.h"
 #include "vm/compiler/backend/flow_graph.h"
 #include "vm/compiler/jit/compiler.h"
 
@@ -55,25 +56,31 @@ void BlockScheduler::AssignEdgeWeights(FlowGraph* flow_graph) {
   if (!FLAG_reorder_basic_blocks) {
     return;
   }
-  if (FLAG_precompiled_mode) {
-    return;
-  }
 
   const Function& function = flow_graph->parsed_function().function();
-  const Array& ic_data_array =
-      Array::Handle(flow_graph->zone(), function.ic_data_array());
-  if (Compiler::IsBackgroundCompilation() && ic_data_array.IsNull()) {
-    // Deferred loading cleared ic_data_array.
-    Compiler::AbortBackgroundCompilation(
-        DeoptId::kNone, "BlockScheduler: ICData array cleared");
-  }
-  if (ic_data_array.IsNull()) {
-    DEBUG_ASSERT(Isolate::Current()->HasAttemptedReload() ||
-                 function.ForceOptimize());
-    return;
-  }
   Array& edge_counters = Array::Handle();
-  edge_counters ^= ic_data_array.At(0);
+  if (FLAG_precompiled_mode) {
+    // Counters are only available from a training run.
+    edge_counters =
+        AotProfile::EdgeCounters(function, flow_graph->preorder().length());
+    if (edge_counters.IsNull()) {
+      return;
+    }
+  } else {
+    const Array& ic_data_array =
+        Array::Handle(flow_graph->zone(), function.ic_data_array());
+    if (Compiler::IsBackgroundCompilation() && ic_data_array.IsNull()) {
+      // Deferred loading cleared ic_data_array.
+      Compiler::AbortBackgroundCompilation(
+          DeoptId::kNone, "BlockScheduler: ICData array cleared");
+    }
+    if (ic_data_array.IsNull()) {
+      DEBUG_ASSERT(Isolate::Current()->HasAttemptedReload() ||
+                   function.ForceOptimize());
+      return;
+    }
+    edge_counters ^= ic_data_array.At(0);
+  }
 
   auto graph_entry = flow_graph->graph_entry();
   BlockEntryInstr* entry = graph_entry->normal_entry();
@@ -159,7 +166,9 @@ static void Union(GrowableArray<Chain*>* chains,
 }
 
 void BlockScheduler::ReorderBlocks(FlowGraph* flow_graph) {
-  if (FLAG_precompiled_mode) {
+  // In AOT, edge weights are only assigned from a training run.
+  if (FLAG_precompiled_mode &&
+      (flow_graph->graph_entry()->entry_count() == 0)) {
     ReorderBlocksAOT(flow_graph);
   } else {
     ReorderBlocksJIT(flow_graph);
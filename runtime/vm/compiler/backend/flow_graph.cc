@@ -7,6 +7,7 @@
 #include "vm/compiler/backend/flow_graph.h"
 
 #include "vm/bit_vector.h"
+#include "vm/compilation_trace.h"
 #include "vm/compiler/backend/flow_graph_compiler.h"
 #include "vm/compiler/backend/il.h"
 #include "vm/compiler/backend/il_printer.h"
@@ -27,6 +28,7 @@ DEFINE_FLAG(bool, use_smi_widening, false, "Enable Smi->Int32 widening pass.");
 DEFINE_FLAG(bool, trace_smi_widening, false, "Trace Smi->Int32 widening pass.");
 #endif
 DEFINE_FLAG(bool, prune_dead_locals, true, "optimize dead locals away");
+DECLARE_FLAG(int, inlining_polymorphic_variants_threshold);
 
 // Quick access to the current zone.
 #define Z (zone())
@@ -2201,6 +2203,11 @@ bool FlowGraph::Canonicalize() {
 
 void FlowGraph::PopulateWithICData(const Function& function) {
   Zone* zone = Thread::Current()->zone();
+  // In AOT the ICData stay empty, but the counts and receivers recorded for
+  // the function by a training run, if any, are attached to the calls.
+  const bool has_profile =
+      FLAG_precompiled_mode && AotProfile::HasProfile(function);
+  Array& call_site = Array::Handle(zone);
 
   for (BlockIterator block_it = reverse_postorder_iterator(); !block_it.Done();
        block_it.Advance()) {
@@ -2218,6 +2225,14 @@ void FlowGraph::PopulateWithICData(const Function& function) {
                           call->deopt_id(), call->checked_argument_count(),
                           ICData::kInstance));
           call->set_ic_data(&ic_data);
+          if (has_profile) {
+            call_site = AotProfile::FindCallSite(
+                function, call->token_pos(), call->function_name(),
+                call->checked_argument_count());
+            if (!call_site.IsNull()) {
+              AddProfiledTargets(function, call, call_site);
+            }
+          }
         }
       } else if (instr->IsStaticCall()) {
         StaticCallInstr* call = instr->AsStaticCall();
@@ -2232,6 +2247,14 @@ void FlowGraph::PopulateWithICData(const Function& function) {
                                 arguments_descriptor, call->deopt_id(),
                                 num_args_checked, ICData::kStatic));
           ic_data.AddTarget(target);
+          if (has_profile) {
+            call_site = AotProfile::FindCallSite(
+                function, call->token_pos(),
+                String::Handle(zone, target.name()), num_args_checked);
+            if (!call_site.IsNull()) {
+              ic_data.SetCountAt(0, AotProfile::CallCount(call_site));
+            }
+          }
           call->set_ic_data(&ic_data);
         }
       }
@@ -2239,6 +2262,24 @@ void FlowGraph::PopulateWithICData(const Function& function) {
   }
 }
 
+void FlowGraph::AddProfiledTargets(const Function& function,
+                                   InstanceCallInstr* call,
+                                   const Array& call_site) {
+  Zone* zone = Thread::Current()->zone();
+  const ICData& profiled = ICData::Handle(
+      zone, ICData::New(function, call->function_name(),
+                        Array::Handle(zone, call->GetArgumentsDescriptor()),
+                        call->deopt_id(), call->checked_argument_count(),
+                        ICData::kInstance));
+  AotProfile::AddReceiverChecks(call_site, profiled);
+  const CallTargets* targets = CallTargets::Create(zone, profiled);
+  // Dispatching on the classes of megamorphic calls does not pay off.
+  if (!targets->is_empty() &&
+      (targets->length() <= FLAG_inlining_polymorphic_variants_threshold)) {
+    call->SetProfiledTargets(targets);
+  }
+}
+
 // Optimize (a << b) & c pattern: if c is a positive Smi or zero, then the
 // shift can be a truncating Smi shift-left and result is always Smi.
 // Merging occurs only per basic-block.
@@ -218,6 +218,11 @@ class FlowGraph : public ZoneAllocated {
   Zone* zone() const { return thread()->zone(); }
   Isolate* isolate() const { return thread()->isolate(); }
 
+  // Hands the graph over to [thread], which then allocates in its own zone
+  // when it transforms the graph. Used by the precompiler to run register
+  // allocation on helper threads.
+  void set_thread(Thread* thread) { thread_ = thread; }
+
   intptr_t max_block_id() const { return max_block_id_; }
   void set_max_block_id(intptr_t id) { max_block_id_ = id; }
   intptr_t allocate_block_id() { return ++max_block_id_; }
@@ -460,6 +465,10 @@ class FlowGraph : public ZoneAllocated {
 
   void RemoveDeadPhis(GrowableArray<PhiInstr*>* live_phis);
 
+  void AddProfiledTargets(const Function& function,
+                          InstanceCallInstr* call,
+                          const Array& call_site);
+
   void ReplacePredecessor(BlockEntryInstr* old_block,
                           BlockEntryInstr* new_block);
 
@@ -2087,11 +2087,23 @@ void FlowGraphCompiler::EmitPolymorphicInstanceCall(
                       original_call.entry_kind());
       assembler()->Bind(&ok);
     } else {
+      // Call the targets directly for the classes they were selected for,
+      // and use a switchable call for the other receivers instead of
+      // deoptimizing.
+      compiler::Label ok, miss;
+      EmitTestAndCall(targets, original_call.function_name(), args_info,
+                      &miss,  // No cid match.
+                      &ok,    // Found cid.
+                      deopt_id, token_pos, locs, false, total_ic_calls,
+                      original_call.entry_kind());
+      assembler()->Jump(&ok);
+      assembler()->Bind(&miss);
       const ICData& unary_checks = ICData::ZoneHandle(
           zone(), original_call.ic_data()->AsUnaryClassChecks());
       // TODO(sjindel/entrypoints): Support skiping type checks on switchable
       // calls.
       EmitInstanceCallAOT(unary_checks, deopt_id, token_pos, locs);
+      assembler()->Bind(&ok);
     }
   }
 }
@@ -3642,6 +3642,9 @@ class InstanceCallInstr : public TemplateDartCall<0> {
   void set_has_unique_selector(bool b) { has_unique_selector_ = b; }
 
   virtual intptr_t CallCount() const {
+    if (profiled_targets_ != nullptr) {
+      return profiled_targets_->AggregateCallCount();
+    }
     return ic_data() == NULL ? 0 : ic_data()->AggregateCount();
   }
 
@@ -3692,6 +3695,14 @@ class InstanceCallInstr : public TemplateDartCall<0> {
     binary_ = binary;
   }
 
+  // The targets seen by this call in a training run of the precompiled
+  // program (see AotProfile). Unlike Targets(), they need not cover all
+  // receivers, so they only guide speculative dispatch.
+  const CallTargets* ProfiledTargets() const { return profiled_targets_; }
+  void SetProfiledTargets(const CallTargets* targets) {
+    profiled_targets_ = targets;
+  }
+
  protected:
   friend class CallSpecializer;
   void set_ic_data(ICData* value) { ic_data_ = value; }
@@ -3699,6 +3710,7 @@ class InstanceCallInstr : public TemplateDartCall<0> {
  private:
   const ICData* ic_data_;
   const CallTargets* targets_ = nullptr;
+  const CallTargets* profiled_targets_ = nullptr;
   const class BinaryFeedback* binary_ = nullptr;
   const String& function_name_;
   const Token::Kind token_kind_;  // Binary op, unary op, kGET or kILLEGAL.
@@ -7202,6 +7214,7 @@ class CheckStackOverflowInstr : public TemplateInstruction<0, NoThrow> {
   bool in_loop() const { return loop_depth_ > 0; }
   intptr_t stack_depth() const { return stack_depth_; }
   intptr_t loop_depth() const { return loop_depth_; }
+  Kind kind() const { return kind_; }
 
   DECLARE_INSTRUCTION(CheckStackOverflow)
 
@@ -1384,8 +1384,12 @@ void LoadIndexedInstr::EmitNativeCode(FlowGraphCompiler* compiler) {
       case kTypedDataFloat64x2ArrayCid:
       case kTypedDataInt32x4ArrayCid:
       case kTypedDataFloat32x4ArrayCid:
-        ASSERT(aligned());
-        __ fldrq(result, element_address);
+        // Vector loads from normal memory may be unaligned.
+        if (aligned()) {
+          __ fldrq(result, element_address);
+        } else {
+          __ fldrq(result, compiler::Address(address));
+        }
         break;
       default:
         UNREACHABLE();
@@ -1747,7 +1751,7 @@ void StoreIndexedInstr::EmitNativeCode(FlowGraphCompiler* compiler) {
     case kTypedDataFloat64x2ArrayCid:
     case kTypedDataInt32x4ArrayCid:
     case kTypedDataFloat32x4ArrayCid: {
-      ASSERT(aligned());
+      // Vector stores to normal memory may be unaligned.
       const VRegister value_reg = locs()->in(2).fpu_reg();
       __ fstrq(value_reg, compiler::Address(address));
       break;
@@ -6,6 +6,7 @@
 
 #include "vm/compiler/backend/inliner.h"
 
+#include "vm/compilation_trace.h"
 #include "vm/compiler/aot/aot_call_specializer.h"
 #include "vm/compiler/aot/precompiler.h"
 #include "vm/compiler/backend/block_scheduler.h"
@@ -39,6 +40,12 @@ DEFINE_FLAG(int,
             inline_getters_setters_smaller_than,
             10,
             "Always inline getters and setters that have fewer instructions");
+DEFINE_FLAG(int,
+            inlining_dispatch_tree_threshold,
+            3,
+            "Dispatch to the variants inlined at a polymorphic call with a "
+            "balanced tree of class id tests when at least threshold variants "
+            "are inlined and others are not.");
 DEFINE_FLAG(int,
             inlining_depth_threshold,
             6,
@@ -56,6 +63,11 @@ DEFINE_FLAG(int,
             inlining_callee_size_threshold,
             160,
             "Do not inline callees larger than threshold");
+DEFINE_FLAG(int,
+            inlining_non_escaping_size_threshold,
+            100,
+            "Inline functions that have threshold or fewer instructions when "
+            "this allows the allocation of an argument to be removed.");
 DEFINE_FLAG(int,
             inlining_small_leaf_size_threshold,
             50,
@@ -69,6 +81,16 @@ DEFINE_FLAG(int,
             10,
             "Inline only hotter calls, in percents (0 .. 100); "
             "default 10%: calls above-equal 10% of max-count are inlined.");
+DEFINE_FLAG(int,
+            inlining_polymorphic_variants_threshold,
+            20,
+            "Do not inline at polymorphic calls with more variants.");
+DEFINE_FLAG(int,
+            inlining_polymorphic_size_budget,
+            100,
+            "Once --max-polymorphic-checks variants are inlined at a "
+            "polymorphic call, inline further ones only while the inlined "
+            "bodies have fewer instructions in total.");
 DEFINE_FLAG(int,
             inlining_recursion_depth_threshold,
             1,
@@ -343,9 +365,13 @@ class CallSites : public ValueObject {
   // Computes the ratio for each call site in a method, defined as the
   // number of times a call site is executed over the maximum number of
   // times any call site is executed in the method. JIT uses actual call
-  // counts whereas AOT uses a static estimate based on nesting depth.
-  void ComputeCallSiteRatio(intptr_t static_call_start_ix,
+  // counts whereas AOT uses a static estimate based on nesting depth, unless
+  // the method was profiled in a training run (see AotProfile).
+  void ComputeCallSiteRatio(const FlowGraph* graph,
+                            intptr_t static_call_start_ix,
                             intptr_t instance_call_start_ix) {
+    const bool use_call_counts =
+        !FLAG_precompiled_mode || AotProfile::HasProfile(graph->function());
     const intptr_t num_static_calls =
         static_calls_.length() - static_call_start_ix;
     const intptr_t num_instance_calls =
@@ -357,8 +383,8 @@ class CallSites : public ValueObject {
       const InstanceCallInfo& info =
           instance_calls_[i + instance_call_start_ix];
       intptr_t aggregate_count =
-          FLAG_precompiled_mode ? AotCallCountApproximation(info.nesting_depth)
-                                : info.call->CallCount();
+          use_call_counts ? info.call->CallCount()
+                          : AotCallCountApproximation(info.nesting_depth);
       instance_call_counts.Add(aggregate_count);
       if (aggregate_count > max_count) max_count = aggregate_count;
     }
@@ -367,8 +393,8 @@ class CallSites : public ValueObject {
     for (intptr_t i = 0; i < num_static_calls; ++i) {
       const StaticCallInfo& info = static_calls_[i + static_call_start_ix];
       intptr_t aggregate_count =
-          FLAG_precompiled_mode ? AotCallCountApproximation(info.nesting_depth)
-                                : info.call->CallCount();
+          use_call_counts ? info.call->CallCount()
+                          : AotCallCountApproximation(info.nesting_depth);
       static_call_counts.Add(aggregate_count);
       if (aggregate_count > max_count) max_count = aggregate_count;
     }
@@ -501,7 +527,8 @@ class CallSites : public ValueObject {
         }
       }
     }
-    ComputeCallSiteRatio(static_call_start_ix, instance_call_start_ix);
+    ComputeCallSiteRatio(graph, static_call_start_ix,
+                         instance_call_start_ix);
   }
 
  private:
@@ -595,6 +622,34 @@ class PolymorphicInliner : public ValueObject {
   bool TryInlineRecognizedMethod(intptr_t receiver_cid, const Function& target);
 
   TargetEntryInstr* BuildDecisionGraph();
+  TargetEntryInstr* BuildDecisionTree();
+  void BuildDecisionSubtree(BlockEntryInstr* block,
+                            Instruction* cursor,
+                            Definition* load_cid,
+                            const GrowableArray<intptr_t>& order,
+                            intptr_t lo,
+                            intptr_t hi,
+                            intptr_t min_cid,
+                            intptr_t max_cid,
+                            JoinEntryInstr* fallback);
+  JoinEntryInstr* SharedBodyJoin(intptr_t i) const;
+  void AddTreeJoinPredecessor(JoinEntryInstr* join,
+                              BlockEntryInstr* predecessor);
+  BranchInstr* AppendCidTest(Instruction* cursor,
+                             Definition* load_cid,
+                             Token::Kind kind,
+                             intptr_t cid);
+  TargetEntryInstr* NewTarget(BlockEntryInstr* dominator);
+  TargetEntryInstr* NewFallbackTarget(BlockEntryInstr* dominator,
+                                      JoinEntryInstr* fallback);
+  void LinkToInlinedBody(BlockEntryInstr* current_block,
+                         Instruction* cursor,
+                         intptr_t i,
+                         BlockEntryInstr* join_dominator);
+  TargetEntryInstr* TargetForInlinedBody(intptr_t i,
+                                         BlockEntryInstr* join_dominator);
+  bool NeedsFallbackCall() const;
+  void BuildFallbackCall(Instruction* cursor);
 
   Isolate* isolate() const;
   Zone* zone() const;
@@ -613,6 +668,11 @@ class PolymorphicInliner : public ValueObject {
   GrowableArray<BlockEntryInstr*> inlined_entries_;
   InlineExitCollector* exit_collector_;
 
+  // The joins reached from several leaves of the decision tree, and the
+  // nearest common dominator of their predecessors so far.
+  GrowableArray<JoinEntryInstr*> tree_joins_;
+  GrowableArray<BlockEntryInstr*> tree_join_dominators_;
+
   const Function& caller_function_;
   const intptr_t caller_inlining_id_;
 };
@@ -767,7 +827,8 @@ class CallSiteInliner : public ValueObject {
   // Inlining heuristics based on Cooper et al. 2008.
   InliningDecision ShouldWeInline(const Function& callee,
                                   intptr_t instr_count,
-                                  intptr_t call_site_count) {
+                                  intptr_t call_site_count,
+                                  bool removes_allocation) {
     // Pragma or size heuristics.
     if (inliner_->AlwaysInline(callee)) {
       return InliningDecision::Yes("AlwaysInline");
@@ -792,6 +853,10 @@ class CallSiteInliner : public ValueObject {
       return InliningDecision::Yes("need to count first");
     } else if (instr_count <= FLAG_inlining_size_threshold) {
       return InliningDecision::Yes("--inlining-size-threshold");
+    } else if (removes_allocation &&
+               instr_count <= FLAG_inlining_non_escaping_size_threshold) {
+      // The allocation of an argument can be sunk once the call is inlined.
+      return InliningDecision::Yes("--inlining-non-escaping-size-threshold");
     } else if (call_site_count <= FLAG_inlining_callee_call_sites_threshold) {
       return InliningDecision::Yes("--inlining-callee-call-sites-threshold");
     }
@@ -935,16 +1000,21 @@ class CallSiteInliner : public ValueObject {
     // Apply early heuristics. For a specialized case
     // (constants_arg_counts > 0), don't use a previously
     // estimate of the call site and instruction counts.
+    // The same holds when an allocation local to the call is passed,
+    // since the late heuristic may allow larger callees in that case.
     // Note that at this point, optional constant parameters
     // are not counted yet, which makes this decision approximate.
     GrowableArray<Value*>* arguments = call_data->arguments;
     const intptr_t constant_arg_count = CountConstants(*arguments);
+    const bool use_estimates =
+        (constant_arg_count == 0) && !HasLocalAllocationArgument(*arguments);
     const intptr_t instruction_count =
-        constant_arg_count == 0 ? function.optimized_instruction_count() : 0;
+        use_estimates ? function.optimized_instruction_count() : 0;
     const intptr_t call_site_count =
-        constant_arg_count == 0 ? function.optimized_call_site_count() : 0;
+        use_estimates ? function.optimized_call_site_count() : 0;
     InliningDecision decision =
-        ShouldWeInline(function, instruction_count, call_site_count);
+        ShouldWeInline(function, instruction_count, call_site_count,
+                       /*removes_allocation=*/false);
     if (!decision.value) {
       TRACE_INLINING(
           THR_Print("     Bailout: early heuristics (%s) with "
@@ -1175,11 +1245,15 @@ class CallSiteInliner : public ValueObject {
                                            &call_site_count);
 
         // Use heuristics do decide if this call should be inlined.
-        InliningDecision decision =
-            ShouldWeInline(function, instruction_count, call_site_count);
+        const bool removes_allocation =
+            RemovesArgumentAllocation(*arguments, *param_stubs);
+        InliningDecision decision = ShouldWeInline(
+            function, instruction_count, call_site_count, removes_allocation);
         if (!decision.value) {
           // If size is larger than all thresholds, don't consider it again.
           if ((instruction_count > FLAG_inlining_size_threshold) &&
+              (instruction_count >
+               FLAG_inlining_non_escaping_size_threshold) &&
               (call_site_count > FLAG_inlining_callee_call_sites_threshold)) {
             function.set_is_inlinable(false);
           }
@@ -1188,9 +1262,11 @@ class CallSiteInliner : public ValueObject {
                         "code size:  %" Pd ", "
                         "call sites: %" Pd ", "
                         "inlining depth of callee: %d, "
-                        "const args: %" Pd "\n",
+                        "const args: %" Pd ", "
+                        "removes allocation: %s\n",
                         decision.reason, instruction_count, call_site_count,
-                        function.inlining_depth(), constants_count));
+                        function.inlining_depth(), constants_count,
+                        removes_allocation ? "yes" : "no"));
           PRINT_INLINING_TREE("Heuristic fail", &call_data->caller, &function,
                               call_data->call);
           return false;
@@ -1373,6 +1449,89 @@ class CallSiteInliner : public ValueObject {
     return count;
   }
 
+  // Returns true if [argument] is an allocation or a box that is only used
+  // to pass it as [argument] and to load or store its fields. If the callee
+  // does not let the parameter escape either, the allocation is removed by
+  // allocation sinking or representation selection once the call is inlined.
+  static bool IsLocalAllocation(Value* argument) {
+    Definition* alloc = argument->definition();
+    const bool is_box = alloc->IsBox();
+    if (!is_box && !alloc->IsAllocateObject() &&
+        !alloc->IsAllocateUninitializedContext()) {
+      return false;
+    }
+    for (Value* use = alloc->input_use_list(); use != NULL;
+         use = use->next_use()) {
+      if (use == argument) continue;
+      if (is_box) return false;
+      Instruction* instr = use->instruction();
+      if (instr->IsLoadField()) continue;
+      StoreInstanceFieldInstr* store = instr->AsStoreInstanceField();
+      if ((store != NULL) && (use == store->instance())) continue;
+      return false;
+    }
+    return true;
+  }
+
+  static bool HasLocalAllocationArgument(
+      const GrowableArray<Value*>& arguments) {
+    for (intptr_t i = 0; i < arguments.length(); i++) {
+      if ((arguments[i] != NULL) && IsLocalAllocation(arguments[i])) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // Returns true if the uses of parameter [param] in the callee graph
+  // neither store it anywhere nor pass it on. A boxed parameter may only
+  // be used unboxed.
+  static bool DoesNotEscape(Definition* param, bool is_box) {
+    for (Value* use = param->input_use_list(); use != NULL;
+         use = use->next_use()) {
+      Instruction* instr = use->instruction();
+      if (is_box) {
+        if (instr->RequiredInputRepresentation(use->use_index()) == kTagged) {
+          return false;
+        }
+        continue;
+      }
+      if (instr->IsLoadField() || instr->IsLoadClassId() ||
+          instr->IsCheckClass() || instr->IsCheckNull()) {
+        continue;
+      }
+      StoreInstanceFieldInstr* store = instr->AsStoreInstanceField();
+      if ((store != NULL) && (use == store->instance())) continue;
+      RedefinitionInstr* redefinition = instr->AsRedefinition();
+      if ((redefinition != NULL) && DoesNotEscape(redefinition, is_box)) {
+        continue;
+      }
+      return false;
+    }
+    return true;
+  }
+
+  // Returns true if inlining the call with [arguments] makes the allocation
+  // of one of them removable. The trailing arguments and parameter stubs are
+  // in one-to-one correspondence, the stubs may have an additional leading
+  // type arguments stub.
+  static bool RemovesArgumentAllocation(
+      const GrowableArray<Value*>& arguments,
+      const ZoneGrowableArray<Definition*>& param_stubs) {
+    const intptr_t stub_offset = param_stubs.length() - arguments.length();
+    for (intptr_t i = 0; i < arguments.length(); i++) {
+      const intptr_t stub_index = stub_offset + i;
+      if ((arguments[i] == NULL) || (stub_index < 0)) continue;
+      if (!IsLocalAllocation(arguments[i])) continue;
+      ParameterInstr* param = param_stubs[stub_index]->AsParameter();
+      if ((param != NULL) &&
+          DoesNotEscape(param, arguments[i]->definition()->IsBox())) {
+        return true;
+      }
+    }
+    return false;
+  }
+
   // Parse a function reusing the cache if possible.
   ParsedFunction* GetParsedFunction(const Function& function, bool* in_cache) {
     // TODO(zerny): Use a hash map for the cache.
@@ -1509,13 +1668,6 @@ class CallSiteInliner : public ValueObject {
                              call_info.length()));
     for (intptr_t call_idx = 0; call_idx < call_info.length(); ++call_idx) {
       PolymorphicInstanceCallInstr* call = call_info[call_idx].call;
-      // PolymorphicInliner introduces deoptimization paths.
-      if (!call->complete() && !FLAG_polymorphic_with_deopt) {
-        TRACE_INLINING(
-            THR_Print("  => %s\n     Bailout: call with checks\n",
-                      call->instance_call()->function_name().ToCString()));
-        continue;
-      }
       const Function& cl = call_info[call_idx].caller();
       intptr_t caller_inlining_id =
           call_info[call_idx].caller_graph->inlining_id();
@@ -1867,7 +2019,7 @@ TargetEntryInstr* PolymorphicInliner::BuildDecisionGraph() {
     // 1. Guard the body with a class id check.  We don't need any check if
     // it's the last test and global analysis has told us that the call is
     // complete.
-    if (is_last_test && non_inlined_variants_->is_empty()) {
+    if (is_last_test && !NeedsFallbackCall()) {
       // If it is the last variant use a check class id instruction which can
       // deoptimize, followed unconditionally by the body. Omit the check if
       // we know that we have covered all possible classes.
@@ -1884,41 +2036,7 @@ TargetEntryInstr* PolymorphicInliner::BuildDecisionGraph() {
       }
 
       // The next instruction is the first instruction of the inlined body.
-      // Handle the two possible cases (unshared and shared subsequent
-      // predecessors) separately.
-      BlockEntryInstr* callee_entry = inlined_entries_[i];
-      if (callee_entry->IsGraphEntry()) {
-        // Unshared.  Graft the normal entry on after the check class
-        // instruction.
-        auto target = callee_entry->AsGraphEntry()->normal_entry();
-        ASSERT(cursor != nullptr);
-        cursor->LinkTo(target->next());
-        target->ReplaceAsPredecessorWith(current_block);
-        // Unuse all inputs of the graph entry and the normal entry. They are
-        // not in the graph anymore.
-        callee_entry->UnuseAllInputs();
-        target->UnuseAllInputs();
-        // All blocks that were dominated by the normal entry are now
-        // dominated by the current block.
-        for (intptr_t j = 0; j < target->dominated_blocks().length(); ++j) {
-          BlockEntryInstr* block = target->dominated_blocks()[j];
-          current_block->AddDominatedBlock(block);
-        }
-      } else if (callee_entry->IsJoinEntry()) {
-        // Shared inlined body and this is a subsequent entry.  We have
-        // already constructed a join and set its dominator.  Add a jump to
-        // the join.
-        JoinEntryInstr* join = callee_entry->AsJoinEntry();
-        ASSERT(join->dominator() != NULL);
-        GotoInstr* goto_join = new GotoInstr(join, DeoptId::kNone);
-        goto_join->InheritDeoptTarget(zone(), join);
-        cursor->LinkTo(goto_join);
-        current_block->set_last_instruction(goto_join);
-      } else {
-        // There is no possibility of a TargetEntry (the first entry to a
-        // shared inlined body) because this is the last inlined entry.
-        UNREACHABLE();
-      }
+      LinkToInlinedBody(current_block, cursor, i, current_block);
       cursor = NULL;
     } else {
       // For all variants except the last, use a branch on the loaded class
@@ -1974,48 +2092,8 @@ TargetEntryInstr* PolymorphicInliner::BuildDecisionGraph() {
       cursor = nullptr;
       current_block->set_last_instruction(branch);
 
-      // 2. Handle a match by linking to the inlined body.  There are three
-      // cases (unshared, shared first predecessor, and shared subsequent
-      // predecessors).
-      BlockEntryInstr* callee_entry = inlined_entries_[i];
-      TargetEntryInstr* true_target = NULL;
-      if (callee_entry->IsGraphEntry()) {
-        // Unshared.
-        auto graph_entry = callee_entry->AsGraphEntry();
-        auto function_entry = graph_entry->normal_entry();
-
-        true_target = BranchSimplifier::ToTargetEntry(zone(), function_entry);
-        function_entry->ReplaceAsPredecessorWith(true_target);
-        for (intptr_t j = 0; j < function_entry->dominated_blocks().length();
-             ++j) {
-          BlockEntryInstr* block = function_entry->dominated_blocks()[j];
-          true_target->AddDominatedBlock(block);
-        }
-
-        // Unuse all inputs of the graph entry. It is not in the graph anymore.
-        graph_entry->UnuseAllInputs();
-      } else if (callee_entry->IsTargetEntry()) {
-        ASSERT(!callee_entry->IsFunctionEntry());
-        // Shared inlined body and this is the first entry.  We have already
-        // constructed a join and this target jumps to it.
-        true_target = callee_entry->AsTargetEntry();
-        BlockEntryInstr* join = true_target->last_instruction()->SuccessorAt(0);
-        current_block->AddDominatedBlock(join);
-      } else {
-        // Shared inlined body and this is a subsequent entry.  We have
-        // already constructed a join.  We need a fresh target that jumps to
-        // the join.
-        JoinEntryInstr* join = callee_entry->AsJoinEntry();
-        ASSERT(join != NULL);
-        ASSERT(join->dominator() != NULL);
-        true_target =
-            new TargetEntryInstr(AllocateBlockId(), try_idx, DeoptId::kNone);
-        true_target->InheritDeoptTarget(zone(), join);
-        GotoInstr* goto_join = new GotoInstr(join, DeoptId::kNone);
-        goto_join->InheritDeoptTarget(zone(), join);
-        true_target->LinkTo(goto_join);
-        true_target->set_last_instruction(goto_join);
-      }
+      // 2. Handle a match by linking to the inlined body.
+      TargetEntryInstr* true_target = TargetForInlinedBody(i, current_block);
       *branch->true_successor_address() = true_target;
       current_block->AddDominatedBlock(true_target);
 
@@ -2058,31 +2136,8 @@ TargetEntryInstr* PolymorphicInliner::BuildDecisionGraph() {
   }
 
   // Handle any non-inlined variants.
-  if (!non_inlined_variants_->is_empty()) {
-    // Move push arguments of the call.
-    for (intptr_t i = 0; i < call_->ArgumentCount(); ++i) {
-      PushArgumentInstr* push = call_->PushArgumentAt(i);
-      push->ReplaceUsesWith(push->value()->definition());
-      push->previous()->LinkTo(push->next());
-      cursor->LinkTo(push);
-      cursor = push;
-    }
-    PolymorphicInstanceCallInstr* fallback_call =
-        new PolymorphicInstanceCallInstr(
-            call_->instance_call(), *non_inlined_variants_, call_->complete());
-    fallback_call->set_ssa_temp_index(
-        owner_->caller_graph()->alloc_ssa_temp_index());
-    fallback_call->InheritDeoptTarget(zone(), call_);
-    fallback_call->set_total_call_count(call_->CallCount());
-    ReturnInstr* fallback_return =
-        new ReturnInstr(call_->instance_call()->token_pos(),
-                        new Value(fallback_call), DeoptId::kNone);
-    fallback_return->InheritDeoptTargetAfter(owner_->caller_graph(), call_,
-                                             fallback_call);
-    AppendInstruction(AppendInstruction(cursor, fallback_call),
-                      fallback_return);
-    exit_collector_->AddExit(fallback_return);
-    cursor = NULL;
+  if (NeedsFallbackCall()) {
+    BuildFallbackCall(cursor);
   } else {
     // Remove push arguments of the call.
     for (intptr_t i = 0; i < call_->ArgumentCount(); ++i) {
@@ -2094,6 +2149,385 @@ TargetEntryInstr* PolymorphicInliner::BuildDecisionGraph() {
   return entry;
 }
 
+// Links the inlined body of the i-th inlined variant as the continuation
+// of [cursor] in [current_block]. There are three cases (unshared, shared
+// first predecessor, and shared subsequent predecessors). The join of a
+// shared body becomes dominated by [join_dominator] on its first link,
+// unless it is null.
+void PolymorphicInliner::LinkToInlinedBody(BlockEntryInstr* current_block,
+                                           Instruction* cursor,
+                                           intptr_t i,
+                                           BlockEntryInstr* join_dominator) {
+  ASSERT(cursor != nullptr);
+  BlockEntryInstr* callee_entry = inlined_entries_[i];
+  if (callee_entry->IsGraphEntry()) {
+    // Unshared.  Graft the normal entry on after the cursor.
+    auto target = callee_entry->AsGraphEntry()->normal_entry();
+    cursor->LinkTo(target->next());
+    target->ReplaceAsPredecessorWith(current_block);
+    // Unuse all inputs of the graph entry and the normal entry. They are
+    // not in the graph anymore.
+    callee_entry->UnuseAllInputs();
+    target->UnuseAllInputs();
+    // All blocks that were dominated by the normal entry are now
+    // dominated by the current block.
+    for (intptr_t j = 0; j < target->dominated_blocks().length(); ++j) {
+      BlockEntryInstr* block = target->dominated_blocks()[j];
+      current_block->AddDominatedBlock(block);
+    }
+  } else if (callee_entry->IsJoinEntry()) {
+    // Shared inlined body and this is a subsequent entry.  We have
+    // already constructed a join and set its dominator.  Add a jump to
+    // the join.
+    JoinEntryInstr* join = callee_entry->AsJoinEntry();
+    ASSERT(join->dominator() != NULL);
+    GotoInstr* goto_join = new GotoInstr(join, DeoptId::kNone);
+    goto_join->InheritDeoptTarget(zone(), join);
+    cursor->LinkTo(goto_join);
+    current_block->set_last_instruction(goto_join);
+  } else {
+    // Shared inlined body and this is the first entry.  Take over the jump
+    // to the join from the target constructed for it.
+    TargetEntryInstr* target = callee_entry->AsTargetEntry();
+    ASSERT(target != NULL);
+    BlockEntryInstr* join = target->last_instruction()->SuccessorAt(0);
+    target->ReplaceAsPredecessorWith(current_block);
+    cursor->LinkTo(target->next());
+    if (join_dominator != nullptr) {
+      join_dominator->AddDominatedBlock(join);
+    }
+  }
+}
+
+// Returns a target entry leading to the inlined body of the i-th inlined
+// variant. There are three cases (unshared, shared first predecessor, and
+// shared subsequent predecessors). The join of a shared body becomes
+// dominated by [join_dominator] when its first predecessor is created,
+// unless it is null.
+TargetEntryInstr* PolymorphicInliner::TargetForInlinedBody(
+    intptr_t i,
+    BlockEntryInstr* join_dominator) {
+  const intptr_t try_idx = call_->GetBlock()->try_index();
+  BlockEntryInstr* callee_entry = inlined_entries_[i];
+  TargetEntryInstr* true_target = NULL;
+  if (callee_entry->IsGraphEntry()) {
+    // Unshared.
+    auto graph_entry = callee_entry->AsGraphEntry();
+    auto function_entry = graph_entry->normal_entry();
+
+    true_target = BranchSimplifier::ToTargetEntry(zone(), function_entry);
+    function_entry->ReplaceAsPredecessorWith(true_target);
+    for (intptr_t j = 0; j < function_entry->dominated_blocks().length();
+         ++j) {
+      BlockEntryInstr* block = function_entry->dominated_blocks()[j];
+      true_target->AddDominatedBlock(block);
+    }
+
+    // Unuse all inputs of the graph entry. It is not in the graph anymore.
+    graph_entry->UnuseAllInputs();
+  } else if (callee_entry->IsTargetEntry()) {
+    ASSERT(!callee_entry->IsFunctionEntry());
+    // Shared inlined body and this is the first entry.  We have already
+    // constructed a join and this target jumps to it.
+    true_target = callee_entry->AsTargetEntry();
+    BlockEntryInstr* join = true_target->last_instruction()->SuccessorAt(0);
+    if (join_dominator != nullptr) {
+      join_dominator->AddDominatedBlock(join);
+    }
+  } else {
+    // Shared inlined body and this is a subsequent entry.  We have
+    // already constructed a join.  We need a fresh target that jumps to
+    // the join.
+    JoinEntryInstr* join = callee_entry->AsJoinEntry();
+    ASSERT(join != NULL);
+    ASSERT(join->dominator() != NULL);
+    true_target =
+        new TargetEntryInstr(AllocateBlockId(), try_idx, DeoptId::kNone);
+    true_target->InheritDeoptTarget(zone(), join);
+    GotoInstr* goto_join = new GotoInstr(join, DeoptId::kNone);
+    goto_join->InheritDeoptTarget(zone(), join);
+    true_target->LinkTo(goto_join);
+    true_target->set_last_instruction(goto_join);
+  }
+  return true_target;
+}
+
+// Moves the push arguments of the call after [cursor] and calls the
+// non-inlined variants.
+// Whether receivers that none of the inlined variants match are handled by
+// a call. Without deoptimization, this includes the receivers of a call with
+// checks that match none of its variants at all.
+bool PolymorphicInliner::NeedsFallbackCall() const {
+  return !non_inlined_variants_->is_empty() ||
+         (!call_->complete() && !FLAG_polymorphic_with_deopt);
+}
+
+void PolymorphicInliner::BuildFallbackCall(Instruction* cursor) {
+  for (intptr_t i = 0; i < call_->ArgumentCount(); ++i) {
+    PushArgumentInstr* push = call_->PushArgumentAt(i);
+    push->ReplaceUsesWith(push->value()->definition());
+    push->previous()->LinkTo(push->next());
+    cursor->LinkTo(push);
+    cursor = push;
+  }
+  Definition* fallback_call;
+  if (non_inlined_variants_->is_empty()) {
+    // All variants are inlined, other receivers take a regular instance call.
+    InstanceCallInstr* instance_call = call_->instance_call();
+    PushArgumentsArray* arguments =
+        new (Z) PushArgumentsArray(call_->ArgumentCount());
+    for (intptr_t i = 0; i < call_->ArgumentCount(); ++i) {
+      arguments->Add(call_->PushArgumentAt(i));
+    }
+    InstanceCallInstr* fallback_instance_call = new (Z) InstanceCallInstr(
+        instance_call->token_pos(), instance_call->function_name(),
+        instance_call->token_kind(), arguments, instance_call->type_args_len(),
+        instance_call->argument_names(),
+        instance_call->checked_argument_count(), call_->deopt_id(),
+        instance_call->interface_target());
+    fallback_instance_call->set_ic_data(instance_call->ic_data());
+    fallback_instance_call->set_entry_kind(instance_call->entry_kind());
+    fallback_call = fallback_instance_call;
+  } else {
+    PolymorphicInstanceCallInstr* fallback_polymorphic_call =
+        new PolymorphicInstanceCallInstr(call_->instance_call(),
+                                         *non_inlined_variants_,
+                                         call_->complete());
+    fallback_polymorphic_call->set_total_call_count(call_->CallCount());
+    fallback_call = fallback_polymorphic_call;
+  }
+  fallback_call->set_ssa_temp_index(
+      owner_->caller_graph()->alloc_ssa_temp_index());
+  fallback_call->InheritDeoptTarget(zone(), call_);
+  ReturnInstr* fallback_return =
+      new ReturnInstr(call_->instance_call()->token_pos(),
+                      new Value(fallback_call), DeoptId::kNone);
+  fallback_return->InheritDeoptTargetAfter(owner_->caller_graph(), call_,
+                                           fallback_call);
+  AppendInstruction(AppendInstruction(cursor, fallback_call), fallback_return);
+  exit_collector_->AddExit(fallback_return);
+}
+
+// Build a balanced tree of class id tests to dispatch to the inlined
+// function bodies.  It is used instead of the chain of tests in frequency
+// order when many variants are inlined and the remaining ones are called:
+// every inlined body is then reached with a logarithmic number of tests.
+// Class ids in between the inlined ranges reach the fallback call.
+TargetEntryInstr* PolymorphicInliner::BuildDecisionTree() {
+  ASSERT(NeedsFallbackCall());
+  const intptr_t try_idx = call_->GetBlock()->try_index();
+
+  TargetEntryInstr* entry = new (Z) TargetEntryInstr(
+      AllocateBlockId(), try_idx, CompilerState::Current().GetNextDeoptId());
+  entry->InheritDeoptTarget(zone(), call_);
+
+  Definition* receiver = call_->Receiver()->definition();
+  LoadClassIdInstr* load_cid =
+      new (Z) LoadClassIdInstr(new (Z) Value(receiver));
+  load_cid->set_ssa_temp_index(owner_->caller_graph()->alloc_ssa_temp_index());
+  Instruction* cursor = AppendInstruction(entry, load_cid);
+
+  // All tests that fail meet at the call of the non-inlined variants.
+  JoinEntryInstr* fallback =
+      new (Z) JoinEntryInstr(AllocateBlockId(), try_idx, DeoptId::kNone);
+  fallback->InheritDeoptTarget(zone(), call_);
+
+  // Order the inlined variants by class id, their ranges are disjoint.
+  GrowableArray<intptr_t> order(inlined_variants_.length());
+  for (intptr_t i = 0; i < inlined_variants_.length(); ++i) {
+    intptr_t j = order.length();
+    order.Add(i);
+    for (; (j > 0) && (inlined_variants_[order[j - 1]].cid_start >
+                       inlined_variants_[i].cid_start);
+         --j) {
+      order[j] = order[j - 1];
+    }
+    order[j] = i;
+  }
+
+  // The joins of the fallback and of shared bodies are reached from several
+  // leaves. Each is dominated by the nearest common dominator of the leaves,
+  // which is only known once the whole tree is built.
+  BuildDecisionSubtree(entry, cursor, load_cid, order, 0, order.length() - 1,
+                       kIllegalCid, kIntptrMax, fallback);
+  for (intptr_t i = 0; i < tree_joins_.length(); ++i) {
+    tree_join_dominators_[i]->AddDominatedBlock(tree_joins_[i]);
+  }
+  BuildFallbackCall(fallback);
+  return entry;
+}
+
+// Returns the join of the body of the i-th inlined variant if the body is
+// shared with other variants, and null otherwise.
+JoinEntryInstr* PolymorphicInliner::SharedBodyJoin(intptr_t i) const {
+  BlockEntryInstr* callee_entry = inlined_entries_[i];
+  if (callee_entry->IsJoinEntry()) {
+    return callee_entry->AsJoinEntry();
+  }
+  if (callee_entry->IsTargetEntry()) {
+    return callee_entry->last_instruction()->SuccessorAt(0)->AsJoinEntry();
+  }
+  return nullptr;
+}
+
+// Returns the nearest block dominating both [a] and [b].
+static BlockEntryInstr* CommonDominator(BlockEntryInstr* a,
+                                        BlockEntryInstr* b) {
+  intptr_t a_depth = 0;
+  for (BlockEntryInstr* block = a->dominator(); block != nullptr;
+       block = block->dominator()) {
+    ++a_depth;
+  }
+  intptr_t b_depth = 0;
+  for (BlockEntryInstr* block = b->dominator(); block != nullptr;
+       block = block->dominator()) {
+    ++b_depth;
+  }
+  for (; a_depth > b_depth; --a_depth) {
+    a = a->dominator();
+  }
+  for (; b_depth > a_depth; --b_depth) {
+    b = b->dominator();
+  }
+  while (a != b) {
+    a = a->dominator();
+    b = b->dominator();
+  }
+  return a;
+}
+
+// Records that [predecessor], a block of the decision tree, jumps to [join].
+void PolymorphicInliner::AddTreeJoinPredecessor(JoinEntryInstr* join,
+                                                BlockEntryInstr* predecessor) {
+  for (intptr_t i = 0; i < tree_joins_.length(); ++i) {
+    if (tree_joins_[i] == join) {
+      tree_join_dominators_[i] =
+          CommonDominator(tree_join_dominators_[i], predecessor);
+      return;
+    }
+  }
+  tree_joins_.Add(join);
+  tree_join_dominators_.Add(predecessor);
+}
+
+// Builds the part of the tree that dispatches to the inlined variants
+// order[lo] .. order[hi], knowing that the class id is in [min_cid, max_cid].
+void PolymorphicInliner::BuildDecisionSubtree(
+    BlockEntryInstr* block,
+    Instruction* cursor,
+    Definition* load_cid,
+    const GrowableArray<intptr_t>& order,
+    intptr_t lo,
+    intptr_t hi,
+    intptr_t min_cid,
+    intptr_t max_cid,
+    JoinEntryInstr* fallback) {
+  if (lo < hi) {
+    // Split on the first class id of the upper half of the ranges.
+    const intptr_t mid = (lo + hi + 1) / 2;
+    const intptr_t split_cid = inlined_variants_[order[mid]].cid_start;
+    BranchInstr* branch =
+        AppendCidTest(cursor, load_cid, Token::kLT, split_cid);
+    block->set_last_instruction(branch);
+    TargetEntryInstr* below = NewTarget(block);
+    TargetEntryInstr* above = NewTarget(block);
+    *branch->true_successor_address() = below;
+    *branch->false_successor_address() = above;
+    BuildDecisionSubtree(below, below, load_cid, order, lo, mid - 1, min_cid,
+                         split_cid - 1, fallback);
+    BuildDecisionSubtree(above, above, load_cid, order, mid, hi, split_cid,
+                         max_cid, fallback);
+    return;
+  }
+
+  const intptr_t i = order[lo];
+  const CidRange& variant = inlined_variants_[i];
+  bool test_lower = variant.cid_start > min_cid;
+  const bool test_upper = variant.cid_end < max_cid;
+  JoinEntryInstr* join = SharedBodyJoin(i);
+  if (!test_lower && !test_upper) {
+    // The enclosing tests have already narrowed the class id to the range.
+    LinkToInlinedBody(block, cursor, i, /* join_dominator = */ nullptr);
+    if (join != nullptr) {
+      AddTreeJoinPredecessor(join, block);
+    }
+    return;
+  }
+  BranchInstr* branch = NULL;
+  if (test_lower && test_upper && variant.IsSingleCid()) {
+    branch =
+        AppendCidTest(cursor, load_cid, Token::kEQ_STRICT, variant.cid_start);
+  } else {
+    if (test_lower && test_upper) {
+      BranchInstr* lower =
+          AppendCidTest(cursor, load_cid, Token::kGTE, variant.cid_start);
+      block->set_last_instruction(lower);
+      TargetEntryInstr* in_range = NewTarget(block);
+      *lower->true_successor_address() = in_range;
+      *lower->false_successor_address() = NewFallbackTarget(block, fallback);
+      block = in_range;
+      cursor = in_range;
+      test_lower = false;
+    }
+    branch = test_lower ? AppendCidTest(cursor, load_cid, Token::kGTE,
+                                        variant.cid_start)
+                        : AppendCidTest(cursor, load_cid, Token::kLTE,
+                                        variant.cid_end);
+  }
+  block->set_last_instruction(branch);
+  TargetEntryInstr* true_target =
+      TargetForInlinedBody(i, /* join_dominator = */ nullptr);
+  block->AddDominatedBlock(true_target);
+  if (join != nullptr) {
+    AddTreeJoinPredecessor(join, true_target);
+  }
+  *branch->true_successor_address() = true_target;
+  *branch->false_successor_address() = NewFallbackTarget(block, fallback);
+}
+
+BranchInstr* PolymorphicInliner::AppendCidTest(Instruction* cursor,
+                                               Definition* load_cid,
+                                               Token::Kind kind,
+                                               intptr_t cid) {
+  ConstantInstr* cid_constant = owner_->caller_graph()->GetConstant(
+      Smi::ZoneHandle(Z, Smi::New(cid)));
+  ComparisonInstr* compare = NULL;
+  if (kind == Token::kEQ_STRICT) {
+    compare = new (Z) StrictCompareInstr(
+        call_->instance_call()->token_pos(), kind, new (Z) Value(load_cid),
+        new (Z) Value(cid_constant), /* number_check = */ false,
+        DeoptId::kNone);
+  } else {
+    compare = new (Z) RelationalOpInstr(
+        call_->instance_call()->token_pos(), kind, new (Z) Value(load_cid),
+        new (Z) Value(cid_constant), kSmiCid, call_->deopt_id());
+  }
+  BranchInstr* branch = new (Z) BranchInstr(compare, DeoptId::kNone);
+  branch->InheritDeoptTarget(zone(), call_);
+  AppendInstruction(cursor, branch);
+  return branch;
+}
+
+TargetEntryInstr* PolymorphicInliner::NewTarget(BlockEntryInstr* dominator) {
+  TargetEntryInstr* target = new (Z) TargetEntryInstr(
+      AllocateBlockId(), call_->GetBlock()->try_index(), DeoptId::kNone);
+  target->InheritDeoptTarget(zone(), call_);
+  dominator->AddDominatedBlock(target);
+  return target;
+}
+
+TargetEntryInstr* PolymorphicInliner::NewFallbackTarget(
+    BlockEntryInstr* dominator,
+    JoinEntryInstr* fallback) {
+  TargetEntryInstr* target = NewTarget(dominator);
+  AddTreeJoinPredecessor(fallback, target);
+  GotoInstr* goto_fallback = new (Z) GotoInstr(fallback, DeoptId::kNone);
+  goto_fallback->InheritDeoptTarget(zone(), call_);
+  target->LinkTo(goto_fallback);
+  target->set_last_instruction(goto_fallback);
+  return target;
+}
+
 static void TracePolyInlining(const CallTargets& targets,
                               intptr_t idx,
                               intptr_t total,
@@ -2114,9 +2548,10 @@ bool PolymorphicInliner::Inline() {
   ASSERT(&variants_ == &call_->targets_);
 
   intptr_t total = call_->total_call_count();
+  intptr_t inlined_size = 0;
   for (intptr_t var_idx = 0; var_idx < variants_.length(); ++var_idx) {
     TargetInfo* info = variants_.TargetAt(var_idx);
-    if (variants_.length() > FLAG_max_polymorphic_checks) {
+    if (variants_.length() > FLAG_inlining_polymorphic_variants_threshold) {
       non_inlined_variants_->Add(info);
       continue;
     }
@@ -2171,10 +2606,20 @@ bool PolymorphicInliner::Inline() {
       continue;
     }
 
+    // Bound the code growth at calls with many variants.
+    if ((inlined_variants_.length() >= FLAG_max_polymorphic_checks) &&
+        (inlined_size >= FLAG_inlining_polymorphic_size_budget)) {
+      TRACE_INLINING(
+          TracePolyInlining(variants_, var_idx, total, "over size budget"));
+      non_inlined_variants_->Add(&variants_[var_idx]);
+      continue;
+    }
+
     // Make an inlining decision.
     if (TryInliningPoly(*info)) {
       TRACE_INLINING(TracePolyInlining(variants_, var_idx, total, "inlined"));
       inlined_variants_.Add(&variants_[var_idx]);
+      inlined_size += target.optimized_instruction_count();
     } else {
       TRACE_INLINING(
           TracePolyInlining(variants_, var_idx, total, "not inlined"));
@@ -2187,7 +2632,14 @@ bool PolymorphicInliner::Inline() {
 
   // Now build a decision tree (a DAG because of shared inline variants) and
   // inline it at the call site.
-  TargetEntryInstr* entry = BuildDecisionGraph();
+  const bool use_tree =
+      NeedsFallbackCall() &&
+      (inlined_variants_.length() >= FLAG_inlining_dispatch_tree_threshold);
+  TRACE_INLINING(THR_Print("  dispatch to %" Pd " inlined variants with a %s\n",
+                           inlined_variants_.length(),
+                           use_tree ? "tree" : "chain"));
+  TargetEntryInstr* entry =
+      use_tree ? BuildDecisionTree() : BuildDecisionGraph();
   exit_collector_->ReplaceCall(entry);
   return true;
 }
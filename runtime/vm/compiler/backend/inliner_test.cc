@@ -13,6 +13,11 @@
 
 namespace dart {
 
+DECLARE_FLAG(int, inlining_callee_call_sites_threshold);
+DECLARE_FLAG(int, inlining_non_escaping_size_threshold);
+DECLARE_FLAG(int, inlining_polymorphic_size_budget);
+DECLARE_FLAG(int, inlining_size_threshold);
+
 // Test that the redefinition for an inlined polymorphic function used with
 // multiple receiver cids does not have a concrete type.
 ISOLATE_UNIT_TEST_CASE(Inliner_PolyInliningRedefinition) {
@@ -134,6 +139,136 @@ ISOLATE_UNIT_TEST_CASE(Inliner_PolyInliningRedefinition) {
   EXPECT(current->AsRedefinition()->Type()->ToCid() == kDynamicCid);
 }
 
+static const char* kDispatchTreeScript = R"(
+    abstract class A {
+      int value();
+    }
+    class B0 extends A { int value() => 0; }
+    class B1 extends A { int value() => 1; }
+    class B2 extends A { int value() => 2; }
+    class B3 extends A { int value() => 3; }
+    class B4 extends A { int value() => 4; }
+    class B5 extends A {
+      @pragma('vm:never-inline')
+      int value() => 5;
+    }
+
+    testInlining(A arg) {
+      return arg.value();
+    }
+
+    main() {
+      final receivers = [B0(), B1(), B2(), B3(), B4(), B5()];
+      for (var i = 0; i < 10; i++) {
+        for (var receiver in receivers) {
+          testInlining(receiver);
+        }
+      }
+    }
+  )";
+
+// Loads kDispatchTreeScript, runs it and returns testInlining.
+static RawFunction* LoadDispatchTreeScript() {
+  const auto& root_library =
+      Library::Handle(LoadTestScript(kDispatchTreeScript));
+  const auto& function =
+      Function::Handle(GetFunction(root_library, "testInlining"));
+
+  Invoke(root_library, "main");
+  return function.raw();
+}
+
+static FlowGraph* RunPassesUpToInlining(TestPipeline* pipeline) {
+  return pipeline->RunPasses({
+      CompilerPass::kComputeSSA,
+      CompilerPass::kApplyICData,
+      CompilerPass::kTryOptimizePatterns,
+      CompilerPass::kSetOuterInliningId,
+      CompilerPass::kTypePropagation,
+      CompilerPass::kApplyClassIds,
+      CompilerPass::kInlining,
+  });
+}
+
+// Returns the number of class ids checked by the PolymorphicInstanceCall of
+// the variants that are not inlined, checking that there is a single one.
+static intptr_t FallbackCallChecks(FlowGraph* flow_graph) {
+  intptr_t fallback_calls = 0;
+  intptr_t checks = 0;
+  for (BlockIterator block_it = flow_graph->reverse_postorder_iterator();
+       !block_it.Done(); block_it.Advance()) {
+    for (ForwardInstructionIterator it(block_it.Current()); !it.Done();
+         it.Advance()) {
+      EXPECT(!it.Current()->IsCheckClassId());
+      if (PolymorphicInstanceCallInstr* call =
+              it.Current()->AsPolymorphicInstanceCall()) {
+        checks = call->NumberOfChecks();
+        ++fallback_calls;
+      }
+    }
+  }
+  EXPECT_EQ(1, fallback_calls);
+  return checks;
+}
+
+// Test that a polymorphic call with many inlined variants and a variant
+// that is not inlined dispatches with a tree of class id tests.
+ISOLATE_UNIT_TEST_CASE(Inliner_PolyInliningDispatchTree) {
+  const auto& function = Function::Handle(LoadDispatchTreeScript());
+  TestPipeline pipeline(function, CompilerPass::kJIT);
+  FlowGraph* flow_graph = RunPassesUpToInlining(&pipeline);
+
+  auto entry = flow_graph->graph_entry()->normal_entry();
+  EXPECT(entry != nullptr);
+
+  LoadClassIdInstr* lcid = nullptr;
+  BranchInstr* root = nullptr;
+
+  ILMatcher cursor(flow_graph, entry);
+  RELEASE_ASSERT(cursor.TryMatch(
+      {
+          {kMatchLoadClassId, &lcid},
+          {kMatchBranch, &root},
+      },
+      /*insert_before=*/kMoveGlob));
+
+  // The root of the tree splits the class ids instead of testing the most
+  // frequent one.
+  EXPECT(root->comparison()->kind() == Token::kLT);
+  EXPECT(root->comparison()->left()->definition() == lcid);
+
+  // The variant that is not inlined is called from the single fallback,
+  // and no class id test deoptimizes.
+  EXPECT_EQ(1, FallbackCallChecks(flow_graph));
+
+  // The dominators maintained while building the tree are the ones
+  // computed from scratch.
+  const GrowableArray<BlockEntryInstr*>& preorder = flow_graph->preorder();
+  GrowableArray<BlockEntryInstr*> dominators(preorder.length());
+  for (intptr_t i = 0; i < preorder.length(); ++i) {
+    dominators.Add(preorder[i]->dominator());
+  }
+  GrowableArray<BitVector*> dominance_frontier;
+  flow_graph->ComputeDominators(&dominance_frontier);
+  for (intptr_t i = 0; i < preorder.length(); ++i) {
+    EXPECT(preorder[i]->dominator() == dominators[i]);
+  }
+}
+
+// Test that variants beyond --max-polymorphic-checks are not inlined once
+// the inlined bodies exceed --inlining-polymorphic-size-budget.
+ISOLATE_UNIT_TEST_CASE(Inliner_PolyInliningSizeBudget) {
+  SetFlagScope<int> sfs_checks(&FLAG_max_polymorphic_checks, 4);
+  SetFlagScope<int> sfs_budget(&FLAG_inlining_polymorphic_size_budget, 0);
+
+  const auto& function = Function::Handle(LoadDispatchTreeScript());
+  TestPipeline pipeline(function, CompilerPass::kJIT);
+  FlowGraph* flow_graph = RunPassesUpToInlining(&pipeline);
+
+  // Four variants are inlined, B5 and one more are called.
+  EXPECT_EQ(2, FallbackCallChecks(flow_graph));
+}
+
 ISOLATE_UNIT_TEST_CASE(Inliner_TypedData_Regress7551) {
   const char* kScript = R"(
     import 'dart:typed_data';
@@ -194,4 +329,87 @@ ISOLATE_UNIT_TEST_CASE(Inliner_TypedData_Regress7551) {
   RELEASE_ASSERT(unbox_instr->is_truncating());
 }
 
+static const char* kNonEscapingScript = R"(
+    class Point {
+      final double x;
+      final double y;
+      @pragma('vm:prefer-inline')
+      Point(this.x, this.y);
+    }
+
+    class Box {
+      double minX = 0.0;
+      double minY = 0.0;
+      double maxX = 0.0;
+      double maxY = 0.0;
+
+      void extend(Point p) {
+        if (p.x < minX) minX = p.x;
+        if (p.y < minY) minY = p.y;
+        if (p.x > maxX) maxX = p.x;
+        if (p.y > maxY) maxY = p.y;
+      }
+    }
+
+    double boundingBox(Box box, List<double> xs) {
+      for (int i = 0; i < xs.length; i++) {
+        box.extend(Point(xs[i], -xs[i]));
+      }
+      return box.maxX - box.minY;
+    }
+
+    main() {
+      final xs = <double>[1.0, 2.0, 3.0];
+      for (int i = 0; i < 100; i++) {
+        boundingBox(Box(), xs);
+      }
+    }
+  )";
+
+static intptr_t CountAllocations(FlowGraph* flow_graph) {
+  intptr_t count = 0;
+  for (BlockIterator block_it = flow_graph->reverse_postorder_iterator();
+       !block_it.Done(); block_it.Advance()) {
+    for (ForwardInstructionIterator it(block_it.Current()); !it.Done();
+         it.Advance()) {
+      if (it.Current()->IsAllocateObject()) {
+        count++;
+      }
+    }
+  }
+  return count;
+}
+
+// Compiles boundingBox from kNonEscapingScript where only the heuristic for
+// calls that let an argument allocation be removed may inline extend, and
+// returns the number of allocations left.
+static intptr_t AllocationsAfterInlining(intptr_t non_escaping_threshold) {
+  SetFlagScope<int> sfs_size(&FLAG_inlining_size_threshold, 1);
+  SetFlagScope<int> sfs_calls(&FLAG_inlining_callee_call_sites_threshold, -1);
+  SetFlagScope<int> sfs_non_escaping(&FLAG_inlining_non_escaping_size_threshold,
+                                     non_escaping_threshold);
+
+  const auto& root_library =
+      Library::Handle(LoadTestScript(kNonEscapingScript));
+  const auto& function =
+      Function::Handle(GetFunction(root_library, "boundingBox"));
+
+  Invoke(root_library, "main");
+
+  TestPipeline pipeline(function, CompilerPass::kJIT);
+  FlowGraph* flow_graph = pipeline.RunPasses({});
+  return CountAllocations(flow_graph);
+}
+
+// Test that a call receiving an allocation it does not let escape is
+// inlined, so that the allocation is sunk.
+ISOLATE_UNIT_TEST_CASE(Inliner_NonEscapingArgumentAllocation) {
+  EXPECT_EQ(0, AllocationsAfterInlining(100));
+}
+
+// Without the heuristic, the call is not inlined and the allocation stays.
+ISOLATE_UNIT_TEST_CASE(Inliner_NonEscapingArgumentAllocationDisabled) {
+  EXPECT_EQ(1, AllocationsAfterInlining(0));
+}
+
 }  // namespace dart
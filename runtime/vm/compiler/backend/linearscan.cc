@@ -18,6 +18,17 @@
 
 namespace dart {
 
+DEFINE_FLAG(bool,
+            graph_coloring_allocator,
+            false,
+            "In AOT mode, color the interference graph of the live ranges "
+            "before allocating registers with the linear scan.");
+DEFINE_FLAG(int,
+            graph_coloring_max_ranges,
+            2000,
+            "Do not color the interference graph of functions with more "
+            "live ranges of one register kind.");
+
 #if defined(DEBUG)
 #define TRACE_ALLOC(statement)                                                 \
   do {                                                                         \
@@ -88,7 +99,8 @@ static ExtraLoopInfo* ComputeExtraLoopInfo(Zone* zone, LoopInfo* loop_info) {
 }
 
 FlowGraphAllocator::FlowGraphAllocator(const FlowGraph& flow_graph,
-                                       bool intrinsic_mode)
+                                       bool intrinsic_mode,
+                                       bool graph_coloring)
     : flow_graph_(flow_graph),
       reaching_defs_(flow_graph),
       value_representations_(flow_graph.max_virtual_register_number()),
@@ -110,6 +122,7 @@ FlowGraphAllocator::FlowGraphAllocator(const FlowGraph& flow_graph,
       safepoints_(),
       register_kind_(),
       number_of_registers_(0),
+      reserved_(),
       registers_(),
       blocked_registers_(),
       unallocated_(),
@@ -117,7 +130,8 @@ FlowGraphAllocator::FlowGraphAllocator(const FlowGraph& flow_graph,
       quad_spill_slots_(),
       untagged_spill_slots_(),
       cpu_spill_slot_count_(0),
-      intrinsic_mode_(intrinsic_mode) {
+      intrinsic_mode_(intrinsic_mode),
+      graph_coloring_(graph_coloring && !intrinsic_mode) {
   for (intptr_t i = 0; i < vreg_count_; i++) {
     live_ranges_.Add(NULL);
   }
@@ -2120,6 +2134,16 @@ intptr_t FlowGraphAllocator::FirstIntersectionWithAllocated(
         unallocated->finger()->first_pending_use_interval(), allocated_head);
     if (pos < intersection) intersection = pos;
   }
+  // Ranges that reserved the register start later and cannot be evicted.
+  for (intptr_t i = 0; i < reserved_[reg]->length(); i++) {
+    LiveRange* reserved = (*reserved_[reg])[i];
+    if (reserved->Start() >= intersection) continue;
+
+    const intptr_t pos =
+        FirstIntersection(unallocated->finger()->first_pending_use_interval(),
+                          reserved->first_use_interval());
+    if (pos < intersection) intersection = pos;
+  }
   return intersection;
 }
 
@@ -2208,7 +2232,8 @@ bool FlowGraphAllocator::AllocateFreeRegister(LiveRange* unallocated) {
                           hint.Name(), unallocated->vreg(), free_until));
   } else {
     for (intptr_t reg = 0; reg < NumberOfRegisters(); ++reg) {
-      if (!blocked_registers_[reg] && (registers_[reg]->length() == 0)) {
+      if (!blocked_registers_[reg] && (registers_[reg]->length() == 0) &&
+          reserved_[reg]->is_empty()) {
         candidate = reg;
         free_until = kMaxPosition;
         break;
@@ -2466,6 +2491,20 @@ bool FlowGraphAllocator::UpdateFreeUntil(intptr_t reg,
     }
   }
 
+  // Ranges that reserved the register can't be evicted either.
+  for (intptr_t i = 0; i < reserved_[reg]->length(); i++) {
+    LiveRange* reserved = (*reserved_[reg])[i];
+    const intptr_t intersection = FirstIntersection(
+        reserved->first_use_interval(), unallocated->first_use_interval());
+    if (intersection <= start) return false;
+    if (intersection < free_until) free_until = intersection;
+    if (intersection < blocked_at) blocked_at = intersection;
+
+    if (free_until <= *cur_free_until) {
+      return false;
+    }
+  }
+
   ASSERT(free_until > *cur_free_until);
   *cur_free_until = free_until;
   *cur_blocked_at = blocked_at;
@@ -2720,9 +2759,11 @@ void FlowGraphAllocator::PrepareForAllocation(
 
   blocked_registers_.Clear();
   registers_.Clear();
+  reserved_.Clear();
   for (intptr_t i = 0; i < number_of_registers_; i++) {
     blocked_registers_.Add(false);
     registers_.Add(new ZoneGrowableArray<LiveRange*>);
+    reserved_.Add(new ZoneGrowableArray<LiveRange*>);
   }
   ASSERT(unallocated_.is_empty());
   unallocated_.AddArray(unallocated);
@@ -2739,6 +2780,447 @@ void FlowGraphAllocator::PrepareForAllocation(
   }
 }
 
+static uint64_t RegisterBit(intptr_t reg) {
+  return static_cast<uint64_t>(1) << reg;
+}
+
+static intptr_t LowestRegister(uint64_t registers) {
+  ASSERT(registers != 0);
+  intptr_t reg = 0;
+  while ((registers & RegisterBit(reg)) == 0) {
+    reg++;
+  }
+  return reg;
+}
+
+// Interference graph of the live ranges of one register kind. Nodes are
+// live ranges, edges connect live ranges that are live at the same time.
+// Coalesced nodes are represented by the node they were merged into and
+// edges only connect such representatives.
+class InterferenceGraph : public ValueObject {
+ public:
+  InterferenceGraph(Zone* zone, intptr_t capacity)
+      : zone_(zone),
+        capacity_(capacity),
+        ranges_(capacity),
+        representatives_(capacity),
+        neighbors_(capacity),
+        allowed_(capacity),
+        hinted_(capacity),
+        costs_(capacity),
+        colors_(capacity),
+        affinities_() {}
+
+  intptr_t NodeCount() const { return ranges_.length(); }
+  LiveRange* RangeAt(intptr_t node) const { return ranges_[node]; }
+
+  // Adds a node for the given range that can be colored with the [allowed]
+  // registers, prefers the [hinted] ones and costs [cost] when spilled.
+  intptr_t AddNode(LiveRange* range,
+                   uint64_t allowed,
+                   uint64_t hinted,
+                   intptr_t cost) {
+    const intptr_t node = NodeCount();
+    ranges_.Add(range);
+    representatives_.Add(node);
+    neighbors_.Add(new (zone_) BitVector(zone_, capacity_));
+    allowed_.Add(allowed);
+    hinted_.Add(hinted);
+    costs_.Add(cost);
+    colors_.Add(kNoRegister);
+    return node;
+  }
+
+  void AddInterference(intptr_t a, intptr_t b) {
+    neighbors_[a]->Add(b);
+    neighbors_[b]->Add(a);
+  }
+
+  // Records that nodes [a] and [b] should get the same color, which saves
+  // moves executed about [weight] times.
+  void AddAffinity(intptr_t a, intptr_t b, intptr_t weight) {
+    Affinity affinity = {a, b, weight};
+    affinities_.Add(affinity);
+  }
+
+  // Merges nodes connected by affinities, heaviest first, as long as the
+  // merged node has fewer neighbors of significant degree than registers
+  // (Briggs' conservative test), so that coalescing never makes the graph
+  // harder to color.
+  void Coalesce();
+
+  // Colors the graph by simplification and optimistic selection. Nodes
+  // that can't be colored are left with kNoRegister.
+  void Color();
+
+  intptr_t ColorOf(intptr_t node) const { return colors_[Find(node)]; }
+
+ private:
+  struct Affinity {
+    intptr_t a;
+    intptr_t b;
+    intptr_t weight;
+  };
+
+  static int CompareAffinities(const Affinity* a, const Affinity* b) {
+    // Heaviest first.
+    if (a->weight != b->weight) return (a->weight > b->weight) ? -1 : 1;
+    return 0;
+  }
+
+  static intptr_t CountRegisters(uint64_t registers) {
+    return Utils::CountOneBits64(registers);
+  }
+
+  intptr_t Find(intptr_t node) const {
+    while (representatives_[node] != node) {
+      node = representatives_[node];
+    }
+    return node;
+  }
+
+  intptr_t Degree(intptr_t node) {
+    intptr_t degree = 0;
+    for (BitVector::Iterator it(neighbors_[node]); !it.Done(); it.Advance()) {
+      degree++;
+    }
+    return degree;
+  }
+
+  bool IsSignificant(intptr_t node) {
+    return Degree(node) >= CountRegisters(allowed_[node]);
+  }
+
+  void Merge(intptr_t into, intptr_t from);
+  intptr_t SelectColor(intptr_t node);
+
+  Zone* zone_;
+  const intptr_t capacity_;
+  GrowableArray<LiveRange*> ranges_;
+  GrowableArray<intptr_t> representatives_;
+  GrowableArray<BitVector*> neighbors_;
+  GrowableArray<uint64_t> allowed_;
+  GrowableArray<uint64_t> hinted_;
+  GrowableArray<intptr_t> costs_;
+  GrowableArray<intptr_t> colors_;
+  GrowableArray<Affinity> affinities_;
+
+  DISALLOW_COPY_AND_ASSIGN(InterferenceGraph);
+};
+
+void InterferenceGraph::Coalesce() {
+  affinities_.Sort(CompareAffinities);
+  for (intptr_t i = 0; i < affinities_.length(); i++) {
+    const intptr_t a = Find(affinities_[i].a);
+    const intptr_t b = Find(affinities_[i].b);
+    if ((a == b) || neighbors_[a]->Contains(b)) continue;
+
+    const intptr_t k = CountRegisters(allowed_[a] & allowed_[b]);
+    if (k == 0) continue;
+
+    intptr_t significant = 0;
+    for (BitVector::Iterator it(neighbors_[a]); !it.Done(); it.Advance()) {
+      if (IsSignificant(it.Current())) significant++;
+    }
+    for (BitVector::Iterator it(neighbors_[b]); !it.Done(); it.Advance()) {
+      if (!neighbors_[a]->Contains(it.Current()) &&
+          IsSignificant(it.Current())) {
+        significant++;
+      }
+    }
+    if (significant >= k) continue;
+
+    Merge(a, b);
+  }
+}
+
+void InterferenceGraph::Merge(intptr_t into, intptr_t from) {
+  representatives_[from] = into;
+  for (BitVector::Iterator it(neighbors_[from]); !it.Done(); it.Advance()) {
+    BitVector* neighbors = neighbors_[it.Current()];
+    neighbors->Remove(from);
+    neighbors->Add(into);
+  }
+  neighbors_[into]->AddAll(neighbors_[from]);
+  neighbors_[from]->Clear();
+  allowed_[into] &= allowed_[from];
+  hinted_[into] |= hinted_[from];
+  costs_[into] += costs_[from];
+}
+
+void InterferenceGraph::Color() {
+  const intptr_t count = NodeCount();
+  GrowableArray<intptr_t> degrees(count);
+  GrowableArray<bool> removed(count);
+  intptr_t remaining = 0;
+  for (intptr_t node = 0; node < count; node++) {
+    const bool is_representative = (Find(node) == node);
+    degrees.Add(is_representative ? Degree(node) : 0);
+    removed.Add(!is_representative);
+    if (is_representative) remaining++;
+  }
+
+  // Simplify: remove nodes that are guaranteed to get a color. When there
+  // are none, optimistically remove the node that is cheapest to spill
+  // relative to the interference it removes.
+  GrowableArray<intptr_t> stack(remaining);
+  while (remaining > 0) {
+    intptr_t selected = -1;
+    for (intptr_t node = 0; node < count; node++) {
+      if (!removed[node] &&
+          (degrees[node] < CountRegisters(allowed_[node]))) {
+        selected = node;
+        break;
+      }
+    }
+    if (selected == -1) {
+      for (intptr_t node = 0; node < count; node++) {
+        if (removed[node]) continue;
+        if ((selected == -1) ||
+            (static_cast<int64_t>(costs_[node]) * (degrees[selected] + 1) <
+             static_cast<int64_t>(costs_[selected]) * (degrees[node] + 1))) {
+          selected = node;
+        }
+      }
+    }
+    removed[selected] = true;
+    remaining--;
+    stack.Add(selected);
+    for (BitVector::Iterator it(neighbors_[selected]); !it.Done();
+         it.Advance()) {
+      if (!removed[it.Current()]) degrees[it.Current()]--;
+    }
+  }
+
+  // Select: color nodes in the reverse order of their removal.
+  while (!stack.is_empty()) {
+    const intptr_t node = stack.RemoveLast();
+    colors_[node] = SelectColor(node);
+  }
+}
+
+intptr_t InterferenceGraph::SelectColor(intptr_t node) {
+  uint64_t used = 0;
+  for (BitVector::Iterator it(neighbors_[node]); !it.Done(); it.Advance()) {
+    const intptr_t color = colors_[it.Current()];
+    if (color != kNoRegister) used |= RegisterBit(color);
+  }
+  const uint64_t available = allowed_[node] & ~used;
+  if (available == 0) return kNoRegister;
+
+  // Prefer the colors of related nodes to remove the moves between them,
+  // then registers the uses are hinted to.
+  uint64_t preferred = 0;
+  for (intptr_t i = 0; i < affinities_.length(); i++) {
+    const intptr_t a = Find(affinities_[i].a);
+    const intptr_t b = Find(affinities_[i].b);
+    if ((a == node) && (colors_[b] != kNoRegister)) {
+      preferred |= RegisterBit(colors_[b]);
+    } else if ((b == node) && (colors_[a] != kNoRegister)) {
+      preferred |= RegisterBit(colors_[a]);
+    }
+  }
+  if ((available & preferred) != 0) {
+    return LowestRegister(available & preferred);
+  }
+  if ((available & hinted_[node]) != 0) {
+    return LowestRegister(available & hinted_[node]);
+  }
+  return LowestRegister(available);
+}
+
+intptr_t FlowGraphAllocator::LoopWeightAt(intptr_t pos) {
+  LoopInfo* loop_info = BlockEntryAt(pos)->loop_info();
+  if (loop_info == nullptr) return 1;
+  const intptr_t depth = Utils::Minimum<intptr_t>(loop_info->NestingDepth(), 4);
+  return static_cast<intptr_t>(1) << (3 * depth);
+}
+
+uint64_t FlowGraphAllocator::AvailableRegistersFor(LiveRange* range) {
+  uint64_t available = 0;
+  for (intptr_t reg = 0; reg < NumberOfRegisters(); reg++) {
+    if (blocked_registers_[reg]) continue;
+    // Only the ranges blocking the register for fixed locations have been
+    // allocated at this point.
+    bool is_free = true;
+    for (intptr_t i = 0; i < registers_[reg]->length(); i++) {
+      LiveRange* blocking = (*registers_[reg])[i];
+      if (FirstIntersection(range->first_use_interval(),
+                            blocking->first_use_interval()) != kMaxPosition) {
+        is_free = false;
+        break;
+      }
+    }
+    if (is_free) available |= RegisterBit(reg);
+  }
+  return available;
+}
+
+uint64_t FlowGraphAllocator::HintedRegistersFor(LiveRange* range) {
+  uint64_t hinted = 0;
+  for (UsePosition* use = range->first_use(); use != NULL; use = use->next()) {
+    if (!use->HasHint()) continue;
+    const Location hint = use->hint();
+    if (hint.IsMachineRegister() && (hint.kind() == register_kind_)) {
+      hinted |= RegisterBit(hint.register_code());
+    }
+  }
+  return hinted;
+}
+
+intptr_t FlowGraphAllocator::SpillCostFor(LiveRange* range) {
+  // Each use that benefits from a register would need a load or a memory
+  // operand when the range is spilled, weighted by the depth of its loop.
+  intptr_t cost = 0;
+  for (UsePosition* use = range->first_use(); use != NULL; use = use->next()) {
+    Location* loc = use->location_slot();
+    if (!loc->IsUnallocated() || !loc->IsRegisterBeneficial()) continue;
+    const bool requires_register =
+        (loc->policy() == Location::kRequiresRegister) ||
+        (loc->policy() == Location::kRequiresFpuRegister);
+    cost += (requires_register ? 2 : 1) * LoopWeightAt(use->pos());
+  }
+  // A spilled loop phi adds memory moves on the back edge.
+  if (range->is_loop_phi()) cost += LoopWeightAt(range->Start());
+  return cost;
+}
+
+static void AddPhiAffinity(InterferenceGraph* graph,
+                           const GrowableArray<intptr_t>& node_of_vreg,
+                           intptr_t phi_vreg,
+                           intptr_t input_vreg,
+                           intptr_t weight) {
+  if (input_vreg < 0) return;
+  const intptr_t phi_node = node_of_vreg[phi_vreg];
+  const intptr_t input_node = node_of_vreg[input_vreg];
+  if ((phi_node >= 0) && (input_node >= 0)) {
+    graph->AddAffinity(phi_node, input_node, weight);
+  }
+}
+
+void FlowGraphAllocator::ColorUnallocatedRanges() {
+  const intptr_t count = unallocated_.length();
+  if (!graph_coloring_ || (count == 0) ||
+      (count > FLAG_graph_coloring_max_ranges)) {
+    return;
+  }
+  COMPILE_ASSERT(kNumberOfCpuRegisters <= 64);
+  COMPILE_ASSERT(kNumberOfFpuRegisters <= 64);
+
+  Zone* zone = flow_graph_.zone();
+  InterferenceGraph graph(zone, count);
+
+  // Number the nodes in the order of the start of their ranges,
+  // unallocated_ is sorted the other way around.
+  GrowableArray<intptr_t> node_of_vreg(vreg_count_);
+  for (intptr_t vreg = 0; vreg < vreg_count_; vreg++) {
+    node_of_vreg.Add(-1);
+  }
+  for (intptr_t i = count - 1; i >= 0; i--) {
+    LiveRange* range = unallocated_[i];
+    const intptr_t node =
+        graph.AddNode(range, AvailableRegistersFor(range),
+                      HintedRegistersFor(range), SpillCostFor(range));
+    if ((range->vreg() >= 0) && (GetLiveRange(range->vreg()) == range)) {
+      node_of_vreg[range->vreg()] = node;
+    }
+  }
+
+  // Sweep over the ranges in the order of their start, keeping the ranges
+  // that have not ended yet.
+  GrowableArray<intptr_t> active;
+  for (intptr_t node = 0; node < count; node++) {
+    LiveRange* range = graph.RangeAt(node);
+    intptr_t live = 0;
+    for (intptr_t i = 0; i < active.length(); i++) {
+      LiveRange* other = graph.RangeAt(active[i]);
+      if (other->End() <= range->Start()) continue;
+      active[live++] = active[i];
+      if (FirstIntersection(range->first_use_interval(),
+                            other->first_use_interval()) != kMaxPosition) {
+        graph.AddInterference(node, active[i]);
+      }
+    }
+    active.TruncateTo(live);
+    active.Add(node);
+  }
+
+  // Phis and their inputs are coalesced to remove the moves on the edges
+  // into the join.
+  for (intptr_t i = 0; i < block_order_.length(); i++) {
+    JoinEntryInstr* join = block_order_[i]->AsJoinEntry();
+    if (join == nullptr) continue;
+    for (PhiIterator it(join); !it.Done(); it.Advance()) {
+      PhiInstr* phi = it.Current();
+      const intptr_t phi_vreg = phi->ssa_temp_index();
+      for (intptr_t k = 0; k < phi->InputCount(); k++) {
+        const intptr_t weight =
+            LoopWeightAt(join->PredecessorAt(k)->end_pos() - 1);
+        const intptr_t input_vreg =
+            phi->InputAt(k)->definition()->ssa_temp_index();
+        AddPhiAffinity(&graph, node_of_vreg, phi_vreg, input_vreg, weight);
+        if (phi->HasPairRepresentation() && (input_vreg >= 0)) {
+          AddPhiAffinity(&graph, node_of_vreg, ToSecondPairVreg(phi_vreg),
+                         ToSecondPairVreg(input_vreg), weight);
+        }
+      }
+    }
+  }
+
+  graph.Coalesce();
+  graph.Color();
+
+  for (intptr_t node = 0; node < count; node++) {
+    const intptr_t reg = graph.ColorOf(node);
+    if (reg == kNoRegister) continue;
+    LiveRange* range = graph.RangeAt(node);
+    TRACE_ALLOC(THR_Print("coloring reserved %s for v%" Pd " [%" Pd
+                          ", %" Pd ")\n",
+                          MakeRegisterLocation(reg).Name(), range->vreg(),
+                          range->Start(), range->End()));
+    range->set_color(reg);
+    reserved_[reg]->Add(range);
+  }
+}
+
+bool FlowGraphAllocator::AllocateReservedRegister(LiveRange* unallocated) {
+  const intptr_t reg = unallocated->color();
+  if (reg == kNoRegister) return false;
+
+  unallocated->set_color(kNoRegister);
+  ZoneGrowableArray<LiveRange*>* reserved = reserved_[reg];
+  for (intptr_t i = 0; i < reserved->length(); i++) {
+    if ((*reserved)[i] == unallocated) {
+      reserved->RemoveAt(i);
+      break;
+    }
+  }
+
+  // Other ranges were kept out of the register while this one is live.
+  if (FirstIntersectionWithAllocated(reg, unallocated) != kMaxPosition) {
+    return false;
+  }
+
+  TRACE_ALLOC(THR_Print("assigning reserved register "));
+  TRACE_ALLOC(MakeRegisterLocation(reg).Print());
+  TRACE_ALLOC(THR_Print(" to v%" Pd "\n", unallocated->vreg()));
+
+  registers_[reg]->Add(unallocated);
+  unallocated->set_assigned_location(MakeRegisterLocation(reg));
+#if defined(TARGET_ARCH_DBC)
+  last_used_register_ = Utils::Maximum(last_used_register_, reg);
+#endif
+  return true;
+}
+
+bool FlowGraphAllocator::UseGraphColoring() {
+#if defined(TARGET_ARCH_DBC)
+  return false;
+#else
+  return FLAG_precompiled_mode && FLAG_graph_coloring_allocator;
+#endif
+}
+
 void FlowGraphAllocator::AllocateUnallocatedRanges() {
 #if defined(DEBUG)
   ASSERT(UnallocatedIsSorted());
@@ -2754,6 +3236,8 @@ void FlowGraphAllocator::AllocateUnallocatedRanges() {
     // TODO(vegorov): eagerly spill liveranges without register uses.
     AdvanceActiveIntervals(start);
 
+    if (AllocateReservedRegister(range)) continue;
+
     if (!AllocateFreeRegister(range)) {
       if (intrinsic_mode_) {
         // No spilling when compiling intrinsics.
@@ -3004,6 +3488,7 @@ void FlowGraphAllocator::AllocateRegisters() {
 
   PrepareForAllocation(Location::kRegister, kNumberOfCpuRegisters,
                        unallocated_cpu_, cpu_regs_, blocked_cpu_registers_);
+  ColorUnallocatedRanges();
   AllocateUnallocatedRanges();
 #if defined(TARGET_ARCH_DBC)
   const intptr_t last_used_cpu_register = last_used_register_;
@@ -3034,6 +3519,7 @@ void FlowGraphAllocator::AllocateRegisters() {
   ASSERT(unallocated_.is_empty());
 #endif
 
+  ColorUnallocatedRanges();
   AllocateUnallocatedRanges();
 #if defined(TARGET_ARCH_DBC)
   const intptr_t last_used_fpu_register = last_used_register_;
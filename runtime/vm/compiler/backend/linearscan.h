@@ -55,8 +55,15 @@ class FlowGraphAllocator : public ValueObject {
   static const intptr_t kDoubleSpillFactor =
       kDoubleSize / compiler::target::kWordSize;
 
+  // When [graph_coloring] is set the allocator first colors the
+  // interference graph of the live ranges (see ColorUnallocatedRanges).
+  // This is slower and is only meant for AOT compilation.
   explicit FlowGraphAllocator(const FlowGraph& flow_graph,
-                              bool intrinsic_mode = false);
+                              bool intrinsic_mode = false,
+                              bool graph_coloring = false);
+
+  // Whether optimized code is allocated with graph coloring by default.
+  static bool UseGraphColoring();
 
   void AllocateRegisters();
 
@@ -151,6 +158,20 @@ class FlowGraphAllocator : public ValueObject {
   // Process live ranges sorted by their start and assign registers
   // to them
   void AllocateUnallocatedRanges();
+
+  // Color the interference graph of the unallocated live ranges with the
+  // available registers, coalescing phis with their inputs when this keeps
+  // the graph colorable. Colored ranges reserve their register, the linear
+  // scan then assigns it to them and splits and spills only the ranges
+  // that were left uncolored around the reserved ones.
+  void ColorUnallocatedRanges();
+  uint64_t AvailableRegistersFor(LiveRange* range);
+  uint64_t HintedRegistersFor(LiveRange* range);
+  intptr_t SpillCostFor(LiveRange* range);
+  intptr_t LoopWeightAt(intptr_t pos);
+
+  // Assign the register reserved by coloring to the given live range.
+  bool AllocateReservedRegister(LiveRange* unallocated);
   void AdvanceActiveIntervals(const intptr_t start);
 
   // Connect split siblings over non-linear control flow edges.
@@ -299,6 +320,11 @@ class FlowGraphAllocator : public ValueObject {
   intptr_t last_used_register_;
 #endif
 
+  // Per register lists of colored live ranges that are not yet allocated.
+  // The linear scan keeps other live ranges out of these registers while
+  // the colored ones are live.
+  GrowableArray<ZoneGrowableArray<LiveRange*>*> reserved_;
+
   // Per register lists of allocated live ranges.  Contain only those
   // ranges that can be affected by future allocation decisions.
   // Those live ranges that end before the start of the current live range are
@@ -330,6 +356,8 @@ class FlowGraphAllocator : public ValueObject {
 
   const bool intrinsic_mode_;
 
+  const bool graph_coloring_;
+
   DISALLOW_COPY_AND_ASSIGN(FlowGraphAllocator);
 };
 
@@ -476,6 +504,7 @@ class LiveRange : public ZoneAllocated {
         next_sibling_(NULL),
         has_only_any_uses_in_loops_(0),
         is_loop_phi_(false),
+        color_(kNoRegister),
         finger_() {}
 
   intptr_t vreg() const { return vreg_; }
@@ -542,6 +571,10 @@ class LiveRange : public ZoneAllocated {
   bool is_loop_phi() const { return is_loop_phi_; }
   void mark_loop_phi() { is_loop_phi_ = true; }
 
+  // The register reserved for this range by graph coloring, or kNoRegister.
+  intptr_t color() const { return color_; }
+  void set_color(intptr_t color) { color_ = color; }
+
  private:
   LiveRange(intptr_t vreg,
             Representation rep,
@@ -561,6 +594,7 @@ class LiveRange : public ZoneAllocated {
         next_sibling_(next_sibling),
         has_only_any_uses_in_loops_(0),
         is_loop_phi_(false),
+        color_(kNoRegister),
         finger_() {}
 
   const intptr_t vreg_;
@@ -580,6 +614,7 @@ class LiveRange : public ZoneAllocated {
   static constexpr intptr_t kMaxLoops = sizeof(uint64_t) * kBitsPerByte;
   uint64_t has_only_any_uses_in_loops_;
   bool is_loop_phi_;
+  intptr_t color_;
 
   AllocationFinger finger_;
 
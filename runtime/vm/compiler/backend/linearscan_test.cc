@@ -0,0 +1,152 @@
+// Copyright (c) 2019, the Dart project authors.  Please see the AUTHORS file
+// for details. All rights reserved. Use of this source code is governed by a
+// BSD-style license that can be found in the LICENSE file.
+//
+// Unit tests for register allocation with graph coloring. The graphs are
+// allocated and compiled directly, so that coloring is used independently
+// of the mode the VM runs in.
+
+#include "vm/compiler/backend/linearscan.h"
+#include "vm/compiler/backend/block_scheduler.h"
+#include "vm/compiler/backend/il_test_helper.h"
+#include "vm/compiler/backend/loops.h"
+#include "vm/compiler/compiler_pass.h"
+#include "vm/object.h"
+#include "vm/unit_test.h"
+
+namespace dart {
+
+#if !defined(TARGET_ARCH_DBC)
+
+// Optimizes [function] with the JIT passes up to register allocation,
+// allocates registers with graph coloring and installs the code.
+static FlowGraph* CompileWithGraphColoring(TestPipeline* pipeline) {
+  FlowGraph* flow_graph = pipeline->RunPasses({
+      CompilerPass::kComputeSSA,
+      CompilerPass::kApplyICData,
+      CompilerPass::kTryOptimizePatterns,
+      CompilerPass::kSetOuterInliningId,
+      CompilerPass::kTypePropagation,
+      CompilerPass::kApplyClassIds,
+      CompilerPass::kInlining,
+      CompilerPass::kTypePropagation,
+      CompilerPass::kApplyICData,
+      CompilerPass::kCanonicalize,
+      CompilerPass::kBranchSimplify,
+      CompilerPass::kIfConvert,
+      CompilerPass::kConstantPropagation,
+      CompilerPass::kOptimisticallySpecializeSmiPhis,
+      CompilerPass::kTypePropagation,
+      CompilerPass::kSelectRepresentations,
+      CompilerPass::kCanonicalize,
+      CompilerPass::kEliminateDeadPhis,
+      CompilerPass::kFinalizeGraph,
+  });
+
+  flow_graph->GetLoopHierarchy();
+  FlowGraphAllocator allocator(*flow_graph, /*intrinsic_mode=*/false,
+                               /*graph_coloring=*/true);
+  allocator.AllocateRegisters();
+  BlockScheduler::ReorderBlocks(flow_graph);
+  pipeline->CompileGraphAndAttachFunction();
+  return flow_graph;
+}
+
+static RawObject* InvokeWithSmi(const Function& function, intptr_t value) {
+  const auto& arguments = Array::Handle(Array::New(1));
+  arguments.SetAt(0, Smi::Handle(Smi::New(value)));
+  return DartEntry::InvokeFunction(function, arguments);
+}
+
+ISOLATE_UNIT_TEST_CASE(GraphColoring_LoopPhis) {
+  const char* kScript = R"(
+    int sum(int n) {
+      int s = 0;
+      for (int i = 0; i < n; i++) {
+        s = (s + i * i) & 0xFFFFFF;
+      }
+      return s;
+    }
+
+    main() {
+      for (var i = 0; i < 10; i++) {
+        sum(100);
+      }
+    }
+  )";
+
+  const auto& root_library = Library::Handle(LoadTestScript(kScript));
+  const auto& function = Function::Handle(GetFunction(root_library, "sum"));
+
+  Invoke(root_library, "main");
+
+  TestPipeline pipeline(function, CompilerPass::kJIT);
+  FlowGraph* flow_graph = CompileWithGraphColoring(&pipeline);
+
+  // There are enough registers for the loop phis, they are not spilled on
+  // the back edge.
+  for (BlockIterator block_it = flow_graph->reverse_postorder_iterator();
+       !block_it.Done(); block_it.Advance()) {
+    JoinEntryInstr* join = block_it.Current()->AsJoinEntry();
+    if ((join == nullptr) || !join->IsLoopHeader()) continue;
+    for (intptr_t i = 0; i < join->PredecessorCount(); i++) {
+      BlockEntryInstr* pred = join->PredecessorAt(i);
+      if (!join->loop_info()->Contains(pred)) continue;
+      GotoInstr* back_edge = pred->last_instruction()->AsGoto();
+      if ((back_edge == nullptr) || !back_edge->HasParallelMove()) continue;
+      ParallelMoveInstr* moves = back_edge->parallel_move();
+      for (intptr_t j = 0; j < moves->NumMoves(); j++) {
+        EXPECT(!moves->MoveOperandsAt(j)->dest().IsStackSlot());
+      }
+    }
+  }
+
+  const auto& result = Object::Handle(InvokeWithSmi(function, 100));
+  EXPECT(result.IsSmi());
+  EXPECT_EQ(328350, Smi::Cast(result).Value());
+}
+
+ISOLATE_UNIT_TEST_CASE(GraphColoring_HighPressure) {
+  // More values are live in the loop than there are registers, so some
+  // ranges are left uncolored and are split by the linear scan.
+  const char* kScript = R"(
+    int mix(int n) {
+      int a = n + 1, b = n + 2, c = n + 3, d = n + 4, e = n + 5, f = n + 6;
+      int g = n + 7, h = n + 8, i = n + 9, j = n + 10, k = n + 11;
+      int l = n + 12, m = n + 13, o = n + 14, p = n + 15, q = n + 16;
+      for (int x = 0; x < n; x++) {
+        a = (a + b) & 0xFFFF; b = (b + c) & 0xFFFF; c = (c + d) & 0xFFFF;
+        d = (d + e) & 0xFFFF; e = (e + f) & 0xFFFF; f = (f + g) & 0xFFFF;
+        g = (g + h) & 0xFFFF; h = (h + i) & 0xFFFF; i = (i + j) & 0xFFFF;
+        j = (j + k) & 0xFFFF; k = (k + l) & 0xFFFF; l = (l + m) & 0xFFFF;
+        m = (m + o) & 0xFFFF; o = (o + p) & 0xFFFF; p = (p + q) & 0xFFFF;
+        q = (q + a) & 0xFFFF;
+      }
+      return a + b + c + d + e + f + g + h + i + j + k + l + m + o + p + q;
+    }
+
+    main() {
+      for (var i = 0; i < 10; i++) {
+        mix(10);
+      }
+    }
+  )";
+
+  const auto& root_library = Library::Handle(LoadTestScript(kScript));
+  const auto& function = Function::Handle(GetFunction(root_library, "mix"));
+
+  Invoke(root_library, "main");
+  const auto& expected = Object::Handle(InvokeWithSmi(function, 37));
+  EXPECT(expected.IsSmi());
+
+  TestPipeline pipeline(function, CompilerPass::kJIT);
+  CompileWithGraphColoring(&pipeline);
+
+  const auto& result = Object::Handle(InvokeWithSmi(function, 37));
+  EXPECT(result.IsSmi());
+  EXPECT_EQ(Smi::Cast(expected).Value(), Smi::Cast(result).Value());
+}
+
+#endif  // !defined(TARGET_ARCH_DBC)
+
+}  // namespace dart
@@ -0,0 +1,1459 @@
+// Copyright (c) 2019, the Dart project authors.  Please see the AUTHORS file
+// for details. All rights reserved. Use of this source code is governed by a
+// BSD-style license that can be found in the LICENSE file.
+
+#if !defined(DART_PRECOMPILED_RUNTIME)
+
+#include "vm/compiler/backend/loop_optimizer.h"
+
+#include "vm/compiler/backend/flow_graph.h"
+#include "vm/compiler/backend/flow_graph_compiler.h"
+#include "vm/compiler/backend/il.h"
+#include "vm/compiler/backend/loops.h"
+
+namespace dart {
+
+DEFINE_FLAG(int,
+            loop_unroll_factor,
+            4,
+            "Unroll counted loops this many times (a value below 2 disables "
+            "unrolling).");
+DEFINE_FLAG(bool,
+            loop_vectorization,
+            true,
+            "Vectorize counted loops over Float32List and Float64List.");
+DEFINE_FLAG(bool,
+            loop_versioning,
+            true,
+            "Version counted loops to run without bounds and null checks "
+            "when a guard before the loop proves them redundant.");
+DEFINE_FLAG(bool,
+            trace_loop_optimizer,
+            false,
+            "Trace loop versioning, unrolling and vectorization.");
+
+// Upper bound on the number of instructions in an unrolled loop body.
+static const intptr_t kMaxUnrolledSize = 64;
+
+// Upper bound on the number of instructions in a versioned loop body.
+static const intptr_t kMaxVersionedSize = 64;
+
+#define Z (flow_graph_->zone())
+
+// Strip-mines a counted loop
+//
+//   P:  goto H
+//   H:  i = phi(i0, i'), r = phi(r0, r')
+//       if (i < n) goto B else goto X
+//   B:  ... i' = i + 1
+//       goto H
+//
+// into a main loop VH/VB that performs step() iterations of B at once,
+// followed by the original loop, which performs the remaining iterations:
+//
+//   P:  lengths, bound = min(lengths) - (step - 1)
+//       goto VH
+//   VH: j = phi(i0, j'), s = phi(r0, s')
+//       check stack overflow
+//       if (j >= 0 && j < bound && j + (step - 1) < n) goto VB else goto E
+//   VB: ... j' = j + step
+//       goto VH
+//   E:  goto H
+//   H:  i = phi(i', j), r = phi(r', s)
+//       ...
+//
+// When versioning a loop, step() is 1 and the guards are evaluated once
+// before the main loop instead, which then runs to completion:
+//
+//   P:  lengths, bound = min(lengths)
+//       goto G
+//   G:  if (i0 >= 0 && n <= bound && x != null ...) goto VH else goto E
+//   VH: j = phi(i0, j'), s = phi(r0, s')
+//       check stack overflow
+//       if (j < n) goto VB else goto E
+//   VB: ... j' = j + 1
+//       goto VH
+//   E:  k = phi(i0, j), t = phi(r0, s)
+//       goto H
+//   H:  i = phi(i', k), r = phi(r', t)
+//       ...
+//
+// A strip-mined main loop may also require guards before it, in the same
+// way as a loop version, for properties that hold on all of its iterations
+// if they hold on the first.
+//
+// Subclasses decide which loops are eligible and emit the main loop body.
+class LoopStripMiner : public ZoneAllocated {
+ public:
+  explicit LoopStripMiner(FlowGraph* flow_graph)
+      : flow_graph_(flow_graph),
+        loop_(nullptr),
+        header_(nullptr),
+        body_(nullptr),
+        preheader_goto_(nullptr),
+        induction_(nullptr),
+        entry_index_(-1),
+        compare_(nullptr),
+        body_on_true_(true),
+        limit_(nullptr),
+        initial_non_negative_(false),
+        arrays_(),
+        checked_lengths_(),
+        null_checks_(),
+        class_checks_(),
+        internal_arrays_(),
+        internal_array_cid_(kIllegalCid),
+        reductions_() {}
+
+  virtual ~LoopStripMiner() {}
+
+  // Returns true if the loop is a counted loop that the strip miner knows
+  // how to transform.
+  bool MatchCountedLoop(LoopInfo* loop);
+
+  // Performs the transformation. The caller rediscovers blocks afterwards.
+  void Transform();
+
+  JoinEntryInstr* header() const { return header_; }
+
+ protected:
+  Zone* zone() const { return flow_graph_->zone(); }
+
+  // The number of iterations of the original loop per main loop iteration.
+  virtual intptr_t step() const = 0;
+
+  // Returns true if the guards are evaluated once before the main loop
+  // rather than on every iteration of it.
+  virtual bool VersionsLoop() const { return false; }
+
+  // Appends the main loop body after the given instruction and returns the
+  // last instruction appended. Sets the back edge values of the reduction
+  // phis of the main loop.
+  virtual Instruction* EmitBody(Instruction* cursor,
+                                PhiInstr* index,
+                                GrowableArray<PhiInstr*>* reductions) = 0;
+
+  // Returns true if the definition is computed outside of the loop.
+  bool IsInvariant(Definition* def) const {
+    return !loop_->Contains(def->GetBlock());
+  }
+
+  // Returns true if the instruction is the increment of the induction that
+  // is not used by anything other than the induction itself.
+  bool IsIncrement(Instruction* instr) const;
+
+  // Returns true if the instruction is a bounds check on the induction
+  // against a loop invariant length. Such checks are dropped from the main
+  // loop, as its guard covers them.
+  bool IsInductionBoundsCheck(Instruction* instr) const;
+
+  // Returns true if the instruction is a null check or a monomorphic class
+  // check on a loop invariant value. A loop version guarded before the loop
+  // drops such checks.
+  bool IsInvariantCheck(Instruction* instr) const;
+
+  // Returns true if the instruction is a check recorded in null_checks_ or
+  // class_checks_.
+  bool IsGuardedCheck(Instruction* instr) const;
+
+  // Returns true if the index is the induction variable itself.
+  bool IsInductionIndex(Value* index) const {
+    return index->definition()
+               ->OriginalDefinitionIgnoreBoxingAndConstraints() == induction_;
+  }
+
+  // Returns true if the instruction loads the data pointer of a typed data
+  // object, as done for accesses to typed data of unknown class.
+  static bool IsDataLoad(Instruction* instr) {
+    LoadUntaggedInstr* load = instr->AsLoadUntagged();
+    return load != nullptr &&
+           load->offset() ==
+               compiler::target::TypedDataBase::data_field_offset();
+  }
+
+  // Notes an access to a typed data array, whose length the main loop
+  // should not reach past.
+  void AddArray(Value* array);
+
+  // Notes the length of a bounds check dropped from the main loop.
+  void AddCheckedLength(Definition* length);
+
+  // Emits i + offset in the representation of the induction variable.
+  Definition* EmitIndexAdd(Instruction** cursor,
+                           Definition* index,
+                           intptr_t offset);
+
+  FlowGraph* const flow_graph_;
+
+  LoopInfo* loop_;
+  JoinEntryInstr* header_;
+  BlockEntryInstr* body_;
+  GotoInstr* preheader_goto_;
+
+  // The induction variable i and the index of the preheader in the
+  // predecessors of the header.
+  PhiInstr* induction_;
+  intptr_t entry_index_;
+
+  // The loop condition i < n.
+  RelationalOpInstr* compare_;
+  bool body_on_true_;
+  Definition* limit_;
+  bool initial_non_negative_;
+
+  // Loop invariant typed data arrays accessed in the loop.
+  GrowableArray<Definition*> arrays_;
+
+  // Lengths of the bounds checks that are dropped from the main loop.
+  GrowableArray<Definition*> checked_lengths_;
+
+  // Null and class checks on loop invariant values that are dropped from
+  // the main loop. Only used when versioning.
+  GrowableArray<CheckNullInstr*> null_checks_;
+  GrowableArray<CheckClassInstr*> class_checks_;
+
+  // Typed data objects that the main loop only runs on if they are internal
+  // typed data of class internal_array_cid_, whose data cannot overlap that
+  // of another object.
+  GrowableArray<Definition*> internal_arrays_;
+  intptr_t internal_array_cid_;
+
+  // Header phis other than the induction variable.
+  GrowableArray<PhiInstr*> reductions_;
+
+ private:
+  TargetEntryInstr* NewTarget() {
+    return new (Z) TargetEntryInstr(flow_graph_->allocate_block_id(),
+                                    header_->try_index(), DeoptId::kNone);
+  }
+
+  JoinEntryInstr* NewJoin() {
+    return new (Z) JoinEntryInstr(flow_graph_->allocate_block_id(),
+                                  header_->try_index(), DeoptId::kNone);
+  }
+
+  Definition* EmitGuardBound();
+
+  // Appends a branch on the guard to the given block and returns the
+  // target taken when the guard holds. The other target goes to exit.
+  TargetEntryInstr* EmitGuard(BlockEntryInstr* block,
+                              Instruction* cursor,
+                              ComparisonInstr* guard,
+                              bool continue_on_true,
+                              JoinEntryInstr* exit);
+
+  // Appends the guards that are evaluated once before the main loop.
+  TargetEntryInstr* EmitEntryGuards(JoinEntryInstr* block,
+                                    Definition* bound,
+                                    JoinEntryInstr* exit,
+                                    intptr_t* exit_count);
+
+  // Appends a copy of the stack overflow check of the original header, so
+  // that the main loop can still be interrupted.
+  Instruction* EmitStackOverflowCheck(
+      Instruction* cursor,
+      PhiInstr* index,
+      const GrowableArray<PhiInstr*>& reductions);
+
+  PhiInstr* AddExitPhi(JoinEntryInstr* exit,
+                       intptr_t guard_exit_count,
+                       intptr_t loop_exit_count,
+                       Definition* initial,
+                       Definition* last);
+
+  DISALLOW_COPY_AND_ASSIGN(LoopStripMiner);
+};
+
+bool LoopStripMiner::MatchCountedLoop(LoopInfo* loop) {
+  loop_ = loop;
+  header_ = loop->header()->AsJoinEntry();
+  if (loop->inner() != nullptr || header_ == nullptr ||
+      header_->PredecessorCount() != 2 || loop->back_edges().length() != 1) {
+    return false;
+  }
+
+  // The header consists of phis, a stack overflow check and the branch
+  // on the loop condition.
+  BranchInstr* branch = header_->last_instruction()->AsBranch();
+  if (branch == nullptr) {
+    return false;
+  }
+  for (Instruction* instr = header_->next(); instr != branch;
+       instr = instr->next()) {
+    if (!instr->IsCheckStackOverflow()) {
+      return false;
+    }
+  }
+  compare_ = branch->comparison()->AsRelationalOp();
+  if (compare_ == nullptr || compare_->CanDeoptimize()) {
+    return false;
+  }
+  // The guards compare the induction and the limit like the loop does.
+  if (compare_->operation_cid() != kSmiCid &&
+      compare_->operation_cid() != kMintCid) {
+    return false;
+  }
+  body_on_true_ = loop->Contains(branch->true_successor());
+  body_ = body_on_true_ ? branch->true_successor() : branch->false_successor();
+  if (!loop->Contains(body_) || loop->back_edges()[0] != body_ ||
+      !body_->last_instruction()->IsGoto()) {
+    return false;
+  }
+
+  // The loop runs while i < n for a unit stride induction i.
+  InductionVar* control = loop->control();
+  int64_t stride = 0;
+  if (!InductionVar::IsLinear(control, &stride) || stride != 1) {
+    return false;
+  }
+  const Token::Kind kind = body_on_true_
+                               ? compare_->kind()
+                               : Token::NegateComparison(compare_->kind());
+  induction_ = compare_->left()->definition()->AsPhi();
+  if (kind != Token::kLT || induction_ == nullptr ||
+      induction_->block() != header_ ||
+      loop->LookupInduction(induction_) != control) {
+    return false;
+  }
+  limit_ = compare_->right()->definition();
+  if (!IsInvariant(limit_)) {
+    return false;
+  }
+  if (induction_->representation() == kTagged) {
+    if (induction_->Type()->ToCid() != kSmiCid) {
+      return false;
+    }
+  } else if (induction_->representation() != kUnboxedInt64) {
+    return false;
+  }
+  int64_t initial = 0;
+  initial_non_negative_ =
+      InductionVar::IsConstant(control->initial(), &initial) && initial >= 0;
+
+  entry_index_ = loop->Contains(header_->PredecessorAt(0)) ? 1 : 0;
+  preheader_goto_ =
+      header_->PredecessorAt(entry_index_)->last_instruction()->AsGoto();
+  if (preheader_goto_ == nullptr) {
+    return false;
+  }
+
+  // Do not strip-mine the epilogue of a loop that was strip-mined or
+  // versioned before. Its initial value is the induction of the main loop,
+  // possibly merged with the initial value of the main loop.
+  PhiInstr* initial_phi =
+      induction_->InputAt(entry_index_)->definition()->AsPhi();
+  if (initial_phi != nullptr) {
+    for (intptr_t i = -1; i < initial_phi->InputCount(); i++) {
+      PhiInstr* phi =
+          i < 0 ? initial_phi : initial_phi->InputAt(i)->definition()->AsPhi();
+      if (phi == nullptr) {
+        continue;
+      }
+      LoopInfo* other = phi->block()->loop_info();
+      if (other != nullptr && other->header() == phi->block() &&
+          !loop->IsIn(other)) {
+        return false;
+      }
+    }
+  }
+
+  for (PhiIterator it(header_); !it.Done(); it.Advance()) {
+    if (it.Current() != induction_) {
+      reductions_.Add(it.Current());
+    }
+  }
+  return true;
+}
+
+bool LoopStripMiner::IsIncrement(Instruction* instr) const {
+  Definition* def = instr->AsDefinition();
+  if (def == nullptr ||
+      def != induction_->InputAt(1 - entry_index_)->definition()) {
+    return false;
+  }
+  Value* use = def->input_use_list();
+  return use != nullptr && use->next_use() == nullptr &&
+         use->instruction() == induction_;
+}
+
+bool LoopStripMiner::IsInductionBoundsCheck(Instruction* instr) const {
+  CheckBoundBase* check = instr->AsCheckBoundBase();
+  return check != nullptr && IsInductionIndex(check->index()) &&
+         IsInvariant(check->length()->definition());
+}
+
+bool LoopStripMiner::IsInvariantCheck(Instruction* instr) const {
+  if (CheckNullInstr* check = instr->AsCheckNull()) {
+    return IsInvariant(check->value()->definition());
+  }
+  if (CheckClassInstr* check = instr->AsCheckClass()) {
+    return IsInvariant(check->value()->definition()) &&
+           !check->IsNullCheck() && check->cids().IsMonomorphic();
+  }
+  return false;
+}
+
+bool LoopStripMiner::IsGuardedCheck(Instruction* instr) const {
+  for (intptr_t i = 0; i < null_checks_.length(); i++) {
+    if (null_checks_[i] == instr) {
+      return true;
+    }
+  }
+  for (intptr_t i = 0; i < class_checks_.length(); i++) {
+    if (class_checks_[i] == instr) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void LoopStripMiner::AddArray(Value* value) {
+  if (IsDataLoad(value->definition())) {
+    value = value->definition()->InputAt(0);
+  }
+  Definition* array = value->definition();
+  if (array->representation() != kTagged || !IsInvariant(array) ||
+      value->Type()->is_nullable()) {
+    return;
+  }
+  for (intptr_t i = 0; i < arrays_.length(); i++) {
+    if (arrays_[i] == array) {
+      return;
+    }
+  }
+  arrays_.Add(array);
+}
+
+void LoopStripMiner::AddCheckedLength(Definition* length) {
+  for (intptr_t i = 0; i < checked_lengths_.length(); i++) {
+    if (checked_lengths_[i] == length) {
+      return;
+    }
+  }
+  checked_lengths_.Add(length);
+}
+
+Definition* LoopStripMiner::EmitIndexAdd(Instruction** cursor,
+                                         Definition* index,
+                                         intptr_t offset) {
+  if (offset == 0) {
+    return index;
+  }
+  // The guard of the main loop keeps the index below the length of an
+  // array, so this cannot overflow.
+  Definition* add = BinaryIntegerOpInstr::Make(
+      induction_->representation(), Token::kADD, new (Z) Value(index),
+      new (Z) Value(flow_graph_->GetConstant(Smi::ZoneHandle(
+          Z, Smi::New(offset)))),
+      DeoptId::kNone, /*can_overflow=*/false, /*is_truncating=*/false,
+      /*range=*/nullptr, Instruction::kNotSpeculative);
+  *cursor = flow_graph_->AppendTo(*cursor, add, nullptr, FlowGraph::kValue);
+  return add;
+}
+
+Definition* LoopStripMiner::EmitGuardBound() {
+  // bound = min(length of each array) - (step - 1), computed in the
+  // preheader. Lengths are non-negative Smis, so this cannot overflow.
+  // A versioned loop may have no lengths to guard.
+  if (arrays_.is_empty() && checked_lengths_.is_empty()) {
+    return nullptr;
+  }
+  Definition* length = nullptr;
+  GrowableArray<Definition*> lengths;
+  for (intptr_t i = 0; i < arrays_.length(); i++) {
+    LoadFieldInstr* load = new (Z)
+        LoadFieldInstr(new (Z) Value(arrays_[i]), Slot::TypedDataBase_length(),
+                       compare_->token_pos());
+    flow_graph_->InsertBefore(preheader_goto_, load, nullptr,
+                              FlowGraph::kValue);
+    lengths.Add(load);
+  }
+  lengths.AddArray(checked_lengths_);
+  for (intptr_t i = 0; i < lengths.length(); i++) {
+    if (length == nullptr) {
+      length = lengths[i];
+      continue;
+    }
+    Definition* min = new (Z) MathMinMaxInstr(
+        MethodRecognizer::kMathMin, new (Z) Value(length),
+        new (Z) Value(lengths[i]), DeoptId::kNone, kSmiCid);
+    flow_graph_->InsertBefore(preheader_goto_, min, nullptr,
+                              FlowGraph::kValue);
+    length = min;
+  }
+  ASSERT(length != nullptr);
+  if (step() == 1) {
+    return length;
+  }
+  BinarySmiOpInstr* bound = new (Z) BinarySmiOpInstr(
+      Token::kSUB, new (Z) Value(length),
+      new (Z) Value(
+          flow_graph_->GetConstant(Smi::ZoneHandle(Z, Smi::New(step() - 1)))),
+      DeoptId::kNone);
+  bound->set_can_overflow(false);
+  flow_graph_->InsertBefore(preheader_goto_, bound, nullptr,
+                            FlowGraph::kValue);
+  return bound;
+}
+
+TargetEntryInstr* LoopStripMiner::EmitGuard(BlockEntryInstr* block,
+                                             Instruction* cursor,
+                                             ComparisonInstr* guard,
+                                             bool continue_on_true,
+                                             JoinEntryInstr* exit) {
+  BranchInstr* branch = new (Z) BranchInstr(guard, DeoptId::kNone);
+  flow_graph_->AppendTo(cursor, branch, nullptr, FlowGraph::kEffect);
+  block->set_last_instruction(branch);
+
+  TargetEntryInstr* failure = NewTarget();
+  GotoInstr* exit_goto = new (Z) GotoInstr(exit, DeoptId::kNone);
+  flow_graph_->AppendTo(failure, exit_goto, nullptr, FlowGraph::kEffect);
+  failure->set_last_instruction(exit_goto);
+
+  TargetEntryInstr* success = NewTarget();
+  *branch->true_successor_address() = continue_on_true ? success : failure;
+  *branch->false_successor_address() = continue_on_true ? failure : success;
+  return success;
+}
+
+TargetEntryInstr* LoopStripMiner::EmitEntryGuards(JoinEntryInstr* block,
+                                                  Definition* bound,
+                                                  JoinEntryInstr* exit,
+                                                  intptr_t* exit_count) {
+  Definition* initial = induction_->InputAt(entry_index_)->definition();
+  const intptr_t cid = compare_->operation_cid();
+  const TokenPosition pos = compare_->token_pos();
+  GrowableArray<ComparisonInstr*> guards;
+  if (VersionsLoop() && !initial_non_negative_ &&
+      !checked_lengths_.is_empty()) {
+    // i0 >= 0. The induction only grows from there.
+    guards.Add(new (Z) RelationalOpInstr(
+        pos, Token::kGTE, new (Z) Value(initial),
+        new (Z) Value(flow_graph_->GetConstant(Object::smi_zero())), cid,
+        DeoptId::kNone, Instruction::kNotSpeculative));
+  }
+  if (VersionsLoop() && bound != nullptr) {
+    // n <= bound, so that the last index n - 1 is below every length.
+    guards.Add(new (Z) RelationalOpInstr(
+        pos, Token::kLTE, new (Z) Value(limit_), new (Z) Value(bound), cid,
+        DeoptId::kNone, Instruction::kNotSpeculative));
+  }
+  for (intptr_t i = 0; i < null_checks_.length(); i++) {
+    guards.Add(new (Z) StrictCompareInstr(
+        pos, Token::kNE_STRICT,
+        new (Z) Value(null_checks_[i]->value()->definition()),
+        new (Z) Value(flow_graph_->constant_null()),
+        /*needs_number_check=*/false, DeoptId::kNone));
+  }
+
+  // Class id guards, of the checked values followed by the internal arrays.
+  const intptr_t cid_guard_count =
+      class_checks_.length() + internal_arrays_.length();
+  Instruction* cursor = block;
+  BlockEntryInstr* current = block;
+  for (intptr_t i = 0; i < guards.length() + cid_guard_count; i++) {
+    ComparisonInstr* guard = nullptr;
+    if (i < guards.length()) {
+      guard = guards[i];
+    } else {
+      const intptr_t k = i - guards.length();
+      Definition* value = nullptr;
+      intptr_t expected = kIllegalCid;
+      if (k < class_checks_.length()) {
+        value = class_checks_[k]->value()->definition();
+        expected = class_checks_[k]->cids().MonomorphicReceiverCid();
+      } else {
+        value = internal_arrays_[k - class_checks_.length()];
+        expected = internal_array_cid_;
+      }
+      LoadClassIdInstr* load_cid =
+          new (Z) LoadClassIdInstr(new (Z) Value(value));
+      cursor =
+          flow_graph_->AppendTo(cursor, load_cid, nullptr, FlowGraph::kValue);
+      guard = new (Z) StrictCompareInstr(
+          pos, Token::kEQ_STRICT, new (Z) Value(load_cid),
+          new (Z) Value(flow_graph_->GetConstant(
+              Smi::ZoneHandle(Z, Smi::New(expected)))),
+          /*needs_number_check=*/false, DeoptId::kNone);
+    }
+    TargetEntryInstr* next =
+        EmitGuard(current, cursor, guard, /*continue_on_true=*/true, exit);
+    (*exit_count)++;
+    current = next;
+    cursor = next;
+  }
+  ASSERT(current != block);
+  return current->AsTargetEntry();
+}
+
+Instruction* LoopStripMiner::EmitStackOverflowCheck(
+    Instruction* cursor,
+    PhiInstr* index,
+    const GrowableArray<PhiInstr*>& reductions) {
+  CheckStackOverflowInstr* check = header_->next()->AsCheckStackOverflow();
+  if (check == nullptr) {
+    return cursor;
+  }
+  CheckStackOverflowInstr* copy = new (Z) CheckStackOverflowInstr(
+      check->token_pos(), check->stack_depth(), check->loop_depth(),
+      check->deopt_id(), check->kind());
+  cursor = flow_graph_->AppendTo(cursor, copy, check->env(),
+                                 FlowGraph::kEffect);
+  // At the header of the main loop, the original loop would continue with
+  // the values of the phis of the main loop.
+  for (Environment::DeepIterator it(copy->env()); !it.Done(); it.Advance()) {
+    Value* value = it.CurrentValue();
+    if (value->definition() == induction_) {
+      value->BindToEnvironment(index);
+      continue;
+    }
+    for (intptr_t i = 0; i < reductions_.length(); i++) {
+      if (value->definition() == reductions_[i]) {
+        value->BindToEnvironment(reductions[i]);
+        break;
+      }
+    }
+  }
+  return cursor;
+}
+
+PhiInstr* LoopStripMiner::AddExitPhi(JoinEntryInstr* exit,
+                                     intptr_t guard_exit_count,
+                                     intptr_t loop_exit_count,
+                                     Definition* initial,
+                                     Definition* last) {
+  // The guards before the loop were emitted first, so their exits come
+  // first in the block id order of the predecessors.
+  PhiInstr* phi = new (Z) PhiInstr(exit, guard_exit_count + loop_exit_count);
+  flow_graph_->AllocateSSAIndexes(phi);
+  phi->mark_alive();
+  for (intptr_t i = 0; i < phi->InputCount(); i++) {
+    Definition* def = i < guard_exit_count ? initial : last;
+    Value* value = new (Z) Value(def);
+    phi->SetInputAt(i, value);
+    def->AddInputUse(value);
+  }
+  exit->InsertPhi(phi);
+  phi->set_representation(last->representation());
+  return phi;
+}
+
+void LoopStripMiner::Transform() {
+  Definition* bound = EmitGuardBound();
+  ASSERT(bound != nullptr || VersionsLoop());
+  Definition* initial = induction_->InputAt(entry_index_)->definition();
+  const intptr_t cid = compare_->operation_cid();
+
+  JoinEntryInstr* vheader = NewJoin();
+  JoinEntryInstr* vexit = NewJoin();
+  intptr_t guard_exit_count = 0;
+  if (VersionsLoop() || !internal_arrays_.is_empty()) {
+    JoinEntryInstr* guards = NewJoin();
+    preheader_goto_->set_successor(guards);
+    TargetEntryInstr* enter =
+        EmitEntryGuards(guards, bound, vexit, &guard_exit_count);
+    GotoInstr* enter_goto = new (Z) GotoInstr(vheader, DeoptId::kNone);
+    flow_graph_->AppendTo(enter, enter_goto, nullptr, FlowGraph::kEffect);
+    enter->set_last_instruction(enter_goto);
+  } else {
+    preheader_goto_->set_successor(vheader);
+  }
+
+  // Phis of the main loop. Their back edge inputs are set once the body
+  // has been emitted.
+  PhiInstr* index = flow_graph_->AddPhi(vheader, initial, initial);
+  index->set_representation(induction_->representation());
+  GrowableArray<PhiInstr*> reductions;
+  for (intptr_t i = 0; i < reductions_.length(); i++) {
+    Definition* value = reductions_[i]->InputAt(entry_index_)->definition();
+    PhiInstr* phi = flow_graph_->AddPhi(vheader, value, value);
+    phi->set_representation(reductions_[i]->representation());
+    reductions.Add(phi);
+  }
+
+  // Chain of guards, each continuing into the next on success and leaving
+  // to the epilogue on failure.
+  BlockEntryInstr* block = vheader;
+  Instruction* cursor = EmitStackOverflowCheck(vheader, index, reductions);
+  intptr_t loop_exit_count = 0;
+  const intptr_t kMaxGuards = 3;
+  for (intptr_t i = 0; i < kMaxGuards; i++) {
+    ComparisonInstr* guard = nullptr;
+    bool continue_on_true = true;
+    if (i == 0) {
+      // j >= 0, needed to drop bounds checks when i0 may be negative.
+      if (VersionsLoop() || initial_non_negative_ ||
+          checked_lengths_.is_empty()) {
+        continue;
+      }
+      guard = new (Z) RelationalOpInstr(
+          compare_->token_pos(), Token::kGTE, new (Z) Value(index),
+          new (Z) Value(flow_graph_->GetConstant(Object::smi_zero())), cid,
+          DeoptId::kNone, Instruction::kNotSpeculative);
+    } else if (i == 1) {
+      // j < bound.
+      if (VersionsLoop()) {
+        continue;
+      }
+      guard = new (Z) RelationalOpInstr(
+          compare_->token_pos(), Token::kLT, new (Z) Value(index),
+          new (Z) Value(bound), cid, DeoptId::kNone,
+          Instruction::kNotSpeculative);
+    } else {
+      // j + (step - 1) < n, the loop condition for the last iteration.
+      Definition* last = EmitIndexAdd(&cursor, index, step() - 1);
+      guard = compare_->CopyWithNewOperands(new (Z) Value(last),
+                                            new (Z) Value(limit_));
+      continue_on_true = body_on_true_;
+    }
+    TargetEntryInstr* next =
+        EmitGuard(block, cursor, guard, continue_on_true, vexit);
+    loop_exit_count++;
+    block = next;
+    cursor = next;
+  }
+
+  // Main loop body.
+  cursor = EmitBody(cursor, index, &reductions);
+  Definition* next_index = EmitIndexAdd(&cursor, index, step());
+  index->InputAt(1)->BindTo(next_index);
+  GotoInstr* back_edge = new (Z) GotoInstr(vheader, DeoptId::kNone);
+  flow_graph_->AppendTo(cursor, back_edge, nullptr, FlowGraph::kEffect);
+  block->set_last_instruction(back_edge);
+
+  GotoInstr* epilogue = new (Z) GotoInstr(header_, DeoptId::kNone);
+  flow_graph_->AppendTo(vexit, epilogue, nullptr, FlowGraph::kEffect);
+  vexit->set_last_instruction(epilogue);
+
+  // Values the original loop continues with. The main loop dominates the
+  // exit unless guards before it may skip it.
+  Definition* exit_index = index;
+  GrowableArray<Definition*> exit_reductions(reductions_.length());
+  for (intptr_t i = 0; i < reductions_.length(); i++) {
+    exit_reductions.Add(reductions[i]);
+  }
+  if (guard_exit_count > 0) {
+    exit_index = AddExitPhi(vexit, guard_exit_count, loop_exit_count,
+                            initial, index);
+    for (intptr_t i = 0; i < reductions_.length(); i++) {
+      exit_reductions[i] = AddExitPhi(
+          vexit, guard_exit_count, loop_exit_count,
+          reductions_[i]->InputAt(entry_index_)->definition(), reductions[i]);
+    }
+  }
+
+  // The original loop now continues where the main loop left off. After
+  // blocks are rediscovered, the predecessors of the header are ordered by
+  // block id, so the back edge comes first and the new entry second.
+  const intptr_t back_index = 1 - entry_index_;
+  Definition* back = induction_->InputAt(back_index)->definition();
+  induction_->InputAt(0)->BindTo(back);
+  induction_->InputAt(1)->BindTo(exit_index);
+  for (intptr_t i = 0; i < reductions_.length(); i++) {
+    back = reductions_[i]->InputAt(back_index)->definition();
+    reductions_[i]->InputAt(0)->BindTo(back);
+    reductions_[i]->InputAt(1)->BindTo(exit_reductions[i]);
+  }
+}
+
+// Replicates the body of a counted loop.
+class LoopUnroller : public LoopStripMiner {
+ public:
+  LoopUnroller(FlowGraph* flow_graph, LoopInfo* loop)
+      : LoopStripMiner(flow_graph),
+        factor_(0),
+        map_(flow_graph->current_ssa_temp_index()) {
+    if (MatchCountedLoop(loop) && CanUnroll()) {
+      factor_ = Utils::Minimum(static_cast<intptr_t>(FLAG_loop_unroll_factor),
+                               kMaxUnrolledSize / BodySize());
+      InitializeMap();
+    }
+  }
+
+  bool ShouldUnroll() const { return factor_ > 1; }
+
+ protected:
+  // Copies the body of the loop once.
+  explicit LoopUnroller(FlowGraph* flow_graph)
+      : LoopStripMiner(flow_graph),
+        factor_(1),
+        map_(flow_graph->current_ssa_temp_index()) {}
+
+  virtual intptr_t step() const { return factor_; }
+
+  virtual Instruction* EmitBody(Instruction* cursor,
+                                PhiInstr* index,
+                                GrowableArray<PhiInstr*>* reductions);
+
+  intptr_t BodySize() const {
+    intptr_t size = 0;
+    for (ForwardInstructionIterator it(body_); !it.Done(); it.Advance()) {
+      size++;
+    }
+    return size;
+  }
+
+  void InitializeMap() {
+    for (intptr_t i = 0; i < flow_graph_->current_ssa_temp_index(); i++) {
+      map_.Add(nullptr);
+    }
+  }
+
+  // Returns true if Copy() knows how to copy the instruction.
+  static bool IsCopyable(Instruction* instr);
+
+ private:
+  static bool IsCopyableArrayCid(intptr_t cid) {
+    return RawObject::IsTypedDataClassId(cid) || cid == kArrayCid ||
+           cid == kImmutableArrayCid;
+  }
+
+  bool CanUnroll();
+
+  Definition* Map(Definition* def) const {
+    const intptr_t i = def->ssa_temp_index();
+    if (i >= 0 && i < map_.length() && map_[i] != nullptr) {
+      return map_[i];
+    }
+    ASSERT(IsInvariant(def));
+    return def;
+  }
+
+  void Bind(Definition* def, Definition* copy) {
+    // Checks that are only used for their effect have no SSA index.
+    if (def->HasSSATemp()) {
+      map_[def->ssa_temp_index()] = copy;
+    }
+  }
+
+  Value* MapInput(Instruction* instr, intptr_t i) const {
+    return new (Z) Value(Map(instr->InputAt(i)->definition()));
+  }
+
+  // Copies an instruction of the loop body, or returns nullptr if the
+  // instruction cannot be copied.
+  Instruction* Copy(Instruction* instr) const;
+
+  intptr_t factor_;
+  GrowableArray<Definition*> map_;
+
+  DISALLOW_COPY_AND_ASSIGN(LoopUnroller);
+};
+
+Instruction* LoopUnroller::Copy(Instruction* instr) const {
+  switch (instr->tag()) {
+    case Instruction::kLoadIndexed: {
+      LoadIndexedInstr* load = instr->AsLoadIndexed();
+      return new (Z) LoadIndexedInstr(
+          MapInput(load, 0), MapInput(load, 1), load->index_scale(),
+          load->class_id(), load->aligned() ? kAlignedAccess : kUnalignedAccess,
+          DeoptId::kNone, load->token_pos());
+    }
+    case Instruction::kStoreIndexed: {
+      StoreIndexedInstr* store = instr->AsStoreIndexed();
+      return new (Z) StoreIndexedInstr(
+          MapInput(store, 0), MapInput(store, 1), MapInput(store, 2),
+          store->ShouldEmitStoreBarrier() ? kEmitStoreBarrier
+                                          : kNoStoreBarrier,
+          store->index_scale(), store->class_id(),
+          store->aligned() ? kAlignedAccess : kUnalignedAccess,
+          DeoptId::kNone, store->token_pos(), store->speculative_mode());
+    }
+    case Instruction::kBinaryDoubleOp: {
+      BinaryDoubleOpInstr* op = instr->AsBinaryDoubleOp();
+      return new (Z) BinaryDoubleOpInstr(
+          op->op_kind(), MapInput(op, 0), MapInput(op, 1), DeoptId::kNone,
+          op->token_pos(), op->speculative_mode());
+    }
+    case Instruction::kBinarySmiOp:
+    case Instruction::kBinaryInt32Op:
+    case Instruction::kBinaryUint32Op:
+    case Instruction::kBinaryInt64Op: {
+      BinaryIntegerOpInstr* op = instr->AsBinaryIntegerOp();
+      return BinaryIntegerOpInstr::Make(
+          op->representation(), op->op_kind(), MapInput(op, 0),
+          MapInput(op, 1), DeoptId::kNone, op->can_overflow(),
+          op->is_truncating(), op->range(), Instruction::kNotSpeculative);
+    }
+    case Instruction::kIntConverter: {
+      IntConverterInstr* conv = instr->AsIntConverter();
+      IntConverterInstr* copy = new (Z) IntConverterInstr(
+          conv->from(), conv->to(), MapInput(conv, 0), DeoptId::kNone);
+      if (conv->is_truncating()) {
+        copy->mark_truncating();
+      }
+      return copy;
+    }
+    case Instruction::kLoadUntagged:
+      return new (Z) LoadUntaggedInstr(MapInput(instr, 0),
+                                       instr->AsLoadUntagged()->offset());
+    case Instruction::kFloatToDouble:
+      return new (Z) FloatToDoubleInstr(MapInput(instr, 0), DeoptId::kNone);
+    case Instruction::kDoubleToFloat:
+      return new (Z) DoubleToFloatInstr(MapInput(instr, 0), DeoptId::kNone,
+                                        instr->speculative_mode());
+    default:
+      if (instr->IsBox()) {
+        return BoxInstr::Create(instr->AsBox()->from_representation(),
+                                MapInput(instr, 0));
+      }
+      if (instr->IsUnbox()) {
+        return UnboxInstr::Create(instr->AsUnbox()->representation(),
+                                  MapInput(instr, 0), DeoptId::kNone,
+                                  Instruction::kNotSpeculative);
+      }
+      return nullptr;
+  }
+}
+
+bool LoopUnroller::IsCopyable(Instruction* instr) {
+  if (LoadIndexedInstr* load = instr->AsLoadIndexed()) {
+    return IsCopyableArrayCid(load->class_id());
+  }
+  if (StoreIndexedInstr* store = instr->AsStoreIndexed()) {
+    return IsCopyableArrayCid(store->class_id()) &&
+           store->class_id() != kImmutableArrayCid;
+  }
+  return instr->IsBinaryDoubleOp() || instr->IsBinaryIntegerOp() ||
+         instr->IsIntConverter() || instr->IsFloatToDouble() ||
+         instr->IsDoubleToFloat() || instr->IsBox() || instr->IsUnbox() ||
+         IsDataLoad(instr);
+}
+
+bool LoopUnroller::CanUnroll() {
+  for (ForwardInstructionIterator it(body_); !it.Done(); it.Advance()) {
+    Instruction* instr = it.Current();
+    if (instr->IsGoto() || IsIncrement(instr)) {
+      continue;
+    }
+    if (IsInductionBoundsCheck(instr)) {
+      AddCheckedLength(instr->AsCheckBoundBase()->length()->definition());
+      continue;
+    }
+    if (instr->CanDeoptimize() || instr->MayThrow() ||
+        instr->IsShiftIntegerOp()) {
+      return false;
+    }
+    if (!IsCopyable(instr)) {
+      return false;
+    }
+    if (LoadIndexedInstr* load = instr->AsLoadIndexed()) {
+      if (RawObject::IsTypedDataClassId(load->class_id())) {
+        AddArray(load->array());
+      }
+    } else if (StoreIndexedInstr* store = instr->AsStoreIndexed()) {
+      if (RawObject::IsTypedDataClassId(store->class_id())) {
+        AddArray(store->array());
+      }
+    }
+  }
+  // The main loop is only bounded if some array length bounds the index.
+  return !arrays_.is_empty() || !checked_lengths_.is_empty();
+}
+
+Instruction* LoopUnroller::EmitBody(Instruction* cursor,
+                                    PhiInstr* index,
+                                    GrowableArray<PhiInstr*>* reductions) {
+  for (intptr_t i = 0; i < reductions_.length(); i++) {
+    Bind(reductions_[i], (*reductions)[i]);
+  }
+  GrowableArray<Definition*> next(reductions_.length());
+  for (intptr_t k = 0; k < factor_; k++) {
+    Bind(induction_, EmitIndexAdd(&cursor, index, k));
+    for (ForwardInstructionIterator it(body_); !it.Done(); it.Advance()) {
+      Instruction* instr = it.Current();
+      if (instr->IsGoto() || IsIncrement(instr)) {
+        continue;
+      }
+      if (IsInductionBoundsCheck(instr)) {
+        Bind(instr->AsDefinition(),
+             Map(instr->AsCheckBoundBase()->index()->definition()));
+        continue;
+      }
+      if (IsGuardedCheck(instr)) {
+        if (CheckNullInstr* check = instr->AsCheckNull()) {
+          Bind(check, Map(check->value()->definition()));
+        }
+        continue;
+      }
+      Instruction* copy = Copy(instr);
+      ASSERT(copy != nullptr);
+      if (Definition* def = copy->AsDefinition()) {
+        cursor = flow_graph_->AppendTo(cursor, def, nullptr, FlowGraph::kValue);
+        Bind(instr->AsDefinition(), def);
+      } else {
+        cursor =
+            flow_graph_->AppendTo(cursor, copy, nullptr, FlowGraph::kEffect);
+      }
+    }
+    // Advance the reductions simultaneously, as they may refer to each
+    // other.
+    next.Clear();
+    for (intptr_t i = 0; i < reductions_.length(); i++) {
+      next.Add(Map(reductions_[i]->InputAt(1 - entry_index_)->definition()));
+    }
+    for (intptr_t i = 0; i < reductions_.length(); i++) {
+      Bind(reductions_[i], next[i]);
+    }
+  }
+  for (intptr_t i = 0; i < reductions_.length(); i++) {
+    (*reductions)[i]->InputAt(1)->BindTo(Map(reductions_[i]));
+  }
+  return cursor;
+}
+
+// Copies a counted loop into a version without bounds checks on the
+// induction and without null and class checks on loop invariant values,
+// guarded once before the loop. The original loop runs instead if a guard
+// fails, so the checks still fail where they did before.
+class LoopVersioner : public LoopUnroller {
+ public:
+  LoopVersioner(FlowGraph* flow_graph, LoopInfo* loop)
+      : LoopUnroller(flow_graph), should_version_(false) {
+    if (MatchCountedLoop(loop) && CanVersion()) {
+      should_version_ = true;
+      InitializeMap();
+    }
+  }
+
+  bool ShouldVersion() const { return should_version_; }
+
+ protected:
+  virtual bool VersionsLoop() const { return true; }
+
+ private:
+  bool CanVersion();
+
+  bool should_version_;
+
+  DISALLOW_COPY_AND_ASSIGN(LoopVersioner);
+};
+
+bool LoopVersioner::CanVersion() {
+  if (BodySize() > kMaxVersionedSize) {
+    return false;
+  }
+  for (ForwardInstructionIterator it(body_); !it.Done(); it.Advance()) {
+    Instruction* instr = it.Current();
+    if (instr->IsGoto() || IsIncrement(instr)) {
+      continue;
+    }
+    if (IsInductionBoundsCheck(instr)) {
+      AddCheckedLength(instr->AsCheckBoundBase()->length()->definition());
+      continue;
+    }
+    if (IsInvariantCheck(instr)) {
+      if (CheckNullInstr* check = instr->AsCheckNull()) {
+        null_checks_.Add(check);
+      } else {
+        class_checks_.Add(instr->AsCheckClass());
+      }
+      continue;
+    }
+    if (instr->CanDeoptimize() || instr->MayThrow() ||
+        instr->IsShiftIntegerOp() || !IsCopyable(instr)) {
+      return false;
+    }
+  }
+  // Only version loops that lose some check.
+  return !checked_lengths_.is_empty() || !null_checks_.is_empty() ||
+         !class_checks_.is_empty();
+}
+
+// Turns a counted loop over Float64List or Float32List elements into a
+// loop over Float64x2 or Float32x4 values.
+class LoopVectorizer : public LoopStripMiner {
+ public:
+  LoopVectorizer(FlowGraph* flow_graph, LoopInfo* loop)
+      : LoopStripMiner(flow_graph),
+        element_cid_(kIllegalCid),
+        vector_map_(flow_graph->current_ssa_temp_index()),
+        splats_() {
+    for (intptr_t i = 0; i < flow_graph->current_ssa_temp_index(); i++) {
+      vector_map_.Add(nullptr);
+    }
+    can_vectorize_ = MatchCountedLoop(loop) && MatchBody();
+  }
+
+  bool CanVectorize() const { return can_vectorize_; }
+
+ protected:
+  virtual intptr_t step() const {
+    return element_cid_ == kTypedDataFloat64ArrayCid ? 2 : 4;
+  }
+
+  virtual Instruction* EmitBody(Instruction* cursor,
+                                PhiInstr* index,
+                                GrowableArray<PhiInstr*>* reductions);
+
+ private:
+  bool MatchBody();
+
+  intptr_t VectorArrayCid() const {
+    return element_cid_ == kTypedDataFloat64ArrayCid
+               ? kTypedDataFloat64x2ArrayCid
+               : kTypedDataFloat32x4ArrayCid;
+  }
+
+  intptr_t VectorCid() const {
+    return element_cid_ == kTypedDataFloat64ArrayCid ? kFloat64x2Cid
+                                                      : kFloat32x4Cid;
+  }
+
+  bool IsBodyDefinition(Definition* def) const {
+    return def->GetBlock() == body_;
+  }
+
+  // Returns true if the array is a loop invariant typed data object, or the
+  // data pointer of one.
+  bool IsVectorArray(Value* array) const {
+    Definition* def = array->definition();
+    if (IsDataLoad(def)) {
+      return IsInvariant(def->InputAt(0)->definition());
+    }
+    return def->representation() == kTagged && IsInvariant(def);
+  }
+
+  // Returns the typed data object of an array accepted by IsVectorArray.
+  static Definition* ObjectOf(Value* array) {
+    Definition* def = array->definition();
+    return IsDataLoad(def) ? def->InputAt(0)->definition() : def;
+  }
+
+  Definition* ArrayOf(Value* array) const {
+    Definition* def = array->definition();
+    return IsBodyDefinition(def) ? vector_map_[def->ssa_temp_index()] : def;
+  }
+
+  // Returns true if the value is available as a vector in the main loop:
+  // it is computed by a vectorizable instruction of the body, or it is a
+  // loop invariant double that can be splat into all lanes.
+  bool IsVectorOperand(Value* value) const;
+
+  bool AreAllUsesDoubleToFloat(Definition* def) const;
+
+  // Notes the typed data objects that must be guarded to not overlap.
+  void GuardAliasing();
+
+  // Notes the object of an array accessed through its data pointer.
+  void AddInternalArray(Value* array);
+
+  // Returns the vector replacing the given scalar definition in the main
+  // loop, splatting loop invariant operands in the preheader.
+  Definition* VectorOf(Definition* def);
+
+  bool can_vectorize_;
+  intptr_t element_cid_;
+  GrowableArray<Definition*> vector_map_;
+  GrowableArray<Definition*> splats_;
+
+  DISALLOW_COPY_AND_ASSIGN(LoopVectorizer);
+};
+
+bool LoopVectorizer::IsVectorOperand(Value* value) const {
+  Definition* def = value->definition();
+  if (IsBodyDefinition(def)) {
+    return def->IsLoadIndexed() || def->IsBinaryDoubleOp() ||
+           def->IsFloatToDouble() || def->IsDoubleToFloat();
+  }
+  // Splats of invariants are only exact on Float64x2 lanes.
+  return element_cid_ == kTypedDataFloat64ArrayCid &&
+         def->representation() == kUnboxedDouble && IsInvariant(def);
+}
+
+bool LoopVectorizer::AreAllUsesDoubleToFloat(Definition* def) const {
+  for (Value* use = def->input_use_list(); use != nullptr;
+       use = use->next_use()) {
+    if (!use->instruction()->IsDoubleToFloat()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void LoopVectorizer::AddInternalArray(Value* array) {
+  if (!IsDataLoad(array->definition())) {
+    return;
+  }
+  Definition* object = ObjectOf(array);
+  for (intptr_t i = 0; i < internal_arrays_.length(); i++) {
+    if (internal_arrays_[i] == object) {
+      return;
+    }
+  }
+  internal_arrays_.Add(object);
+}
+
+void LoopVectorizer::GuardAliasing() {
+  // A vector store writes several elements before the next elements are
+  // loaded, so no store may overlap another access at a different index.
+  // All accesses are at the same index, so accesses to the same object
+  // overlap exactly, and distinct internal typed data objects do not
+  // overlap at all. Views and external typed data are accessed through a
+  // data pointer and may share their data with any other object, so the
+  // main loop only runs if they are in fact internal typed data.
+  GrowableArray<Value*> stores;
+  GrowableArray<Value*> accesses;
+  for (ForwardInstructionIterator it(body_); !it.Done(); it.Advance()) {
+    if (LoadIndexedInstr* load = it.Current()->AsLoadIndexed()) {
+      accesses.Add(load->array());
+    } else if (StoreIndexedInstr* store = it.Current()->AsStoreIndexed()) {
+      stores.Add(store->array());
+      accesses.Add(store->array());
+    }
+  }
+  internal_array_cid_ = element_cid_;
+  for (intptr_t i = 0; i < stores.length(); i++) {
+    for (intptr_t j = 0; j < accesses.length(); j++) {
+      if (ObjectOf(stores[i]) == ObjectOf(accesses[j])) {
+        continue;
+      }
+      AddInternalArray(stores[i]);
+      AddInternalArray(accesses[j]);
+    }
+  }
+}
+
+bool LoopVectorizer::MatchBody() {
+#if defined(TARGET_ARCH_ARM)
+  // NEON flushes denormals to zero, which Float32List code must not do.
+  return false;
+#else
+  if (!FlowGraphCompiler::SupportsUnboxedSimd128() ||
+      !reductions_.is_empty()) {
+    return false;
+  }
+  // The element type is that of the first array access.
+  for (ForwardInstructionIterator it(body_); !it.Done(); it.Advance()) {
+    if (LoadIndexedInstr* load = it.Current()->AsLoadIndexed()) {
+      element_cid_ = load->class_id();
+      break;
+    }
+    if (StoreIndexedInstr* store = it.Current()->AsStoreIndexed()) {
+      element_cid_ = store->class_id();
+      break;
+    }
+  }
+  if (element_cid_ != kTypedDataFloat64ArrayCid &&
+      element_cid_ != kTypedDataFloat32ArrayCid) {
+    return false;
+  }
+  for (ForwardInstructionIterator it(body_); !it.Done(); it.Advance()) {
+    Instruction* instr = it.Current();
+    if (instr->IsGoto() || IsIncrement(instr)) {
+      continue;
+    }
+    if (IsInductionBoundsCheck(instr)) {
+      AddCheckedLength(instr->AsCheckBoundBase()->length()->definition());
+      continue;
+    }
+    intptr_t cid = kIllegalCid;
+    if (IsDataLoad(instr)) {
+      continue;
+    } else if (LoadIndexedInstr* load = instr->AsLoadIndexed()) {
+      if (!IsInductionIndex(load->index()) || !IsVectorArray(load->array())) {
+        return false;
+      }
+      cid = load->class_id();
+      AddArray(load->array());
+    } else if (StoreIndexedInstr* store = instr->AsStoreIndexed()) {
+      if (!IsInductionIndex(store->index()) ||
+          !IsVectorArray(store->array()) ||
+          !IsVectorOperand(store->value())) {
+        return false;
+      }
+      cid = store->class_id();
+      AddArray(store->array());
+    } else if (BinaryDoubleOpInstr* op = instr->AsBinaryDoubleOp()) {
+      switch (op->op_kind()) {
+        case Token::kADD:
+        case Token::kSUB:
+        case Token::kMUL:
+        case Token::kDIV:
+          break;
+        default:
+          return false;
+      }
+      if (!IsVectorOperand(op->left()) || !IsVectorOperand(op->right())) {
+        return false;
+      }
+      // A single float operation computed on doubles and rounded back is
+      // exact, a sequence of them is not.
+      if (element_cid_ == kTypedDataFloat32ArrayCid &&
+          (!op->left()->definition()->IsFloatToDouble() ||
+           !op->right()->definition()->IsFloatToDouble() ||
+           !AreAllUsesDoubleToFloat(op))) {
+        return false;
+      }
+    } else if (FloatToDoubleInstr* conv = instr->AsFloatToDouble()) {
+      if (!IsBodyDefinition(conv->value()->definition()) ||
+          !conv->value()->definition()->IsLoadIndexed()) {
+        return false;
+      }
+      cid = kTypedDataFloat32ArrayCid;
+    } else if (DoubleToFloatInstr* conv = instr->AsDoubleToFloat()) {
+      if (!IsBodyDefinition(conv->value()->definition()) ||
+          !conv->value()->definition()->IsBinaryDoubleOp()) {
+        return false;
+      }
+      cid = kTypedDataFloat32ArrayCid;
+    } else {
+      return false;
+    }
+    if (cid != kIllegalCid && cid != element_cid_) {
+      return false;
+    }
+  }
+  // Float64 values flow from loads into stores. Float32 loads must be
+  // widened and narrowed around an arithmetic operation.
+  if (element_cid_ == kTypedDataFloat32ArrayCid) {
+    for (ForwardInstructionIterator it(body_); !it.Done(); it.Advance()) {
+      StoreIndexedInstr* store = it.Current()->AsStoreIndexed();
+      if (store != nullptr &&
+          !store->value()->definition()->IsDoubleToFloat()) {
+        return false;
+      }
+    }
+  }
+  if (arrays_.is_empty() && checked_lengths_.is_empty()) {
+    return false;
+  }
+  GuardAliasing();
+  return true;
+#endif
+}
+
+Definition* LoopVectorizer::VectorOf(Definition* def) {
+  if (IsBodyDefinition(def)) {
+    ASSERT(vector_map_[def->ssa_temp_index()] != nullptr);
+    return vector_map_[def->ssa_temp_index()];
+  }
+  for (intptr_t i = 0; i < splats_.length(); i += 2) {
+    if (splats_[i] == def) {
+      return splats_[i + 1];
+    }
+  }
+  ASSERT(element_cid_ == kTypedDataFloat64ArrayCid);
+  Definition* splat = SimdOpInstr::Create(MethodRecognizer::kFloat64x2Splat,
+                                          new (Z) Value(def), DeoptId::kNone);
+  flow_graph_->InsertBefore(preheader_goto_, splat, nullptr,
+                            FlowGraph::kValue);
+  splats_.Add(def);
+  splats_.Add(splat);
+  return splat;
+}
+
+Instruction* LoopVectorizer::EmitBody(Instruction* cursor,
+                                      PhiInstr* index,
+                                      GrowableArray<PhiInstr*>* reductions) {
+  ASSERT(reductions->is_empty());
+  for (ForwardInstructionIterator it(body_); !it.Done(); it.Advance()) {
+    Instruction* instr = it.Current();
+    if (instr->IsGoto() || IsIncrement(instr) ||
+        IsInductionBoundsCheck(instr)) {
+      continue;
+    }
+    Definition* vector = nullptr;
+    if (IsDataLoad(instr)) {
+      vector = new (Z) LoadUntaggedInstr(
+          new (Z) Value(instr->InputAt(0)->definition()),
+          instr->AsLoadUntagged()->offset());
+    } else if (LoadIndexedInstr* load = instr->AsLoadIndexed()) {
+      vector = new (Z) LoadIndexedInstr(
+          new (Z) Value(ArrayOf(load->array())), new (Z) Value(index),
+          load->index_scale(), VectorArrayCid(), kUnalignedAccess,
+          DeoptId::kNone, load->token_pos());
+    } else if (StoreIndexedInstr* store = instr->AsStoreIndexed()) {
+      Definition* value = VectorOf(store->value()->definition());
+      StoreIndexedInstr* copy = new (Z) StoreIndexedInstr(
+          new (Z) Value(ArrayOf(store->array())), new (Z) Value(index),
+          new (Z) Value(value), kNoStoreBarrier, store->index_scale(),
+          VectorArrayCid(), kUnalignedAccess, DeoptId::kNone,
+          store->token_pos(), Instruction::kNotSpeculative);
+      cursor = flow_graph_->AppendTo(cursor, copy, nullptr, FlowGraph::kEffect);
+      continue;
+    } else if (BinaryDoubleOpInstr* op = instr->AsBinaryDoubleOp()) {
+      Definition* left = VectorOf(op->left()->definition());
+      Definition* right = VectorOf(op->right()->definition());
+      vector = SimdOpInstr::Create(
+          SimdOpInstr::KindForOperator(VectorCid(), op->op_kind()),
+          new (Z) Value(left), new (Z) Value(right), DeoptId::kNone);
+    } else {
+      // Widening and narrowing of Float32 lanes is implicit.
+      ASSERT(instr->IsFloatToDouble() || instr->IsDoubleToFloat());
+      Definition* def = instr->AsDefinition();
+      vector_map_[def->ssa_temp_index()] =
+          VectorOf(def->InputAt(0)->definition());
+      continue;
+    }
+    cursor = flow_graph_->AppendTo(cursor, vector, nullptr, FlowGraph::kValue);
+    vector_map_[instr->AsDefinition()->ssa_temp_index()] = vector;
+  }
+  return cursor;
+}
+
+// Collects the counted loops of the flow graph that the given strip miner
+// accepts, transforms them and updates the flow graph.
+template <typename Miner, typename Accept>
+static void StripMineLoops(FlowGraph* flow_graph,
+                           const char* what,
+                           Accept accept) {
+  const LoopHierarchy& loop_hierarchy = flow_graph->GetLoopHierarchy();
+  loop_hierarchy.ComputeInduction();
+
+  GrowableArray<Miner*> miners;
+  for (intptr_t i = 0; i < loop_hierarchy.headers().length(); i++) {
+    LoopInfo* loop = loop_hierarchy.headers()[i]->loop_info();
+    Miner* miner = new (flow_graph->zone()) Miner(flow_graph, loop);
+    if (accept(miner)) {
+      miners.Add(miner);
+    }
+  }
+  if (miners.is_empty()) {
+    return;
+  }
+  for (intptr_t i = 0; i < miners.length(); i++) {
+    if (FLAG_trace_loop_optimizer) {
+      THR_Print("%s loop at B%" Pd " in %s\n", what,
+                miners[i]->header()->block_id(),
+                flow_graph->function().ToFullyQualifiedCString());
+    }
+    miners[i]->Transform();
+  }
+  flow_graph->DiscoverBlocks();
+  GrowableArray<BitVector*> dominance_frontier;
+  flow_graph->ComputeDominators(&dominance_frontier);
+}
+
+void LoopOptimizer::VersionLoops(FlowGraph* flow_graph) {
+  if (!FLAG_loop_versioning) {
+    return;
+  }
+  StripMineLoops<LoopVersioner>(
+      flow_graph, "Versioned",
+      [](LoopVersioner* miner) { return miner->ShouldVersion(); });
+}
+
+void LoopOptimizer::VectorizeLoops(FlowGraph* flow_graph) {
+  if (!FLAG_loop_vectorization) {
+    return;
+  }
+  StripMineLoops<LoopVectorizer>(
+      flow_graph, "Vectorized",
+      [](LoopVectorizer* miner) { return miner->CanVectorize(); });
+}
+
+void LoopOptimizer::UnrollLoops(FlowGraph* flow_graph) {
+  if (FLAG_loop_unroll_factor < 2) {
+    return;
+  }
+  StripMineLoops<LoopUnroller>(
+      flow_graph, "Unrolled",
+      [](LoopUnroller* miner) { return miner->ShouldUnroll(); });
+}
+
+#undef Z
+
+}  // namespace dart
+
+#endif  // !defined(DART_PRECOMPILED_RUNTIME)
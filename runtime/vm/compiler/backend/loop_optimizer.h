@@ -0,0 +1,44 @@
+// Copyright (c) 2019, the Dart project authors.  Please see the AUTHORS file
+// for details. All rights reserved. Use of this source code is governed by a
+// BSD-style license that can be found in the LICENSE file.
+
+#ifndef RUNTIME_VM_COMPILER_BACKEND_LOOP_OPTIMIZER_H_
+#define RUNTIME_VM_COMPILER_BACKEND_LOOP_OPTIMIZER_H_
+
+#include "vm/allocation.h"
+
+namespace dart {
+
+class FlowGraph;
+
+// Loop transformations on counted loops, i.e. innermost loops that consist
+// of a header and a single body block and that are controlled by a unit
+// stride induction i < n (see InductionVar in loops.h).
+//
+// The transformations strip-mine the loop: a new main loop that performs
+// one or several iterations of the original loop at once is placed in
+// front of the original loop, which is kept as the epilogue that finishes
+// the remaining iterations. The main loop is guarded such that it never
+// reaches past the length of any array accessed in the loop, so bounds
+// checks on the induction variable are dropped from it.
+class LoopOptimizer : public AllStatic {
+ public:
+  // Adds a version of counted loops that runs without the bounds checks on
+  // the induction and the null and class checks on loop invariant values,
+  // entered when a single guard before the loop proves them redundant. The
+  // original loop runs otherwise.
+  static void VersionLoops(FlowGraph* flow_graph);
+
+  // Turns counted loops whose bodies only load, compute on and store
+  // elements of Float64List or Float32List into SimdOp sequences on
+  // Float64x2 or Float32x4 values.
+  static void VectorizeLoops(FlowGraph* flow_graph);
+
+  // Replicates the body of small counted loops, so that the loop control
+  // and bounds checks are paid once per FLAG_loop_unroll_factor iterations.
+  static void UnrollLoops(FlowGraph* flow_graph);
+};
+
+}  // namespace dart
+
+#endif  // RUNTIME_VM_COMPILER_BACKEND_LOOP_OPTIMIZER_H_
@@ -0,0 +1,369 @@
+// Copyright (c) 2019, the Dart project authors.  Please see the AUTHORS file
+// for details. All rights reserved. Use of this source code is governed by a
+// BSD-style license that can be found in the LICENSE file.
+//
+// Unit tests for loop versioning, unrolling and vectorization. The loops
+// have a trip count that is not a multiple of the unroll factor or vector
+// width, so the epilogue loops are exercised as well.
+
+#include "vm/compiler/backend/loop_optimizer.h"
+#include "vm/compiler/backend/block_builder.h"
+#include "vm/compiler/backend/il_test_helper.h"
+#include "vm/compiler/backend/type_propagator.h"
+#include "vm/compiler/compiler_pass.h"
+#include "vm/object.h"
+#include "vm/unit_test.h"
+
+namespace dart {
+
+#if defined(DART_PRECOMPILER) &&                                               \
+    (defined(TARGET_ARCH_X64) || defined(TARGET_ARCH_ARM64))
+
+static intptr_t CountInstructions(FlowGraph* flow_graph,
+                                  bool (*predicate)(Instruction*)) {
+  intptr_t count = 0;
+  for (BlockIterator block_it = flow_graph->reverse_postorder_iterator();
+       !block_it.Done(); block_it.Advance()) {
+    for (ForwardInstructionIterator it(block_it.Current()); !it.Done();
+         it.Advance()) {
+      if (predicate(it.Current())) {
+        count++;
+      }
+    }
+  }
+  return count;
+}
+
+ISOLATE_UNIT_TEST_CASE(LoopOptimizer_VectorizeFloat64Add) {
+  const char* kScript =
+      R"(
+      import 'dart:typed_data';
+
+      void add(Float64List a, Float64List b, Float64List c) {
+        final n = c.length;
+        if (a.length < n || b.length < n) return;
+        for (int i = 0; i < n; i++) {
+          c[i] = a[i] + b[i];
+        }
+      }
+      )";
+
+  const auto& root_library = Library::Handle(LoadTestScript(kScript));
+  const auto& function = Function::Handle(GetFunction(root_library, "add"));
+
+  TestPipeline pipeline(function, CompilerPass::kAOT);
+  FlowGraph* flow_graph = pipeline.RunPasses({});
+  EXPECT(CountInstructions(flow_graph, [](Instruction* instr) {
+           return instr->IsSimdOp();
+         }) > 0);
+  pipeline.CompileGraphAndAttachFunction();
+
+  const intptr_t kLength = 7;
+  const auto& a = TypedData::Handle(
+      TypedData::New(kTypedDataFloat64ArrayCid, kLength));
+  const auto& b = TypedData::Handle(
+      TypedData::New(kTypedDataFloat64ArrayCid, kLength));
+  const auto& c = TypedData::Handle(
+      TypedData::New(kTypedDataFloat64ArrayCid, kLength));
+  for (intptr_t i = 0; i < kLength; i++) {
+    a.SetFloat64(i * sizeof(double), i + 0.5);
+    b.SetFloat64(i * sizeof(double), 2.0 * i);
+  }
+  const auto& arguments = Array::Handle(Array::New(3));
+  arguments.SetAt(0, a);
+  arguments.SetAt(1, b);
+  arguments.SetAt(2, c);
+  const auto& result =
+      Object::Handle(DartEntry::InvokeFunction(function, arguments));
+  EXPECT(result.IsNull());
+  for (intptr_t i = 0; i < kLength; i++) {
+    EXPECT_EQ(3.0 * i + 0.5, c.GetFloat64(i * sizeof(double)));
+  }
+}
+
+ISOLATE_UNIT_TEST_CASE(LoopOptimizer_VectorizeOverlappingView) {
+  const char* kScript =
+      R"(
+      import 'dart:typed_data';
+
+      void add(Float64List a, Float64List b, Float64List c) {
+        final n = c.length;
+        if (a.length < n || b.length < n) return;
+        for (int i = 0; i < n; i++) {
+          c[i] = a[i] + b[i];
+        }
+      }
+      )";
+
+  const auto& root_library = Library::Handle(LoadTestScript(kScript));
+  const auto& function = Function::Handle(GetFunction(root_library, "add"));
+
+  TestPipeline pipeline(function, CompilerPass::kAOT);
+  FlowGraph* flow_graph = pipeline.RunPasses({});
+  EXPECT(CountInstructions(flow_graph, [](Instruction* instr) {
+           return instr->IsSimdOp();
+         }) > 0);
+  // The main loop keeps a stack overflow check of its own.
+  EXPECT_EQ(2, CountInstructions(flow_graph, [](Instruction* instr) {
+              CheckStackOverflowInstr* check = instr->AsCheckStackOverflow();
+              return check != nullptr && check->in_loop();
+            }));
+  pipeline.CompileGraphAndAttachFunction();
+
+  // c is a view of a shifted by one element, so each iteration reads the
+  // element the previous one wrote.
+  const intptr_t kLength = 7;
+  const auto& a = TypedData::Handle(
+      TypedData::New(kTypedDataFloat64ArrayCid, kLength + 1));
+  const auto& b = TypedData::Handle(
+      TypedData::New(kTypedDataFloat64ArrayCid, kLength));
+  const auto& c = TypedDataView::Handle(TypedDataView::New(
+      kTypedDataFloat64ArrayViewCid, a, sizeof(double), kLength));
+  for (intptr_t i = 0; i <= kLength; i++) {
+    a.SetFloat64(i * sizeof(double), i + 0.5);
+  }
+  const auto& arguments = Array::Handle(Array::New(3));
+  arguments.SetAt(0, a);
+  arguments.SetAt(1, b);
+  arguments.SetAt(2, c);
+  const auto& result =
+      Object::Handle(DartEntry::InvokeFunction(function, arguments));
+  EXPECT(result.IsNull());
+  for (intptr_t i = 0; i <= kLength; i++) {
+    EXPECT_EQ(0.5, a.GetFloat64(i * sizeof(double)));
+  }
+}
+
+ISOLATE_UNIT_TEST_CASE(LoopOptimizer_UnrollUint8Sum) {
+  const char* kScript =
+      R"(
+      import 'dart:typed_data';
+
+      int sum(Uint8List a) {
+        final n = a.length;
+        int s = 0;
+        for (int i = 0; i < n; i++) {
+          s = (s + a[i]) & 0xFFFF;
+        }
+        return s;
+      }
+      )";
+
+  const auto& root_library = Library::Handle(LoadTestScript(kScript));
+  const auto& function = Function::Handle(GetFunction(root_library, "sum"));
+
+  TestPipeline pipeline(function, CompilerPass::kAOT);
+  FlowGraph* flow_graph = pipeline.RunPasses({});
+  // The unrolled loop has its own copies of the element load.
+  EXPECT(CountInstructions(flow_graph, [](Instruction* instr) {
+           return instr->IsLoadIndexed();
+         }) > 1);
+  pipeline.CompileGraphAndAttachFunction();
+
+  const intptr_t kLength = 11;
+  const auto& a =
+      TypedData::Handle(TypedData::New(kTypedDataUint8ArrayCid, kLength));
+  for (intptr_t i = 0; i < kLength; i++) {
+    a.SetUint8(i, i + 1);
+  }
+  const auto& arguments = Array::Handle(Array::New(1));
+  arguments.SetAt(0, a);
+  const auto& result =
+      Object::Handle(DartEntry::InvokeFunction(function, arguments));
+  EXPECT(result.IsSmi());
+  EXPECT_EQ(kLength * (kLength + 1) / 2, Smi::Cast(result).Value());
+}
+
+ISOLATE_UNIT_TEST_CASE(LoopOptimizer_VersionBoundsCheck) {
+  const char* kScript =
+      R"(
+      import 'dart:typed_data';
+
+      int sum(Uint8List a, int n) {
+        int s = 0;
+        for (int i = 0; i < n; i++) {
+          s = (s + a[i]) & 0xFFFF;
+        }
+        return s;
+      }
+      )";
+
+  const auto& root_library = Library::Handle(LoadTestScript(kScript));
+  const auto& function = Function::Handle(GetFunction(root_library, "sum"));
+
+  TestPipeline pipeline(function, CompilerPass::kAOT);
+  FlowGraph* flow_graph = pipeline.RunPasses({});
+  // The bounds check on i < n is only left in the original loop.
+  EXPECT_EQ(1, CountInstructions(flow_graph, [](Instruction* instr) {
+              return instr->IsCheckBoundBase();
+            }));
+  EXPECT(CountInstructions(flow_graph, [](Instruction* instr) {
+           return instr->IsLoadIndexed();
+         }) > 1);
+  pipeline.CompileGraphAndAttachFunction();
+
+  const intptr_t kLength = 11;
+  const auto& a =
+      TypedData::Handle(TypedData::New(kTypedDataUint8ArrayCid, kLength));
+  for (intptr_t i = 0; i < kLength; i++) {
+    a.SetUint8(i, i + 1);
+  }
+  const auto& arguments = Array::Handle(Array::New(2));
+  arguments.SetAt(0, a);
+  auto& result = Object::Handle();
+
+  // The guard holds, so the version without checks runs.
+  arguments.SetAt(1, Smi::Handle(Smi::New(kLength)));
+  result = DartEntry::InvokeFunction(function, arguments);
+  EXPECT(result.IsSmi());
+  EXPECT_EQ(kLength * (kLength + 1) / 2, Smi::Cast(result).Value());
+
+  // The guard fails, so the original loop runs and throws.
+  arguments.SetAt(1, Smi::Handle(Smi::New(kLength + 1)));
+  result = DartEntry::InvokeFunction(function, arguments);
+  EXPECT(result.IsError());
+
+  // The guard compares n like the loop does, even when it is not a Smi.
+  arguments.SetAt(1, Integer::Handle(Integer::New(kMaxInt64)));
+  result = DartEntry::InvokeFunction(function, arguments);
+  EXPECT(result.IsError());
+}
+
+static bool IsLoopStackOverflowCheck(Instruction* instr) {
+  CheckStackOverflowInstr* check = instr->AsCheckStackOverflow();
+  return check != nullptr && check->in_loop();
+}
+
+// Builds the flow graph of
+//
+//   for (int i = 0; i < n; i++) {
+//     check(a);
+//   }
+//
+// with the check made by the given function, and versions its loop.
+static FlowGraph* VersionCheckLoop(
+    CompilerState* S,
+    Instruction* (*make_check)(CompilerState* S, Definition* value)) {
+  using compiler::BlockBuilder;
+  FlowGraphBuilderHelper H;
+
+  // B0[graph_entry]
+  // B1[function_entry]:
+  //   v0 <- Parameter(0)
+  //   v1 <- Parameter(1)
+  //   goto B2
+  // B2:
+  //   v2 <- phi(0, v3)
+  //   CheckStackOverflow
+  //   if v2 < v1 then B3 else B4
+  // B3:
+  //   check(v0)
+  //   v3 <- v2 + 1
+  //   goto B2
+  // B4:
+  //   Return(null)
+
+  auto b1 = H.flow_graph()->graph_entry()->normal_entry();
+  auto b2 = H.JoinEntry();
+  auto b3 = H.TargetEntry();
+  auto b4 = H.TargetEntry();
+  Definition* v0;
+  Definition* v1;
+  PhiInstr* v2;
+  Definition* v3;
+
+  {
+    BlockBuilder builder(H.flow_graph(), b1);
+    v0 = builder.AddParameter(0, /*with_frame=*/true);
+    v1 = builder.AddParameter(1, /*with_frame=*/true);
+    builder.AddInstruction(new GotoInstr(b2, S->GetNextDeoptId()));
+  }
+
+  {
+    BlockBuilder builder(H.flow_graph(), b2);
+    // The back edge input is bound to v3 once the graph is finished.
+    v2 = H.Phi(b2, {{b1, H.IntConstant(0)}, {b3, H.IntConstant(0)}});
+    builder.AddPhi(v2);
+    builder.AddInstruction(new CheckStackOverflowInstr(
+        TokenPosition::kNoSource, /*stack_depth=*/0, /*loop_depth=*/1,
+        S->GetNextDeoptId(), CheckStackOverflowInstr::kOsrAndPreemption));
+    builder.AddBranch(
+        new RelationalOpInstr(TokenPosition::kNoSource, Token::kLT,
+                              new Value(v2), new Value(v1), kSmiCid,
+                              S->GetNextDeoptId()),
+        b3, b4);
+  }
+
+  {
+    BlockBuilder builder(H.flow_graph(), b3);
+    builder.AddInstruction(make_check(S, v0));
+    v3 = builder.AddDefinition(new BinarySmiOpInstr(
+        Token::kADD, new Value(v2), new Value(H.IntConstant(1)),
+        S->GetNextDeoptId()));
+    builder.AddInstruction(new GotoInstr(b2, S->GetNextDeoptId()));
+  }
+
+  {
+    BlockBuilder builder(H.flow_graph(), b4);
+    builder.AddReturn(new Value(H.flow_graph()->constant_null()));
+  }
+
+  H.FinishGraph();
+  v2->InputAt(b2->IndexOfPredecessor(b3))->BindTo(v3);
+  FlowGraphTypePropagator::Propagate(H.flow_graph());
+
+  LoopOptimizer::VersionLoops(H.flow_graph());
+  return H.flow_graph();
+}
+
+ISOLATE_UNIT_TEST_CASE(LoopOptimizer_VersionNullCheck) {
+  CompilerState S(thread);
+  FlowGraph* flow_graph =
+      VersionCheckLoop(&S, [](CompilerState* S, Definition* value) {
+        return static_cast<Instruction*>(
+            new CheckNullInstr(new Value(value), String::ZoneHandle(),
+                               S->GetNextDeoptId(), TokenPosition::kNoSource));
+      });
+
+  // Only the original loop keeps the null check. The guard before the
+  // version compares with null instead.
+  EXPECT_EQ(1, CountInstructions(flow_graph, [](Instruction* instr) {
+              return instr->IsCheckNull();
+            }));
+  EXPECT_EQ(1, CountInstructions(flow_graph, [](Instruction* instr) {
+              BranchInstr* branch = instr->AsBranch();
+              return branch != nullptr &&
+                     branch->comparison()->IsStrictCompare() &&
+                     branch->comparison()->kind() == Token::kNE_STRICT;
+            }));
+  // Both loops can still be interrupted.
+  EXPECT_EQ(2, CountInstructions(flow_graph, IsLoopStackOverflowCheck));
+}
+
+ISOLATE_UNIT_TEST_CASE(LoopOptimizer_VersionClassCheck) {
+  CompilerState S(thread);
+  FlowGraph* flow_graph =
+      VersionCheckLoop(&S, [](CompilerState* S, Definition* value) {
+        return static_cast<Instruction*>(new CheckClassInstr(
+            new Value(value), S->GetNextDeoptId(),
+            *Cids::CreateMonomorphic(Thread::Current()->zone(),
+                                     kTypedDataUint8ArrayCid),
+            TokenPosition::kNoSource));
+      });
+
+  // Only the original loop keeps the class check. The guard before the
+  // version compares the class id instead.
+  EXPECT_EQ(1, CountInstructions(flow_graph, [](Instruction* instr) {
+              return instr->IsCheckClass();
+            }));
+  EXPECT_EQ(1, CountInstructions(flow_graph, [](Instruction* instr) {
+              return instr->IsLoadClassId();
+            }));
+  // Both loops can still be interrupted.
+  EXPECT_EQ(2, CountInstructions(flow_graph, IsLoopStackOverflowCheck));
+}
+
+#endif  // defined(DART_PRECOMPILER) &&                                        \
+        // (defined(TARGET_ARCH_X64) || defined(TARGET_ARCH_ARM64))
+
+}  // namespace dart
@@ -15,6 +15,7 @@
 #include "vm/compiler/backend/il_serializer.h"
 #include "vm/compiler/backend/inliner.h"
 #include "vm/compiler/backend/linearscan.h"
+#include "vm/compiler/backend/loop_optimizer.h"
 #include "vm/compiler/backend/range_analysis.h"
 #include "vm/compiler/backend/redundancy_elimination.h"
 #include "vm/compiler/backend/type_propagator.h"
@@ -23,6 +24,8 @@
 #include "vm/compiler/aot/aot_call_specializer.h"
 #include "vm/compiler/aot/precompiler.h"
 #endif
+#include "vm/isolate.h"
+#include "vm/json_stream.h"
 #include "vm/timeline.h"
 
 #define COMPILER_PASS_REPEAT(Name, Body)                                       \
@@ -56,6 +59,11 @@ DEFINE_OPTION_HANDLER(CompilerPass::ParseFilters,
                       "List of comma separated compilation passes flags. "
                       "Use -Name to disable a pass, Name to print IL after it. "
                       "Do --compiler-passes=help for more information.");
+DEFINE_FLAG(bool,
+            compiler_pass_stats,
+            false,
+            "Collect the time, zone memory and instruction counts of each "
+            "compiler pass, see the _getCompilerPassStats service RPC.");
 DEFINE_FLAG(bool,
             early_round_trip_serialization,
             false,
@@ -186,7 +194,41 @@ void CompilerPass::Run(CompilerPassState* state) const {
     PrintGraph(state, kTraceBefore, round);
     {
       TIMELINE_DURATION(thread, CompilerVerbose, name());
+      bool measure = FLAG_compiler_pass_stats;
+#if !defined(PRODUCT)
+      measure = measure || tds.enabled();
+#endif
+      int64_t start_micros = 0;
+      uintptr_t start_zone_bytes = 0;
+      intptr_t instructions_before = 0;
+      if (measure) {
+        start_micros = OS::GetCurrentMonotonicMicros();
+        start_zone_bytes = thread->zone()->SizeInBytes();
+        instructions_before = state->flow_graph->InstructionCount();
+      }
       repeat = DoBody(state);
+      if (measure) {
+        const int64_t micros = OS::GetCurrentMonotonicMicros() - start_micros;
+        const intptr_t zone_bytes =
+            thread->zone()->SizeInBytes() - start_zone_bytes;
+        const intptr_t instructions_after =
+            state->flow_graph->InstructionCount();
+        if (FLAG_compiler_pass_stats) {
+          thread->isolate()->compiler_pass_stats()->Add(
+              id(), micros, zone_bytes, instructions_before,
+              instructions_after);
+        }
+#if !defined(PRODUCT)
+        if (tds.enabled()) {
+          tds.SetNumArguments(3);
+          tds.FormatArgument(0, "zoneBytes", "%" Pd, zone_bytes);
+          tds.FormatArgument(1, "instructionsBefore", "%" Pd,
+                             instructions_before);
+          tds.FormatArgument(2, "instructionsAfter", "%" Pd,
+                             instructions_after);
+        }
+#endif
+      }
       thread->CheckForSafepoint();
 #if defined(DEBUG)
       FlowGraphChecker(state->flow_graph).Check(name());
@@ -196,6 +238,77 @@ void CompilerPass::Run(CompilerPassState* state) const {
   }
 }
 
+void CompilerPassStats::Add(CompilerPass::Id id,
+                            int64_t micros,
+                            intptr_t zone_bytes,
+                            intptr_t instructions_before,
+                            intptr_t instructions_after) {
+  MutexLocker ml(&mutex_);
+  Entry* entry = &entries_[id];
+  entry->runs++;
+  entry->micros += micros;
+  entry->zone_bytes += zone_bytes;
+  entry->instructions_before += instructions_before;
+  entry->instructions_after += instructions_after;
+}
+
+void CompilerPassStats::Reset() {
+  MutexLocker ml(&mutex_);
+  memset(entries_, 0, sizeof(entries_));
+}
+
+#if !defined(PRODUCT)
+void CompilerPassStats::PrintToJSONObject(JSONObject* obj) {
+  MutexLocker ml(&mutex_);
+  obj->AddProperty("enabled", FLAG_compiler_pass_stats);
+  JSONArray passes(obj, "passes");
+  for (intptr_t i = 0; i < CompilerPass::kNumPasses; i++) {
+    const Entry& entry = entries_[i];
+    CompilerPass* pass = CompilerPass::Get(static_cast<CompilerPass::Id>(i));
+    if ((pass == NULL) || (entry.runs == 0)) continue;
+    JSONObject pass_obj(&passes);
+    pass_obj.AddProperty("name", pass->name());
+    pass_obj.AddProperty("runs", entry.runs);
+    pass_obj.AddProperty64("micros", entry.micros);
+    pass_obj.AddProperty64("zoneBytes", entry.zone_bytes);
+    pass_obj.AddProperty64("instructionsBefore", entry.instructions_before);
+    pass_obj.AddProperty64("instructionsAfter", entry.instructions_after);
+  }
+}
+
+void CompilerPassStats::ReportToTimeline() {
+  MutexLocker ml(&mutex_);
+  intptr_t num_arguments = 0;
+  for (intptr_t i = 0; i < CompilerPass::kNumPasses; i++) {
+    if (entries_[i].runs > 0) num_arguments++;
+  }
+  if (num_arguments == 0) {
+    return;
+  }
+  TimelineStream* stream = Timeline::GetCompilerStream();
+  ASSERT(stream != NULL);
+  TimelineEvent* event = stream->StartEvent();
+  if (event == NULL) {
+    return;
+  }
+  event->Instant("CompilerPassStats");
+  event->SetNumArguments(num_arguments);
+  intptr_t arg = 0;
+  for (intptr_t i = 0; i < CompilerPass::kNumPasses; i++) {
+    const Entry& entry = entries_[i];
+    if (entry.runs == 0) continue;
+    CompilerPass* pass = CompilerPass::Get(static_cast<CompilerPass::Id>(i));
+    event->FormatArgument(
+        arg++, pass->name(),
+        "runs: %" Pd ", micros: %" Pd64 ", zone bytes: %" Pd64
+        ", instructions: %" Pd64 " -> %" Pd64,
+        entry.runs, entry.micros, entry.zone_bytes, entry.instructions_before,
+        entry.instructions_after);
+  }
+  event->Complete();
+}
+#endif  // !defined(PRODUCT)
+
 void CompilerPass::PrintGraph(CompilerPassState* state,
                               Flag mask,
                               intptr_t round) const {
@@ -266,6 +379,9 @@ FlowGraph* CompilerPass::RunForceOptimizedPipeline(
   if (FLAG_late_round_trip_serialization) {
     INVOKE_PASS(RoundTripSerialization);
   }
+  if (pass_state->defer_register_allocation) {
+    return pass_state->flow_graph;
+  }
   INVOKE_PASS(AllocateRegisters);
   INVOKE_PASS(ReorderBlocks);
   return pass_state->flow_graph;
@@ -328,6 +444,9 @@ FlowGraph* CompilerPass::RunPipeline(PipelineMode mode,
   INVOKE_PASS(Canonicalize);
   INVOKE_PASS(AllocationSinking_Sink);
   INVOKE_PASS(EliminateDeadPhis);
+  INVOKE_PASS(VersionLoops);
+  INVOKE_PASS(VectorizeLoops);
+  INVOKE_PASS(UnrollLoops);
   INVOKE_PASS(TypePropagation);
   INVOKE_PASS(SelectRepresentations);
   INVOKE_PASS(Canonicalize);
@@ -346,6 +465,9 @@ FlowGraph* CompilerPass::RunPipeline(PipelineMode mode,
   if (FLAG_late_round_trip_serialization) {
     INVOKE_PASS(RoundTripSerialization);
   }
+  if (pass_state->defer_register_allocation) {
+    return pass_state->flow_graph;
+  }
   INVOKE_PASS(AllocateRegisters);
   INVOKE_PASS(ReorderBlocks);
   return pass_state->flow_graph;
@@ -473,6 +595,12 @@ COMPILER_PASS(AllocationSinking_Sink, {
   }
 });
 
+COMPILER_PASS(VersionLoops, { LoopOptimizer::VersionLoops(flow_graph); });
+
+COMPILER_PASS(VectorizeLoops, { LoopOptimizer::VectorizeLoops(flow_graph); });
+
+COMPILER_PASS(UnrollLoops, { LoopOptimizer::UnrollLoops(flow_graph); });
+
 COMPILER_PASS(AllocationSinking_DetachMaterializations, {
   if (state->sinking != NULL) {
     // Remove all MaterializeObject instructions inserted by allocation
@@ -487,7 +615,8 @@ COMPILER_PASS(AllocateRegisters, {
   // Ensure loop hierarchy has been computed.
   flow_graph->GetLoopHierarchy();
   // Perform register allocation on the SSA graph.
-  FlowGraphAllocator allocator(*flow_graph);
+  FlowGraphAllocator allocator(*flow_graph, /*intrinsic_mode=*/false,
+                               FlowGraphAllocator::UseGraphColoring());
   allocator.AllocateRegisters();
 });
 
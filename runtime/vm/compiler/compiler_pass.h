@@ -10,11 +10,14 @@
 #include <initializer_list>
 
 #include "vm/growable_array.h"
+#include "vm/os_thread.h"
 #include "vm/token_position.h"
 #include "vm/zone.h"
 
 namespace dart {
 
+class JSONObject;
+
 #define COMPILER_PASS_LIST(V)                                                  \
   V(AllocateRegisters)                                                         \
   V(AllocateRegistersForGraphIntrinsic)                                        \
@@ -47,6 +50,9 @@ namespace dart {
   V(TryCatchOptimization)                                                      \
   V(TryOptimizePatterns)                                                       \
   V(TypePropagation)                                                           \
+  V(UnrollLoops)                                                               \
+  V(VectorizeLoops)                                                            \
+  V(VersionLoops)                                                              \
   V(WidenSmiToInt32)                                                           \
   V(WriteBarrierElimination)
 
@@ -73,6 +79,7 @@ struct CompilerPassState {
         call_specializer(NULL),
         speculative_policy(speculative_policy),
         reorder_blocks(false),
+        defer_register_allocation(false),
         sticky_flags(0) {
   }
 
@@ -96,6 +103,10 @@ struct CompilerPassState {
 
   bool reorder_blocks;
 
+  // Whether the pipeline stops before register allocation. The caller then
+  // runs the AllocateRegisters and ReorderBlocks passes itself.
+  bool defer_register_allocation;
+
   intptr_t sticky_flags;
 };
 
@@ -111,7 +122,7 @@ class CompilerPass {
   static const intptr_t kNumPasses = 0 COMPILER_PASS_LIST(ADD_ONE);
 #undef ADD_ONE
 
-  CompilerPass(Id id, const char* name) : name_(name), flags_(0) {
+  CompilerPass(Id id, const char* name) : id_(id), name_(name), flags_(0) {
     ASSERT(passes_[id] == NULL);
     passes_[id] = this;
 
@@ -132,6 +143,7 @@ class CompilerPass {
 
   void Run(CompilerPassState* state) const;
 
+  Id id() const { return id_; }
   intptr_t flags() const { return flags_; }
   const char* name() const { return name_; }
 
@@ -188,10 +200,47 @@ class CompilerPass {
 
   static CompilerPass* passes_[];
 
+  const Id id_;
   const char* name_;
   intptr_t flags_;
 };
 
+// Per pass totals of the time, zone memory and IL instruction counts of the
+// compilations of an isolate, collected with --compiler-pass-stats.
+class CompilerPassStats {
+ public:
+  CompilerPassStats() : mutex_() { Reset(); }
+
+  void Add(CompilerPass::Id id,
+           int64_t micros,
+           intptr_t zone_bytes,
+           intptr_t instructions_before,
+           intptr_t instructions_after);
+
+  void Reset();
+
+#if !defined(PRODUCT)
+  void PrintToJSONObject(JSONObject* obj);
+
+  // Emits the totals as an instant event on the Compiler timeline stream.
+  void ReportToTimeline();
+#endif  // !defined(PRODUCT)
+
+ private:
+  struct Entry {
+    intptr_t runs;
+    int64_t micros;
+    int64_t zone_bytes;
+    int64_t instructions_before;
+    int64_t instructions_after;
+  };
+
+  Mutex mutex_;  // Passes run on the mutator and background compilers.
+  Entry entries_[CompilerPass::kNumPasses];
+
+  DISALLOW_COPY_AND_ASSIGN(CompilerPassStats);
+};
+
 }  // namespace dart
 
 #endif
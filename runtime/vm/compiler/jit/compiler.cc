@@ -7,6 +7,7 @@
 #include "vm/compiler/assembler/assembler.h"
 
 #include "vm/code_patcher.h"
+#include "vm/compilation_trace.h"
 #include "vm/compiler/aot/precompiler.h"
 #include "vm/compiler/assembler/disassembler.h"
 #include "vm/compiler/backend/block_scheduler.h"
@@ -50,6 +51,11 @@
 
 namespace dart {
 
+DEFINE_FLAG(int,
+            background_compiler_tasks,
+            1,
+            "The number of tasks to use for background optimizing "
+            "compilation.");
 DEFINE_FLAG(
     int,
     max_deoptimization_counter_threshold,
@@ -902,7 +908,12 @@ RawObject* Compiler::CompileFunction(Thread* thread, const Function& function) {
       CompilationPipeline::New(thread->zone(), function);
 
   const bool optimized = function.ForceOptimize();
-  return CompileFunctionHelper(pipeline, function, optimized, kNoOSRDeoptId);
+  const Object& result = Object::Handle(
+      CompileFunctionHelper(pipeline, function, optimized, kNoOSRDeoptId));
+  if (!optimized && !result.IsError() && !IsBackgroundCompilation()) {
+    TypeFeedbackLoader::ApplyPendingFeedback(thread, function);
+  }
+  return result.raw();
 }
 
 RawError* Compiler::EnsureUnoptimizedCode(Thread* thread,
@@ -1125,126 +1136,22 @@ void Compiler::AbortBackgroundCompilation(intptr_t deopt_id, const char* msg) {
       deopt_id, Object::background_compilation_error());
 }
 
-// C-heap allocated background compilation queue element.
-class QueueElement {
- public:
-  explicit QueueElement(const Function& function)
-      : next_(NULL), function_(function.raw()) {}
-
-  virtual ~QueueElement() {
-    next_ = NULL;
-    function_ = Function::null();
-  }
-
-  RawFunction* Function() const { return function_; }
-
-  void set_next(QueueElement* elem) { next_ = elem; }
-  QueueElement* next() const { return next_; }
-
-  RawObject* function() const { return function_; }
-  RawObject** function_ptr() {
-    return reinterpret_cast<RawObject**>(&function_);
-  }
-
- private:
-  QueueElement* next_;
-  RawFunction* function_;
-
-  DISALLOW_COPY_AND_ASSIGN(QueueElement);
-};
-
-// Allocated in C-heap. Handles both input and output of background compilation.
-// It implements a FIFO queue, using Peek, Add, Remove operations.
-class BackgroundCompilationQueue {
- public:
-  BackgroundCompilationQueue() : first_(NULL), last_(NULL) {}
-  virtual ~BackgroundCompilationQueue() { Clear(); }
-
-  void VisitObjectPointers(ObjectPointerVisitor* visitor) {
-    ASSERT(visitor != NULL);
-    QueueElement* p = first_;
-    while (p != NULL) {
-      visitor->VisitPointer(p->function_ptr());
-      p = p->next();
-    }
-  }
-
-  bool IsEmpty() const { return first_ == NULL; }
-
-  void Add(QueueElement* value) {
-    ASSERT(value != NULL);
-    ASSERT(value->next() == NULL);
-    if (first_ == NULL) {
-      first_ = value;
-      ASSERT(last_ == NULL);
-    } else {
-      ASSERT(last_ != NULL);
-      last_->set_next(value);
-    }
-    last_ = value;
-    ASSERT(first_ != NULL && last_ != NULL);
-  }
-
-  QueueElement* Peek() const { return first_; }
-
-  RawFunction* PeekFunction() const {
-    QueueElement* e = Peek();
-    if (e == NULL) {
-      return Function::null();
-    } else {
-      return e->Function();
-    }
-  }
-
-  QueueElement* Remove() {
-    ASSERT(first_ != NULL);
-    QueueElement* result = first_;
-    first_ = first_->next();
-    if (first_ == NULL) {
-      last_ = NULL;
-    }
-    return result;
-  }
-
-  bool ContainsObj(const Object& obj) const {
-    QueueElement* p = first_;
-    while (p != NULL) {
-      if (p->function() == obj.raw()) {
-        return true;
-      }
-      p = p->next();
-    }
-    return false;
-  }
-
-  void Clear() {
-    while (!IsEmpty()) {
-      QueueElement* e = Remove();
-      delete e;
-    }
-    ASSERT((first_ == NULL) && (last_ == NULL));
-  }
-
- private:
-  QueueElement* first_;
-  QueueElement* last_;
-
-  DISALLOW_COPY_AND_ASSIGN(BackgroundCompilationQueue);
-};
-
 BackgroundCompiler::BackgroundCompiler(Isolate* isolate, bool optimizing)
     : isolate_(isolate),
       queue_monitor_(),
       function_queue_(new BackgroundCompilationQueue()),
+      active_queue_(new BackgroundCompilationQueue()),
       done_monitor_(),
       running_(false),
       done_(true),
+      running_tasks_(0),
       optimizing_(optimizing),
       disabled_depth_(0) {}
 
 // Fields all deleted in ::Stop; here clear them.
 BackgroundCompiler::~BackgroundCompiler() {
   delete function_queue_;
+  delete active_queue_;
 }
 
 void BackgroundCompiler::Run() {
@@ -1259,11 +1166,13 @@ void BackgroundCompiler::Run() {
       Zone* zone = stack_zone.GetZone();
       HANDLESCOPE(thread);
       Function& function = Function::Handle(zone);
+      QueueElement* qelem = NULL;
       {
         MonitorLocker ml(&queue_monitor_);
-        function = function_queue()->PeekFunction();
+        qelem = TakeNextElement();
       }
-      while (running_ && !function.IsNull()) {
+      while (qelem != NULL) {
+        function = qelem->Function();
         if (is_optimizing()) {
           Compiler::CompileOptimizedFunction(thread, function,
                                              Compiler::kNoOSRDeoptId);
@@ -1272,32 +1181,27 @@ void BackgroundCompiler::Run() {
           Compiler::CompileFunction(thread, function);
         }
 
-        QueueElement* qelem = NULL;
+        QueueElement* done_qelem = qelem;
         {
           MonitorLocker ml(&queue_monitor_);
-          if (function_queue()->IsEmpty()) {
-            // We are shutting down, queue was cleared.
-            function = Function::null();
-          } else {
-            qelem = function_queue()->Remove();
-            const Function& old = Function::Handle(qelem->Function());
-            // If an optimizable method is not optimized, put it back on
-            // the background queue (unless it was passed to foreground).
-            if ((is_optimizing() && !old.HasOptimizedCode() &&
-                 old.IsOptimizable()) ||
-                FLAG_stress_test_background_compilation) {
-              if (old.is_background_optimizable() &&
-                  Compiler::CanOptimizeFunction(thread, old)) {
-                QueueElement* repeat_qelem = new QueueElement(old);
-                function_queue()->Add(repeat_qelem);
-              }
+          active_queue()->RemoveElement(done_qelem);
+          // If an optimizable method is not optimized, put it back on
+          // the background queue (unless it was passed to foreground).
+          // We are shutting down if not running, the queue was cleared.
+          if (running_ &&
+              ((is_optimizing() && !function.HasOptimizedCode() &&
+                function.IsOptimizable()) ||
+               FLAG_stress_test_background_compilation)) {
+            if (function.is_background_optimizable() &&
+                Compiler::CanOptimizeFunction(thread, function) &&
+                !function_queue()->ContainsObj(function)) {
+              QueueElement* repeat_qelem = new QueueElement(function);
+              function_queue()->Add(repeat_qelem);
             }
-            function = function_queue()->PeekFunction();
           }
+          qelem = TakeNextElement();
         }
-        if (qelem != NULL) {
-          delete qelem;
-        }
+        delete done_qelem;
       }
     }
     Thread::ExitIsolateAsHelper();
@@ -1311,18 +1215,34 @@ void BackgroundCompiler::Run() {
   }  // while running
 
   {
-    // Notify that the thread is done.
+    // Notify that the thread is done once all tasks are.
     MonitorLocker ml_done(&done_monitor_);
-    done_ = true;
-    ml_done.Notify();
+    running_tasks_--;
+    if (running_tasks_ == 0) {
+      done_ = true;
+      ml_done.Notify();
+    }
+  }
+}
+
+// Moves the hottest queued function to the queue of functions being compiled
+// and returns its element, or NULL if there is nothing left to do.
+QueueElement* BackgroundCompiler::TakeNextElement() {
+  ASSERT(queue_monitor_.IsOwnedByCurrentThread());
+  if (!running_ || function_queue()->IsEmpty()) {
+    return NULL;
   }
+  QueueElement* qelem = function_queue()->RemoveHottest();
+  active_queue()->Add(qelem);
+  return qelem;
 }
 
 void BackgroundCompiler::Compile(const Function& function) {
   ASSERT(Thread::Current()->IsMutatorThread());
   MonitorLocker ml(&queue_monitor_);
   ASSERT(running_);
-  if (function_queue()->ContainsObj(function)) {
+  if (function_queue()->ContainsObj(function) ||
+      active_queue()->ContainsObj(function)) {
     return;
   }
   QueueElement* elem = new QueueElement(function);
@@ -1332,6 +1252,7 @@ void BackgroundCompiler::Compile(const Function& function) {
 
 void BackgroundCompiler::VisitPointers(ObjectPointerVisitor* visitor) {
   function_queue_->VisitObjectPointers(visitor);
+  active_queue_->VisitObjectPointers(visitor);
 }
 
 class BackgroundCompilerTask : public ThreadPool::Task {
@@ -1355,10 +1276,23 @@ void BackgroundCompiler::Start() {
 
   MonitorLocker ml(&done_monitor_);
   if (running_ || !done_) return;
+  ASSERT(running_tasks_ == 0);
   running_ = true;
   done_ = false;
-  bool task_started = Dart::thread_pool()->Run<BackgroundCompilerTask>(this);
-  if (!task_started) {
+  // Functions often become hot together during warm-up, several tasks
+  // compile them concurrently.
+  const intptr_t num_tasks =
+      is_optimizing() ? Utils::Maximum(1, FLAG_background_compiler_tasks) : 1;
+  // All tasks are counted while done_monitor_ is held, before any of them
+  // can finish and count itself out in Run.
+  running_tasks_ = num_tasks;
+  for (intptr_t i = 0; i < num_tasks; i++) {
+    if (!Dart::thread_pool()->Run<BackgroundCompilerTask>(this)) {
+      running_tasks_ -= num_tasks - i;
+      break;
+    }
+  }
+  if (running_tasks_ == 0) {
     running_ = false;
     done_ = true;
   }
@@ -1373,7 +1307,7 @@ void BackgroundCompiler::Stop() {
     MonitorLocker ml(&queue_monitor_);
     running_ = false;
     function_queue_->Clear();
-    ml.Notify();  // Stop waiting for the queue.
+    ml.NotifyAll();  // Stop waiting for the queue.
   }
 
   {
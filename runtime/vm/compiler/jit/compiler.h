@@ -8,13 +8,13 @@
 #include "vm/allocation.h"
 #include "vm/compiler/compiler_state.h"
 #include "vm/growable_array.h"
+#include "vm/object.h"
 #include "vm/runtime_entry.h"
 #include "vm/thread_pool.h"
 
 namespace dart {
 
 // Forward declarations.
-class BackgroundCompilationQueue;
 class Class;
 class Code;
 class CompilationWorkQueue;
@@ -23,7 +23,6 @@ class Function;
 class IndirectGotoInstr;
 class Library;
 class ParsedFunction;
-class QueueElement;
 class RawInstance;
 class Script;
 class SequenceNode;
@@ -126,9 +125,155 @@ class Compiler : public AllStatic {
   static void AbortBackgroundCompilation(intptr_t deopt_id, const char* msg);
 };
 
+// C-heap allocated background compilation queue element.
+class QueueElement {
+ public:
+  explicit QueueElement(const Function& function)
+      : next_(NULL), function_(function.raw()) {}
+
+  virtual ~QueueElement() {
+    next_ = NULL;
+    function_ = Function::null();
+  }
+
+  RawFunction* Function() const { return function_; }
+
+  void set_next(QueueElement* elem) { next_ = elem; }
+  QueueElement* next() const { return next_; }
+
+  RawObject* function() const { return function_; }
+  RawObject** function_ptr() {
+    return reinterpret_cast<RawObject**>(&function_);
+  }
+
+ private:
+  QueueElement* next_;
+  RawFunction* function_;
+
+  DISALLOW_COPY_AND_ASSIGN(QueueElement);
+};
+
+// Allocated in C-heap. Handles both input and output of background compilation.
+// It implements a FIFO queue, using Peek, Add, Remove operations, and allows
+// taking out its hottest element, see RemoveHottest.
+class BackgroundCompilationQueue {
+ public:
+  BackgroundCompilationQueue() : first_(NULL), last_(NULL) {}
+  virtual ~BackgroundCompilationQueue() { Clear(); }
+
+  void VisitObjectPointers(ObjectPointerVisitor* visitor) {
+    ASSERT(visitor != NULL);
+    QueueElement* p = first_;
+    while (p != NULL) {
+      visitor->VisitPointer(p->function_ptr());
+      p = p->next();
+    }
+  }
+
+  bool IsEmpty() const { return first_ == NULL; }
+
+  void Add(QueueElement* value) {
+    ASSERT(value != NULL);
+    ASSERT(value->next() == NULL);
+    if (first_ == NULL) {
+      first_ = value;
+      ASSERT(last_ == NULL);
+    } else {
+      ASSERT(last_ != NULL);
+      last_->set_next(value);
+    }
+    last_ = value;
+    ASSERT(first_ != NULL && last_ != NULL);
+  }
+
+  QueueElement* Peek() const { return first_; }
+
+  RawFunction* PeekFunction() const {
+    QueueElement* e = Peek();
+    if (e == NULL) {
+      return Function::null();
+    } else {
+      return e->Function();
+    }
+  }
+
+  QueueElement* Remove() {
+    ASSERT(first_ != NULL);
+    QueueElement* result = first_;
+    first_ = first_->next();
+    if (first_ == NULL) {
+      last_ = NULL;
+    }
+    return result;
+  }
+
+  void RemoveElement(QueueElement* elem) {
+    ASSERT(elem != NULL);
+    if (elem == first_) {
+      Remove();
+      elem->set_next(NULL);
+      return;
+    }
+    QueueElement* prev = first_;
+    while (prev->next() != elem) {
+      prev = prev->next();
+      ASSERT(prev != NULL);
+    }
+    prev->set_next(elem->next());
+    if (elem == last_) {
+      last_ = prev;
+    }
+    elem->set_next(NULL);
+  }
+
+  // Removes the element of the function that was invoked most often since
+  // it was queued. The usage counter of a function is reset to INT_MIN when
+  // it is queued for optimization and keeps counting while it waits.
+  QueueElement* RemoveHottest() {
+    ASSERT(first_ != NULL);
+    Function& function = Function::Handle(first_->Function());
+    QueueElement* hottest = first_;
+    intptr_t hottest_count = function.usage_counter();
+    for (QueueElement* p = first_->next(); p != NULL; p = p->next()) {
+      function = p->Function();
+      if (function.usage_counter() > hottest_count) {
+        hottest = p;
+        hottest_count = function.usage_counter();
+      }
+    }
+    RemoveElement(hottest);
+    return hottest;
+  }
+
+  bool ContainsObj(const Object& obj) const {
+    QueueElement* p = first_;
+    while (p != NULL) {
+      if (p->function() == obj.raw()) {
+        return true;
+      }
+      p = p->next();
+    }
+    return false;
+  }
+
+  void Clear() {
+    while (!IsEmpty()) {
+      QueueElement* e = Remove();
+      delete e;
+    }
+    ASSERT((first_ == NULL) && (last_ == NULL));
+  }
+
+ private:
+  QueueElement* first_;
+  QueueElement* last_;
+
+  DISALLOW_COPY_AND_ASSIGN(BackgroundCompilationQueue);
+};
+
 // Class to run optimizing compilation in a background thread.
-// Current implementation: one task per isolate, it dies with the owning
-// isolate.
+// Current implementation: one task per isolate, or --background-compiler-tasks
+// tasks sharing the queue when optimizing, they die with the owning isolate.
 // No OSR compilation in the background compiler.
 class BackgroundCompiler {
  public:
@@ -192,6 +337,7 @@ class BackgroundCompiler {
   void VisitPointers(ObjectPointerVisitor* visitor);
 
   BackgroundCompilationQueue* function_queue() const { return function_queue_; }
+  BackgroundCompilationQueue* active_queue() const { return active_queue_; }
   bool is_running() const { return running_; }
   bool is_optimizing() const { return optimizing_; }
 
@@ -204,19 +350,23 @@ class BackgroundCompiler {
   void Disable();
   bool IsDisabled();
   bool IsRunning() { return !done_; }
+  QueueElement* TakeNextElement();
 
   Isolate* isolate_;
 
-  Monitor queue_monitor_;  // Controls access to the queue.
+  Monitor queue_monitor_;  // Controls access to the queues.
   BackgroundCompilationQueue* function_queue_;
+  BackgroundCompilationQueue* active_queue_;  // Functions being compiled.
 
-  Monitor done_monitor_;    // Notify/wait that the thread is done.
+  Monitor done_monitor_;    // Notify/wait that the threads are done.
   bool running_;            // While true, will try to read queue and compile.
-  bool done_;               // True if the thread is done.
+  bool done_;               // True if all threads are done.
+  intptr_t running_tasks_;  // Number of tasks that are not done.
   bool optimizing_;
 
   int16_t disabled_depth_;
 
+  friend class BackgroundCompilerTestPeer;
   DISALLOW_IMPLICIT_CONSTRUCTORS(BackgroundCompiler);
 };
 
@@ -6,9 +6,11 @@
 #include "platform/assert.h"
 #include "vm/class_finalizer.h"
 #include "vm/code_patcher.h"
+#include "vm/compiler/compiler_pass.h"
 #include "vm/compiler/frontend/bytecode_reader.h"
 #include "vm/dart_api_impl.h"
 #include "vm/heap/safepoint.h"
+#include "vm/json_stream.h"
 #include "vm/kernel_isolate.h"
 #include "vm/object.h"
 #include "vm/symbols.h"
@@ -17,6 +19,9 @@
 
 namespace dart {
 
+DECLARE_FLAG(int, background_compiler_tasks);
+DECLARE_FLAG(bool, compiler_pass_stats);
+
 ISOLATE_UNIT_TEST_CASE(CompileFunction) {
   const char* kScriptChars =
       "class A {\n"
@@ -99,6 +104,266 @@ ISOLATE_UNIT_TEST_CASE(OptimizeCompileFunctionOnHelperThread) {
   BackgroundCompiler::Stop(isolate);
 }
 
+ISOLATE_UNIT_TEST_CASE(OptimizeCompileFunctionsOnHelperThreads) {
+  const char* kScriptChars =
+      "class A {\n"
+      "  static foo0() { return 40; }\n"
+      "  static foo1() { return 41; }\n"
+      "  static foo2() { return 42; }\n"
+      "  static foo3() { return 43; }\n"
+      "}\n";
+  Dart_Handle library;
+  {
+    TransitionVMToNative transition(thread);
+    library = TestCase::LoadTestScript(kScriptChars, NULL);
+  }
+  const Library& lib =
+      Library::Handle(Library::RawCast(Api::UnwrapHandle(library)));
+  EXPECT(ClassFinalizer::ProcessPendingClasses());
+  Class& cls =
+      Class::Handle(lib.LookupClass(String::Handle(Symbols::New(thread, "A"))));
+  EXPECT(!cls.IsNull());
+  const intptr_t kNumFunctions = 4;
+  const Array& funcs = Array::Handle(Array::New(kNumFunctions));
+  Function& func = Function::Handle();
+  for (intptr_t i = 0; i < kNumFunctions; i++) {
+    func = cls.LookupStaticFunction(
+        String::Handle(String::NewFormatted("foo%" Pd, i)));
+    EXPECT(!func.IsNull());
+    CompilerTest::TestCompileFunction(func);
+    EXPECT(!func.HasOptimizedCode());
+    funcs.SetAt(i, func);
+  }
+#if !defined(PRODUCT)
+  // Constant in product mode.
+  FLAG_background_compilation = true;
+#endif
+  const intptr_t saved_tasks = FLAG_background_compiler_tasks;
+  FLAG_background_compiler_tasks = 3;
+  Isolate* isolate = thread->isolate();
+  BackgroundCompiler::Start(isolate);
+  for (intptr_t i = 0; i < kNumFunctions; i++) {
+    func ^= funcs.At(i);
+    isolate->optimizing_background_compiler()->Compile(func);
+    // Duplicate requests are ignored.
+    isolate->optimizing_background_compiler()->Compile(func);
+  }
+  Monitor* m = new Monitor();
+  for (intptr_t i = 0; i < kNumFunctions; i++) {
+    func ^= funcs.At(i);
+    MonitorLocker ml(m);
+    while (!func.HasOptimizedCode()) {
+      ml.WaitWithSafepointCheck(thread, 1);
+    }
+  }
+  delete m;
+  BackgroundCompiler::Stop(isolate);
+  FLAG_background_compiler_tasks = saved_tasks;
+}
+
+class BackgroundCompilerTestPeer {
+ public:
+  explicit BackgroundCompilerTestPeer(BackgroundCompiler* compiler)
+      : compiler_(compiler) {}
+
+  // Lets Compile queue functions without starting any task, the test then
+  // takes the role of the tasks.
+  void set_running(bool running) { compiler_->running_ = running; }
+
+  // What a task does to pick its next function.
+  RawFunction* TakeNextFunction() {
+    MonitorLocker ml(&compiler_->queue_monitor_);
+    QueueElement* qelem = compiler_->TakeNextElement();
+    return (qelem == NULL) ? Function::null() : qelem->Function();
+  }
+
+  // What a task does once it has compiled [function].
+  void FinishFunction(const Function& function) {
+    MonitorLocker ml(&compiler_->queue_monitor_);
+    QueueElement* qelem = compiler_->active_queue()->Peek();
+    while (qelem->Function() != function.raw()) {
+      qelem = qelem->next();
+    }
+    compiler_->active_queue()->RemoveElement(qelem);
+    delete qelem;
+  }
+
+ private:
+  BackgroundCompiler* compiler_;
+
+  DISALLOW_COPY_AND_ASSIGN(BackgroundCompilerTestPeer);
+};
+
+static RawArray* LoadQueueTestFunctions(Thread* thread,
+                                        intptr_t num_functions) {
+  const char* kScriptChars =
+      "class A {\n"
+      "  static foo0() { return 40; }\n"
+      "  static foo1() { return 41; }\n"
+      "  static foo2() { return 42; }\n"
+      "  static foo3() { return 43; }\n"
+      "}\n";
+  Dart_Handle library;
+  {
+    TransitionVMToNative transition(thread);
+    library = TestCase::LoadTestScript(kScriptChars, NULL);
+  }
+  const Library& lib =
+      Library::Handle(Library::RawCast(Api::UnwrapHandle(library)));
+  EXPECT(ClassFinalizer::ProcessPendingClasses());
+  Class& cls =
+      Class::Handle(lib.LookupClass(String::Handle(Symbols::New(thread, "A"))));
+  EXPECT(!cls.IsNull());
+  const Array& funcs = Array::Handle(Array::New(num_functions));
+  Function& func = Function::Handle();
+  for (intptr_t i = 0; i < num_functions; i++) {
+    func = cls.LookupStaticFunction(
+        String::Handle(String::NewFormatted("foo%" Pd, i)));
+    EXPECT(!func.IsNull());
+    funcs.SetAt(i, func);
+  }
+  return funcs.raw();
+}
+
+ISOLATE_UNIT_TEST_CASE(BackgroundCompilationQueue_RemoveHottest) {
+  const Array& funcs = Array::Handle(LoadQueueTestFunctions(thread, 4));
+  const intptr_t kUsageCounters[] = {10, 40, 20, 30};
+  Function& func = Function::Handle();
+  BackgroundCompilationQueue queue;
+  for (intptr_t i = 0; i < funcs.Length(); i++) {
+    func ^= funcs.At(i);
+    func.SetUsageCounter(kUsageCounters[i]);
+    queue.Add(new QueueElement(func));
+  }
+
+  // Functions are taken hottest first, not in queue order.
+  const intptr_t kExpectedOrder[] = {1, 3, 2, 0};
+  for (intptr_t i = 0; i < funcs.Length(); i++) {
+    QueueElement* qelem = queue.RemoveHottest();
+    EXPECT(qelem->Function() == funcs.At(kExpectedOrder[i]));
+    EXPECT(qelem->next() == NULL);
+    delete qelem;
+  }
+  EXPECT(queue.IsEmpty());
+
+  // Functions queued later get ahead once they are hotter.
+  func ^= funcs.At(0);
+  func.SetUsageCounter(1);
+  queue.Add(new QueueElement(func));
+  func ^= funcs.At(1);
+  func.SetUsageCounter(2);
+  queue.Add(new QueueElement(func));
+  QueueElement* qelem = queue.RemoveHottest();
+  EXPECT(qelem->Function() == funcs.At(1));
+  delete qelem;
+  func ^= funcs.At(2);
+  func.SetUsageCounter(0);
+  queue.Add(new QueueElement(func));
+  qelem = queue.RemoveHottest();
+  EXPECT(qelem->Function() == funcs.At(0));
+  delete qelem;
+  qelem = queue.RemoveHottest();
+  EXPECT(qelem->Function() == funcs.At(2));
+  delete qelem;
+  EXPECT(queue.IsEmpty());
+}
+
+ISOLATE_UNIT_TEST_CASE(BackgroundCompiler_DeduplicatesAcrossTasks) {
+  const Array& funcs = Array::Handle(LoadQueueTestFunctions(thread, 3));
+  Function& func = Function::Handle();
+  for (intptr_t i = 0; i < funcs.Length(); i++) {
+    func ^= funcs.At(i);
+    func.SetUsageCounter(i);
+  }
+
+  BackgroundCompiler compiler(thread->isolate(), /*optimizing=*/true);
+  BackgroundCompilerTestPeer peer(&compiler);
+  peer.set_running(true);
+  for (intptr_t i = 0; i < funcs.Length(); i++) {
+    func ^= funcs.At(i);
+    compiler.Compile(func);
+    // Duplicate requests are ignored.
+    compiler.Compile(func);
+  }
+
+  // Two tasks take the two hottest functions.
+  const Function& first = Function::Handle(peer.TakeNextFunction());
+  const Function& second = Function::Handle(peer.TakeNextFunction());
+  EXPECT(first.raw() == funcs.At(2));
+  EXPECT(second.raw() == funcs.At(1));
+
+  // Requests for functions being compiled are ignored, so that no other
+  // task compiles them again.
+  compiler.Compile(first);
+  compiler.Compile(second);
+  const Function& third = Function::Handle(peer.TakeNextFunction());
+  EXPECT(third.raw() == funcs.At(0));
+  EXPECT(peer.TakeNextFunction() == Function::null());
+
+  // Once compiled, a function can be queued again.
+  peer.FinishFunction(first);
+  compiler.Compile(first);
+  compiler.Compile(second);
+  EXPECT(peer.TakeNextFunction() == first.raw());
+  EXPECT(peer.TakeNextFunction() == Function::null());
+
+  peer.FinishFunction(first);
+  peer.FinishFunction(second);
+  peer.FinishFunction(third);
+  peer.set_running(false);
+}
+
+#if !defined(PRODUCT)
+ISOLATE_UNIT_TEST_CASE(CompilerPassStats) {
+  const char* kScriptChars =
+      "class A {\n"
+      "  static foo(x) { return x + 42; }\n"
+      "}\n";
+  Dart_Handle library;
+  {
+    TransitionVMToNative transition(thread);
+    library = TestCase::LoadTestScript(kScriptChars, NULL);
+  }
+  const Library& lib =
+      Library::Handle(Library::RawCast(Api::UnwrapHandle(library)));
+  EXPECT(ClassFinalizer::ProcessPendingClasses());
+  Class& cls =
+      Class::Handle(lib.LookupClass(String::Handle(Symbols::New(thread, "A"))));
+  EXPECT(!cls.IsNull());
+  const Function& func = Function::Handle(
+      cls.LookupStaticFunction(String::Handle(String::New("foo"))));
+  CompilerTest::TestCompileFunction(func);
+
+  const bool saved_stats = FLAG_compiler_pass_stats;
+  FLAG_compiler_pass_stats = true;
+  CompilerPassStats* stats = thread->isolate()->compiler_pass_stats();
+  stats->Reset();
+  const Object& result =
+      Object::Handle(Compiler::CompileOptimizedFunction(thread, func));
+  EXPECT(result.IsCode());
+  {
+    JSONStream js;
+    {
+      JSONObject obj(&js);
+      stats->PrintToJSONObject(&obj);
+    }
+    EXPECT_SUBSTRING("\"name\":\"AllocateRegisters\",\"runs\":1",
+                     js.ToCString());
+    EXPECT_SUBSTRING("\"name\":\"ComputeSSA\",\"runs\":1", js.ToCString());
+  }
+  stats->Reset();
+  {
+    JSONStream js;
+    {
+      JSONObject obj(&js);
+      stats->PrintToJSONObject(&obj);
+    }
+    EXPECT_SUBSTRING("\"passes\":[]", js.ToCString());
+  }
+  FLAG_compiler_pass_stats = saved_stats;
+}
+#endif  // !defined(PRODUCT)
+
 ISOLATE_UNIT_TEST_CASE(CompileFunctionOnHelperThread) {
   // Create a simple function and compile it without optimization.
   const char* kScriptChars =
@@ -1090,10 +1090,14 @@ ISOLATE_METRIC_LIST(ISOLATE_METRIC_API);
 
 // --- Isolates ---
 
+// Creates an isolate of [group] from its snapshot and kernel program or, if
+// [template_snapshot_data] is given, from the group's template.
 static Dart_Isolate CreateIsolate(IsolateGroup* group,
                                   const char* name,
                                   void* isolate_data,
-                                  char** error) {
+                                  char** error,
+                                  const uint8_t* template_snapshot_data =
+                                      nullptr) {
   CHECK_NO_ISOLATE(Isolate::Current());
 
   auto source = group->source();
@@ -1114,12 +1118,19 @@ static Dart_Isolate CreateIsolate(IsolateGroup* group,
     // bootstrap library files which call out to a tag handler that may create
     // Api Handles when an error is encountered.
     T->EnterApiScope();
-    const Error& error_obj =
-        Error::Handle(Z, Dart::InitializeIsolate(
-                             source->snapshot_data,
-                             source->snapshot_instructions, source->shared_data,
-                             source->shared_instructions, source->kernel_buffer,
-                             source->kernel_buffer_size, isolate_data));
+    Error& error_obj = Error::Handle(Z);
+    if (template_snapshot_data != nullptr) {
+      error_obj = Dart::InitializeIsolate(template_snapshot_data, NULL, NULL,
+                                          NULL, NULL, 0, isolate_data);
+      if (error_obj.IsNull()) {
+        I->object_store()->ResetIsolateListeners();
+      }
+    } else {
+      error_obj = Dart::InitializeIsolate(
+          source->snapshot_data, source->snapshot_instructions,
+          source->shared_data, source->shared_instructions,
+          source->kernel_buffer, source->kernel_buffer_size, isolate_data);
+    }
     if (error_obj.IsNull()) {
 #if defined(DART_NO_SNAPSHOT) && !defined(PRODUCT)
       if (FLAG_check_function_fingerprints && source->kernel_buffer == NULL) {
@@ -1157,14 +1168,18 @@ Isolate* CreateWithinExistingIsolateGroup(IsolateGroup* group,
   API_TIMELINE_DURATION(Thread::Current());
   CHECK_NO_ISOLATE(Isolate::Current());
 
+  // A template already has the program loaded, including the root library.
+  const uint8_t* template_snapshot_data = group->template_snapshot_data();
   Isolate* isolate = reinterpret_cast<Isolate*>(
-      CreateIsolate(group, name, /*isolate_data=*/nullptr, error));
+      CreateIsolate(group, name, /*isolate_data=*/nullptr, error,
+                    template_snapshot_data));
   if (isolate == nullptr) return nullptr;
 
   auto source = group->source();
   ASSERT(isolate->source() == source);
 
-  if (source->script_kernel_buffer != nullptr) {
+  if (template_snapshot_data == nullptr &&
+      source->script_kernel_buffer != nullptr) {
 #if defined(DART_PRECOMPILED_RUNTIME)
     UNREACHABLE();
 #else
@@ -1614,6 +1629,16 @@ DART_EXPORT void Dart_NotifyLowMemory() {
   Isolate::NotifyLowMemory();
 }
 
+DART_EXPORT void Dart_SetGCPauseTimeGoal(int64_t micros) {
+  Thread* T = Thread::Current();
+  CHECK_ISOLATE(T->isolate());
+  if (micros < 0) {
+    FATAL1("%s expects argument 'micros' to be non-negative.", CURRENT_FUNC);
+  }
+  TransitionNativeToVM transition(T);
+  T->isolate()->heap()->SetPauseTimeGoal(micros);
+}
+
 DART_EXPORT void Dart_ExitIsolate() {
   Thread* T = Thread::Current();
   CHECK_ISOLATE(T->isolate());
@@ -1678,6 +1703,55 @@ Dart_CreateSnapshot(uint8_t** vm_snapshot_data_buffer,
   return Api::Success();
 }
 
+#if !defined(DART_PRECOMPILED_RUNTIME)
+static uint8_t* MallocReallocate(uint8_t* ptr,
+                                 intptr_t old_size,
+                                 intptr_t new_size) {
+  return reinterpret_cast<uint8_t*>(realloc(ptr, new_size));
+}
+#endif  // !defined(DART_PRECOMPILED_RUNTIME)
+
+DART_EXPORT Dart_Handle Dart_SetIsolateGroupTemplate() {
+#if defined(DART_PRECOMPILED_RUNTIME)
+  return Api::NewError("%s: Cannot be used on an AOT runtime.", CURRENT_FUNC);
+#else
+  DARTSCOPE(Thread::Current());
+  API_TIMELINE_DURATION(T);
+  Isolate* I = T->isolate();
+  IsolateGroup* group = I->group();
+  if (group->template_snapshot_data() != nullptr) {
+    return Api::NewError("%s: The isolate group already has a template.",
+                         CURRENT_FUNC);
+  }
+  if (I->object_store()->root_library() == Library::null()) {
+    return Api::NewError("%s: Missing root library.", CURRENT_FUNC);
+  }
+  Dart_Handle state = Api::CheckAndFinalizePendingClasses(T);
+  if (Api::IsError(state)) {
+    return state;
+  }
+
+  // The snapshot has the loaded program and the initial values of the static
+  // fields, but no code: isolates created from it compile lazily as usual.
+  uint8_t* buffer = nullptr;
+  BackgroundCompiler::Disable(I);
+  {
+    FullSnapshotWriter writer(Snapshot::kFull, NULL, &buffer, MallocReallocate,
+                              NULL /* vm_image_writer */,
+                              NULL /* isolate_image_writer */);
+    writer.WriteFullSnapshot();
+  }
+  BackgroundCompiler::Enable(I);
+
+  if (!group->set_template_snapshot_data(buffer)) {
+    free(buffer);
+    return Api::NewError("%s: The isolate group already has a template.",
+                         CURRENT_FUNC);
+  }
+  return Api::Success();
+#endif  // defined(DART_PRECOMPILED_RUNTIME)
+}
+
 DART_EXPORT bool Dart_IsKernel(const uint8_t* buffer, intptr_t buffer_size) {
   if (buffer_size < 4) {
     return false;
@@ -6063,6 +6137,76 @@ Dart_Handle Dart_LoadTypeFeedback(uint8_t* buffer, intptr_t buffer_length) {
 #endif  // defined(DART_PRECOMPILED_RUNTIME)
 }
 
+DART_EXPORT
+Dart_Handle Dart_LoadTypeFeedbackLazily(uint8_t* buffer,
+                                        intptr_t buffer_length) {
+#if defined(DART_PRECOMPILED_RUNTIME)
+  return Api::NewError("%s: Cannot compile on an AOT runtime.", CURRENT_FUNC);
+#else
+  Thread* thread = Thread::Current();
+  API_TIMELINE_DURATION(thread);
+  DARTSCOPE(thread);
+  CHECK_NULL(buffer);
+  Dart_Handle state = Api::CheckAndFinalizePendingClasses(T);
+  if (Api::IsError(state)) {
+    return state;
+  }
+  ReadStream stream(buffer, buffer_length);
+  TypeFeedbackLoader loader(thread);
+  const Object& error =
+      Object::Handle(loader.LoadFeedback(&stream, /*lazy=*/true));
+  if (error.IsError()) {
+    return Api::NewHandle(T, Error::Cast(error).raw());
+  }
+  return Api::Success();
+#endif  // defined(DART_PRECOMPILED_RUNTIME)
+}
+
+DART_EXPORT
+Dart_Handle Dart_SaveAotProfile(uint8_t** buffer, intptr_t* buffer_length) {
+#if defined(DART_PRECOMPILED_RUNTIME)
+  return Api::NewError("%s: Cannot compile on an AOT runtime.", CURRENT_FUNC);
+#else
+  Thread* thread = Thread::Current();
+  API_TIMELINE_DURATION(thread);
+  DARTSCOPE(thread);
+  CHECK_NULL(buffer);
+  CHECK_NULL(buffer_length);
+
+  WriteStream stream(buffer, ApiReallocate, MB);
+  AotProfileSaver saver(&stream);
+  saver.WriteHeader();
+  saver.SaveClasses();
+  ProgramVisitor::VisitFunctions(&saver);
+  *buffer_length = stream.bytes_written();
+
+  return Api::Success();
+#endif  // defined(DART_PRECOMPILED_RUNTIME)
+}
+
+DART_EXPORT
+Dart_Handle Dart_LoadAotProfile(uint8_t* buffer, intptr_t buffer_length) {
+#if defined(DART_PRECOMPILED_RUNTIME)
+  return Api::NewError("%s: Cannot compile on an AOT runtime.", CURRENT_FUNC);
+#else
+  Thread* thread = Thread::Current();
+  API_TIMELINE_DURATION(thread);
+  DARTSCOPE(thread);
+  CHECK_NULL(buffer);
+  Dart_Handle state = Api::CheckAndFinalizePendingClasses(T);
+  if (Api::IsError(state)) {
+    return state;
+  }
+  ReadStream stream(buffer, buffer_length);
+  AotProfileLoader loader(thread);
+  const Object& error = Object::Handle(loader.LoadProfile(&stream));
+  if (error.IsError()) {
+    return Api::NewHandle(T, Error::Cast(error).raw());
+  }
+  return Api::Success();
+#endif  // defined(DART_PRECOMPILED_RUNTIME)
+}
+
 DART_EXPORT Dart_Handle Dart_SortClasses() {
 #if defined(DART_PRECOMPILED_RUNTIME)
   return Api::NewError("%s: Cannot compile on an AOT runtime.", CURRENT_FUNC);
@@ -6004,6 +6004,55 @@ TEST_CASE(DartAPI_RootLibrary) {
   EXPECT(Dart_IsNull(root_lib));  // Root library did change.
 }
 
+#if !defined(DART_PRECOMPILED_RUNTIME)
+TEST_CASE(DartAPI_IsolateGroupTemplate) {
+  const char* kScriptChars =
+      "var counter = 40;\n"
+      "main() {\n"
+      "  counter += 2;\n"
+      "  return counter;\n"
+      "}\n"
+      "readCounter() => counter;\n";
+  Dart_Handle lib = TestCase::LoadTestScript(kScriptChars, NULL);
+  EXPECT_VALID(lib);
+  Dart_Handle result = Dart_Invoke(lib, NewString("main"), 0, NULL);
+  EXPECT_VALID(result);
+
+  EXPECT_VALID(Dart_SetIsolateGroupTemplate());
+  EXPECT_ERROR(Dart_SetIsolateGroupTemplate(), "already has a template");
+
+  // An isolate spawned into the group has the program of the template, but
+  // its static fields start out with their initial values.
+  Dart_Isolate parent = Dart_CurrentIsolate();
+  IsolateGroup* group = Isolate::Current()->group();
+  Dart_ExitIsolate();
+  char* error = NULL;
+  Isolate* child = CreateWithinExistingIsolateGroup(group, "child", &error);
+  EXPECT(child != NULL);
+  EXPECT(error == NULL);
+  {
+    Dart_EnterScope();
+    Dart_Handle child_lib = Dart_RootLibrary();
+    EXPECT_VALID(child_lib);
+    EXPECT(!Dart_IsNull(child_lib));
+    result = Dart_Invoke(child_lib, NewString("readCounter"), 0, NULL);
+    EXPECT_VALID(result);
+    int64_t value = 0;
+    EXPECT_VALID(Dart_IntegerToInt64(result, &value));
+    EXPECT_EQ(40, value);
+    Dart_ExitScope();
+  }
+  Dart_ShutdownIsolate();
+  Dart_EnterIsolate(parent);
+
+  result = Dart_Invoke(lib, NewString("readCounter"), 0, NULL);
+  EXPECT_VALID(result);
+  int64_t value = 0;
+  EXPECT_VALID(Dart_IntegerToInt64(result, &value));
+  EXPECT_EQ(42, value);
+}
+#endif  // !defined(DART_PRECOMPILED_RUNTIME)
+
 TEST_CASE(DartAPI_LookupLibrary) {
   const char* kScriptChars =
       "import 'library1_dart';"
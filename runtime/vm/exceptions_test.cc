@@ -5,6 +5,8 @@
 #include "include/dart_api.h"
 #include "platform/assert.h"
 #include "vm/dart_api_impl.h"
+#include "vm/debugger.h"
+#include "vm/object_store.h"
 #include "vm/unit_test.h"
 
 namespace dart {
@@ -119,4 +121,78 @@ TEST_CASE(UnhandledExceptions) {
   EXPECT_VALID(Dart_Invoke(lib, NewString("testMain"), 0, NULL));
 }
 
+#if !defined(PRODUCT)
+
+// Moves the handled types of the exception handlers on the stack into the
+// object store, as done for handlers left in a read-only AOT snapshot image,
+// and checks that the debugger still finds the handler for the first
+// argument and none for the second.
+static void CheckHandlerFrames(Dart_NativeArguments args) {
+  NativeArguments* arguments = reinterpret_cast<NativeArguments*>(args);
+  Thread* thread = arguments->thread();
+  TransitionNativeToVM transition(thread);
+  Zone* zone = thread->zone();
+  const Instance& caught =
+      Instance::CheckedHandle(zone, arguments->NativeArgAt(0));
+  const Instance& uncaught =
+      Instance::CheckedHandle(zone, arguments->NativeArgAt(1));
+
+  DebuggerStackTrace* stack =
+      thread->isolate()->debugger()->CurrentStackTrace();
+  const GrowableObjectArray& table =
+      GrowableObjectArray::Handle(zone, GrowableObjectArray::New());
+  ExceptionHandlers& handlers = ExceptionHandlers::Handle(zone);
+  for (intptr_t i = 0; i < stack->Length(); i++) {
+    ActivationFrame* frame = stack->FrameAt(i);
+    if (frame->IsInterpreted()) {
+      continue;
+    }
+    handlers = frame->code().exception_handlers();
+    if (handlers.num_entries() > 0) {
+      handlers.MoveHandledTypesTo(table);
+    }
+  }
+  EXPECT(table.Length() > 0);
+  thread->isolate()->object_store()->set_exception_handled_types(
+      Array::Handle(zone, Array::MakeFixedLength(table)));
+
+  EXPECT(stack->GetHandlerFrame(caught) != NULL);
+  EXPECT(stack->GetHandlerFrame(uncaught) == NULL);
+}
+
+static Dart_NativeFunction CheckHandlerFramesLookup(Dart_Handle name,
+                                                    int argument_count,
+                                                    bool* auto_setup_scope) {
+  ASSERT(auto_setup_scope != NULL);
+  *auto_setup_scope = true;
+  return reinterpret_cast<Dart_NativeFunction>(&CheckHandlerFrames);
+}
+
+// Unit test case to verify that exceptions are still caught, and that the
+// debugger still tells caught from unhandled exceptions, once the handled
+// types were moved out of the exception handlers.
+TEST_CASE(UnhandledExceptions_HandledTypesTable) {
+  const char* kScriptChars =
+      "class Caught {}\n"
+      "class Uncaught {}\n"
+      "checkHandlerFrames(caught, uncaught) native 'CheckHandlerFrames';\n"
+      "testMain() {\n"
+      "  try {\n"
+      "    checkHandlerFrames(new Caught(), new Uncaught());\n"
+      "    throw new Caught();\n"
+      "  } on Caught catch (e) {\n"
+      "    return 42;\n"
+      "  }\n"
+      "}\n";
+  Dart_Handle lib =
+      TestCase::LoadTestScript(kScriptChars, &CheckHandlerFramesLookup);
+  Dart_Handle result = Dart_Invoke(lib, NewString("testMain"), 0, NULL);
+  EXPECT_VALID(result);
+  int64_t value = 0;
+  EXPECT_VALID(Dart_IntegerToInt64(result, &value));
+  EXPECT_EQ(42, value);
+}
+
+#endif  // !defined(PRODUCT)
+
 }  // namespace dart
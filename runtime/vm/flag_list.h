@@ -99,6 +99,9 @@ constexpr bool kDartUseBytecode = false;
   P(enable_mirrors, bool, true,                                                \
     "Disable to make importing dart:mirrors an error.")                        \
   P(enable_ffi, bool, true, "Disable to make importing dart:ffi an error.")    \
+  P(evacuation_threshold, int, 0,                                              \
+    "Evacuate regular old-space pages whose live bytes are below this "        \
+    "percentage of the page during mark-sweep (0 means never).")               \
   P(fields_may_be_reset, bool, false,                                          \
     "Don't optimize away static field initialization")                         \
   C(force_clone_compiler_objects, false, false, bool, false,                   \
@@ -107,8 +110,23 @@ constexpr bool kDartUseBytecode = false;
     "Ratio of getter/setter usage used for double field unboxing heuristics")  \
   P(guess_icdata_cid, bool, true,                                              \
     "Artificially create type feedback for arithmetic etc. operations")        \
+  P(heap_huge_pages, bool, false,                                              \
+    "Back semi-spaces and large old-space pages whose size is a multiple "     \
+    "of 2MB with transparent huge pages (Linux only).")                        \
+  P(heap_hugetlb, bool, false,                                                 \
+    "Back semi-spaces with explicitly reserved huge pages (MAP_HUGETLB), "     \
+    "falling back to transparent huge pages when none are reserved.")          \
+  P(heap_numa_nodes, int, 0,                                                   \
+    "Bind the heap of each isolate group to one of this many NUMA nodes, "     \
+    "assigned round-robin (0 means no binding, Linux only).")                  \
+  R(heap_snapshot_tasks, 0, int, 2,                                            \
+    "The number of tasks that help count and encode objects when writing a "   \
+    "heap snapshot or computing retained sizes.")                              \
   P(huge_method_cutoff_in_tokens, int, 20000,                                  \
     "Huge method cutoff in tokens: Disables optimizations for huge methods.")  \
+  P(idle_gc_slices, bool, true,                                                \
+    "Use idle notifications for bounded increments of old-space marking, "     \
+    "sweeping and weak table cleanup.")                                        \
   P(idle_timeout_micros, int, 1000 * kMicrosecondsPerMillisecond,              \
     "Consider thread pool isolates for idle tasks after this long.")           \
   P(idle_duration_micros, int, 500 * kMicrosecondsPerMillisecond,              \
@@ -121,6 +139,8 @@ constexpr bool kDartUseBytecode = false;
   P(marker_tasks, int, USING_MULTICORE ? 2 : 0,                                \
     "The number of tasks to spawn during old gen GC marking (0 means "         \
     "perform all marking on main thread).")                                    \
+  P(max_evacuation_kb, int, 8192,                                              \
+    "The maximum amount of live data moved by one evacuation.")                \
   P(max_polymorphic_checks, int, 4,                                            \
     "Maximum number of polymorphic check, otherwise it is megamorphic.")       \
   P(max_equality_polymorphic_checks, int, 32,                                  \
@@ -139,6 +159,9 @@ constexpr bool kDartUseBytecode = false;
   P(old_gen_heap_size, int, kDefaultMaxOldGenHeapSize,                         \
     "Max size of old gen heap size in MB, or 0 for unlimited,"                 \
     "e.g: --old_gen_heap_size=1024 allows up to 1024MB old gen heap")          \
+  P(old_gen_tlab_size, int, 32,                                                \
+    "Size in KB of the thread-local buffers used for old-space allocation "    \
+    "and promotion, or 0 to allocate from the shared free list directly.")     \
   R(pause_isolates_on_start, false, bool, false,                               \
     "Pause isolates before starting.")                                         \
   R(pause_isolates_on_exit, false, bool, false, "Pause isolates exiting.")     \
@@ -162,6 +185,9 @@ constexpr bool kDartUseBytecode = false;
   R(profiler_native_memory, false, bool, false,                                \
     "Enable native memory statistic collection.")                              \
   P(reorder_basic_blocks, bool, true, "Reorder basic blocks")                  \
+  P(scavenger_tasks, int, 0,                                                   \
+    "The number of tasks to spawn during new gen GC scavenging (0 means "      \
+    "perform all scavenging on main thread).")                                 \
   C(stress_async_stacks, false, false, bool, false,                            \
     "Stress test async stack traces")                                          \
   P(use_bare_instructions, bool, true, "Enable bare instructions mode.")       \
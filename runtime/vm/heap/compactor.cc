@@ -254,33 +254,7 @@ void GCCompactor::Compact(HeapPage* pages,
     barrier.Exit();
   }
 
-  // Update inner pointers in typed data views (needs to be done after all
-  // threads are done with sliding since we need to access fields of the
-  // view's backing store)
-  //
-  // (If the sliding compactor was single-threaded we could do this during the
-  // sliding phase: The class id of the backing store can be either accessed by
-  // looking at the already-slided-object or the not-yet-slided object. Though
-  // with parallel sliding there is no safe way to access the backing store
-  // object header.)
-  {
-    TIMELINE_FUNCTION_GC_DURATION(thread(),
-                                  "ForwardTypedDataViewInternalPointers");
-    const intptr_t length = typed_data_views_.length();
-    for (intptr_t i = 0; i < length; ++i) {
-      auto raw_view = typed_data_views_[i];
-      const classid_t cid = raw_view->ptr()->typed_data_->GetClassIdMayBeSmi();
-
-      // If we have external typed data we can simply return, since the backing
-      // store lives in C-heap and will not move. Otherwise we have to update
-      // the inner pointer.
-      if (RawObject::IsTypedDataClassId(cid)) {
-        raw_view->RecomputeDataFieldForInternalTypedData();
-      } else {
-        ASSERT(RawObject::IsExternalTypedDataClassId(cid));
-      }
-    }
-  }
+  ForwardTypedDataViewInternalPointers();
 
   for (intptr_t task_index = 0; task_index < num_tasks; task_index++) {
     ASSERT(tails[task_index] != NULL);
@@ -367,56 +341,7 @@ void CompactorTask::Run() {
       *tail_ = free_page_;  // Last live page.
     }
 
-    // Heap: Regular pages already visited during sliding. Code and image pages
-    // have no pointers to forward. Visit large pages and new-space.
-
-    bool more_forwarding_tasks = true;
-    while (more_forwarding_tasks) {
-      intptr_t forwarding_task =
-          AtomicOperations::FetchAndIncrement(next_forwarding_task_);
-      switch (forwarding_task) {
-        case 0: {
-          TIMELINE_FUNCTION_GC_DURATION(thread, "ForwardLargePages");
-          for (HeapPage* large_page =
-                   isolate_->heap()->old_space()->large_pages_;
-               large_page != NULL; large_page = large_page->next()) {
-            large_page->VisitObjectPointers(compactor_);
-          }
-          break;
-        }
-        case 1: {
-          TIMELINE_FUNCTION_GC_DURATION(thread, "ForwardNewSpace");
-          isolate_->heap()->new_space()->VisitObjectPointers(compactor_);
-          break;
-        }
-        case 2: {
-          TIMELINE_FUNCTION_GC_DURATION(thread, "ForwardRememberedSet");
-          isolate_->store_buffer()->VisitObjectPointers(compactor_);
-          break;
-        }
-        case 3: {
-          TIMELINE_FUNCTION_GC_DURATION(thread, "ForwardWeakTables");
-          isolate_->heap()->ForwardWeakTables(compactor_);
-          break;
-        }
-        case 4: {
-          TIMELINE_FUNCTION_GC_DURATION(thread, "ForwardWeakHandles");
-          isolate_->VisitWeakPersistentHandles(compactor_);
-          break;
-        }
-#ifndef PRODUCT
-        case 5: {
-          if (FLAG_support_service) {
-            TIMELINE_FUNCTION_GC_DURATION(thread, "ForwardObjectIdRing");
-            isolate_->object_id_ring()->VisitPointers(compactor_);
-          }
-          break;
-        }
-#endif  // !PRODUCT
-        default:
-          more_forwarding_tasks = false;
-      }
-    }
+    compactor_->ForwardRoots(isolate_, next_forwarding_task_);
 
     barrier_->Sync();
   }
@@ -555,6 +480,392 @@ void CompactorTask::PlanMoveToContiguousSize(intptr_t size) {
   }
 }
 
+class EvacuatorTask : public ThreadPool::Task {
+ public:
+  EvacuatorTask(Isolate* isolate,
+                GCCompactor* compactor,
+                ThreadBarrier* barrier,
+                intptr_t* next_forwarding_task,
+                MallocGrowableArray<HeapPage*>* evacuated_pages,
+                intptr_t* evacuated_not_started,
+                MallocGrowableArray<HeapPage*>* surviving_pages,
+                intptr_t* surviving_not_started)
+      : isolate_(isolate),
+        compactor_(compactor),
+        barrier_(barrier),
+        next_forwarding_task_(next_forwarding_task),
+        evacuated_pages_(evacuated_pages),
+        evacuated_not_started_(evacuated_not_started),
+        surviving_pages_(surviving_pages),
+        surviving_not_started_(surviving_not_started) {}
+
+ private:
+  void Run();
+  void EvacuatePage(HeapPage* page);
+  void ForwardPage(HeapPage* page);
+
+  Isolate* isolate_;
+  GCCompactor* compactor_;
+  ThreadBarrier* barrier_;
+  intptr_t* next_forwarding_task_;
+  MallocGrowableArray<HeapPage*>* evacuated_pages_;
+  intptr_t* evacuated_not_started_;
+  MallocGrowableArray<HeapPage*>* surviving_pages_;
+  intptr_t* surviving_not_started_;
+
+  DISALLOW_COPY_AND_ASSIGN(EvacuatorTask);
+};
+
+static intptr_t MarkedBytes(HeapPage* page) {
+  intptr_t marked_bytes = 0;
+  uword current = page->object_start();
+  uword end = page->object_end();
+  while (current < end) {
+    RawObject* obj = RawObject::FromAddr(current);
+    intptr_t size = obj->HeapSize();
+    if (obj->IsMarked()) {
+      marked_bytes += size;
+    }
+    current += size;
+  }
+  return marked_bytes;
+}
+
+// Moves the live objects off the sparsest regular pages as part of a
+// mark-sweep, so the pause is proportional to the evacuated volume rather than
+// to the size of the heap. Candidates are chosen from the live bytes recorded
+// by the previous sweep and confirmed against the current mark bits. The live
+// objects of each block of a candidate are copied contiguously into fresh
+// pages (see ForwardingBlock), then every live object outside the candidates
+// and the roots are visited to update the references into the candidates,
+// which are released afterwards. Moved objects stay marked, so the sweep that
+// follows treats the fresh pages like any other page.
+void GCCompactor::EvacuateSparsePages() {
+  PageSpace* old_space = heap_->old_space();
+  const intptr_t threshold = FLAG_evacuation_threshold;
+  const intptr_t budget = static_cast<intptr_t>(FLAG_max_evacuation_kb) * KB;
+
+  MallocGrowableArray<HeapPage*> evacuated_pages;
+  MallocGrowableArray<HeapPage*> surviving_pages;
+  intptr_t evacuated_bytes = 0;
+  for (HeapPage* page = old_space->pages_; page != NULL; page = page->next()) {
+    const intptr_t capacity = page->object_end() - page->object_start();
+    // A page that was not swept yet has no liveness data.
+    const intptr_t swept_bytes = page->used_in_bytes();
+    if ((swept_bytes != 0) && (swept_bytes * 100 < capacity * threshold) &&
+        (evacuated_bytes < budget)) {
+      // Objects may have been allocated into the page since it was swept.
+      const intptr_t live_bytes = MarkedBytes(page);
+      if ((live_bytes != 0) && (live_bytes * 100 < capacity * threshold) &&
+          (evacuated_bytes + live_bytes <= budget)) {
+        evacuated_pages.Add(page);
+        evacuated_bytes += live_bytes;
+        continue;
+      }
+    }
+    surviving_pages.Add(page);
+  }
+  if (evacuated_pages.length() < 2) {
+    return;  // Evacuating cannot release any memory.
+  }
+
+  SetupImagePageBoundaries();
+
+  // Plan the new location of every live object, allocating fresh pages as
+  // needed. Free space at the end of a fresh page is left as a free list
+  // element for the sweeper to find.
+  HeapPage* fresh_pages = NULL;
+  HeapPage* fresh_pages_tail = NULL;
+  uword free_current = 0;
+  uword free_end = 0;
+  bool out_of_memory = false;
+  {
+    TIMELINE_FUNCTION_GC_DURATION(thread(), "PlanEvacuation");
+    for (intptr_t i = 0; (i < evacuated_pages.length()) && !out_of_memory;
+         i++) {
+      HeapPage* page = evacuated_pages[i];
+      ForwardingPage* forwarding_page = page->AllocateForwardingPage();
+      uword current = page->object_start();
+      uword end = page->object_end();
+      while (current < end) {
+        uword block_end = (current & kBlockMask) + kBlockSize;
+        ForwardingBlock* forwarding_block = forwarding_page->BlockFor(current);
+        intptr_t block_live_size = 0;
+        while (current < block_end) {
+          RawObject* obj = RawObject::FromAddr(current);
+          intptr_t size = obj->HeapSize();
+          if (obj->IsMarked()) {
+            forwarding_block->RecordLive(current, size);
+            block_live_size += size;
+          }
+          current += size;
+        }
+        if (static_cast<intptr_t>(free_end - free_current) < block_live_size) {
+          if (free_current != free_end) {
+            FreeListElement::AsElement(free_current, free_end - free_current);
+          }
+          HeapPage* fresh_page =
+              old_space->AllocatePage(HeapPage::kData, /* link */ false);
+          if (fresh_page == NULL) {
+            out_of_memory = true;
+            break;
+          }
+          if (fresh_pages == NULL) {
+            fresh_pages = fresh_page;
+          } else {
+            fresh_pages_tail->set_next(fresh_page);
+          }
+          fresh_pages_tail = fresh_page;
+          free_current = fresh_page->object_start();
+          free_end = fresh_page->object_end();
+        }
+        forwarding_block->set_new_address(free_current);
+        free_current += block_live_size;
+      }
+    }
+  }
+
+  if (out_of_memory) {
+    // Nothing has moved yet: drop the plan and let the sweep proceed as usual.
+    for (intptr_t i = 0; i < evacuated_pages.length(); i++) {
+      if (evacuated_pages[i]->forwarding_page() != NULL) {
+        evacuated_pages[i]->FreeForwardingPage();
+      }
+    }
+    while (fresh_pages != NULL) {
+      HeapPage* next = fresh_pages->next();
+      old_space->IncreaseCapacityInWords(
+          -(fresh_pages->memory_->size() >> kWordSizeLog2));
+      fresh_pages->Deallocate();
+      fresh_pages = next;
+    }
+    return;
+  }
+  if (free_current != free_end) {
+    FreeListElement::AsElement(free_current, free_end - free_current);
+  }
+
+  // The copies need their pointers forwarded like any other surviving object.
+  for (HeapPage* page = fresh_pages; page != NULL; page = page->next()) {
+    surviving_pages.Add(page);
+  }
+
+  intptr_t num_tasks = FLAG_compactor_tasks;
+  RELEASE_ASSERT(num_tasks >= 1);
+  {
+    ThreadBarrier barrier(num_tasks + 1, heap_->barrier(),
+                          heap_->barrier_done());
+    intptr_t next_forwarding_task = 0;
+    intptr_t evacuated_not_started = evacuated_pages.length();
+    intptr_t surviving_not_started = surviving_pages.length();
+
+    for (intptr_t task_index = 0; task_index < num_tasks; task_index++) {
+      Dart::thread_pool()->Run<EvacuatorTask>(
+          thread()->isolate(), this, &barrier, &next_forwarding_task,
+          &evacuated_pages, &evacuated_not_started, &surviving_pages,
+          &surviving_not_started);
+    }
+
+    // Copy objects.
+    barrier.Sync();
+    // Forward surviving pages, large pages, new space, etc.
+    barrier.Sync();
+    barrier.Exit();
+  }
+
+  ForwardTypedDataViewInternalPointers();
+
+  {
+    TIMELINE_FUNCTION_GC_DURATION(thread(), "ForwardStackPointers");
+    ForwardStackPointers();
+  }
+
+  // Release the evacuated pages and add the fresh pages to the end of the
+  // heap, where the sweeper will find them.
+  HeapPage* previous_page = NULL;
+  HeapPage* page = old_space->pages_;
+  while (page != NULL) {
+    HeapPage* next_page = page->next();
+    if (page->forwarding_page() != NULL) {
+      page->FreeForwardingPage();
+      old_space->FreePage(page, previous_page);
+    } else {
+      previous_page = page;
+    }
+    page = next_page;
+  }
+  {
+    MutexLocker ml(&old_space->pages_lock_);
+    if (old_space->pages_ == NULL) {
+      old_space->pages_ = fresh_pages;
+    } else {
+      old_space->pages_tail_->set_next(fresh_pages);
+    }
+    old_space->pages_tail_ = fresh_pages_tail;
+  }
+}
+
+void EvacuatorTask::Run() {
+  bool result =
+      Thread::EnterIsolateAsHelper(isolate_, Thread::kCompactorTask, true);
+  ASSERT(result);
+#ifdef SUPPORT_TIMELINE
+  Thread* thread = Thread::Current();
+#endif
+  {
+    {
+      TIMELINE_FUNCTION_GC_DURATION(thread, "Evacuate");
+      for (;;) {
+        intptr_t i =
+            AtomicOperations::FetchAndDecrement(evacuated_not_started_) - 1;
+        if (i < 0) break;
+        EvacuatePage((*evacuated_pages_)[i]);
+      }
+    }
+
+    // Every copy must be complete before any pointer to it is forwarded.
+    barrier_->Sync();
+
+    {
+      TIMELINE_FUNCTION_GC_DURATION(thread, "ForwardSurvivingPages");
+      for (;;) {
+        intptr_t i =
+            AtomicOperations::FetchAndDecrement(surviving_not_started_) - 1;
+        if (i < 0) break;
+        ForwardPage((*surviving_pages_)[i]);
+      }
+    }
+
+    compactor_->ForwardRoots(isolate_, next_forwarding_task_);
+
+    barrier_->Sync();
+  }
+  Thread::ExitIsolateAsHelper(true);
+
+  // This task is done. Notify the original thread.
+  barrier_->Exit();
+}
+
+void EvacuatorTask::EvacuatePage(HeapPage* page) {
+  ForwardingPage* forwarding_page = page->forwarding_page();
+  uword old_addr = page->object_start();
+  uword end = page->object_end();
+  while (old_addr < end) {
+    RawObject* old_obj = RawObject::FromAddr(old_addr);
+    intptr_t size = old_obj->HeapSize();
+    if (old_obj->IsMarked()) {
+      uword new_addr = forwarding_page->Lookup(old_addr);
+      memcpy(reinterpret_cast<void*>(new_addr),
+             reinterpret_cast<void*>(old_addr), size);
+      RawObject* new_obj = RawObject::FromAddr(new_addr);
+      if (RawObject::IsTypedDataClassId(new_obj->GetClassId())) {
+        reinterpret_cast<RawTypedData*>(new_obj)->RecomputeDataField();
+      }
+    }
+    old_addr += size;
+  }
+}
+
+// Only marked objects are visited: the pointers of dead objects may refer to
+// memory that is no longer part of the heap, and they are about to be swept.
+void EvacuatorTask::ForwardPage(HeapPage* page) {
+  uword current = page->object_start();
+  uword end = page->object_end();
+  while (current < end) {
+    RawObject* obj = RawObject::FromAddr(current);
+    if (obj->IsMarked()) {
+      current += obj->VisitPointers(compactor_);
+    } else {
+      current += obj->HeapSize();
+    }
+  }
+}
+
+// Update inner pointers in typed data views (needs to be done after all
+// threads are done with sliding or evacuating since we need to access fields
+// of the view's backing store)
+//
+// (If the sliding compactor was single-threaded we could do this during the
+// sliding phase: The class id of the backing store can be either accessed by
+// looking at the already-slided-object or the not-yet-slided object. Though
+// with parallel sliding there is no safe way to access the backing store
+// object header.)
+void GCCompactor::ForwardTypedDataViewInternalPointers() {
+  TIMELINE_FUNCTION_GC_DURATION(thread(),
+                                "ForwardTypedDataViewInternalPointers");
+  const intptr_t length = typed_data_views_.length();
+  for (intptr_t i = 0; i < length; ++i) {
+    auto raw_view = typed_data_views_[i];
+    const classid_t cid = raw_view->ptr()->typed_data_->GetClassIdMayBeSmi();
+
+    // If we have external typed data we can simply return, since the backing
+    // store lives in C-heap and will not move. Otherwise we have to update
+    // the inner pointer.
+    if (RawObject::IsTypedDataClassId(cid)) {
+      raw_view->RecomputeDataFieldForInternalTypedData();
+    } else {
+      ASSERT(RawObject::IsExternalTypedDataClassId(cid));
+    }
+  }
+}
+
+// Heap: Regular pages are visited during sliding or evacuation. Code and
+// image pages have no pointers to forward. Visit large pages, new-space and
+// the non-stack roots, claiming them one at a time from
+// 'next_forwarding_task' so that several tasks can share the work.
+void GCCompactor::ForwardRoots(Isolate* isolate,
+                               intptr_t* next_forwarding_task) {
+#ifdef SUPPORT_TIMELINE
+  Thread* thread = Thread::Current();
+#endif
+  bool more_forwarding_tasks = true;
+  while (more_forwarding_tasks) {
+    intptr_t forwarding_task =
+        AtomicOperations::FetchAndIncrement(next_forwarding_task);
+    switch (forwarding_task) {
+      case 0: {
+        TIMELINE_FUNCTION_GC_DURATION(thread, "ForwardLargePages");
+        for (HeapPage* large_page = isolate->heap()->old_space()->large_pages_;
+             large_page != NULL; large_page = large_page->next()) {
+          large_page->VisitObjectPointers(this);
+        }
+        break;
+      }
+      case 1: {
+        TIMELINE_FUNCTION_GC_DURATION(thread, "ForwardNewSpace");
+        isolate->heap()->new_space()->VisitObjectPointers(this);
+        break;
+      }
+      case 2: {
+        TIMELINE_FUNCTION_GC_DURATION(thread, "ForwardRememberedSet");
+        isolate->store_buffer()->VisitObjectPointers(this);
+        break;
+      }
+      case 3: {
+        TIMELINE_FUNCTION_GC_DURATION(thread, "ForwardWeakTables");
+        isolate->heap()->ForwardWeakTables(this);
+        break;
+      }
+      case 4: {
+        TIMELINE_FUNCTION_GC_DURATION(thread, "ForwardWeakHandles");
+        isolate->VisitWeakPersistentHandles(this);
+        break;
+      }
+#ifndef PRODUCT
+      case 5: {
+        if (FLAG_support_service) {
+          TIMELINE_FUNCTION_GC_DURATION(thread, "ForwardObjectIdRing");
+          isolate->object_id_ring()->VisitPointers(this);
+        }
+        break;
+      }
+#endif  // !PRODUCT
+      default:
+        more_forwarding_tasks = false;
+    }
+  }
+}
+
 void GCCompactor::SetupImagePageBoundaries() {
   for (intptr_t i = 0; i < kMaxImagePages; i++) {
     image_page_ranges_[i].base = 0;
@@ -18,9 +18,11 @@ namespace dart {
 class FreeList;
 class Heap;
 class HeapPage;
+class Isolate;
 class RawObject;
 
-// Implements a sliding compactor.
+// Implements a sliding compactor, and the selective evacuation of sparse pages
+// that shares its forwarding machinery.
 class GCCompactor : public ValueObject,
                     public HandleVisitor,
                     public ObjectPointerVisitor {
@@ -33,10 +35,16 @@ class GCCompactor : public ValueObject,
 
   void Compact(HeapPage* pages, FreeList* freelist, Mutex* mutex);
 
+  // Must run after marking and before sweeping the regular pages.
+  void EvacuateSparsePages();
+
  private:
   friend class CompactorTask;
+  friend class EvacuatorTask;
 
   void SetupImagePageBoundaries();
+  void ForwardRoots(Isolate* isolate, intptr_t* next_forwarding_task);
+  void ForwardTypedDataViewInternalPointers();
   void ForwardStackPointers();
   void ForwardPointer(RawObject** ptr);
   void VisitTypedDataViewPointers(RawTypedDataView* view,
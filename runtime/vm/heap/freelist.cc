@@ -334,6 +334,20 @@ void FreeList::SplitElementAfterAndEnqueue(FreeListElement* element,
   }
 }
 
+FreeListElement* FreeList::TryAllocateBatchLocked(intptr_t size,
+                                                  intptr_t count) {
+  DEBUG_ASSERT(mutex_.IsOwnedByCurrentThread());
+  const intptr_t index = IndexForSize(size);
+  ASSERT(index < kNumLists);
+  FreeListElement* result = NULL;
+  for (intptr_t i = 0; (i < count) && free_map_.Test(index); i++) {
+    FreeListElement* element = DequeueElement(index);
+    element->set_next(result);
+    result = element;
+  }
+  return result;
+}
+
 FreeListElement* FreeList::TryAllocateLarge(intptr_t minimum_size) {
   MutexLocker ml(&mutex_);
   return TryAllocateLargeLocked(minimum_size);
@@ -368,4 +382,80 @@ FreeListElement* FreeList::TryAllocateLargeLocked(intptr_t minimum_size) {
   return NULL;
 }
 
+uword OldTLAB::TryAllocateSlow(FreeList* freelist, intptr_t size) {
+  MutexLocker ml(freelist->mutex());
+  const intptr_t index = size >> kObjectAlignmentLog2;
+  if (index <= kNumSizeClasses) {
+    FreeListElement* batch =
+        freelist->TryAllocateBatchLocked(size, kSizeClassBatch);
+    if (batch != NULL) {
+      size_classes_[index] = batch->next();
+      return reinterpret_cast<uword>(batch);
+    }
+  }
+  const intptr_t chunk_size = FLAG_old_gen_tlab_size * KB;
+  // Objects that would use up much of a chunk are not worth buffering.
+  if (size <= (chunk_size >> 2)) {
+    FreeListElement* chunk = freelist->TryAllocateLargeLocked(chunk_size);
+    if (chunk != NULL) {
+      uword start = reinterpret_cast<uword>(chunk);
+      uword chunk_end = start + chunk->HeapSize();
+      if (chunk_end > start + chunk_size) {
+        // Leave the rest of a large element to other threads.
+        freelist->FreeLocked(start + chunk_size,
+                             chunk_end - (start + chunk_size));
+        chunk_end = start + chunk_size;
+      }
+      if (top_ < end_) {
+        freelist->FreeLocked(top_, end_ - top_);
+      }
+      top_ = start + size;
+      end_ = chunk_end;
+      if (top_ < end_) {
+        FreeListElement::AsElement(top_, end_ - top_);
+      }
+      return start;
+    }
+  }
+  return freelist->TryAllocateLocked(size, false /* is_protected */);
+}
+
+void OldTLAB::Release(FreeList* freelist) {
+  if (IsEmpty()) {
+    return;
+  }
+  MutexLocker ml(freelist->mutex());
+  ReleaseLocked(freelist);
+}
+
+void OldTLAB::ReleaseLocked(FreeList* freelist) {
+  if (top_ < end_) {
+    freelist->FreeLocked(top_, end_ - top_);
+  }
+  top_ = 0;
+  end_ = 0;
+  for (intptr_t i = 1; i <= kNumSizeClasses; i++) {
+    FreeListElement* element = size_classes_[i];
+    while (element != NULL) {
+      FreeListElement* next = element->next();
+      freelist->FreeLocked(reinterpret_cast<uword>(element),
+                           i << kObjectAlignmentLog2);
+      element = next;
+    }
+  }
+  ClearSizeClasses();
+}
+
+bool OldTLAB::IsEmpty() const {
+  if (top_ < end_) {
+    return false;
+  }
+  for (intptr_t i = 1; i <= kNumSizeClasses; i++) {
+    if (size_classes_[i] != NULL) {
+      return false;
+    }
+  }
+  return true;
+}
+
 }  // namespace dart
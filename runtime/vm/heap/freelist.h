@@ -94,6 +94,11 @@ class FreeList {
   FreeListElement* TryAllocateLarge(intptr_t minimum_size);
   FreeListElement* TryAllocateLargeLocked(intptr_t minimum_size);
 
+  // Removes up to 'count' elements of exactly 'size' bytes from their fixed
+  // size list and returns them chained through their next pointers, or NULL
+  // if there are none.
+  FreeListElement* TryAllocateBatchLocked(intptr_t size, intptr_t count);
+
   // Allocates locked and unprotected memory, but only from small elements
   // (i.e., fixed size lists).
   uword TryAllocateSmallLocked(intptr_t size) {
@@ -173,6 +178,81 @@ class FreeList {
   DISALLOW_COPY_AND_ASSIGN(FreeList);
 };
 
+// A thread-local old-space allocation buffer (old-TLAB). Objects are bump
+// allocated from a chunk carved out of a large free list element, and small
+// objects are first served from per-size-class lists of exactly fitting
+// elements that are taken from the FreeList in batches. Only refills take the
+// FreeList's lock. The unused part of the chunk and the cached elements remain
+// free list elements, so the pages they live in stay walkable.
+class OldTLAB {
+ public:
+  OldTLAB() : top_(0), end_(0) { ClearSizeClasses(); }
+
+  // Returns 0 if the request cannot be served without refilling.
+  uword TryAllocateFast(intptr_t size) {
+    ASSERT(Utils::IsAligned(size, kObjectAlignment));
+    const intptr_t index = size >> kObjectAlignmentLog2;
+    if (index <= kNumSizeClasses) {
+      FreeListElement* element = size_classes_[index];
+      if (element != NULL) {
+        size_classes_[index] = element->next();
+        return reinterpret_cast<uword>(element);
+      }
+    }
+    if (static_cast<intptr_t>(end_ - top_) >= size) {
+      uword result = top_;
+      top_ += size;
+      if (top_ < end_) {
+        FreeListElement::AsElement(top_, end_ - top_);
+      }
+      return result;
+    }
+    return 0;
+  }
+
+  uword TryAllocate(FreeList* freelist, intptr_t size) {
+    uword result = TryAllocateFast(size);
+    if (result != 0) {
+      return result;
+    }
+    return TryAllocateSlow(freelist, size);
+  }
+
+  // Returns all cached memory to 'freelist'.
+  void Release(FreeList* freelist);
+  void ReleaseLocked(FreeList* freelist);
+
+  // Forgets all cached memory. Only valid when the free list is about to be
+  // rebuilt by a sweep, which reclaims the free list elements left behind.
+  void Abandon() {
+    top_ = 0;
+    end_ = 0;
+    ClearSizeClasses();
+  }
+
+  bool IsEmpty() const;
+
+ private:
+  // Size classes cover the sizes of up to this many allocation units.
+  static const intptr_t kNumSizeClasses = 8;
+  // The number of elements moved from the FreeList by one size class refill.
+  static const intptr_t kSizeClassBatch = 16;
+
+  void ClearSizeClasses() {
+    for (intptr_t i = 0; i <= kNumSizeClasses; i++) {
+      size_classes_[i] = NULL;
+    }
+  }
+
+  uword TryAllocateSlow(FreeList* freelist, intptr_t size);
+
+  uword top_;
+  uword end_;
+  FreeListElement* size_classes_[kNumSizeClasses + 1];
+
+  DISALLOW_COPY_AND_ASSIGN(OldTLAB);
+};
+
 }  // namespace dart
 
 #endif  // RUNTIME_VM_HEAP_FREELIST_H_
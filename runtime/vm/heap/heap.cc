@@ -37,6 +37,9 @@ Heap::Heap(Isolate* isolate,
            intptr_t max_new_gen_semi_words,
            intptr_t max_old_gen_words)
     : isolate_(isolate),
+      numa_node_(((isolate != NULL) && (isolate->group() != NULL))
+                     ? isolate->group()->numa_node()
+                     : -1),
       new_space_(this, max_new_gen_semi_words, kNewObjectAlignmentOffset),
       old_space_(this, max_old_gen_words),
       barrier_(),
@@ -126,15 +129,22 @@ uword Heap::AllocateNew(intptr_t size) {
 }
 
 uword Heap::AllocateOld(intptr_t size, HeapPage::PageType type) {
-  ASSERT(Thread::Current()->no_safepoint_scope_depth() == 0);
+  Thread* thread = Thread::Current();
+  ASSERT(thread->no_safepoint_scope_depth() == 0);
   CollectForDebugging();
-  uword addr = old_space_.TryAllocate(size, type);
+  uword addr = 0;
+  if ((type == HeapPage::kData) && (FLAG_old_gen_tlab_size > 0)) {
+    addr = old_space_.TryAllocateInTLAB(thread->old_tlab(), size);
+    if (addr != 0) {
+      return addr;
+    }
+  }
+  addr = old_space_.TryAllocate(size, type);
   if (addr != 0) {
     return addr;
   }
   // If we are in the process of running a sweep, wait for the sweeper to free
   // memory.
-  Thread* thread = Thread::Current();
   if (thread->CanCollectGarbage()) {
     // Wait for any GC tasks that are in progress.
     WaitForSweeperTasks(thread);
@@ -426,7 +436,14 @@ void Heap::NotifyIdle(int64_t deadline) {
   // Because we use a deadline instead of a timeout, we automatically take any
   // time used up by a scavenge into account when deciding if we can complete
   // a mark-sweep on time.
-  if (old_space_.ShouldPerformIdleMarkCompact(deadline)) {
+  if (FLAG_idle_gc_slices && PerformIdleSlice(thread, deadline)) {
+    // A slice of the collection in progress used up this idle period, but
+    // old space may still have outgrown its limit, as below.
+    if (old_space_.NeedsGarbageCollection()) {
+      TIMELINE_FUNCTION_GC_DURATION(thread, "IdleGC");
+      CollectOldSpaceGarbage(thread, kMarkSweep, kIdle);
+    }
+  } else if (old_space_.ShouldPerformIdleMarkCompact(deadline)) {
     TIMELINE_FUNCTION_GC_DURATION(thread, "IdleGC");
     CollectOldSpaceGarbage(thread, kMarkCompact, kIdle);
   } else if (old_space_.ShouldPerformIdleMarkSweep(deadline)) {
@@ -440,15 +457,72 @@ void Heap::NotifyIdle(int64_t deadline) {
     // the only place that checks the old space allocation limit.
     // Compare the tail end of Heap::CollectNewSpaceGarbage.
     CollectOldSpaceGarbage(thread, kMarkSweep, kIdle);  // Blocks for O(heap)
+  } else if (FLAG_idle_gc_slices && old_space_.ShouldStartIdleMarking()) {
+    // The collection does not fit in this idle period as a whole: perform it
+    // in slices, starting with this idle period.
+    StartConcurrentMarking(thread);  // Blocks for up to O(roots)
+    PerformIdleSlice(thread, deadline);
   } else {
     CheckStartConcurrentMarking(thread, kIdle);  // Blocks for up to O(roots)
   }
+  if (FLAG_idle_gc_slices) {
+    CompactWeakTables(deadline);
+  }
+}
+
+bool Heap::PerformIdleSlice(Thread* thread, int64_t deadline) {
+  PageSpace::Phase phase;
+  {
+    MonitorLocker ml(old_space_.tasks_lock());
+    phase = old_space_.phase();
+  }
+  if ((phase != PageSpace::kMarking) &&
+      (phase != PageSpace::kAwaitingFinalization)) {
+    return false;
+  }
+  bool performed_work = false;
+  if ((phase == PageSpace::kMarking) &&
+      (OS::GetCurrentMonotonicMicros() < deadline)) {
+    TIMELINE_FUNCTION_GC_DURATION(thread, "IdleGC");
+    performed_work = true;
+    if (!old_space_.IncrementalMarkUntil(deadline)) {
+      return true;
+    }
+    // If the marker tasks have not noticed that the work ran out yet, the
+    // marking is finalized by a later slice.
+  }
+  if (old_space_.ShouldPerformIdleFinalization(deadline)) {
+    TIMELINE_FUNCTION_GC_DURATION(thread, "IdleGC");
+    old_space_.set_idle_sweep_deadline(deadline);
+    CollectOldSpaceGarbage(thread, kMarkSweep, kIdle);
+    old_space_.set_idle_sweep_deadline(0);
+    performed_work = true;
+  }
+  return performed_work;
+}
+
+void Heap::CompactWeakTables(int64_t deadline) {
+  TIMELINE_FUNCTION_GC_DURATION(Thread::Current(), "CompactWeakTables");
+  for (int sel = 0; sel < kNumWeakSelectors; sel++) {
+    if (OS::GetCurrentMonotonicMicros() >= deadline) {
+      return;
+    }
+    const WeakSelector selector = static_cast<WeakSelector>(sel);
+    GetWeakTable(kNew, selector)->Compact();
+    GetWeakTable(kOld, selector)->Compact();
+  }
 }
 
 void Heap::NotifyLowMemory() {
   CollectAllGarbage(kLowMemory);
 }
 
+void Heap::SetPauseTimeGoal(int64_t micros) {
+  ASSERT(micros >= 0);
+  new_space_.set_pause_time_goal_micros(micros);
+  old_space_.SetPauseTimeGoal(micros);
+}
+
 void Heap::EvacuateNewSpace(Thread* thread, GCReason reason) {
   ASSERT((reason != kOldSpace) && (reason != kPromotion));
   if (thread->isolate() == Dart::vm_isolate()) {
@@ -583,11 +657,15 @@ void Heap::CheckStartConcurrentMarking(Thread* thread, GCReason reason) {
   }
 
   if (old_space_.AlmostNeedsGarbageCollection()) {
-    if (BeginOldSpaceGC(thread)) {
-      TIMELINE_FUNCTION_GC_DURATION_BASIC(thread, "StartConcurrentMarking");
-      old_space_.CollectGarbage(/*compact=*/false, /*finalize=*/false);
-      EndOldSpaceGC();
-    }
+    StartConcurrentMarking(thread);
+  }
+}
+
+void Heap::StartConcurrentMarking(Thread* thread) {
+  if (BeginOldSpaceGC(thread)) {
+    TIMELINE_FUNCTION_GC_DURATION_BASIC(thread, "StartConcurrentMarking");
+    old_space_.CollectGarbage(/*compact=*/false, /*finalize=*/false);
+    EndOldSpaceGC();
   }
 }
 
@@ -932,6 +1010,13 @@ void Heap::PrintMemoryUsageJSON(JSONObject* jsobj) const {
   jsobj->AddProperty64("heapCapacity", TotalCapacityInWords() * kWordSize);
   jsobj->AddProperty64("externalUsage", TotalExternalInWords() * kWordSize);
 }
+
+void Heap::PrintGCControllerStateJSON(JSONStream* stream) const {
+  JSONObject obj(stream);
+  obj.AddProperty("type", "_GCControllerState");
+  new_space_.PrintControllerStateToJSONObject(&obj);
+  old_space_.PrintControllerStateToJSONObject(&obj);
+}
 #endif  // PRODUCT
 
 void Heap::RecordBeforeGC(GCType type, GCReason reason) {
@@ -121,6 +121,10 @@ class Heap {
   void NotifyIdle(int64_t deadline);
   void NotifyLowMemory();
 
+  // Asks the growth policies of both generations to keep GC pauses below
+  // 'micros' microseconds, or restores the default policies if 0.
+  void SetPauseTimeGoal(int64_t micros);
+
   // Collect a single generation.
   void CollectGarbage(Space space);
   void CollectGarbage(GCType type, GCReason reason);
@@ -141,6 +145,7 @@ class Heap {
   }
 
   void CheckStartConcurrentMarking(Thread* thread, GCReason reason);
+  void StartConcurrentMarking(Thread* thread);
   void CheckFinishConcurrentMarking(Thread* thread);
   void WaitForMarkerTasks(Thread* thread);
   void WaitForSweeperTasks(Thread* thread);
@@ -284,6 +289,9 @@ class Heap {
   void PrintMemoryUsageJSON(JSONStream* stream) const;
   void PrintMemoryUsageJSON(JSONObject* jsobj) const;
 
+  // Returns the state of the policies sizing new and old space.
+  void PrintGCControllerStateJSON(JSONStream* stream) const;
+
   // The heap map contains the sizes and class ids for the objects in each page.
   void PrintHeapMapToJSONStream(Isolate* isolate, JSONStream* stream) {
     old_space_.PrintHeapMapToJSONStream(isolate, stream);
@@ -291,6 +299,7 @@ class Heap {
 #endif  // PRODUCT
 
   Isolate* isolate() const { return isolate_; }
+  intptr_t numa_node() const { return numa_node_; }
 
   Monitor* barrier() const { return &barrier_; }
   Monitor* barrier_done() const { return &barrier_done_; }
@@ -366,6 +375,10 @@ class Heap {
   bool VerifyGC(MarkExpectation mark_expectation = kForbidMarked) const;
 
   // Helper functions for garbage collection.
+  // Advances an old-space collection that is in progress with a bounded
+  // increment of work. Returns false if no such work was performed.
+  bool PerformIdleSlice(Thread* thread, int64_t deadline);
+  void CompactWeakTables(int64_t deadline);
   void CollectNewSpaceGarbage(Thread* thread, GCReason reason);
   void CollectOldSpaceGarbage(Thread* thread, GCType type, GCReason reason);
   void EvacuateNewSpace(Thread* thread, GCReason reason);
@@ -389,6 +402,9 @@ class Heap {
 
   Isolate* isolate_;
 
+  // NUMA node the spaces are bound to, or -1 if none.
+  const intptr_t numa_node_;
+
   // The different spaces used for allocation.
   Scavenger new_space_;
   PageSpace old_space_;
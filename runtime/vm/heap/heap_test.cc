@@ -14,6 +14,8 @@
 
 namespace dart {
 
+DECLARE_FLAG(int, new_gen_growth_factor);
+
 TEST_CASE(OldGC) {
   const char* kScriptChars =
       "main() {\n"
@@ -785,4 +787,296 @@ ISOLATE_UNIT_TEST_CASE(ArrayTruncationRaces) {
   }
 }
 
+ISOLATE_UNIT_TEST_CASE(CardRememberedArray) {
+  Heap* heap = thread->heap();
+
+  // Large enough to be allocated in old space and remembered by cards.
+  const intptr_t kLength = 1 * MB;
+  const Array& old = Array::Handle(Array::New(kLength, Heap::kOld));
+  EXPECT(old.raw()->IsCardRemembered());
+
+  // A few stores spread over distinct cards; the rest of the cards stay clean.
+  const intptr_t kStride = kLength / 7;
+  Array& neu = Array::Handle();
+  for (intptr_t i = 0; i < kLength; i += kStride) {
+    neu = Array::New(1, Heap::kNew);
+    neu.SetAt(0, Smi::Handle(Smi::New(i)));
+    old.SetAt(i, neu);
+  }
+  neu = Array::null();
+
+  // Survivors are copied by the first scavenge and promoted by the second,
+  // after which no card refers to new space anymore.
+  for (intptr_t round = 0; round < 3; round++) {
+    heap->CollectGarbage(Heap::kNew);
+    for (intptr_t i = 0; i < kLength; i++) {
+      if ((i % kStride) == 0) {
+        neu ^= old.At(i);
+        EXPECT_EQ(i, Smi::Value(Smi::RawCast(neu.At(0))));
+      } else {
+        EXPECT(old.At(i) == Object::null());
+      }
+    }
+  }
+}
+
+ISOLATE_UNIT_TEST_CASE(ParallelScavenge) {
+  const intptr_t saved_scavenger_tasks = FLAG_scavenger_tasks;
+  FLAG_scavenger_tasks = 2;
+  Heap* heap = thread->heap();
+
+  // Old-to-new references are found through the store buffer; new-to-new
+  // references and weak properties through the tasks' work lists.
+  const intptr_t kNumElements = 10000;
+  const Array& old = Array::Handle(Array::New(kNumElements, Heap::kOld));
+  Array& neu = Array::Handle();
+  Integer& mint = Integer::Handle();
+  for (intptr_t i = 0; i < kNumElements; i++) {
+    neu = Array::New(2, Heap::kNew);
+    neu.SetAt(0, Smi::Handle(Smi::New(i)));
+    mint = Integer::New(kMaxInt64 - i, Heap::kNew);
+    neu.SetAt(1, mint);
+    old.SetAt(i, neu);
+  }
+  const WeakProperty& live_weak =
+      WeakProperty::Handle(WeakProperty::New(Heap::kNew));
+  live_weak.set_key(neu);
+  live_weak.set_value(mint);
+  const WeakProperty& dead_weak =
+      WeakProperty::Handle(WeakProperty::New(Heap::kNew));
+  {
+    HANDLESCOPE(thread);
+    dead_weak.set_key(Array::Handle(Array::New(1, Heap::kNew)));
+    dead_weak.set_value(mint);
+  }
+  neu = Array::null();
+  mint = Integer::null();
+
+  // Survivors are copied by the first scavenge and promoted by the second.
+  for (intptr_t round = 0; round < 3; round++) {
+    heap->CollectGarbage(Heap::kNew);
+    for (intptr_t i = 0; i < kNumElements; i++) {
+      neu ^= old.At(i);
+      EXPECT_EQ(i, Smi::Value(Smi::RawCast(neu.At(0))));
+      mint ^= neu.At(1);
+      EXPECT_EQ(kMaxInt64 - i, mint.AsInt64Value());
+    }
+    EXPECT(live_weak.key() == old.At(kNumElements - 1));
+    EXPECT(live_weak.value() != Object::null());
+    EXPECT(dead_weak.key() == Object::null());
+    EXPECT(dead_weak.value() == Object::null());
+  }
+
+  FLAG_scavenger_tasks = saved_scavenger_tasks;
+}
+
+ISOLATE_UNIT_TEST_CASE(ParallelWeakTables) {
+  const intptr_t saved_scavenger_tasks = FLAG_scavenger_tasks;
+  FLAG_scavenger_tasks = 2;
+  Heap* heap = thread->heap();
+  heap->CollectAllGarbage();
+  const int64_t peers_before = heap->PeerCount();
+
+  const intptr_t kNumObjects = 1000;
+  const Array& live = Array::Handle(Array::New(kNumObjects, Heap::kOld));
+  Array& obj = Array::Handle();
+  for (intptr_t i = 0; i < kNumObjects; i++) {
+    obj = Array::New(0, Heap::kNew);
+    heap->SetPeer(obj.raw(), reinterpret_cast<void*>(i + 1));
+    if ((i % 2) == 0) {
+      live.SetAt(i, obj);
+    }
+  }
+  obj = Array::null();
+  EXPECT_EQ(peers_before + kNumObjects, heap->PeerCount());
+
+  // Survivors are copied by the first scavenge and promoted by the second.
+  for (intptr_t round = 0; round < 3; round++) {
+    heap->CollectGarbage(Heap::kNew);
+    EXPECT_EQ(peers_before + kNumObjects / 2, heap->PeerCount());
+  }
+  heap->CollectAllGarbage();
+  EXPECT_EQ(peers_before + kNumObjects / 2, heap->PeerCount());
+  for (intptr_t i = 0; i < kNumObjects; i += 2) {
+    obj ^= live.At(i);
+    EXPECT_EQ(reinterpret_cast<void*>(i + 1), heap->GetPeer(obj.raw()));
+  }
+
+  FLAG_scavenger_tasks = saved_scavenger_tasks;
+}
+
+ISOLATE_UNIT_TEST_CASE(EvacuateSparsePages) {
+  const intptr_t saved_evacuation_threshold = FLAG_evacuation_threshold;
+  const bool saved_concurrent_sweep = FLAG_concurrent_sweep;
+  const bool saved_verify_after_gc = FLAG_verify_after_gc;
+  FLAG_evacuation_threshold = 0;
+  FLAG_concurrent_sweep = false;
+  FLAG_verify_after_gc = true;
+  Heap* heap = thread->heap();
+  heap->CollectAllGarbage();
+
+  // Leave one in twenty objects alive so the sweep records sparse pages.
+  const intptr_t kNumObjects = 20000;
+  const Array& live = Array::Handle(Array::New(kNumObjects, Heap::kOld));
+  Array& obj = Array::Handle();
+  for (intptr_t i = 0; i < kNumObjects; i++) {
+    obj = Array::New(10, Heap::kOld);
+    obj.SetAt(0, Smi::Handle(Smi::New(i)));
+    if ((i % 20) == 0) {
+      live.SetAt(i, obj);
+    }
+  }
+  obj = Array::null();
+  heap->CollectAllGarbage();
+  const int64_t capacity_before = heap->old_space()->CapacityInWords();
+
+  FLAG_evacuation_threshold = 50;
+  heap->CollectAllGarbage();
+  EXPECT_LT(heap->old_space()->CapacityInWords(), capacity_before);
+  for (intptr_t i = 0; i < kNumObjects; i += 20) {
+    obj ^= live.At(i);
+    EXPECT(obj.IsOld());
+    EXPECT_EQ(i, Smi::Value(Smi::RawCast(obj.At(0))));
+  }
+
+  FLAG_evacuation_threshold = saved_evacuation_threshold;
+  FLAG_concurrent_sweep = saved_concurrent_sweep;
+  FLAG_verify_after_gc = saved_verify_after_gc;
+}
+
+ISOLATE_UNIT_TEST_CASE(OldTLAB) {
+  const intptr_t saved_old_gen_tlab_size = FLAG_old_gen_tlab_size;
+  const bool saved_verify_after_gc = FLAG_verify_after_gc;
+  FLAG_old_gen_tlab_size = 32;
+  FLAG_verify_after_gc = true;
+  Heap* heap = thread->heap();
+  heap->CollectAllGarbage();
+  EXPECT(thread->old_tlab()->IsEmpty());
+
+  // Mix sizes covered by the size classes with larger ones.
+  const intptr_t kNumObjects = 5000;
+  const Array& live = Array::Handle(Array::New(kNumObjects, Heap::kOld));
+  Array& obj = Array::Handle();
+  const int64_t used_before = heap->old_space()->UsedInWords();
+  for (intptr_t i = 0; i < kNumObjects; i++) {
+    obj = Array::New(1 + (i % 40), Heap::kOld);
+    obj.SetAt(0, Smi::Handle(Smi::New(i)));
+    live.SetAt(i, obj);
+  }
+  EXPECT(!thread->old_tlab()->IsEmpty());
+  EXPECT_LT(used_before, heap->old_space()->UsedInWords());
+
+  heap->CollectAllGarbage();
+  EXPECT(thread->old_tlab()->IsEmpty());
+  for (intptr_t i = 0; i < kNumObjects; i++) {
+    obj ^= live.At(i);
+    EXPECT(obj.IsOld());
+    EXPECT_EQ(1 + (i % 40), obj.Length());
+    EXPECT_EQ(i, Smi::Value(Smi::RawCast(obj.At(0))));
+  }
+
+  FLAG_old_gen_tlab_size = saved_old_gen_tlab_size;
+  FLAG_verify_after_gc = saved_verify_after_gc;
+}
+
+#if !defined(TARGET_ARCH_IA32)  // Concurrent marking not implemented.
+ISOLATE_UNIT_TEST_CASE(IdleGCSlices) {
+  Heap* heap = thread->heap();
+  if (!heap->old_space()->enable_concurrent_mark() ||
+      (FLAG_marker_tasks == 0)) {
+    return;
+  }
+  heap->CollectAllGarbage();
+  const int64_t peers_before = heap->PeerCount();
+
+  const intptr_t kNumObjects = 10000;
+  const Array& live = Array::Handle(Array::New(kNumObjects, Heap::kOld));
+  Array& obj = Array::Handle();
+  for (intptr_t i = 0; i < kNumObjects; i++) {
+    obj = Array::New(1, Heap::kOld);
+    heap->SetPeer(obj.raw(), reinterpret_cast<void*>(i + 1));
+    if ((i % 2) == 0) {
+      live.SetAt(i, obj);
+    }
+  }
+  obj = Array::null();
+
+  // Nothing but idle notifications finishes the collection.
+  heap->StartConcurrentMarking(thread);
+  EXPECT(heap->old_space()->phase() != PageSpace::kDone);
+  const int64_t kBudgetMicros = 1000;
+  for (intptr_t i = 0; i < 10000; i++) {
+    {
+      MonitorLocker ml(heap->old_space()->tasks_lock());
+      if (heap->old_space()->phase() == PageSpace::kDone) {
+        break;
+      }
+    }
+    heap->NotifyIdle(OS::GetCurrentMonotonicMicros() + kBudgetMicros);
+  }
+  heap->WaitForSweeperTasks(thread);
+  EXPECT_EQ(PageSpace::kDone, heap->old_space()->phase());
+  EXPECT_EQ(peers_before + kNumObjects / 2, heap->PeerCount());
+  for (intptr_t i = 0; i < kNumObjects; i += 2) {
+    obj ^= live.At(i);
+    EXPECT_EQ(reinterpret_cast<void*>(i + 1), heap->GetPeer(obj.raw()));
+  }
+}
+#endif  // !defined(TARGET_ARCH_IA32)
+
+class ScavengerTestHelper {
+ public:
+  // Replaces the stats history with scavenges that took [micros] and found no
+  // garbage in a semi-space of [size_in_words].
+  static void SetRecentPauses(Scavenger* scavenger,
+                              int64_t micros,
+                              intptr_t size_in_words) {
+    SpaceUsage usage;
+    usage.capacity_in_words = size_in_words;
+    usage.used_in_words = size_in_words;
+    for (intptr_t i = 0; i < Scavenger::kStatsHistoryCapacity; i++) {
+      scavenger->stats_history_.Add(
+          ScavengeStats(0, micros, usage, usage, 0, 0, 0));
+    }
+  }
+  static intptr_t NewSizeInWords(Scavenger* scavenger, intptr_t size) {
+    return scavenger->NewSizeInWords(size);
+  }
+};
+
+ISOLATE_UNIT_TEST_CASE(PauseTimeGoal) {
+  Heap* heap = thread->heap();
+  Scavenger* scavenger = heap->new_space();
+  heap->CollectAllGarbage();
+  const intptr_t size = 4 * MBInWords;
+  const int64_t goal = 1000;
+
+  // Without a goal, a semi-space without garbage grows.
+  ScavengerTestHelper::SetRecentPauses(scavenger, 10 * goal, size);
+  EXPECT(!scavenger->ExceedsPauseTimeGoal());
+  const intptr_t grown = ScavengerTestHelper::NewSizeInWords(scavenger, size);
+  EXPECT_GT(grown, size);
+
+  scavenger->set_pause_time_goal_micros(goal);
+
+  // Pauses well below the goal do not change the decision.
+  ScavengerTestHelper::SetRecentPauses(scavenger, goal / 4, size);
+  EXPECT(!scavenger->ExceedsPauseTimeGoal());
+  EXPECT_EQ(grown, ScavengerTestHelper::NewSizeInWords(scavenger, size));
+
+  // Close to the goal, the semi-space is held.
+  ScavengerTestHelper::SetRecentPauses(scavenger, 3 * goal / 4, size);
+  EXPECT(!scavenger->ExceedsPauseTimeGoal());
+  EXPECT_EQ(size, ScavengerTestHelper::NewSizeInWords(scavenger, size));
+
+  // Over the goal, it shrinks.
+  ScavengerTestHelper::SetRecentPauses(scavenger, goal + 1, size);
+  EXPECT(scavenger->ExceedsPauseTimeGoal());
+  EXPECT_EQ(size / FLAG_new_gen_growth_factor,
+            ScavengerTestHelper::NewSizeInWords(scavenger, size));
+
+  scavenger->set_pause_time_goal_micros(0);
+  EXPECT(!scavenger->ExceedsPauseTimeGoal());
+}
+
 }  // namespace dart
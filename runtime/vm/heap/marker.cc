@@ -75,6 +75,14 @@ class MarkerWorkList : public ValueObject {
     marking_stack_ = NULL;
   }
 
+  // Makes the local work available to other markers.
+  void Flush() {
+    if (!work_->IsEmpty()) {
+      marking_stack_->PushBlock(work_);
+      work_ = marking_stack_->PopEmptyBlock();
+    }
+  }
+
  private:
   MarkingStack::Block* work_;
   MarkingStack* marking_stack_;
@@ -167,18 +175,7 @@ class MarkingVisitorBase : public ObjectPointerVisitor {
     do {
       do {
         // First drain the marking stacks.
-        const intptr_t class_id = raw_obj->GetClassId();
-
-        intptr_t size;
-        if (class_id != kWeakPropertyCid) {
-          size = raw_obj->VisitPointersNonvirtual(this);
-        } else {
-          RawWeakProperty* raw_weak = static_cast<RawWeakProperty*>(raw_obj);
-          size = ProcessWeakProperty(raw_weak);
-        }
-        marked_bytes_ += size;
-        NOT_IN_PRODUCT(UpdateLiveOld(class_id, size));
-
+        VisitMarkedObject(raw_obj);
         raw_obj = work_list_.Pop();
       } while (raw_obj != NULL);
 
@@ -191,6 +188,33 @@ class MarkingVisitorBase : public ObjectPointerVisitor {
     } while (raw_obj != NULL);
   }
 
+  // Like DrainMarkingStack, but gives up once 'deadline' has passed. Returns
+  // true if no marking work was left.
+  bool DrainMarkingStackUntil(int64_t deadline) {
+    // Reading the clock after every object would dominate small objects.
+    const uintptr_t kBytesBetweenClockChecks = 64 * KB;
+    uintptr_t next_clock_check = marked_bytes_ + kBytesBetweenClockChecks;
+    RawObject* raw_obj = work_list_.Pop();
+    if ((raw_obj == NULL) && ProcessPendingWeakProperties()) {
+      raw_obj = work_list_.Pop();
+    }
+    while (raw_obj != NULL) {
+      VisitMarkedObject(raw_obj);
+      if (marked_bytes_ >= next_clock_check) {
+        if (OS::GetCurrentMonotonicMicros() >= deadline) {
+          return false;
+        }
+        next_clock_check = marked_bytes_ + kBytesBetweenClockChecks;
+      }
+      raw_obj = work_list_.Pop();
+      if (raw_obj == NULL) {
+        ProcessPendingWeakProperties();
+        raw_obj = work_list_.Pop();
+      }
+    }
+    return true;
+  }
+
   void VisitPointers(RawObject** first, RawObject** last) {
     for (RawObject** current = first; current <= last; current++) {
       MarkObject(*current);
@@ -247,6 +271,10 @@ class MarkingVisitorBase : public ObjectPointerVisitor {
     deferred_work_list_.Finalize();
   }
 
+  // Replaces FinalizeDeferredMarking for a visitor whose work was flushed to
+  // the other markers.
+  void FinalizeFlushedDeferredMarking() { deferred_work_list_.Finalize(); }
+
   // Called when all marking is complete.
   void Finalize() {
     work_list_.Finalize();
@@ -270,7 +298,45 @@ class MarkingVisitorBase : public ObjectPointerVisitor {
     deferred_work_list_.AbandonWork();
   }
 
+  // Hands the unfinished work of this visitor to the other markers, including
+  // the weak properties whose keys are not marked yet; these get rechecked by
+  // whichever marker pops them. The visitor can be used again afterwards.
+  void FlushWork() {
+    RawWeakProperty* cur_weak = delayed_weak_properties_;
+    delayed_weak_properties_ = NULL;
+    while (cur_weak != NULL) {
+      uword next_weak = cur_weak->ptr()->next_;
+      cur_weak->ptr()->next_ = 0;
+      // Its size is counted again by the marker that pops it.
+      const intptr_t size = cur_weak->HeapSize();
+      marked_bytes_ -= size;
+#ifndef PRODUCT
+      class_stats_count_[kWeakPropertyCid] -= 1;
+      class_stats_size_[kWeakPropertyCid] -= size;
+#endif  // !PRODUCT
+      work_list_.Push(cur_weak);
+      cur_weak = reinterpret_cast<RawWeakProperty*>(next_weak);
+    }
+    work_list_.Flush();
+    deferred_work_list_.Flush();
+  }
+
  private:
+  DART_FORCE_INLINE
+  void VisitMarkedObject(RawObject* raw_obj) {
+    const intptr_t class_id = raw_obj->GetClassId();
+
+    intptr_t size;
+    if (class_id != kWeakPropertyCid) {
+      size = raw_obj->VisitPointersNonvirtual(this);
+    } else {
+      RawWeakProperty* raw_weak = static_cast<RawWeakProperty*>(raw_obj);
+      size = ProcessWeakProperty(raw_weak);
+    }
+    marked_bytes_ += size;
+    NOT_IN_PRODUCT(UpdateLiveOld(class_id, size));
+  }
+
   void PushMarked(RawObject* raw_obj) {
     ASSERT(raw_obj->IsHeapObject());
     ASSERT(raw_obj->IsOldObject());
@@ -495,20 +561,63 @@ void GCMarker::IterateWeakRoots(HandleVisitor* visitor) {
   isolate_->VisitWeakPersistentHandles(visitor);
 }
 
-void GCMarker::ProcessWeakTables(PageSpace* page_space) {
+// The old-space weak tables are swept in slices of this many entries, which
+// the marker tasks claim in parallel.
+static const intptr_t kWeakTableSliceSize = 64 * KB;
+
+static intptr_t WeakTableSlices(WeakTable* table) {
+  return (table->size() + kWeakTableSliceSize - 1) / kWeakTableSliceSize;
+}
+
+void GCMarker::ResetWeakTableSlices() {
+  intptr_t slices = 0;
   for (int sel = 0; sel < Heap::kNumWeakSelectors; sel++) {
-    WeakTable* table =
-        heap_->GetWeakTable(Heap::kOld, static_cast<Heap::WeakSelector>(sel));
-    intptr_t size = table->size();
-    for (intptr_t i = 0; i < size; i++) {
+    slices += WeakTableSlices(
+        heap_->GetWeakTable(Heap::kOld, static_cast<Heap::WeakSelector>(sel)));
+  }
+  weak_slices_not_started_ = slices;
+}
+
+void GCMarker::ProcessWeakTables() {
+  TIMELINE_FUNCTION_GC_DURATION(Thread::Current(), "ProcessWeakTables");
+  for (;;) {
+    intptr_t slice =
+        AtomicOperations::FetchAndDecrement(&weak_slices_not_started_) - 1;
+    if (slice < 0) {
+      return;  // No more slices.
+    }
+
+    // Find the table and the range of entries covered by this slice.
+    WeakTable* table = NULL;
+    for (int sel = 0; sel < Heap::kNumWeakSelectors; sel++) {
+      table =
+          heap_->GetWeakTable(Heap::kOld, static_cast<Heap::WeakSelector>(sel));
+      const intptr_t table_slices = WeakTableSlices(table);
+      if (slice < table_slices) {
+        break;
+      }
+      slice -= table_slices;
+    }
+    ASSERT(table != NULL);
+    const intptr_t start = slice * kWeakTableSliceSize;
+    const intptr_t end =
+        Utils::Minimum(start + kWeakTableSliceSize, table->size());
+
+    intptr_t removed = 0;
+    for (intptr_t i = start; i < end; i++) {
       if (table->IsValidEntryAtExclusive(i)) {
         RawObject* raw_obj = table->ObjectAtExclusive(i);
         ASSERT(raw_obj->IsHeapObject());
         if (!raw_obj->IsMarked()) {
-          table->InvalidateAtExclusive(i);
+          table->InvalidateAtExclusiveUncounted(i);
+          removed++;
         }
       }
     }
+    if (removed > 0) {
+      MutexLocker ml(&stats_mutex_);
+      table->RemoveCountExclusive(removed);
+    }
   }
 }
 
@@ -627,7 +736,8 @@ class ParallelMarkTask : public ThreadPool::Task {
       // Phase 2: Weak processing and follow-up marking on main thread.
       barrier_->Sync();
 
-      // Phase 3: Finalize results from all markers (detach code, etc.).
+      // Phase 3: Finalize results from all markers (detach code, etc.) and
+      // sweep the weak tables.
       int64_t stop = OS::GetCurrentMonotonicMicros();
       visitor_->AddMicros(stop - start);
       if (FLAG_log_marker_tasks) {
@@ -635,6 +745,7 @@ class ParallelMarkTask : public ThreadPool::Task {
                   visitor_->marked_bytes(), visitor_->marked_micros());
       }
       marker_->FinalizeResultsFrom(visitor_);
+      marker_->ProcessWeakTables();
 
       delete visitor_;
     }
@@ -760,6 +871,8 @@ GCMarker::GCMarker(Isolate* isolate, Heap* heap)
       heap_(heap),
       marking_stack_(),
       visitors_(),
+      incremental_visitor_(NULL),
+      weak_slices_not_started_(0),
       marked_bytes_(0),
       marked_micros_(0) {
   visitors_ = new SyncMarkingVisitor*[FLAG_marker_tasks];
@@ -777,6 +890,10 @@ GCMarker::~GCMarker() {
       visitors_[i]->AbandonWork();
       delete visitors_[i];
     }
+    if (incremental_visitor_ != NULL) {
+      incremental_visitor_->AbandonWork();
+      delete incremental_visitor_;
+    }
   }
   delete[] visitors_;
 }
@@ -817,12 +934,33 @@ void GCMarker::StartConcurrentMark(PageSpace* page_space) {
   }
 }
 
+bool GCMarker::IncrementalMarkUntil(PageSpace* page_space, int64_t deadline) {
+  ASSERT(isolate_->marking_stack() != NULL);
+  TIMELINE_FUNCTION_GC_DURATION(Thread::Current(), "IncrementalMark");
+  const int64_t start = OS::GetCurrentMonotonicMicros();
+  if (incremental_visitor_ == NULL) {
+    incremental_visitor_ = new SyncMarkingVisitor(
+        isolate_, page_space, &marking_stack_, &deferred_marking_stack_);
+  }
+  const bool done = incremental_visitor_->DrainMarkingStackUntil(deadline);
+  incremental_visitor_->FlushWork();
+  incremental_visitor_->AddMicros(OS::GetCurrentMonotonicMicros() - start);
+  return done;
+}
+
 void GCMarker::MarkObjects(PageSpace* page_space) {
   if (isolate_->marking_stack() != NULL) {
     isolate_->DisableIncrementalBarrier();
   }
 
   Prologue();
+  if (incremental_visitor_ != NULL) {
+    // Its work was flushed at the end of its last increment.
+    incremental_visitor_->FinalizeFlushedDeferredMarking();
+    FinalizeResultsFrom(incremental_visitor_);
+    delete incremental_visitor_;
+    incremental_visitor_ = NULL;
+  }
   {
     Thread* thread = Thread::Current();
     const int num_tasks = FLAG_marker_tasks;
@@ -846,10 +984,13 @@ void GCMarker::MarkObjects(PageSpace* page_space) {
       int64_t stop = OS::GetCurrentMonotonicMicros();
       mark.AddMicros(stop - start);
       FinalizeResultsFrom(&mark);
+      ResetWeakTableSlices();
+      ProcessWeakTables();
     } else {
       ThreadBarrier barrier(num_tasks + 1, heap_->barrier(),
                             heap_->barrier_done());
       ResetRootSlices();
+      ResetWeakTableSlices();
       // Used to coordinate draining among tasks; all start out as 'busy'.
       uintptr_t num_busy = num_tasks;
       // Phase 1: Iterate over roots and drain marking stack in tasks.
@@ -896,10 +1037,11 @@ void GCMarker::MarkObjects(PageSpace* page_space) {
       }
       barrier.Sync();
 
-      // Phase 3: Finalize results from all markers (detach code, etc.).
+      // Phase 3: Finalize results from all markers (detach code, etc.) and
+      // sweep the weak tables.
+      ProcessWeakTables();
       barrier.Exit();
     }
-    ProcessWeakTables(page_space);
     ProcessObjectIdTable();
   }
   Epilogue();
@@ -41,6 +41,11 @@ class GCMarker {
   // Does not required StartConcurrentMark to have been previously called.
   void MarkObjects(PageSpace* page_space);
 
+  // Helps the concurrent marker tasks on the current thread until the marking
+  // queue is empty or 'deadline' has passed. Returns true in the former case.
+  // Only called between StartConcurrentMark and MarkObjects.
+  bool IncrementalMarkUntil(PageSpace* page_space, int64_t deadline);
+
   intptr_t marked_words() const { return marked_bytes_ >> kWordSizeLog2; }
   intptr_t MarkedWordsPerMicro() const;
 
@@ -52,7 +57,8 @@ class GCMarker {
   void IterateWeakRoots(HandleVisitor* visitor);
   template <class MarkingVisitorType>
   void IterateWeakReferences(MarkingVisitorType* visitor);
-  void ProcessWeakTables(PageSpace* page_space);
+  void ResetWeakTableSlices();
+  void ProcessWeakTables();
   void ProcessObjectIdTable();
 
   // Called by anyone: finalize and accumulate stats from 'visitor'.
@@ -64,11 +70,17 @@ class GCMarker {
   MarkingStack marking_stack_;
   MarkingStack deferred_marking_stack_;
   MarkingVisitorBase<true>** visitors_;
+  // Used by IncrementalMarkUntil. Its statistics are merged when marking is
+  // finalized, after the old-space class counters have been reset.
+  MarkingVisitorBase<true>* incremental_visitor_;
 
   Monitor root_slices_monitor_;
   intptr_t root_slices_not_started_;
   intptr_t root_slices_not_finished_;
 
+  // Chunks of the old-space weak tables that no task has swept yet.
+  intptr_t weak_slices_not_started_;
+
   Mutex stats_mutex_;
   uintptr_t marked_bytes_;
   int64_t marked_micros_;
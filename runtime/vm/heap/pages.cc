@@ -44,6 +44,7 @@ DEFINE_FLAG(bool, log_growth, false, "Log PageSpace growth policy decisions.");
 
 HeapPage* HeapPage::Allocate(intptr_t size_in_words,
                              PageType type,
+                             intptr_t numa_node,
                              const char* name) {
 #if defined(TARGET_ARCH_DBC)
   bool executable = false;
@@ -51,8 +52,17 @@ HeapPage* HeapPage::Allocate(intptr_t size_in_words,
   bool executable = type == kExecutable;
 #endif
 
-  VirtualMemory* memory = VirtualMemory::AllocateAligned(
-      size_in_words << kWordSizeLog2, kPageSize, executable, name);
+  const intptr_t size_in_bytes = size_in_words << kWordSizeLog2;
+  VirtualMemory* memory = NULL;
+  if (executable) {
+    memory = VirtualMemory::AllocateAligned(size_in_bytes, kPageSize,
+                                            executable, name);
+  } else {
+    // Large pages may be truncated after allocation.
+    const bool kTruncatable = true;
+    memory = VirtualMemory::AllocateHeap(size_in_bytes, kPageSize, kTruncatable,
+                                         numa_node, name);
+  }
   if (memory == NULL) {
     return NULL;
   }
@@ -122,15 +132,17 @@ void HeapPage::VisitObjectPointers(ObjectPointerVisitor* visitor) const {
   ASSERT(obj_addr == end_addr);
 }
 
-void HeapPage::VisitRememberedCards(ObjectPointerVisitor* visitor) {
-  ASSERT(Thread::Current()->IsAtSafepoint());
+intptr_t HeapPage::VisitRememberedCards(ObjectPointerVisitor* visitor) {
+  ASSERT(Thread::Current()->IsAtSafepoint() ||
+         (Thread::Current()->task_kind() == Thread::kScavengerTask));
   NoSafepointScope no_safepoint;
 
   if (card_table_ == NULL) {
-    return;
+    return 0;
   }
 
-  bool table_is_empty = false;
+  bool table_is_empty = true;
+  intptr_t dirty_cards = 0;
 
   RawArray* obj = static_cast<RawArray*>(RawObject::FromAddr(object_start()));
   ASSERT(obj->IsArray());
@@ -140,7 +152,15 @@ void HeapPage::VisitRememberedCards(ObjectPointerVisitor* visitor) {
 
   const intptr_t size = card_table_size();
   for (intptr_t i = 0; i < size; i++) {
+    // Most cards of a large array are clean: skip them a word at a time. The
+    // card table is allocated with calloc, so word-sized loads are aligned.
+    if (Utils::IsAligned(i, kWordSize) && ((i + kWordSize) <= size) &&
+        (*reinterpret_cast<uword*>(&card_table_[i]) == 0)) {
+      i += kWordSize - 1;
+      continue;
+    }
     if (card_table_[i] != 0) {
+      dirty_cards++;
       RawObject** card_from =
           reinterpret_cast<RawObject**>(this) + (i << kSlotsPerCardLog2);
       RawObject** card_to = reinterpret_cast<RawObject**>(card_from) +
@@ -177,9 +197,13 @@ void HeapPage::VisitRememberedCards(ObjectPointerVisitor* visitor) {
   }
 
   if (table_is_empty) {
+    // No card refers to new space anymore. The write barrier allocates a new
+    // table on the next store of a new object.
     free(card_table_);
     card_table_ = NULL;
   }
+
+  return dirty_cards;
 }
 
 RawObject* HeapPage::FindObject(FindObjectVisitor* visitor) const {
@@ -252,6 +276,8 @@ PageSpace::PageSpace(Heap* heap, intptr_t max_capacity_in_words)
       gc_time_micros_(0),
       collections_(0),
       mark_words_per_micro_(kConservativeInitialMarkSpeed),
+      finalization_micros_(0),
+      idle_sweep_deadline_(0),
       enable_concurrent_mark_(FLAG_concurrent_mark) {
   // We aren't holding the lock but no one can reference us yet.
   UpdateMaxCapacityLocked();
@@ -291,7 +317,9 @@ HeapPage* PageSpace::AllocatePage(HeapPage::PageType type, bool link) {
   char vm_name[kVmNameSize];
   Heap::RegionName(heap_, is_exec ? Heap::kCode : Heap::kOld, vm_name,
                    kVmNameSize);
-  HeapPage* page = HeapPage::Allocate(kPageSizeInWords, type, vm_name);
+  const intptr_t numa_node = (heap_ != NULL) ? heap_->numa_node() : -1;
+  HeapPage* page =
+      HeapPage::Allocate(kPageSizeInWords, type, numa_node, vm_name);
   if (page == NULL) {
     RELEASE_ASSERT(!FLAG_abort_on_oom);
     IncreaseCapacityInWords(-kPageSizeInWords);
@@ -345,7 +373,9 @@ HeapPage* PageSpace::AllocateLargePage(intptr_t size, HeapPage::PageType type) {
   char vm_name[kVmNameSize];
   Heap::RegionName(heap_, is_exec ? Heap::kCode : Heap::kOld, vm_name,
                    kVmNameSize);
-  HeapPage* page = HeapPage::Allocate(page_size_in_words, type, vm_name);
+  const intptr_t numa_node = (heap_ != NULL) ? heap_->numa_node() : -1;
+  HeapPage* page =
+      HeapPage::Allocate(page_size_in_words, type, numa_node, vm_name);
   {
     MutexLocker ml(&pages_lock_);
     if (page == nullptr) {
@@ -668,6 +698,24 @@ void PageSpace::AbandonBumpAllocation() {
   }
 }
 
+void PageSpace::AbandonTLABs(Isolate* isolate) {
+  ASSERT(Thread::Current()->IsAtSafepoint());
+  MonitorLocker ml(isolate->threads_lock(), false);
+  Thread* current = isolate->thread_registry()->active_list();
+  while (current != NULL) {
+    // See Scavenger::AbandonTLABs: threads of other isolates in the group
+    // allocate in their own heaps.
+    if (current->isolate() == isolate) {
+      current->old_tlab()->Abandon();
+    }
+    current = current->next();
+  }
+  Thread* mutator_thread = isolate->mutator_thread();
+  if (mutator_thread != NULL) {
+    mutator_thread->old_tlab()->Abandon();
+  }
+}
+
 void PageSpace::AbandonMarkingForShutdown() {
   delete marker_;
   marker_ = NULL;
@@ -778,11 +826,15 @@ void PageSpace::VisitObjectPointers(ObjectPointerVisitor* visitor) const {
   }
 }
 
-void PageSpace::VisitRememberedCards(ObjectPointerVisitor* visitor) const {
-  ASSERT(Thread::Current()->IsAtSafepoint());
+intptr_t PageSpace::VisitRememberedCards(
+    ObjectPointerVisitor* visitor) const {
+  ASSERT(Thread::Current()->IsAtSafepoint() ||
+         (Thread::Current()->task_kind() == Thread::kScavengerTask));
+  intptr_t dirty_cards = 0;
   for (HeapPage* page = large_pages_; page != NULL; page = page->next()) {
-    page->VisitRememberedCards(visitor);
+    dirty_cards += page->VisitRememberedCards(visitor);
   }
+  return dirty_cards;
 }
 
 RawObject* PageSpace::FindObject(FindObjectVisitor* visitor,
@@ -999,6 +1051,46 @@ bool PageSpace::ShouldPerformIdleMarkCompact(int64_t deadline) {
   return estimated_mark_compact_completion <= deadline;
 }
 
+bool PageSpace::ShouldStartIdleMarking() {
+#if defined(TARGET_ARCH_IA32)
+  return false;  // Barrier not implemented.
+#else
+  if (!enable_concurrent_mark() || (FLAG_marker_tasks == 0)) {
+    return false;
+  }
+  {
+    MonitorLocker locker(tasks_lock());
+    if ((tasks() > 0) || (phase() != kDone)) {
+      return false;
+    }
+  }
+  return page_space_controller_.NeedsIdleGarbageCollection(usage_);
+#endif
+}
+
+bool PageSpace::IncrementalMarkUntil(int64_t deadline) {
+  {
+    MonitorLocker locker(tasks_lock());
+    if (phase() != kMarking) {
+      return true;
+    }
+  }
+  // The marker is only deleted by finalization, which needs a safepoint that
+  // this thread does not reach while marking.
+  ASSERT(marker_ != NULL);
+  return marker_->IncrementalMarkUntil(this, deadline);
+}
+
+bool PageSpace::ShouldPerformIdleFinalization(int64_t deadline) {
+  {
+    MonitorLocker locker(tasks_lock());
+    if (phase() != kAwaitingFinalization) {
+      return false;
+    }
+  }
+  return OS::GetCurrentMonotonicMicros() + finalization_micros_ <= deadline;
+}
+
 void PageSpace::CollectGarbage(bool compact, bool finalize) {
   if (!finalize) {
 #if defined(TARGET_ARCH_IA32)
@@ -1085,6 +1177,7 @@ void PageSpace::CollectGarbageAtSafepoint(bool compact,
   SpaceUsage usage_before = GetCurrentUsage();
 
   // Mark all reachable old-gen objects.
+  const bool finalizing_concurrent_mark = (marker_ != NULL);
   if (marker_ == NULL) {
     ASSERT(phase() == kDone);
     marker_ = new GCMarker(isolate, heap_);
@@ -1108,8 +1201,10 @@ void PageSpace::CollectGarbageAtSafepoint(bool compact,
 
   int64_t mid1 = OS::GetCurrentMonotonicMicros();
 
-  // Abandon the remainder of the bump allocation block.
+  // Abandon the remainder of the bump allocation block and the thread-local
+  // buffers.
   AbandonBumpAllocation();
+  AbandonTLABs(isolate);
   // Reset the freelists and setup sweeping.
   freelist_[HeapPage::kData].Reset();
   freelist_[HeapPage::kExecutable].Reset();
@@ -1166,6 +1261,14 @@ void PageSpace::CollectGarbageAtSafepoint(bool compact,
     mid3 = OS::GetCurrentMonotonicMicros();
   }
 
+  if (finalizing_concurrent_mark) {
+    finalization_micros_ = mid3 - start;
+  }
+
+  if (!compact && (FLAG_evacuation_threshold > 0)) {
+    EvacuateSparsePages(thread);
+  }
+
   if (compact) {
     Compact(thread);
     set_phase(kDone);
@@ -1235,9 +1338,40 @@ void PageSpace::BlockingSweep() {
 }
 
 void PageSpace::ConcurrentSweep(Isolate* isolate) {
+  FreeList* freelist = &freelist_[HeapPage::kData];
+  HeapPage* prev_page = NULL;
+  HeapPage* page = pages_;
+  if (idle_sweep_deadline_ > 0) {
+    // Use the rest of the idle time before handing over to the sweeper task.
+    TIMELINE_FUNCTION_GC_DURATION(Thread::Current(), "IdleSweep");
+    MutexLocker ml(freelist->mutex());
+    GCSweeper sweeper;
+    while ((page != NULL) &&
+           (OS::GetCurrentMonotonicMicros() < idle_sweep_deadline_)) {
+      HeapPage* next_page = page->next();
+      bool page_in_use = sweeper.SweepPage(page, freelist, true);
+      if (page_in_use) {
+        prev_page = page;
+      } else {
+        FreePage(page, prev_page);
+      }
+      page = next_page;
+    }
+    if (page == NULL) {
+      set_phase(kDone);
+      return;
+    }
+  }
   // Start the concurrent sweeper task now.
-  GCSweeper::SweepConcurrent(isolate, pages_, pages_tail_,
-                             &freelist_[HeapPage::kData]);
+  GCSweeper::SweepConcurrent(isolate, prev_page, page, pages_tail_, freelist);
+}
+
+void PageSpace::EvacuateSparsePages(Thread* thread) {
+  TIMELINE_FUNCTION_GC_DURATION(thread, "EvacuateSparsePages");
+  thread->isolate()->set_compaction_in_progress(true);
+  GCCompactor compactor(thread, heap_);
+  compactor.EvacuateSparsePages();
+  thread->isolate()->set_compaction_in_progress(false);
 }
 
 void PageSpace::Compact(Thread* thread) {
@@ -1364,7 +1498,8 @@ PageSpaceController::PageSpaceController(Heap* heap,
       desired_utilization_((100.0 - heap_growth_ratio) / 100.0),
       heap_growth_max_(heap_growth_max),
       garbage_collection_time_ratio_(garbage_collection_time_ratio),
-      idle_gc_threshold_in_words_(0) {
+      idle_gc_threshold_in_words_(0),
+      pause_time_goal_micros_(0) {
   intptr_t grow_heap = heap_growth_max / 2;
   gc_threshold_in_words_ =
       last_usage_.capacity_in_words + (kPageSizeInWords * grow_heap);
@@ -1487,6 +1622,16 @@ void PageSpaceController::EvaluateGarbageCollection(SpaceUsage before,
   }
   heap_->RecordData(PageSpace::kPageGrowth, grow_heap);
 
+  // Pauses over the goal cannot be made shorter by sizing the old generation,
+  // but they can be made rarer: eager tenuring by the scavenger moves work
+  // here, so avoid also paying for it with more frequent old-space GCs.
+  if ((pause_time_goal_micros_ > 0) &&
+      ((history_.MaxDurationMicros() > pause_time_goal_micros_) ||
+       heap_->new_space()->ExceedsPauseTimeGoal())) {
+    grow_heap =
+        Utils::Maximum(grow_heap, static_cast<intptr_t>(heap_growth_max_));
+  }
+
   // Limit shrinkage: allow growth by at least half the pages freed by GC.
   const intptr_t freed_pages =
       (before.CombinedCapacityInWords() - after.CombinedCapacityInWords()) /
@@ -1554,6 +1699,21 @@ void PageSpaceController::RecordUpdate(SpaceUsage before,
   }
 }
 
+#ifndef PRODUCT
+void PageSpaceController::PrintToJSONObject(JSONObject* object) const {
+  JSONObject controller(object, "old");
+  controller.AddProperty("enabled", is_enabled_);
+  controller.AddProperty64("pauseTimeGoalMicros", pause_time_goal_micros_);
+  controller.AddProperty64("recentMaxPauseMicros",
+                           history_.MaxDurationMicros());
+  controller.AddProperty64("threshold", gc_threshold_in_words_ * kWordSize);
+  controller.AddProperty64("idleThreshold",
+                           idle_gc_threshold_in_words_ * kWordSize);
+  controller.AddProperty64("heapGrowthRatio", heap_growth_ratio_);
+  controller.AddProperty64("heapGrowthMaxPages", heap_growth_max_);
+}
+#endif  // !PRODUCT
+
 void PageSpaceGarbageCollectionHistory::AddGarbageCollectionTime(int64_t start,
                                                                  int64_t end) {
   Entry entry;
@@ -1562,6 +1722,15 @@ void PageSpaceGarbageCollectionHistory::AddGarbageCollectionTime(int64_t start,
   history_.Add(entry);
 }
 
+int64_t PageSpaceGarbageCollectionHistory::MaxDurationMicros() const {
+  int64_t result = 0;
+  for (int i = 0; i < history_.Size(); i++) {
+    const Entry& entry = history_.Get(i);
+    result = Utils::Maximum(result, entry.end - entry.start);
+  }
+  return result;
+}
+
 int PageSpaceGarbageCollectionHistory::GarbageCollectionTimeFraction() {
   int64_t gc_time = 0;
   int64_t total_time = 0;
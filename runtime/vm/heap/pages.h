@@ -141,7 +141,9 @@ class HeapPage {
     ASSERT((index >= 0) && (index < card_table_size()));
     card_table_[index] = 1;
   }
-  void VisitRememberedCards(ObjectPointerVisitor* visitor);
+  // Visits the slots covered by dirty cards and cleans the cards that no
+  // longer refer to new space. Returns the number of dirty cards visited.
+  intptr_t VisitRememberedCards(ObjectPointerVisitor* visitor);
 
  private:
   void set_object_end(uword value) {
@@ -149,9 +151,11 @@ class HeapPage {
     object_end_ = value;
   }
 
-  // Returns NULL on OOM.
+  // Returns NULL on OOM. Data pages are bound to numa_node if it is not
+  // negative.
   static HeapPage* Allocate(intptr_t size_in_words,
                             PageType type,
+                            intptr_t numa_node,
                             const char* name);
 
   // Deallocate the virtual memory backing this page. The page pointer to this
@@ -184,6 +188,9 @@ class PageSpaceGarbageCollectionHistory {
 
   int GarbageCollectionTimeFraction();
 
+  // The longest collection in the history.
+  int64_t MaxDurationMicros() const;
+
   bool IsEmpty() const { return history_.Size() == 0; }
 
  private:
@@ -231,6 +238,17 @@ class PageSpaceController {
   void Disable() { is_enabled_ = false; }
   bool is_enabled() { return is_enabled_; }
 
+  // When positive, the heap is grown more eagerly while collections of either
+  // generation take longer than this many microseconds.
+  void set_pause_time_goal_micros(int64_t micros) {
+    ASSERT(micros >= 0);
+    pause_time_goal_micros_ = micros;
+  }
+
+#ifndef PRODUCT
+  void PrintToJSONObject(JSONObject* object) const;
+#endif  // !PRODUCT
+
  private:
   void RecordUpdate(SpaceUsage before, SpaceUsage after, const char* reason);
 
@@ -262,6 +280,9 @@ class PageSpaceController {
   // Start considering idle GC when capacity exceeds this amount.
   intptr_t idle_gc_threshold_in_words_;
 
+  // See set_pause_time_goal_micros().
+  int64_t pause_time_goal_micros_;
+
   PageSpaceGarbageCollectionHistory history_;
 
   DISALLOW_IMPLICIT_CONSTRUCTORS(PageSpaceController);
@@ -329,7 +350,8 @@ class PageSpace {
   void VisitObjectsImagePages(ObjectVisitor* visitor) const;
   void VisitObjectPointers(ObjectPointerVisitor* visitor) const;
 
-  void VisitRememberedCards(ObjectPointerVisitor* visitor) const;
+  // Returns the number of dirty cards visited.
+  intptr_t VisitRememberedCards(ObjectPointerVisitor* visitor) const;
 
   RawObject* FindObject(FindObjectVisitor* visitor,
                         HeapPage::PageType type) const;
@@ -354,6 +376,10 @@ class PageSpace {
 
   bool GrowthControlState() { return page_space_controller_.is_enabled(); }
 
+  void SetPauseTimeGoal(int64_t micros) {
+    page_space_controller_.set_pause_time_goal_micros(micros);
+  }
+
   // Note: Code pages are made executable/non-executable when 'read_only' is
   // true/false, respectively.
   void WriteProtect(bool read_only);
@@ -362,6 +388,21 @@ class PageSpace {
   bool ShouldPerformIdleMarkSweep(int64_t deadline);
   bool ShouldPerformIdleMarkCompact(int64_t deadline);
 
+  // Whether to start concurrent marking for a collection that would not fit
+  // in the idle time as a whole.
+  bool ShouldStartIdleMarking();
+  // Marks on the current thread until concurrent marking has no work left or
+  // 'deadline' has passed. Returns true in the former case.
+  bool IncrementalMarkUntil(int64_t deadline);
+  // Whether finalizing concurrent marking is expected to end before
+  // 'deadline'.
+  bool ShouldPerformIdleFinalization(int64_t deadline);
+  // While non-zero, collections sweep regular pages on the current thread
+  // until this deadline and leave only the rest to the concurrent sweeper.
+  void set_idle_sweep_deadline(int64_t deadline) {
+    idle_sweep_deadline_ = deadline;
+  }
+
   void AddGCTime(int64_t micros) { gc_time_micros_ += micros; }
 
   int64_t gc_time_micros() const { return gc_time_micros_; }
@@ -373,6 +414,9 @@ class PageSpace {
 #ifndef PRODUCT
   void PrintToJSONObject(JSONObject* object) const;
   void PrintHeapMapToJSONStream(Isolate* isolate, JSONStream* stream) const;
+  void PrintControllerStateToJSONObject(JSONObject* object) const {
+    page_space_controller_.PrintToJSONObject(object);
+  }
 #endif  // PRODUCT
 
   void AllocateBlack(intptr_t size) {
@@ -416,6 +460,34 @@ class PageSpace {
   uword TryAllocateDataBumpLocked(intptr_t size);
   // Prefer small freelist blocks, then chip away at the bump block.
   uword TryAllocatePromoLocked(intptr_t size);
+  // As above, but acquires the data lock itself. Used by parallel scavenger
+  // tasks, which do not hold the data lock for the whole scavenge.
+  uword TryAllocatePromo(intptr_t size) {
+    MutexLocker ml(freelist_[HeapPage::kData].mutex());
+    return TryAllocatePromoLocked(size);
+  }
+
+  // Allocates data from a thread-local buffer, refilling it from the data
+  // freelist when needed. Returns 0 for large objects or when the freelist
+  // cannot satisfy the request.
+  uword TryAllocateInTLAB(OldTLAB* tlab, intptr_t size) {
+    if (size >= kAllocatablePageSize) {
+      return 0;
+    }
+    uword result = tlab->TryAllocate(&freelist_[HeapPage::kData], size);
+    if (result != 0) {
+      AtomicOperations::IncrementBy(&(usage_.used_in_words),
+                                    (size >> kWordSizeLog2));
+    }
+    return result;
+  }
+  // Returns the memory cached by the buffer to the data freelist.
+  void ReleaseTLAB(OldTLAB* tlab) {
+    tlab->Release(&freelist_[HeapPage::kData]);
+  }
+  // Drops the old-space buffers of all threads before the freelists are
+  // rebuilt.
+  void AbandonTLABs(Isolate* isolate);
 
   void SetupImagePage(void* pointer, uword size, bool is_executable);
 
@@ -474,6 +546,7 @@ class PageSpace {
                                  int64_t pre_safe_point);
   void BlockingSweep();
   void ConcurrentSweep(Isolate* isolate);
+  void EvacuateSparsePages(Thread* thread);
   void Compact(Thread* thread);
 
   static intptr_t LargePageSizeInWordsFor(intptr_t size);
@@ -531,6 +604,10 @@ class PageSpace {
   intptr_t collections_;
   intptr_t mark_words_per_micro_;
 
+  // Duration of the last finalization of concurrent marking.
+  int64_t finalization_micros_;
+  int64_t idle_sweep_deadline_;
+
   bool enable_concurrent_mark_;
 
   friend class ExclusivePageIterator;
@@ -541,6 +618,7 @@ class PageSpace {
   friend class ConcurrentSweeperTask;
   friend class GCCompactor;
   friend class CompactorTask;
+  friend class CountingPageTable;
 
   DISALLOW_IMPLICIT_CONSTRUCTORS(PageSpace);
 };
@@ -7,6 +7,7 @@
 #include "vm/dart.h"
 #include "vm/dart_api_state.h"
 #include "vm/flag_list.h"
+#include "vm/heap/become.h"
 #include "vm/heap/pointer_block.h"
 #include "vm/heap/safepoint.h"
 #include "vm/heap/verifier.h"
@@ -17,6 +18,8 @@
 #include "vm/object_id_ring.h"
 #include "vm/object_set.h"
 #include "vm/stack_frame.h"
+#include "vm/thread_barrier.h"
+#include "vm/thread_pool.h"
 #include "vm/thread_registry.h"
 #include "vm/timeline.h"
 #include "vm/visitor.h"
@@ -85,19 +88,118 @@ static inline void objcpy(void* dst, const void* src, size_t size) {
   } while (size > 0);
 }
 
-class ScavengerVisitor : public ObjectPointerVisitor {
+// Parallel scavenger tasks copy objects into private buffers of this size
+// carved out of to-space. Objects larger than kLargeCopySize get a chunk of
+// their own instead, which bounds the space lost at the end of each buffer.
+static const intptr_t kCopyBufferSize = 32 * KB;
+static const intptr_t kLargeCopySize = kCopyBufferSize / 8;
+
+class ScavengerWorkList : public ValueObject {
+ public:
+  explicit ScavengerWorkList(ScavengerStack* stack) : stack_(stack) {
+    work_ = (stack_ != NULL) ? stack_->PopEmptyBlock() : NULL;
+  }
+
+  ~ScavengerWorkList() {
+    ASSERT(work_ == NULL);
+    ASSERT(stack_ == NULL);
+  }
+
+  // Returns NULL if no more work was found.
+  RawObject* Pop() {
+    ASSERT(work_ != NULL);
+    if (work_->IsEmpty()) {
+      ScavengerStackBlock* new_work = stack_->PopNonEmptyBlock();
+      if (new_work == NULL) {
+        return NULL;
+      }
+      stack_->PushBlock(work_);
+      work_ = new_work;
+    }
+    return work_->Pop();
+  }
+
+  void Push(RawObject* raw_obj) {
+    if (work_->IsFull()) {
+      // Publish the full block so that idle tasks can steal it.
+      stack_->PushBlock(work_);
+      work_ = stack_->PopEmptyBlock();
+    }
+    work_->Push(raw_obj);
+  }
+
+  void Finalize() {
+    if (work_ != NULL) {
+      ASSERT(work_->IsEmpty());
+      stack_->PushBlock(work_);
+      work_ = NULL;
+    }
+    // Fail fast on attempts to push after finalizing.
+    stack_ = NULL;
+  }
+
+ private:
+  ScavengerStackBlock* work_;
+  ScavengerStack* stack_;
+
+  DISALLOW_COPY_AND_ASSIGN(ScavengerWorkList);
+};
+
+// The serial visitor (parallel = false) copies into the scavenger's to-space
+// directly and relies on Cheney-style scanning of to-space plus the promoted
+// stack to find unvisited objects. The parallel visitor (parallel = true)
+// copies into a private buffer carved out of to-space, installs forwarding
+// pointers with a compare-and-swap, and records every object it copies or
+// promotes on a shared work list from which other tasks may steal.
+template <bool parallel>
+class ScavengerVisitorBase : public ObjectPointerVisitor {
  public:
-  explicit ScavengerVisitor(Isolate* isolate,
-                            Scavenger* scavenger,
-                            SemiSpace* from)
+  ScavengerVisitorBase(Isolate* isolate,
+                       Scavenger* scavenger,
+                       SemiSpace* from,
+                       ScavengerStack* work_stack)
       : ObjectPointerVisitor(isolate),
         thread_(Thread::Current()),
         scavenger_(scavenger),
         from_(from),
         heap_(scavenger->heap_),
         page_space_(scavenger->heap_->old_space()),
+#ifndef PRODUCT
+        num_classes_(parallel ? isolate->shared_class_table()->NumCids() : 0),
+        new_stats_count_(parallel ? new intptr_t[num_classes_] : NULL),
+        new_stats_size_(parallel ? new intptr_t[num_classes_] : NULL),
+        old_stats_count_(parallel ? new intptr_t[num_classes_] : NULL),
+        old_stats_size_(parallel ? new intptr_t[num_classes_] : NULL),
+#endif  // !PRODUCT
+        work_list_(work_stack),
+        copy_top_(0),
+        copy_end_(0),
+        promo_tlab_(),
+        delayed_weak_properties_(NULL),
         bytes_promoted_(0),
-        visiting_old_object_(NULL) {}
+        store_buffer_entries_(0),
+        dirty_cards_(0),
+        visiting_old_object_(NULL) {
+    ASSERT(parallel == (work_stack != NULL));
+#ifndef PRODUCT
+    for (intptr_t i = 0; i < num_classes_; i++) {
+      new_stats_count_[i] = 0;
+      new_stats_size_[i] = 0;
+      old_stats_count_[i] = 0;
+      old_stats_size_[i] = 0;
+    }
+#endif  // !PRODUCT
+  }
+
+  ~ScavengerVisitorBase() {
+    ASSERT(delayed_weak_properties_ == NULL);
+#ifndef PRODUCT
+    delete[] new_stats_count_;
+    delete[] new_stats_size_;
+    delete[] old_stats_count_;
+    delete[] old_stats_size_;
+#endif  // !PRODUCT
+  }
 
   virtual void VisitTypedDataViewPointers(RawTypedDataView* view,
                                           RawObject** first,
@@ -160,8 +262,168 @@ class ScavengerVisitor : public ObjectPointerVisitor {
   }
 
   intptr_t bytes_promoted() const { return bytes_promoted_; }
+  intptr_t store_buffer_entries() const { return store_buffer_entries_; }
+  void AddStoreBufferEntries(intptr_t count) { store_buffer_entries_ += count; }
+  intptr_t dirty_cards() const { return dirty_cards_; }
+  void AddDirtyCards(intptr_t count) { dirty_cards_ += count; }
+
+#ifndef PRODUCT
+  intptr_t num_classes() const { return num_classes_; }
+  intptr_t live_new_count(intptr_t class_id) const {
+    return new_stats_count_[class_id];
+  }
+  intptr_t live_new_size(intptr_t class_id) const {
+    return new_stats_size_[class_id];
+  }
+  intptr_t promoted_count(intptr_t class_id) const {
+    return old_stats_count_[class_id];
+  }
+  intptr_t promoted_size(intptr_t class_id) const {
+    return old_stats_size_[class_id];
+  }
+#endif  // !PRODUCT
+
+  void EnqueueWeakProperty(RawWeakProperty* raw_weak) {
+    ASSERT(raw_weak->IsHeapObject());
+    ASSERT(raw_weak->IsNewObject());
+    ASSERT(raw_weak->IsWeakProperty());
+#if defined(DEBUG)
+    uword raw_addr = RawObject::ToAddr(raw_weak);
+    uword header = *reinterpret_cast<uword*>(raw_addr);
+    ASSERT(!IsForwarding(header));
+#endif  // defined(DEBUG)
+    ASSERT(raw_weak->ptr()->next_ == 0);
+    raw_weak->ptr()->next_ = reinterpret_cast<uword>(delayed_weak_properties_);
+    delayed_weak_properties_ = raw_weak;
+  }
+
+  intptr_t ProcessWeakProperty(RawWeakProperty* raw_weak) {
+    // The fate of the weak property is determined by its key.
+    RawObject* raw_key = raw_weak->ptr()->key_;
+    if (raw_key->IsHeapObject() && raw_key->IsNewObject()) {
+      uword raw_addr = RawObject::ToAddr(raw_key);
+      uword header = ReadHeader(raw_addr);
+      if (!IsForwarding(header)) {
+        // Key is white.  Enqueue the weak property.
+        EnqueueWeakProperty(raw_weak);
+        return raw_weak->HeapSize();
+      }
+    }
+    // Key is gray or black.  Make the weak property black.
+    return raw_weak->VisitPointersNonvirtual(this);
+  }
+
+  // Visits the pending weak properties whose keys have become reachable since
+  // they were enqueued. Returns true if any were visited, which may have
+  // produced more work.
+  bool ProcessPendingWeakProperties() {
+    bool visited = false;
+    RawWeakProperty* cur_weak = delayed_weak_properties_;
+    delayed_weak_properties_ = NULL;
+    while (cur_weak != NULL) {
+      uword next_weak = cur_weak->ptr()->next_;
+      // Promoted weak properties are not enqueued. So we can guarantee that
+      // we do not need to think about store barriers here.
+      ASSERT(cur_weak->IsNewObject());
+      RawObject* raw_key = cur_weak->ptr()->key_;
+      ASSERT(raw_key->IsHeapObject());
+      // Key still points into from space even if the object has been
+      // promoted to old space by now. The key will be updated accordingly
+      // below when VisitPointers is run.
+      ASSERT(raw_key->IsNewObject());
+      uword raw_addr = RawObject::ToAddr(raw_key);
+      ASSERT(from_->Contains(raw_addr));
+      uword header = ReadHeader(raw_addr);
+      // Reset the next pointer in the weak property.
+      cur_weak->ptr()->next_ = 0;
+      if (IsForwarding(header)) {
+        cur_weak->VisitPointersNonvirtual(this);
+        visited = true;
+      } else {
+        EnqueueWeakProperty(cur_weak);
+      }
+      // Advance to next weak property in the queue.
+      cur_weak = reinterpret_cast<RawWeakProperty*>(next_weak);
+    }
+    return visited;
+  }
+
+  // Drains the work list of a parallel scavenge, including the pending weak
+  // properties whose keys were forwarded in the meantime.
+  void ProcessWorkList() {
+    ASSERT(parallel);
+    do {
+      RawObject* raw_obj;
+      while ((raw_obj = work_list_.Pop()) != NULL) {
+        const intptr_t class_id = raw_obj->GetClassId();
+        intptr_t size;
+        if (raw_obj->IsNewObject()) {
+          if (class_id != kWeakPropertyCid) {
+            size = raw_obj->VisitPointersNonvirtual(this);
+          } else {
+            size = ProcessWeakProperty(static_cast<RawWeakProperty*>(raw_obj));
+          }
+          UpdateLiveNew(class_id, size);
+        } else {
+          // Promoted: resolve or copy all objects referred to by it.
+          ASSERT(!raw_obj->IsRemembered());
+          VisitingOldObject(raw_obj);
+          size = raw_obj->VisitPointersNonvirtual(this);
+          VisitingOldObject(NULL);
+          UpdatePromoted(class_id, size);
+          if (raw_obj->IsMarked()) {
+            // Complete our promise from ScavengePointer. See the comment in
+            // Scavenger::ProcessToSpace.
+            thread_->MarkingStackAddObject(raw_obj);
+          }
+        }
+      }
+    } while (ProcessPendingWeakProperties());
+  }
+
+  // Called when all scavenging is complete. The remaining delayed weak
+  // properties do not refer to reachable keys, so we clear their key and
+  // value fields.
+  void Finalize() {
+    RawWeakProperty* cur_weak = delayed_weak_properties_;
+    delayed_weak_properties_ = NULL;
+    while (cur_weak != NULL) {
+      uword next_weak = cur_weak->ptr()->next_;
+      // Reset the next pointer in the weak property.
+      cur_weak->ptr()->next_ = 0;
+
+#if defined(DEBUG)
+      RawObject* raw_key = cur_weak->ptr()->key_;
+      uword raw_addr = RawObject::ToAddr(raw_key);
+      uword header = *reinterpret_cast<uword*>(raw_addr);
+      ASSERT(!IsForwarding(header));
+      ASSERT(raw_key->IsHeapObject());
+      ASSERT(raw_key->IsNewObject());  // Key still points into from space.
+#endif                                 // defined(DEBUG)
+
+      WeakProperty::Clear(cur_weak);
+
+      // Advance to next weak property in the queue.
+      cur_weak = reinterpret_cast<RawWeakProperty*>(next_weak);
+    }
+    if (parallel) {
+      MakeCopyBufferIterable();
+      page_space_->ReleaseTLAB(&promo_tlab_);
+    }
+    work_list_.Finalize();
+  }
 
  private:
+  static uword ReadHeader(uword raw_addr) {
+    uword* header_addr = reinterpret_cast<uword*>(raw_addr);
+    if (parallel) {
+      // Pairs with the compare-and-swap in InstallForwardingPointer, so the
+      // contents of the copy are visible once the forwarding pointer is.
+      return AtomicOperations::LoadAcquire(header_addr);
+    }
+    return *header_addr;
+  }
+
   void UpdateStoreBuffer(RawObject** p, RawObject* obj) {
     ASSERT(obj->IsHeapObject());
     if (FLAG_verify_gc_contains) {
@@ -177,6 +439,92 @@ class ScavengerVisitor : public ObjectPointerVisitor {
     thread_->StoreBufferAddObjectGC(visiting_old_object_);
   }
 
+  uword TryAllocateCopy(intptr_t size) {
+    if (!parallel) {
+      return scavenger_->AllocateGC(size);
+    }
+    if (static_cast<intptr_t>(copy_end_ - copy_top_) >= size) {
+      uword result = copy_top_;
+      copy_top_ += size;
+      return result;
+    }
+    if (size > kLargeCopySize) {
+      intptr_t chunk_size;
+      return scavenger_->TryAllocateCopyBuffer(size, size, &chunk_size);
+    }
+    MakeCopyBufferIterable();
+    intptr_t buffer_size;
+    uword buffer =
+        scavenger_->TryAllocateCopyBuffer(size, kCopyBufferSize, &buffer_size);
+    if (buffer == 0) {
+      return 0;
+    }
+    copy_top_ = buffer + size;
+    copy_end_ = buffer + buffer_size;
+    return buffer;
+  }
+
+  // Gives back a copy that lost the race to forward its original.
+  void UndoCopy(uword addr, intptr_t size) {
+    ASSERT(parallel);
+    if ((addr + size) == copy_top_) {
+      copy_top_ = addr;
+    } else {
+      // A dedicated chunk for a large object. Keep to-space walkable.
+      ForwardingCorpse::AsForwarder(addr, size);
+    }
+  }
+
+  void MakeCopyBufferIterable() {
+    ASSERT(parallel);
+    if (copy_end_ > copy_top_) {
+      // ForwardingCorpse(forwarding to default null) will work as filler.
+      ForwardingCorpse::AsForwarder(copy_top_, copy_end_ - copy_top_);
+      scavenger_->ReleaseCopyBufferTail(copy_top_, copy_end_);
+    }
+    copy_top_ = 0;
+    copy_end_ = 0;
+  }
+
+  uword TryAllocatePromo(intptr_t size) {
+    if (!parallel) {
+      return page_space_->TryAllocatePromoLocked(size);
+    }
+    if (FLAG_old_gen_tlab_size > 0) {
+      uword result = page_space_->TryAllocateInTLAB(&promo_tlab_, size);
+      if (result != 0) {
+        return result;
+      }
+    }
+    return page_space_->TryAllocatePromo(size);
+  }
+
+  // Returns the address the object at 'raw_addr' was forwarded to, which may
+  // differ from 'new_addr' if another task won the race to forward it.
+  uword InstallForwardingPointer(uword raw_addr,
+                                 uword header,
+                                 uword new_addr,
+                                 intptr_t size) {
+    if (!parallel) {
+      ForwardTo(raw_addr, new_addr);
+      return new_addr;
+    }
+    ASSERT((new_addr & kForwardingMask) == 0);
+    uword old_header = AtomicOperations::CompareAndSwapWord(
+        reinterpret_cast<uword*>(raw_addr), header, new_addr | kForwarded);
+    if (old_header == header) {
+      return new_addr;
+    }
+    // Lost the race. Discard our copy and use the winner's.
+    if (RawObject::FromAddr(new_addr)->IsNewObject()) {
+      UndoCopy(new_addr, size);
+    } else {
+      // Unreachable garbage until the next old-space sweep.
+      FreeListElement::AsElement(new_addr, size);
+    }
+    return ForwardedAddr(old_header);
+  }
+
   DART_FORCE_INLINE
   void ScavengePointer(RawObject** p) {
     // ScavengePointer cannot be called recursively.
@@ -191,35 +539,43 @@ class ScavengerVisitor : public ObjectPointerVisitor {
     ASSERT(from_->Contains(raw_addr));
     // Read the header word of the object and determine if the object has
     // already been copied.
-    uword header = *reinterpret_cast<uword*>(raw_addr);
+    uword header = ReadHeader(raw_addr);
     uword new_addr = 0;
     if (IsForwarding(header)) {
       // Get the new location of the object.
       new_addr = ForwardedAddr(header);
     } else {
-      intptr_t size = raw_obj->HeapSize();
+      // Compute the size from the header we read: in a parallel scavenge,
+      // another task may replace it with a forwarding pointer at any time.
+      // The tags occupy the low half of the header word.
+      intptr_t size = raw_obj->HeapSize(static_cast<uint32_t>(header));
       // Check whether object should be promoted.
       if (scavenger_->survivor_end_ <= raw_addr) {
         // Not a survivor of a previous scavenge. Just copy the object into the
         // to space.
-        new_addr = scavenger_->AllocateGC(size);
-      } else {
+        new_addr = TryAllocateCopy(size);
+      }
+      if (new_addr == 0) {
         // TODO(iposva): Experiment with less aggressive promotion. For example
         // a coin toss determines if an object is promoted or whether it should
         // survive in this generation.
         //
-        // This object is a survivor of a previous scavenge. Attempt to promote
-        // the object.
-        new_addr = page_space_->TryAllocatePromoLocked(size);
-        if (new_addr != 0) {
-          // If promotion succeeded then we need to remember it so that it can
-          // be traversed later.
-          scavenger_->PushToPromotedStack(new_addr);
-          bytes_promoted_ += size;
-        } else {
+        // This object is a survivor of a previous scavenge (or, in a parallel
+        // scavenge, to space has been used up by partially filled copy
+        // buffers). Attempt to promote the object.
+        new_addr = TryAllocatePromo(size);
+        if (new_addr == 0) {
           // Promotion did not succeed. Copy into the to space instead.
           scavenger_->failed_to_promote_ = true;
-          new_addr = scavenger_->AllocateGC(size);
+          new_addr = TryAllocateCopy(size);
+          if (parallel && (new_addr == 0)) {
+            // The serial scavenger would still find room in the unused ends
+            // of the copy buffers of this and the other tasks.
+            new_addr = scavenger_->TryAllocateFromCopyBufferTails(size);
+          }
+          if (new_addr == 0) {
+            OUT_OF_MEMORY();
+          }
         }
       }
       // During a scavenge we always succeed to at least copy all of the
@@ -232,7 +588,7 @@ class ScavengerVisitor : public ObjectPointerVisitor {
       RawObject* new_obj = RawObject::FromAddr(new_addr);
       if (new_obj->IsOldObject()) {
         // Promoted: update age/barrier tags.
-        uint32_t tags = new_obj->ptr()->tags_;
+        uint32_t tags = static_cast<uint32_t>(header);
         tags = RawObject::OldBit::update(true, tags);
         tags = RawObject::OldAndNotRememberedBit::update(true, tags);
         tags = RawObject::NewBit::update(false, tags);
@@ -246,12 +602,30 @@ class ScavengerVisitor : public ObjectPointerVisitor {
         new_obj->ptr()->tags_ = tags;
       }
 
-      if (RawObject::IsTypedDataClassId(new_obj->GetClassId())) {
+      const intptr_t cid =
+          RawObject::ClassIdTag::decode(static_cast<uint32_t>(header));
+      if (RawObject::IsTypedDataClassId(cid)) {
         reinterpret_cast<RawTypedData*>(new_obj)->RecomputeDataField();
       }
 
       // Remember forwarding address.
-      ForwardTo(raw_addr, new_addr);
+      uword forwarded_addr =
+          InstallForwardingPointer(raw_addr, header, new_addr, size);
+      if (forwarded_addr == new_addr) {
+        if (new_obj->IsOldObject()) {
+          bytes_promoted_ += size;
+          if (parallel) {
+            work_list_.Push(new_obj);
+          } else {
+            // If promotion succeeded then we need to remember it so that it
+            // can be traversed later.
+            scavenger_->PushToPromotedStack(new_addr);
+          }
+        } else if (parallel) {
+          work_list_.Push(new_obj);
+        }
+      }
+      new_addr = forwarded_addr;
     }
     // Update the reference.
     RawObject* new_obj = RawObject::FromAddr(new_addr);
@@ -262,18 +636,46 @@ class ScavengerVisitor : public ObjectPointerVisitor {
     }
   }
 
+  void UpdateLiveNew(intptr_t class_id, intptr_t size) {
+#ifndef PRODUCT
+    ASSERT(class_id < num_classes_);
+    new_stats_count_[class_id] += 1;
+    new_stats_size_[class_id] += size;
+#endif  // !PRODUCT
+  }
+
+  void UpdatePromoted(intptr_t class_id, intptr_t size) {
+#ifndef PRODUCT
+    ASSERT(class_id < num_classes_);
+    old_stats_count_[class_id] += 1;
+    old_stats_size_[class_id] += size;
+#endif  // !PRODUCT
+  }
+
   Thread* thread_;
   Scavenger* scavenger_;
   SemiSpace* from_;
   Heap* heap_;
   PageSpace* page_space_;
+#ifndef PRODUCT
+  intptr_t num_classes_;
+  intptr_t* new_stats_count_;
+  intptr_t* new_stats_size_;
+  intptr_t* old_stats_count_;
+  intptr_t* old_stats_size_;
+#endif  // !PRODUCT
+  ScavengerWorkList work_list_;
+  uword copy_top_;
+  uword copy_end_;
+  // Promotion buffer of a parallel visitor.
+  OldTLAB promo_tlab_;
   RawWeakProperty* delayed_weak_properties_;
   intptr_t bytes_promoted_;
+  intptr_t store_buffer_entries_;
+  intptr_t dirty_cards_;
   RawObject* visiting_old_object_;
 
-  friend class Scavenger;
-
-  DISALLOW_COPY_AND_ASSIGN(ScavengerVisitor);
+  DISALLOW_COPY_AND_ASSIGN(ScavengerVisitorBase);
 };
 
 class ScavengerWeakVisitor : public HandleVisitor {
@@ -334,8 +736,8 @@ class VerifyStoreBufferPointerVisitor : public ObjectPointerVisitor {
   DISALLOW_COPY_AND_ASSIGN(VerifyStoreBufferPointerVisitor);
 };
 
-SemiSpace::SemiSpace(VirtualMemory* reserved)
-    : reserved_(reserved), region_(NULL, 0) {
+SemiSpace::SemiSpace(VirtualMemory* reserved, intptr_t numa_node)
+    : reserved_(reserved), region_(NULL, 0), numa_node_(numa_node) {
   if (reserved != NULL) {
     region_ = MemoryRegion(reserved_->address(), reserved_->size());
   }
@@ -361,12 +763,15 @@ void SemiSpace::Cleanup() {
   cache_ = NULL;
 }
 
-SemiSpace* SemiSpace::New(intptr_t size_in_words, const char* name) {
+SemiSpace* SemiSpace::New(intptr_t size_in_words,
+                          intptr_t numa_node,
+                          const char* name) {
   SemiSpace* result = nullptr;
   {
     MutexLocker locker(mutex_);
     // TODO(koda): Cache one entry per size.
-    if (cache_ != nullptr && cache_->size_in_words() == size_in_words) {
+    if (cache_ != nullptr && cache_->size_in_words() == size_in_words &&
+        cache_->numa_node_ == numa_node) {
       result = cache_;
       cache_ = nullptr;
     }
@@ -379,12 +784,13 @@ SemiSpace* SemiSpace::New(intptr_t size_in_words, const char* name) {
   }
 
   if (size_in_words == 0) {
-    return new SemiSpace(nullptr);
+    return new SemiSpace(nullptr, numa_node);
   } else {
     intptr_t size_in_bytes = size_in_words << kWordSizeLog2;
-    const bool kExecutable = false;
-    VirtualMemory* memory =
-        VirtualMemory::Allocate(size_in_bytes, kExecutable, name);
+    const bool kTruncatable = false;
+    VirtualMemory* memory = VirtualMemory::AllocateHeap(
+        size_in_bytes, VirtualMemory::PageSize(), kTruncatable, numa_node,
+        name);
     if (memory == nullptr) {
       // TODO(koda): If cache_ is not empty, we could try to delete it.
       return nullptr;
@@ -392,7 +798,7 @@ SemiSpace* SemiSpace::New(intptr_t size_in_words, const char* name) {
 #if defined(DEBUG)
     memset(memory->address(), Heap::kZapByte, size_in_bytes);
 #endif  // defined(DEBUG)
-    return new SemiSpace(memory);
+    return new SemiSpace(memory, numa_node);
   }
 }
 
@@ -431,15 +837,22 @@ Scavenger::Scavenger(Heap* heap,
                      uword object_alignment)
     : heap_(heap),
       max_semi_capacity_in_words_(max_semi_capacity_in_words),
+      pause_time_goal_micros_(0),
       object_alignment_(object_alignment),
       scavenging_(false),
-      delayed_weak_properties_(NULL),
       gc_time_micros_(0),
       collections_(0),
       scavenge_words_per_micro_(kConservativeInitialScavengeSpeed),
       idle_scavenge_threshold_in_words_(0),
       external_size_(0),
-      failed_to_promote_(false) {
+      failed_to_promote_(false),
+      pending_store_buffer_blocks_(NULL),
+      root_slices_not_started_(0),
+      weak_slices_not_started_(0),
+      weak_tables_micros_(0),
+      bytes_promoted_(0),
+      store_buffer_entries_(0),
+      dirty_cards_(0) {
   // Verify assumptions about the first word in objects which the scavenger is
   // going to use for forwarding pointers.
   ASSERT(Object::tags_offset() == 0);
@@ -451,7 +864,8 @@ Scavenger::Scavenger(Heap* heap,
   const intptr_t kVmNameSize = 128;
   char vm_name[kVmNameSize];
   Heap::RegionName(heap_, Heap::kNew, vm_name, kVmNameSize);
-  to_ = SemiSpace::New(initial_semi_capacity_in_words, vm_name);
+  to_ = SemiSpace::New(initial_semi_capacity_in_words, heap_->numa_node(),
+                       vm_name);
   if (to_ == NULL) {
     OUT_OF_MEMORY();
   }
@@ -472,10 +886,36 @@ Scavenger::~Scavenger() {
   to_->Delete();
 }
 
+int64_t Scavenger::RecentMaxPauseMicros() const {
+  int64_t result = 0;
+  for (intptr_t i = 0; i < stats_history_.Size(); i++) {
+    result = Utils::Maximum(result, stats_history_.Get(i).DurationMicros());
+  }
+  return result;
+}
+
 intptr_t Scavenger::NewSizeInWords(intptr_t old_size_in_words) const {
   if (stats_history_.Size() == 0) {
     return old_size_in_words;
   }
+  if (pause_time_goal_micros_ > 0) {
+    const int64_t pause = RecentMaxPauseMicros();
+    if (pause > pause_time_goal_micros_) {
+      // The cost of a scavenge is dominated by the survivors, which shrink
+      // with the semi-space. The new to-space must still be able to hold
+      // everything currently in the from-space.
+      const intptr_t used_in_words = Utils::RoundUp(
+          static_cast<intptr_t>(UsedInWords()), MBInWords);
+      return Utils::Minimum(
+          old_size_in_words,
+          Utils::Maximum(used_in_words,
+                         old_size_in_words / FLAG_new_gen_growth_factor));
+    }
+    if (2 * pause > pause_time_goal_micros_) {
+      // Close to the goal: growing would likely overshoot it.
+      return old_size_in_words;
+    }
+  }
   double garbage = stats_history_.Get(0).ExpectedGarbageFraction();
   if (garbage < (FLAG_new_gen_garbage_threshold / 100.0)) {
     return Utils::Minimum(max_semi_capacity_in_words_,
@@ -498,7 +938,8 @@ SemiSpace* Scavenger::Prologue(Isolate* isolate) {
   const intptr_t kVmNameSize = 128;
   char vm_name[kVmNameSize];
   Heap::RegionName(heap_, Heap::kNew, vm_name, kVmNameSize);
-  to_ = SemiSpace::New(NewSizeInWords(from->size_in_words()), vm_name);
+  to_ = SemiSpace::New(NewSizeInWords(from->size_in_words()),
+                       heap_->numa_node(), vm_name);
   if (to_ == NULL) {
     // TODO(koda): We could try to recover (collect old space, wait for another
     // isolate to finish scavenge, etc.).
@@ -527,12 +968,15 @@ void Scavenger::Epilogue(Isolate* isolate, SemiSpace* from) {
     avg_frac += 0.5 * stats_history_.Get(1).PromoCandidatesSuccessFraction();
     avg_frac /= 1.0 + 0.5;  // Normalize.
   }
-  if (avg_frac < (FLAG_early_tenuring_threshold / 100.0)) {
+  if ((avg_frac < (FLAG_early_tenuring_threshold / 100.0)) &&
+      !ExceedsPauseTimeGoal()) {
     // Remember the limit to which objects have been copied.
     survivor_end_ = top_;
   } else {
     // Move survivor end to the end of the to_ space, making all surviving
-    // objects candidates for promotion next time.
+    // objects candidates for promotion next time. This is also done when
+    // scavenges are over the pause time goal, to avoid copying long-lived
+    // objects more than once.
     survivor_end_ = end_;
   }
 
@@ -612,18 +1056,26 @@ bool Scavenger::ShouldPerformIdleScavenge(int64_t deadline) {
   return estimated_scavenge_completion <= deadline;
 }
 
+StoreBufferBlock* Scavenger::PopPendingStoreBufferBlock() {
+  MutexLocker ml(&store_buffer_lock_);
+  StoreBufferBlock* block = pending_store_buffer_blocks_;
+  if (block != NULL) {
+    pending_store_buffer_blocks_ = block->next();
+  }
+  return block;
+}
+
+template <bool parallel>
 void Scavenger::IterateStoreBuffers(Isolate* isolate,
-                                    ScavengerVisitor* visitor) {
+                                    ScavengerVisitorBase<parallel>* visitor) {
   // Iterating through the store buffers.
-  // Grab the deduplication sets out of the isolate's consolidated store buffer.
-  StoreBufferBlock* pending = isolate->store_buffer()->Blocks();
-  intptr_t total_count = 0;
-  while (pending != NULL) {
-    StoreBufferBlock* next = pending->next();
+  // The deduplication sets were grabbed out of the isolate's consolidated store
+  // buffer before the scavenge started; each visitor claims one at a time.
+  StoreBufferBlock* pending;
+  while ((pending = PopPendingStoreBufferBlock()) != NULL) {
     // Generated code appends to store buffers; tell MemorySanitizer.
     MSAN_UNPOISON(pending, sizeof(*pending));
-    intptr_t count = pending->Count();
-    total_count += count;
+    visitor->AddStoreBufferEntries(pending->Count());
     while (!pending->IsEmpty()) {
       RawObject* raw_object = pending->Pop();
       ASSERT(!raw_object->IsForwardingCorpse());
@@ -635,21 +1087,22 @@ void Scavenger::IterateStoreBuffers(Isolate* isolate,
     pending->Reset();
     // Return the emptied block for recycling (no need to check threshold).
     isolate->store_buffer()->PushBlock(pending, StoreBuffer::kIgnoreThreshold);
-    pending = next;
   }
-
+  // Done iterating through old objects remembered in the store buffers.
   visitor->VisitingOldObject(NULL);
-  heap_->old_space()->VisitRememberedCards(visitor);
+}
 
-  heap_->RecordData(kStoreBufferEntries, total_count);
-  heap_->RecordData(kDataUnused1, 0);
-  heap_->RecordData(kDataUnused2, 0);
-  // Done iterating through old objects remembered in the store buffers.
+template <bool parallel>
+void Scavenger::IterateRememberedCards(
+    Isolate* isolate,
+    ScavengerVisitorBase<parallel>* visitor) {
   visitor->VisitingOldObject(NULL);
+  visitor->AddDirtyCards(heap_->old_space()->VisitRememberedCards(visitor));
 }
 
+template <bool parallel>
 void Scavenger::IterateObjectIdTable(Isolate* isolate,
-                                     ScavengerVisitor* visitor) {
+                                     ScavengerVisitorBase<parallel>* visitor) {
 #ifndef PRODUCT
   if (!FLAG_support_service) {
     return;
@@ -658,27 +1111,40 @@ void Scavenger::IterateObjectIdTable(Isolate* isolate,
 #endif  // !PRODUCT
 }
 
-void Scavenger::IterateRoots(Isolate* isolate, ScavengerVisitor* visitor) {
-#ifdef SUPPORT_TIMELINE
-  Thread* thread = Thread::Current();
-#endif
-  int64_t start = OS::GetCurrentMonotonicMicros();
-  {
-    TIMELINE_FUNCTION_GC_DURATION(thread, "ProcessRoots");
-    isolate->VisitObjectPointers(visitor,
-                                 ValidationPolicy::kDontValidateFrames);
-  }
-  int64_t middle = OS::GetCurrentMonotonicMicros();
-  {
-    TIMELINE_FUNCTION_GC_DURATION(thread, "ProcessRememberedSet");
-    IterateStoreBuffers(isolate, visitor);
+enum RootSlices {
+  kIsolate = 0,
+  kObjectIdRing = 1,
+  kRememberedCards = 2,
+  kNumRootSlices = 3,
+};
+
+template <bool parallel>
+void Scavenger::IterateRoots(Isolate* isolate,
+                             ScavengerVisitorBase<parallel>* visitor) {
+  for (;;) {
+    intptr_t slice =
+        AtomicOperations::FetchAndDecrement(&root_slices_not_started_) - 1;
+    if (slice < 0) {
+      break;  // No more slices.
+    }
+
+    switch (slice) {
+      case kIsolate: {
+        TIMELINE_FUNCTION_GC_DURATION(Thread::Current(), "ProcessRoots");
+        isolate->VisitObjectPointers(visitor,
+                                     ValidationPolicy::kDontValidateFrames);
+        break;
+      }
+      case kObjectIdRing:
+        IterateObjectIdTable(isolate, visitor);
+        break;
+      case kRememberedCards:
+        IterateRememberedCards(isolate, visitor);
+        break;
+      default:
+        UNREACHABLE();
+    }
   }
-  IterateObjectIdTable(isolate, visitor);
-  int64_t end = OS::GetCurrentMonotonicMicros();
-  heap_->RecordData(kToKBAfterStoreBuffer, RoundWordsToKB(UsedInWords()));
-  heap_->RecordTime(kVisitIsolateRoots, middle - start);
-  heap_->RecordTime(kIterateStoreBuffers, end - middle);
-  heap_->RecordTime(kDummyScavengeTime, 0);
 }
 
 bool Scavenger::IsUnreachable(RawObject** p) {
@@ -706,7 +1172,7 @@ void Scavenger::IterateWeakRoots(Isolate* isolate, HandleVisitor* visitor) {
   isolate->VisitWeakPersistentHandles(visitor);
 }
 
-void Scavenger::ProcessToSpace(ScavengerVisitor* visitor) {
+void Scavenger::ProcessToSpace(SerialScavengerVisitor* visitor) {
   Thread* thread = Thread::Current();
   NOT_IN_PRODUCT(auto class_table = visitor->isolate()->shared_class_table());
 
@@ -720,7 +1186,7 @@ void Scavenger::ProcessToSpace(ScavengerVisitor* visitor) {
         size = raw_obj->VisitPointersNonvirtual(visitor);
       } else {
         RawWeakProperty* raw_weak = reinterpret_cast<RawWeakProperty*>(raw_obj);
-        size = ProcessWeakProperty(raw_weak, visitor);
+        size = visitor->ProcessWeakProperty(raw_weak);
       }
       NOT_IN_PRODUCT(class_table->UpdateLiveNewGC(class_id, size));
       resolved_top_ += size;
@@ -752,37 +1218,10 @@ void Scavenger::ProcessToSpace(ScavengerVisitor* visitor) {
       }
       visitor->VisitingOldObject(NULL);
     }
-    {
-      // Finished this round of scavenging. Process the pending weak properties
-      // for which the keys have become reachable. Potentially this adds more
-      // objects to the to space.
-      RawWeakProperty* cur_weak = delayed_weak_properties_;
-      delayed_weak_properties_ = NULL;
-      while (cur_weak != NULL) {
-        uword next_weak = cur_weak->ptr()->next_;
-        // Promoted weak properties are not enqueued. So we can guarantee that
-        // we do not need to think about store barriers here.
-        ASSERT(cur_weak->IsNewObject());
-        RawObject* raw_key = cur_weak->ptr()->key_;
-        ASSERT(raw_key->IsHeapObject());
-        // Key still points into from space even if the object has been
-        // promoted to old space by now. The key will be updated accordingly
-        // below when VisitPointers is run.
-        ASSERT(raw_key->IsNewObject());
-        uword raw_addr = RawObject::ToAddr(raw_key);
-        ASSERT(visitor->from_->Contains(raw_addr));
-        uword header = *reinterpret_cast<uword*>(raw_addr);
-        // Reset the next pointer in the weak property.
-        cur_weak->ptr()->next_ = 0;
-        if (IsForwarding(header)) {
-          cur_weak->VisitPointersNonvirtual(visitor);
-        } else {
-          EnqueueWeakProperty(cur_weak);
-        }
-        // Advance to next weak property in the queue.
-        cur_weak = reinterpret_cast<RawWeakProperty*>(next_weak);
-      }
-    }
+    // Finished this round of scavenging. Process the pending weak properties
+    // for which the keys have become reachable. Potentially this adds more
+    // objects to the to space.
+    visitor->ProcessPendingWeakProperties();
   }
 }
 
@@ -815,110 +1254,72 @@ void Scavenger::UpdateMaxHeapUsage() {
 #endif  // !defined(PRODUCT)
 }
 
-void Scavenger::EnqueueWeakProperty(RawWeakProperty* raw_weak) {
-  ASSERT(raw_weak->IsHeapObject());
-  ASSERT(raw_weak->IsNewObject());
-  ASSERT(raw_weak->IsWeakProperty());
-#if defined(DEBUG)
-  uword raw_addr = RawObject::ToAddr(raw_weak);
-  uword header = *reinterpret_cast<uword*>(raw_addr);
-  ASSERT(!IsForwarding(header));
-#endif  // defined(DEBUG)
-  ASSERT(raw_weak->ptr()->next_ == 0);
-  raw_weak->ptr()->next_ = reinterpret_cast<uword>(delayed_weak_properties_);
-  delayed_weak_properties_ = raw_weak;
-}
-
-uword Scavenger::ProcessWeakProperty(RawWeakProperty* raw_weak,
-                                     ScavengerVisitor* visitor) {
-  // The fate of the weak property is determined by its key.
-  RawObject* raw_key = raw_weak->ptr()->key_;
-  if (raw_key->IsHeapObject() && raw_key->IsNewObject()) {
-    uword raw_addr = RawObject::ToAddr(raw_key);
-    uword header = *reinterpret_cast<uword*>(raw_addr);
-    if (!IsForwarding(header)) {
-      // Key is white.  Enqueue the weak property.
-      EnqueueWeakProperty(raw_weak);
-      return raw_weak->HeapSize();
+static void RehashWeakTable(WeakTable* table,
+                            WeakTable* replacement_new,
+                            WeakTable* replacement_old) {
+  intptr_t size = table->size();
+  for (intptr_t i = 0; i < size; i++) {
+    if (table->IsValidEntryAtExclusive(i)) {
+      RawObject* raw_obj = table->ObjectAtExclusive(i);
+      ASSERT(raw_obj->IsHeapObject());
+      uword raw_addr = RawObject::ToAddr(raw_obj);
+      uword header = *reinterpret_cast<uword*>(raw_addr);
+      if (IsForwarding(header)) {
+        // The object has survived.  Preserve its record.
+        uword new_addr = ForwardedAddr(header);
+        raw_obj = RawObject::FromAddr(new_addr);
+        auto replacement =
+            raw_obj->IsNewObject() ? replacement_new : replacement_old;
+        replacement->SetValueExclusive(raw_obj, table->ValueAtExclusive(i));
+      }
     }
   }
-  // Key is gray or black.  Make the weak property black.
-  return raw_weak->VisitPointersNonvirtual(visitor);
 }
 
-void Scavenger::ProcessWeakReferences() {
-  auto rehash_weak_table = [](WeakTable* table, WeakTable* replacement_new,
-                              WeakTable* replacement_old) {
-    intptr_t size = table->size();
-    for (intptr_t i = 0; i < size; i++) {
-      if (table->IsValidEntryAtExclusive(i)) {
-        RawObject* raw_obj = table->ObjectAtExclusive(i);
-        ASSERT(raw_obj->IsHeapObject());
-        uword raw_addr = RawObject::ToAddr(raw_obj);
-        uword header = *reinterpret_cast<uword*>(raw_addr);
-        if (IsForwarding(header)) {
-          // The object has survived.  Preserve its record.
-          uword new_addr = ForwardedAddr(header);
-          raw_obj = RawObject::FromAddr(new_addr);
-          auto replacement =
-              raw_obj->IsNewObject() ? replacement_new : replacement_old;
-          replacement->SetValueExclusive(raw_obj, table->ValueAtExclusive(i));
-        }
-      }
-    }
-  };
+void Scavenger::ProcessWeakTables() {
+  TIMELINE_FUNCTION_GC_DURATION(Thread::Current(), "ProcessWeakTables");
+  int64_t start = OS::GetCurrentMonotonicMicros();
 
   // Rehash the weak tables now that we know which objects survive this cycle.
-  for (int sel = 0; sel < Heap::kNumWeakSelectors; sel++) {
-    const auto selector = static_cast<Heap::WeakSelector>(sel);
-    auto table = heap_->GetWeakTable(Heap::kNew, selector);
-    auto table_old = heap_->GetWeakTable(Heap::kOld, selector);
-
-    // Create a new weak table for the new-space.
-    auto table_new = WeakTable::NewFrom(table);
-    rehash_weak_table(table, table_new, table_old);
-    heap_->SetWeakTable(Heap::kNew, selector, table_new);
-
-    // Remove the old table as it has been replaced with the newly allocated
-    // table above.
-    delete table;
-  }
-
-  // Each isolate might have a weak table used for fast snapshot writing (i.e.
-  // isolate communication). Rehash those tables if need be.
-  auto isolate = heap_->isolate();
-  auto table = isolate->forward_table_new();
-  if (table != NULL) {
-    auto replacement = WeakTable::NewFrom(table);
-    rehash_weak_table(table, replacement, isolate->forward_table_old());
-    isolate->set_forward_table_new(replacement);
-  }
-
-  // The queued weak properties at this point do not refer to reachable keys,
-  // so we clear their key and value fields.
-  {
-    RawWeakProperty* cur_weak = delayed_weak_properties_;
-    delayed_weak_properties_ = NULL;
-    while (cur_weak != NULL) {
-      uword next_weak = cur_weak->ptr()->next_;
-      // Reset the next pointer in the weak property.
-      cur_weak->ptr()->next_ = 0;
+  // Each slice rehashes one new-space table into a replacement and into the
+  // corresponding old-space table, which no other slice touches, so scavenger
+  // tasks can claim the slices in parallel.
+  for (;;) {
+    intptr_t slice =
+        AtomicOperations::FetchAndDecrement(&weak_slices_not_started_) - 1;
+    if (slice < 0) {
+      break;  // No more slices.
+    }
 
-#if defined(DEBUG)
-      RawObject* raw_key = cur_weak->ptr()->key_;
-      uword raw_addr = RawObject::ToAddr(raw_key);
-      uword header = *reinterpret_cast<uword*>(raw_addr);
-      ASSERT(!IsForwarding(header));
-      ASSERT(raw_key->IsHeapObject());
-      ASSERT(raw_key->IsNewObject());  // Key still points into from space.
-#endif                                 // defined(DEBUG)
+    if (slice < Heap::kNumWeakSelectors) {
+      const auto selector = static_cast<Heap::WeakSelector>(slice);
+      auto table = heap_->GetWeakTable(Heap::kNew, selector);
+      auto table_old = heap_->GetWeakTable(Heap::kOld, selector);
 
-      WeakProperty::Clear(cur_weak);
+      // Create a new weak table for the new-space.
+      auto table_new = WeakTable::NewFrom(table);
+      RehashWeakTable(table, table_new, table_old);
+      heap_->SetWeakTable(Heap::kNew, selector, table_new);
 
-      // Advance to next weak property in the queue.
-      cur_weak = reinterpret_cast<RawWeakProperty*>(next_weak);
+      // Remove the old table as it has been replaced with the newly allocated
+      // table above.
+      delete table;
+    } else {
+      ASSERT(slice == Heap::kNumWeakSelectors);
+      // Each isolate might have a weak table used for fast snapshot writing
+      // (i.e. isolate communication). Rehash those tables if need be.
+      auto isolate = heap_->isolate();
+      auto table = isolate->forward_table_new();
+      if (table != NULL) {
+        auto replacement = WeakTable::NewFrom(table);
+        RehashWeakTable(table, replacement, isolate->forward_table_old());
+        isolate->set_forward_table_new(replacement);
+      }
     }
   }
+
+  int64_t end = OS::GetCurrentMonotonicMicros();
+  AtomicOperations::IncrementInt64By(&weak_tables_micros_, end - start);
 }
 
 void Scavenger::MakeNewSpaceIterable() const {
@@ -1041,6 +1442,298 @@ uword Scavenger::TryAllocateNewTLAB(Thread* thread, intptr_t size) {
   return result;
 }
 
+uword Scavenger::TryAllocateCopyBuffer(intptr_t min_size,
+                                       intptr_t preferred_size,
+                                       intptr_t* size) {
+  ASSERT(Utils::IsAligned(min_size, kObjectAlignment));
+  ASSERT(Utils::IsAligned(preferred_size, kObjectAlignment));
+  ASSERT(scavenging_);
+  MutexLocker ml(&space_lock_);
+  uword result = top_;
+  intptr_t remaining = end_ - top_;
+  if (remaining < min_size) {
+    return 0;
+  }
+  intptr_t chunk_size = Utils::Minimum(remaining, preferred_size);
+  chunk_size = Utils::RoundDown(chunk_size, kObjectAlignment);
+  ASSERT(chunk_size >= min_size);
+  ASSERT(to_->Contains(result));
+  ASSERT((result & kObjectAlignmentMask) == object_alignment_);
+  top_ += chunk_size;
+  ASSERT(to_->Contains(top_) || (top_ == to_->end()));
+  *size = chunk_size;
+  return result;
+}
+
+void Scavenger::ReleaseCopyBufferTail(uword start, uword end) {
+  ASSERT(scavenging_);
+  MutexLocker ml(&space_lock_);
+  copy_buffer_tails_.Add(start);
+  copy_buffer_tails_.Add(end);
+}
+
+uword Scavenger::TryAllocateFromCopyBufferTails(intptr_t size) {
+  ASSERT(Utils::IsAligned(size, kObjectAlignment));
+  ASSERT(scavenging_);
+  MutexLocker ml(&space_lock_);
+  for (intptr_t i = 0; i < copy_buffer_tails_.length(); i += 2) {
+    const uword start = copy_buffer_tails_[i];
+    const uword end = copy_buffer_tails_[i + 1];
+    if (static_cast<intptr_t>(end - start) < size) {
+      continue;
+    }
+    if (static_cast<intptr_t>(end - start) > size) {
+      // Keep to space walkable.
+      ForwardingCorpse::AsForwarder(start + size, end - start - size);
+      copy_buffer_tails_[i] = start + size;
+    } else {
+      const uword last_end = copy_buffer_tails_.RemoveLast();
+      const uword last_start = copy_buffer_tails_.RemoveLast();
+      if (i < copy_buffer_tails_.length()) {
+        copy_buffer_tails_[i] = last_start;
+        copy_buffer_tails_[i + 1] = last_end;
+      }
+    }
+    return start;
+  }
+  return 0;
+}
+
+class ParallelScavengerTask : public ThreadPool::Task {
+ public:
+  ParallelScavengerTask(Scavenger* scavenger,
+                        Isolate* isolate,
+                        SemiSpace* from,
+                        ScavengerStack* work_stack,
+                        ThreadBarrier* barrier,
+                        uintptr_t* num_busy)
+      : scavenger_(scavenger),
+        isolate_(isolate),
+        from_(from),
+        work_stack_(work_stack),
+        barrier_(barrier),
+        num_busy_(num_busy) {}
+
+  virtual void Run() {
+    bool result =
+        Thread::EnterIsolateAsHelper(isolate_, Thread::kScavengerTask, true);
+    ASSERT(result);
+    {
+      TIMELINE_FUNCTION_GC_DURATION(Thread::Current(), "ParallelScavenge");
+      // The visitor adds to the store buffer and marking stack blocks of the
+      // current thread, so it must be created on the task's thread.
+      ParallelScavengerVisitor visitor(isolate_, scavenger_, from_,
+                                       work_stack_);
+
+      // Phase 1: Iterate over roots and drain the work list in tasks.
+      scavenger_->IterateRoots(isolate_, &visitor);
+      scavenger_->IterateStoreBuffers(isolate_, &visitor);
+
+      bool more_to_scavenge = false;
+      do {
+        do {
+          visitor.ProcessWorkList();
+
+          // I can't find more work right now. If no other task is busy,
+          // then there will never be more work (NB: 1 is *before* decrement).
+          if (AtomicOperations::FetchAndDecrement(num_busy_) == 1) break;
+
+          // Wait for some work to appear.
+          while (work_stack_->IsEmpty() &&
+                 AtomicOperations::LoadRelaxed(num_busy_) > 0) {
+          }
+
+          // If no tasks are busy, there will never be more work.
+          if (AtomicOperations::LoadRelaxed(num_busy_) == 0) break;
+
+          // I saw some work; get busy and compete for it.
+          AtomicOperations::FetchAndIncrement(num_busy_);
+        } while (true);
+        // Wait for all scavengers to stop.
+        barrier_->Sync();
+#if defined(DEBUG)
+        ASSERT(AtomicOperations::LoadRelaxed(num_busy_) == 0);
+        // Caveat: must not allow any scavenger to continue past the barrier
+        // before we checked num_busy, otherwise one of them might rush
+        // ahead and increment it.
+        barrier_->Sync();
+#endif
+        // Check if we have any pending properties with forwarded keys.
+        // Those might have been forwarded by another scavenger.
+        more_to_scavenge = visitor.ProcessPendingWeakProperties();
+        if (more_to_scavenge) {
+          // We have more work to do. Notify others.
+          AtomicOperations::FetchAndIncrement(num_busy_);
+        }
+
+        // Wait for all other scavengers to finish processing their pending
+        // weak properties and decide if they need to continue scavenging.
+        // Caveat: we need two barriers here to make this decision in lock step
+        // between all scavengers and the main thread.
+        barrier_->Sync();
+        if (!more_to_scavenge &&
+            (AtomicOperations::LoadRelaxed(num_busy_) > 0)) {
+          // All scavengers continue to scavenge as long as any single
+          // scavenger has some work to do.
+          AtomicOperations::FetchAndIncrement(num_busy_);
+          more_to_scavenge = true;
+        }
+        barrier_->Sync();
+      } while (more_to_scavenge);
+
+      // Phase 2: Weak processing on main thread.
+      barrier_->Sync();
+
+      // Phase 3: Clear unreachable weak properties, give back the unused part
+      // of the copy buffer, merge the statistics and rehash the weak tables.
+      visitor.Finalize();
+      scavenger_->FinalizeResultsFrom(&visitor);
+      scavenger_->ProcessWeakTables();
+    }
+    Thread::ExitIsolateAsHelper(true);
+
+    // This task is done. Notify the original thread.
+    barrier_->Exit();
+  }
+
+ private:
+  Scavenger* scavenger_;
+  Isolate* isolate_;
+  SemiSpace* from_;
+  ScavengerStack* work_stack_;
+  ThreadBarrier* barrier_;
+  uintptr_t* num_busy_;
+
+  DISALLOW_COPY_AND_ASSIGN(ParallelScavengerTask);
+};
+
+void Scavenger::FinalizeResultsFrom(ParallelScavengerVisitor* visitor) {
+  MutexLocker ml(&stats_mutex_);
+  bytes_promoted_ += visitor->bytes_promoted();
+  store_buffer_entries_ += visitor->store_buffer_entries();
+  dirty_cards_ += visitor->dirty_cards();
+#ifndef PRODUCT
+  SharedClassTable* class_table = heap_->isolate()->shared_class_table();
+  for (intptr_t cid = 0; cid < visitor->num_classes(); cid++) {
+    if (visitor->live_new_count(cid) > 0) {
+      class_table->UpdateLiveNewGC(cid, visitor->live_new_size(cid),
+                                   visitor->live_new_count(cid));
+    }
+    if (visitor->promoted_count(cid) > 0) {
+      class_table->UpdateAllocatedOldGC(cid, visitor->promoted_size(cid),
+                                        visitor->promoted_count(cid));
+    }
+  }
+#endif  // !PRODUCT
+}
+
+void Scavenger::SerialScavenge(SemiSpace* from) {
+  Thread* thread = Thread::Current();
+  Isolate* isolate = heap_->isolate();
+  PageSpace* page_space = heap_->old_space();
+
+  int64_t start = OS::GetCurrentMonotonicMicros();
+  SerialScavengerVisitor visitor(isolate, this, from, NULL);
+  page_space->AcquireDataLock();
+  IterateRoots(isolate, &visitor);
+  int64_t middle = OS::GetCurrentMonotonicMicros();
+  {
+    TIMELINE_FUNCTION_GC_DURATION(thread, "ProcessRememberedSet");
+    IterateStoreBuffers(isolate, &visitor);
+  }
+  int64_t iterate_roots = OS::GetCurrentMonotonicMicros();
+  heap_->RecordData(kToKBAfterStoreBuffer, RoundWordsToKB(UsedInWords()));
+  {
+    TIMELINE_FUNCTION_GC_DURATION(thread, "ProcessToSpace");
+    ProcessToSpace(&visitor);
+  }
+  int64_t process_to_space = OS::GetCurrentMonotonicMicros();
+  {
+    TIMELINE_FUNCTION_GC_DURATION(thread, "ProcessWeakHandles");
+    ScavengerWeakVisitor weak_visitor(thread, this);
+    IterateWeakRoots(isolate, &weak_visitor);
+  }
+  ProcessWeakTables();
+  visitor.Finalize();
+  page_space->ReleaseDataLock();
+  int64_t end = OS::GetCurrentMonotonicMicros();
+
+  heap_->RecordTime(kVisitIsolateRoots, middle - start);
+  heap_->RecordTime(kIterateStoreBuffers, iterate_roots - middle);
+  heap_->RecordTime(kProcessToSpace, process_to_space - iterate_roots);
+  heap_->RecordTime(kIterateWeaks, end - process_to_space);
+  bytes_promoted_ = visitor.bytes_promoted();
+  store_buffer_entries_ = visitor.store_buffer_entries();
+  dirty_cards_ = visitor.dirty_cards();
+}
+
+void Scavenger::ParallelScavenge(SemiSpace* from) {
+  Thread* thread = Thread::Current();
+  Isolate* isolate = heap_->isolate();
+  const intptr_t num_tasks = FLAG_scavenger_tasks;
+  ASSERT(num_tasks > 0);
+
+  int64_t start = OS::GetCurrentMonotonicMicros();
+  int64_t process_to_space;
+  // Objects copied or promoted by the tasks whose slots still need visiting.
+  ScavengerStack work_stack;
+  {
+    ThreadBarrier barrier(num_tasks + 1, heap_->barrier(),
+                          heap_->barrier_done());
+    // Used to coordinate draining among tasks; all start out as 'busy'.
+    uintptr_t num_busy = num_tasks;
+    // Phase 1: Iterate over roots and drain the work list in tasks.
+    for (intptr_t i = 0; i < num_tasks; i++) {
+      bool result = Dart::thread_pool()->Run<ParallelScavengerTask>(
+          this, isolate, from, &work_stack, &barrier, &num_busy);
+      ASSERT(result);
+    }
+    bool more_to_scavenge = false;
+    do {
+      // Wait for all scavengers to stop.
+      barrier.Sync();
+#if defined(DEBUG)
+      ASSERT(AtomicOperations::LoadRelaxed(&num_busy) == 0);
+      // Caveat: must not allow any scavenger to continue past the barrier
+      // before we checked num_busy, otherwise one of them might rush
+      // ahead and increment it.
+      barrier.Sync();
+#endif
+
+      // Wait for all scavengers to go through weak properties and verify
+      // that there are no more objects to scavenge.
+      // Note: we need to have two barriers here because we want all
+      // scavengers and main thread to make decisions in lock step.
+      barrier.Sync();
+      more_to_scavenge = AtomicOperations::LoadRelaxed(&num_busy) > 0;
+      barrier.Sync();
+    } while (more_to_scavenge);
+    process_to_space = OS::GetCurrentMonotonicMicros();
+
+    // Phase 2: Weak processing on main thread.
+    {
+      TIMELINE_FUNCTION_GC_DURATION(thread, "ProcessWeakHandles");
+      ScavengerWeakVisitor weak_visitor(thread, this);
+      IterateWeakRoots(isolate, &weak_visitor);
+    }
+    barrier.Sync();
+
+    // Phase 3: Finalize results from all scavengers and rehash the weak
+    // tables.
+    ProcessWeakTables();
+    barrier.Exit();
+  }
+  int64_t end = OS::GetCurrentMonotonicMicros();
+
+  // Roots, store buffers and to-space are processed concurrently by the
+  // tasks, so only the combined time is recorded.
+  heap_->RecordData(kToKBAfterStoreBuffer, 0);
+  heap_->RecordTime(kVisitIsolateRoots, 0);
+  heap_->RecordTime(kIterateStoreBuffers, 0);
+  heap_->RecordTime(kProcessToSpace, process_to_space - start);
+  heap_->RecordTime(kIterateWeaks, end - process_to_space);
+}
+
 void Scavenger::Scavenge() {
   Isolate* isolate = heap_->isolate();
   // Ensure that all threads for this isolate are at a safepoint (either stopped
@@ -1059,8 +1752,8 @@ void Scavenger::Scavenge() {
   scavenging_ = true;
 
   failed_to_promote_ = false;
+  copy_buffer_tails_.Clear();
 
-  PageSpace* page_space = heap_->old_space();
   NoSafepointScope no_safepoints;
 
   int64_t safe_point = OS::GetCurrentMonotonicMicros();
@@ -1082,31 +1775,34 @@ void Scavenger::Scavenge() {
   // depend on zone allocations surviving beyond the epilogue callback.
   {
     StackZone zone(thread);
-    // Setup the visitor and run the scavenge.
-    ScavengerVisitor visitor(isolate, this, from);
-    page_space->AcquireDataLock();
-    IterateRoots(isolate, &visitor);
-    int64_t iterate_roots = OS::GetCurrentMonotonicMicros();
-    {
-      TIMELINE_FUNCTION_GC_DURATION(thread, "ProcessToSpace");
-      ProcessToSpace(&visitor);
-    }
-    int64_t process_to_space = OS::GetCurrentMonotonicMicros();
-    {
-      TIMELINE_FUNCTION_GC_DURATION(thread, "ProcessWeakHandles");
-      ScavengerWeakVisitor weak_visitor(thread, this);
-      IterateWeakRoots(isolate, &weak_visitor);
+    // Grab the deduplication sets out of the isolate's consolidated store
+    // buffer. They are claimed one at a time by the visitors.
+    pending_store_buffer_blocks_ = isolate->store_buffer()->Blocks();
+    root_slices_not_started_ = kNumRootSlices;
+    // One slice per weak selector, plus one for the isolate's forward table.
+    weak_slices_not_started_ = Heap::kNumWeakSelectors + 1;
+    weak_tables_micros_ = 0;
+    bytes_promoted_ = 0;
+    store_buffer_entries_ = 0;
+    dirty_cards_ = 0;
+
+    // Run the scavenge.
+    if (FLAG_scavenger_tasks == 0) {
+      SerialScavenge(from);
+    } else {
+      ParallelScavenge(from);
     }
-    ProcessWeakReferences();
-    page_space->ReleaseDataLock();
+    ASSERT(pending_store_buffer_blocks_ == NULL);
 
     // Scavenge finished. Run accounting.
     int64_t end = OS::GetCurrentMonotonicMicros();
-    heap_->RecordTime(kProcessToSpace, process_to_space - iterate_roots);
-    heap_->RecordTime(kIterateWeaks, end - process_to_space);
+    heap_->RecordTime(kDummyScavengeTime, 0);
+    heap_->RecordData(kStoreBufferEntries, store_buffer_entries_);
+    heap_->RecordData(kDirtyCards, dirty_cards_);
+    heap_->RecordData(kWeakTablesMicros, weak_tables_micros_);
     stats_history_.Add(ScavengeStats(
         start, end, usage_before, GetCurrentUsage(), promo_candidate_words,
-        visitor.bytes_promoted() >> kWordSizeLog2));
+        bytes_promoted_ >> kWordSizeLog2, weak_tables_micros_));
   }
   Epilogue(isolate, from);
 
@@ -1155,6 +1851,16 @@ void Scavenger::PrintToJSONObject(JSONObject* object) const {
   space.AddProperty64("external", ExternalInWords() * kWordSize);
   space.AddProperty("time", MicrosecondsToSeconds(gc_time_micros()));
 }
+
+void Scavenger::PrintControllerStateToJSONObject(JSONObject* object) const {
+  JSONObject controller(object, "new");
+  controller.AddProperty64("pauseTimeGoalMicros", pause_time_goal_micros_);
+  controller.AddProperty64("recentMaxPauseMicros", RecentMaxPauseMicros());
+  controller.AddProperty64("semiSpaceCapacity", CapacityInWords() * kWordSize);
+  controller.AddProperty64("maxSemiSpaceCapacity",
+                           max_semi_capacity_in_words_ * kWordSize);
+  controller.AddProperty("tenureAllSurvivors", survivor_end_ == end_);
+}
 #endif  // !PRODUCT
 
 void Scavenger::AllocateExternal(intptr_t cid, intptr_t size) {
@@ -6,10 +6,13 @@
 #define RUNTIME_VM_HEAP_SCAVENGER_H_
 
 #include "platform/assert.h"
+#include "platform/atomic.h"
 #include "platform/utils.h"
 #include "vm/dart.h"
 #include "vm/flags.h"
 #include "vm/globals.h"
+#include "vm/growable_array.h"
+#include "vm/heap/pointer_block.h"
 #include "vm/heap/spaces.h"
 #include "vm/lockers.h"
 #include "vm/raw_object.h"
@@ -24,7 +27,10 @@ class Heap;
 class Isolate;
 class JSONObject;
 class ObjectSet;
-class ScavengerVisitor;
+template <bool parallel>
+class ScavengerVisitorBase;
+typedef ScavengerVisitorBase<false> SerialScavengerVisitor;
+typedef ScavengerVisitorBase<true> ParallelScavengerVisitor;
 
 // Wrapper around VirtualMemory that adds caching and handles the empty case.
 class SemiSpace {
@@ -35,8 +41,11 @@ class SemiSpace {
   // Get a space of the given size. Returns NULL on out of memory. If size is 0,
   // returns an empty space: pointer(), start() and end() all return NULL.
   // The name parameter may be NULL. If non-NULL it is ued to give the OS a name
-  // for the underlying virtual memory region.
-  static SemiSpace* New(intptr_t size_in_words, const char* name);
+  // for the underlying virtual memory region. A non-negative numa_node binds
+  // the space to that NUMA node.
+  static SemiSpace* New(intptr_t size_in_words,
+                        intptr_t numa_node,
+                        const char* name);
 
   // Hand back an unused space.
   void Delete();
@@ -55,11 +64,12 @@ class SemiSpace {
   void WriteProtect(bool read_only);
 
  private:
-  explicit SemiSpace(VirtualMemory* reserved);
+  SemiSpace(VirtualMemory* reserved, intptr_t numa_node);
   ~SemiSpace();
 
   VirtualMemory* reserved_;  // NULL for an empty space.
   MemoryRegion region_;
+  intptr_t numa_node_;
 
   static SemiSpace* cache_;
   static Mutex* mutex_;
@@ -74,13 +84,15 @@ class ScavengeStats {
                 SpaceUsage before,
                 SpaceUsage after,
                 intptr_t promo_candidates_in_words,
-                intptr_t promoted_in_words)
+                intptr_t promoted_in_words,
+                int64_t weak_tables_micros)
       : start_micros_(start_micros),
         end_micros_(end_micros),
         before_(before),
         after_(after),
         promo_candidates_in_words_(promo_candidates_in_words),
-        promoted_in_words_(promoted_in_words) {}
+        promoted_in_words_(promoted_in_words),
+        weak_tables_micros_(weak_tables_micros) {}
 
   // Of all data before scavenge, what fraction was found to be garbage?
   // If this scavenge included growth, assume the extra capacity would become
@@ -103,6 +115,9 @@ class ScavengeStats {
 
   int64_t DurationMicros() const { return end_micros_ - start_micros_; }
 
+  // Time spent rehashing the weak tables, summed over all scavenger tasks.
+  int64_t WeakTablesMicros() const { return weak_tables_micros_; }
+
  private:
   int64_t start_micros_;
   int64_t end_micros_;
@@ -110,6 +125,7 @@ class ScavengeStats {
   SpaceUsage after_;
   intptr_t promo_candidates_in_words_;
   intptr_t promoted_in_words_;
+  int64_t weak_tables_micros_;
 };
 
 class Scavenger {
@@ -146,6 +162,20 @@ class Scavenger {
     return result;
   }
 
+  // Used by parallel scavenger tasks to claim a chunk of to space of at least
+  // 'min_size' and at most 'preferred_size' bytes, whose actual size is
+  // returned in 'size'. Returns 0 if to space is exhausted.
+  uword TryAllocateCopyBuffer(intptr_t min_size,
+                              intptr_t preferred_size,
+                              intptr_t* size);
+
+  // Used by parallel scavenger tasks to hand back the unused end of a copy
+  // buffer, which must already be filled with a forwarding corpse, and to
+  // allocate from such ends once to space is exhausted. Returns 0 if none
+  // of the ends is large enough.
+  void ReleaseCopyBufferTail(uword start, uword end);
+  uword TryAllocateFromCopyBufferTails(intptr_t size);
+
   uword TryAllocateInTLAB(Thread* thread, intptr_t size) {
     ASSERT(Utils::IsAligned(size, kObjectAlignment));
     ASSERT(heap_ != Dart::vm_isolate()->heap());
@@ -209,8 +239,25 @@ class Scavenger {
 
   intptr_t collections() const { return collections_; }
 
+  // When positive, the semi-space capacity and the tenuring policy are tuned
+  // to keep scavenge pauses below this many microseconds.
+  int64_t pause_time_goal_micros() const { return pause_time_goal_micros_; }
+  void set_pause_time_goal_micros(int64_t micros) {
+    ASSERT(micros >= 0);
+    pause_time_goal_micros_ = micros;
+  }
+
+  // The longest pause of the scavenges in the stats history, which is the
+  // estimate of the tail latency compared against the pause time goal.
+  int64_t RecentMaxPauseMicros() const;
+  bool ExceedsPauseTimeGoal() const {
+    return (pause_time_goal_micros_ > 0) &&
+           (RecentMaxPauseMicros() > pause_time_goal_micros_);
+  }
+
 #ifndef PRODUCT
   void PrintToJSONObject(JSONObject* object) const;
+  void PrintControllerStateToJSONObject(JSONObject* object) const;
 #endif  // !PRODUCT
 
   void AllocateExternal(intptr_t cid, intptr_t size);
@@ -232,23 +279,30 @@ class Scavenger {
     kIterateWeaks = 5,
     // Data
     kStoreBufferEntries = 0,
-    kDataUnused1 = 1,
-    kDataUnused2 = 2,
+    kDirtyCards = 1,
+    kWeakTablesMicros = 2,
     kToKBAfterStoreBuffer = 3
   };
 
   uword FirstObjectStart() const { return to_->start() | object_alignment_; }
   SemiSpace* Prologue(Isolate* isolate);
-  void IterateStoreBuffers(Isolate* isolate, ScavengerVisitor* visitor);
-  void IterateObjectIdTable(Isolate* isolate, ScavengerVisitor* visitor);
-  void IterateRoots(Isolate* isolate, ScavengerVisitor* visitor);
-  void IterateWeakProperties(Isolate* isolate, ScavengerVisitor* visitor);
-  void IterateWeakReferences(Isolate* isolate, ScavengerVisitor* visitor);
+  void SerialScavenge(SemiSpace* from);
+  void ParallelScavenge(SemiSpace* from);
+  StoreBufferBlock* PopPendingStoreBufferBlock();
+  template <bool parallel>
+  void IterateStoreBuffers(Isolate* isolate,
+                           ScavengerVisitorBase<parallel>* visitor);
+  template <bool parallel>
+  void IterateRememberedCards(Isolate* isolate,
+                              ScavengerVisitorBase<parallel>* visitor);
+  template <bool parallel>
+  void IterateObjectIdTable(Isolate* isolate,
+                            ScavengerVisitorBase<parallel>* visitor);
+  template <bool parallel>
+  void IterateRoots(Isolate* isolate, ScavengerVisitorBase<parallel>* visitor);
   void IterateWeakRoots(Isolate* isolate, HandleVisitor* visitor);
-  void ProcessToSpace(ScavengerVisitor* visitor);
-  void EnqueueWeakProperty(RawWeakProperty* raw_weak);
-  uword ProcessWeakProperty(RawWeakProperty* raw_weak,
-                            ScavengerVisitor* visitor);
+  void ProcessToSpace(SerialScavengerVisitor* visitor);
+  void FinalizeResultsFrom(ParallelScavengerVisitor* visitor);
   void Epilogue(Isolate* isolate, SemiSpace* from);
 
   bool IsUnreachable(RawObject** p);
@@ -278,7 +332,7 @@ class Scavenger {
   void UpdateMaxHeapCapacity();
   void UpdateMaxHeapUsage();
 
-  void ProcessWeakReferences();
+  void ProcessWeakTables();
 
   intptr_t NewSizeInWords(intptr_t old_size_in_words) const;
 
@@ -298,15 +352,15 @@ class Scavenger {
 
   intptr_t max_semi_capacity_in_words_;
 
+  // See pause_time_goal_micros().
+  int64_t pause_time_goal_micros_;
+
   // All object are aligned to this value.
   uword object_alignment_;
 
   // Keep track whether a scavenge is currently running.
   bool scavenging_;
 
-  // Keep track of pending weak properties discovered while scagenging.
-  RawWeakProperty* delayed_weak_properties_;
-
   int64_t gc_time_micros_;
   intptr_t collections_;
   static const int kStatsHistoryCapacity = 4;
@@ -318,13 +372,40 @@ class Scavenger {
   // The total size of external data associated with objects in this scavenger.
   intptr_t external_size_;
 
-  bool failed_to_promote_;
+  // Set by any scavenger task that fails to promote an object.
+  RelaxedAtomic<bool> failed_to_promote_;
+
+  // Old objects remembered in the store buffers that have not been visited by
+  // the current scavenge yet.
+  StoreBufferBlock* pending_store_buffer_blocks_;
+  Mutex store_buffer_lock_;
+
+  // Root slices of the current scavenge that no visitor has claimed yet.
+  intptr_t root_slices_not_started_;
 
-  // Protects new space during the allocation of new TLABs
+  // Weak tables of the current scavenge that no visitor has rehashed yet.
+  intptr_t weak_slices_not_started_;
+  int64_t weak_tables_micros_;
+
+  // Results of the current scavenge, merged from all scavenger tasks.
+  Mutex stats_mutex_;
+  intptr_t bytes_promoted_;
+  intptr_t store_buffer_entries_;
+  intptr_t dirty_cards_;
+
+  // Protects new space during the allocation of new TLABs and of copy buffers
+  // for parallel scavenger tasks.
   Mutex space_lock_;
 
-  friend class ScavengerVisitor;
+  // Unused ends of the copy buffers of the current scavenge, as pairs of
+  // start and end addresses. Protected by space_lock_.
+  MallocGrowableArray<uword> copy_buffer_tails_;
+
+  template <bool>
+  friend class ScavengerVisitorBase;
   friend class ScavengerWeakVisitor;
+  friend class ParallelScavengerTask;
+  friend class ScavengerTestHelper;
 
   DISALLOW_COPY_AND_ASSIGN(Scavenger);
 };
@@ -108,11 +108,13 @@ class ConcurrentSweeperTask : public ThreadPool::Task {
  public:
   ConcurrentSweeperTask(Isolate* isolate,
                         PageSpace* old_space,
+                        HeapPage* prev,
                         HeapPage* first,
                         HeapPage* last,
                         FreeList* freelist)
       : task_isolate_(isolate),
         old_space_(old_space),
+        prev_(prev),
         first_(first),
         last_(last),
         freelist_(freelist) {
@@ -136,7 +138,7 @@ class ConcurrentSweeperTask : public ThreadPool::Task {
       GCSweeper sweeper;
 
       HeapPage* page = first_;
-      HeapPage* prev_page = NULL;
+      HeapPage* prev_page = prev_;
 
       while (page != NULL) {
         ASSERT(thread->BypassSafepoints());  // Or we should be checking in.
@@ -173,17 +175,19 @@ class ConcurrentSweeperTask : public ThreadPool::Task {
  private:
   Isolate* task_isolate_;
   PageSpace* old_space_;
+  HeapPage* prev_;
   HeapPage* first_;
   HeapPage* last_;
   FreeList* freelist_;
 };
 
 void GCSweeper::SweepConcurrent(Isolate* isolate,
+                                HeapPage* prev,
                                 HeapPage* first,
                                 HeapPage* last,
                                 FreeList* freelist) {
   bool result = Dart::thread_pool()->Run<ConcurrentSweeperTask>(
-      isolate, isolate->heap()->old_space(), first, last, freelist);
+      isolate, isolate->heap()->old_space(), prev, first, last, freelist);
   ASSERT(result);
 }
 
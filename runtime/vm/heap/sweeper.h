@@ -35,7 +35,10 @@ class GCSweeper {
   intptr_t SweepLargePage(HeapPage* page);
 
   // Sweep the regular sized data pages between first and last inclusive.
+  // The page preceding first is given by prev, or NULL if first is the head
+  // of the page list.
   static void SweepConcurrent(Isolate* isolate,
+                              HeapPage* prev,
                               HeapPage* first,
                               HeapPage* last,
                               FreeList* freelist);
@@ -95,12 +95,25 @@ void WeakTable::Forward(ObjectPointerVisitor* visitor) {
   Rehash();
 }
 
-void WeakTable::Rehash() {
+bool WeakTable::Compact() {
+  MutexLocker ml(&mutex_);
+  if ((size() > kMinSize) && (count() <= (size() / 4))) {
+    RehashTo(SizeFor(count(), size()));
+    return true;
+  }
+  if ((used() - count()) > count()) {
+    RehashTo(size());
+    return true;
+  }
+  return false;
+}
+
+void WeakTable::RehashTo(intptr_t new_size) {
   intptr_t old_size = size();
   intptr_t* old_data = data_;
 
-  intptr_t new_size = SizeFor(count(), size());
   ASSERT(Utils::IsPowerOfTwo(new_size));
+  ASSERT(LimitFor(new_size) > count());
   intptr_t* new_data =
       reinterpret_cast<intptr_t*>(calloc(new_size, kEntrySize * kWordSize));
 
@@ -78,6 +78,20 @@ class WeakTable {
     SetValueAt(i, 0);
   }
 
+  // Like InvalidateAtExclusive, but leaves the count of valid entries alone so
+  // that disjoint ranges of the table can be swept in parallel. The sweepers
+  // must account for the invalidated entries with RemoveCountExclusive.
+  void InvalidateAtExclusiveUncounted(intptr_t i) {
+    ASSERT(IsValidEntryAtExclusive(i));
+    data_[ObjectIndex(i)] = kDeletedEntry;
+    data_[ValueIndex(i)] = 0;
+  }
+
+  void RemoveCountExclusive(intptr_t removed) {
+    ASSERT(removed >= 0);
+    set_count(count() - removed);
+  }
+
   RawObject* ObjectAtExclusive(intptr_t i) const {
     ASSERT(i >= 0);
     ASSERT(i < size());
@@ -130,6 +144,10 @@ class WeakTable {
 
   void Reset();
 
+  // Rehashes the table if it is mostly deleted entries or mostly empty, to
+  // speed up lookups and release memory. Returns whether it did.
+  bool Compact();
+
  private:
   enum {
     kObjectOffset = 0,
@@ -187,7 +205,8 @@ class WeakTable {
     data_[ValueIndex(i)] = val;
   }
 
-  void Rehash();
+  void Rehash() { RehashTo(SizeFor(count(), size())); }
+  void RehashTo(intptr_t new_size);
 
   static intptr_t Hash(RawObject* key) {
     return reinterpret_cast<uintptr_t>(key) * 92821;
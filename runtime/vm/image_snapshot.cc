@@ -218,6 +218,14 @@ static intptr_t PcDescriptorsSizeInSnapshot(intptr_t len) {
                         compiler::target::ObjectAlignment::kObjectAlignment);
 }
 
+static intptr_t ExceptionHandlersSizeInSnapshot(intptr_t num_entries) {
+  const intptr_t unrounded_size_in_bytes =
+      3 * compiler::target::kWordSize +
+      num_entries * sizeof(ExceptionHandlerInfo);
+  return Utils::RoundUp(unrounded_size_in_bytes,
+                        compiler::target::ObjectAlignment::kObjectAlignment);
+}
+
 static constexpr intptr_t kSimarmX64InstructionsAlignment =
     2 * compiler::target::ObjectAlignment::kObjectAlignment;
 static intptr_t InstructionsSizeInSnapshot(intptr_t len) {
@@ -248,6 +256,11 @@ intptr_t ImageWriter::SizeInSnapshot(RawObject* raw_object) {
       RawPcDescriptors* raw_desc = static_cast<RawPcDescriptors*>(raw_object);
       return PcDescriptorsSizeInSnapshot(raw_desc->ptr()->length_);
     }
+    case kExceptionHandlersCid: {
+      RawExceptionHandlers* raw_handlers =
+          static_cast<RawExceptionHandlers*>(raw_object);
+      return ExceptionHandlersSizeInSnapshot(raw_handlers->ptr()->num_entries_);
+    }
     case kInstructionsCid: {
       RawInstructions* raw_insns = static_cast<RawInstructions*>(raw_object);
       return InstructionsSizeInSnapshot(Instructions::Size(raw_insns));
@@ -428,6 +441,22 @@ void ImageWriter::WriteROData(WriteStream* stream) {
     marked_tags |= static_cast<uword>(obj.raw()->ptr()->hash_) << 32;
 #endif
 
+    // Read-only objects cannot point into the heap. The precompiler moved the
+    // handled types of exception handlers into the object store (see
+    // ExceptionHandlers::MoveHandledTypesTo), empty handlers have none.
+    uword* handled_types_field = nullptr;
+    RawObject* handled_types = Smi::New(0);
+    if (obj.IsExceptionHandlers()) {
+      const ExceptionHandlers& handlers = ExceptionHandlers::Cast(obj);
+      handled_types_field = reinterpret_cast<uword*>(
+          &handlers.raw()->ptr()->handled_types_data_);
+      if (handlers.raw()->ptr()->handled_types_data_->IsHeapObject()) {
+        RELEASE_ASSERT(handlers.num_entries() == 0);
+      } else {
+        handled_types = handlers.raw()->ptr()->handled_types_data_;
+      }
+    }
+
 #if defined(IS_SIMARM_X64)
     if (obj.IsStackMap()) {
       const StackMap& map = StackMap::Cast(obj);
@@ -483,18 +512,37 @@ void ImageWriter::WriteROData(WriteStream* stream) {
       stream->WriteTargetWord(desc.Length());
       stream->WriteBytes(desc.raw()->ptr()->data(), desc.Length());
       stream->Align(compiler::target::ObjectAlignment::kObjectAlignment);
+    } else if (obj.IsExceptionHandlers()) {
+      const ExceptionHandlers& handlers = ExceptionHandlers::Cast(obj);
+      const int32_t num_entries = handlers.num_entries();
+
+      const intptr_t size_in_bytes =
+          ExceptionHandlersSizeInSnapshot(num_entries);
+      marked_tags = RawObject::SizeTag::update(size_in_bytes * 2, marked_tags);
+
+      stream->WriteTargetWord(marked_tags);
+      stream->WriteBytes(&num_entries, sizeof(num_entries));
+      stream->WriteTargetWord(reinterpret_cast<uword>(handled_types));
+      stream->WriteBytes(handlers.raw()->ptr()->data(),
+                         num_entries * sizeof(ExceptionHandlerInfo));
+      stream->Align(compiler::target::ObjectAlignment::kObjectAlignment);
     } else {
       const Class& clazz = Class::Handle(obj.clazz());
       FATAL1("Unsupported class %s in rodata section.\n", clazz.ToCString());
     }
     USE(start);
     USE(end);
+    USE(handled_types_field);
 #else   // defined(IS_SIMARM_X64)
     stream->WriteWord(marked_tags);
     start += sizeof(uword);
     for (uword* cursor = reinterpret_cast<uword*>(start);
          cursor < reinterpret_cast<uword*>(end); cursor++) {
-      stream->WriteWord(*cursor);
+      if (cursor == handled_types_field) {
+        stream->WriteWord(reinterpret_cast<uword>(handled_types));
+      } else {
+        stream->WriteWord(*cursor);
+      }
     }
 #endif  // defined(IS_SIMARM_X64)
   }
@@ -13,6 +13,7 @@
 #include "platform/text_buffer.h"
 #include "vm/class_finalizer.h"
 #include "vm/code_observers.h"
+#include "vm/compiler/compiler_pass.h"
 #include "vm/compiler/jit/compiler.h"
 #include "vm/dart_api_message.h"
 #include "vm/dart_api_state.h"
@@ -130,6 +131,16 @@ static RawInstance* DeserializeMessage(Thread* thread, Message* message) {
   }
 }
 
+// Spreads isolate groups round-robin over the first --heap_numa_nodes nodes.
+static intptr_t NextNumaNode() {
+  if (FLAG_heap_numa_nodes <= 0) {
+    return -1;
+  }
+  static intptr_t next_numa_node = 0;
+  return AtomicOperations::FetchAndIncrement(&next_numa_node) %
+         FLAG_heap_numa_nodes;
+}
+
 IsolateGroup::IsolateGroup(std::unique_ptr<IsolateGroupSource> source,
                            void* embedder_data)
     : source_(std::move(source)),
@@ -137,9 +148,26 @@ IsolateGroup::IsolateGroup(std::unique_ptr<IsolateGroupSource> source,
       thread_registry_(new ThreadRegistry()),
       safepoint_handler_(new SafepointHandler(this)),
       isolates_monitor_(new Monitor()),
-      isolates_() {}
+      isolates_(),
+      numa_node_(NextNumaNode()) {}
+
+IsolateGroup::~IsolateGroup() {
+  free(template_snapshot_data_);
+}
 
-IsolateGroup::~IsolateGroup() {}
+const uint8_t* IsolateGroup::template_snapshot_data() const {
+  MonitorLocker ml(isolates_monitor_.get());
+  return template_snapshot_data_;
+}
+
+bool IsolateGroup::set_template_snapshot_data(uint8_t* data) {
+  MonitorLocker ml(isolates_monitor_.get());
+  if (template_snapshot_data_ != nullptr) {
+    return false;
+  }
+  template_snapshot_data_ = data;
+  return true;
+}
 
 void IsolateGroup::RegisterIsolate(Isolate* isolate) {
   MonitorLocker ml(isolates_monitor_.get());
@@ -720,8 +748,10 @@ MessageHandler::MessageStatus IsolateMessageHandler::HandleMessage(
   Object& msg_obj = Object::Handle(zone);
   if (message->IsRaw()) {
     msg_obj = message->raw_obj();
-    // We should only be sending RawObjects that can be converted to CObjects.
-    ASSERT(ApiObjectConverter::CanConvert(msg_obj.raw()));
+    // We should only be sending RawObjects that can be converted to CObjects
+    // or that are shared with the sender.
+    ASSERT(ApiObjectConverter::CanConvert(msg_obj.raw()) ||
+           MessageWriter::IsSharedReadOnlyObject(I, msg_obj.raw()));
   } else {
     MessageSnapshotReader reader(message.get(), thread);
     msg_obj = reader.ReadObject();
@@ -1114,6 +1144,7 @@ Isolate::Isolate(IsolateGroup* isolate_group,
   }
   NOT_IN_PRECOMPILED(optimizing_background_compiler_ =
                          new BackgroundCompiler(this, /* optimizing = */ true));
+  NOT_IN_PRECOMPILED(compiler_pass_stats_ = new CompilerPassStats());
 
   isolate_group->RegisterIsolate(this);
   isolate_group_ = isolate_group;
@@ -1131,6 +1162,9 @@ Isolate::~Isolate() {
   delete reverse_pc_lookup_cache_;
   reverse_pc_lookup_cache_ = nullptr;
 
+  free(snapshot_data_);
+  snapshot_data_ = nullptr;
+
   if (FLAG_enable_interpreter) {
     delete background_compiler_;
     background_compiler_ = nullptr;
@@ -1139,6 +1173,9 @@ Isolate::~Isolate() {
   delete optimizing_background_compiler_;
   optimizing_background_compiler_ = nullptr;
 
+  NOT_IN_PRECOMPILED(delete compiler_pass_stats_);
+  NOT_IN_PRECOMPILED(compiler_pass_stats_ = nullptr);
+
 #if !defined(PRODUCT)
   delete debugger_;
   debugger_ = nullptr;
@@ -2024,6 +2061,11 @@ void Isolate::Shutdown() {
   delete optimizing_background_compiler_;
   optimizing_background_compiler_ = nullptr;
 
+#if !defined(PRODUCT) && !defined(DART_PRECOMPILED_RUNTIME)
+  // No compilation is running anymore.
+  compiler_pass_stats_->ReportToTimeline();
+#endif  // !defined(PRODUCT) && !defined(DART_PRECOMPILED_RUNTIME)
+
 #if defined(DEBUG)
   if (heap_ != nullptr && FLAG_verify_on_transition) {
     // The VM isolate keeps all objects marked.
@@ -42,6 +42,7 @@ class ApiState;
 class BackgroundCompiler;
 class Capability;
 class CodeIndexTable;
+class CompilerPassStats;
 class Debugger;
 class DeoptContext;
 class ExternalTypedData;
@@ -228,6 +229,9 @@ class IsolateGroup {
 
   void set_initial_spawn_successful() { initial_spawn_successful_ = true; }
 
+  // The NUMA node the heaps of this group are bound to, or -1 if none.
+  intptr_t numa_node() const { return numa_node_; }
+
   void RegisterIsolate(Isolate* isolate);
   void UnregisterIsolate(Isolate* isolate);
 
@@ -262,6 +266,13 @@ class IsolateGroup {
     library_tag_handler_ = handler;
   }
 
+  // The isolate snapshot that isolates spawned into this group are created
+  // from (see Dart_SetIsolateGroupTemplate), or nullptr.
+  const uint8_t* template_snapshot_data() const;
+  // Takes ownership of [data]. Returns false if the group already has a
+  // template.
+  bool set_template_snapshot_data(uint8_t* data);
+
  private:
   std::unique_ptr<IsolateGroupSource> source_;
   void* embedder_data_ = nullptr;
@@ -272,6 +283,8 @@ class IsolateGroup {
   intptr_t isolate_count_ = 0;
   bool initial_spawn_successful_ = false;
   Dart_LibraryTagHandler library_tag_handler_ = nullptr;
+  intptr_t numa_node_ = -1;
+  uint8_t* template_snapshot_data_ = nullptr;
 };
 
 class Isolate : public BaseIsolate, public IntrusiveDListEntry<Isolate> {
@@ -627,6 +640,12 @@ class Isolate : public BaseIsolate, public IntrusiveDListEntry<Isolate> {
     return optimizing_background_compiler_;
   }
 
+#if !defined(DART_PRECOMPILED_RUNTIME)
+  CompilerPassStats* compiler_pass_stats() const {
+    return compiler_pass_stats_;
+  }
+#endif  // !defined(DART_PRECOMPILED_RUNTIME)
+
 #if !defined(PRODUCT)
   void UpdateLastAllocationProfileAccumulatorResetTimestamp() {
     last_allocationprofile_accumulator_reset_timestamp_ =
@@ -865,6 +884,13 @@ class Isolate : public BaseIsolate, public IntrusiveDListEntry<Isolate> {
     reverse_pc_lookup_cache_ = table;
   }
 
+  // Takes ownership of the malloc()ed buffer a compressed isolate snapshot
+  // was decompressed into.
+  void set_snapshot_data(uint8_t* data) {
+    ASSERT(snapshot_data_ == nullptr);
+    snapshot_data_ = data;
+  }
+
   // Isolate-specific flag handling.
   static void FlagsInitialize(Dart_IsolateFlags* api_flags);
   void FlagsCopyTo(Dart_IsolateFlags* api_flags) const;
@@ -1085,6 +1111,11 @@ class Isolate : public BaseIsolate, public IntrusiveDListEntry<Isolate> {
   // Optimized background compilation.
   BackgroundCompiler* optimizing_background_compiler_ = nullptr;
 
+#if !defined(DART_PRECOMPILED_RUNTIME)
+  // Totals of the compiler passes run for this isolate.
+  CompilerPassStats* compiler_pass_stats_ = nullptr;
+#endif  // !defined(DART_PRECOMPILED_RUNTIME)
+
 // Fields that aren't needed in a product build go here with boolean flags at
 // the top.
 #if !defined(PRODUCT)
@@ -1189,6 +1220,8 @@ class Isolate : public BaseIsolate, public IntrusiveDListEntry<Isolate> {
 
   ReversePcLookupCache* reverse_pc_lookup_cache_ = nullptr;
 
+  uint8_t* snapshot_data_ = nullptr;
+
   // Used during message sending of messages between isolates.
   std::unique_ptr<WeakTable> forward_table_new_;
   std::unique_ptr<WeakTable> forward_table_old_;
@@ -1223,7 +1256,9 @@ class Isolate : public BaseIsolate, public IntrusiveDListEntry<Isolate> {
   friend class SafepointHandler;
   friend class ObjectGraph;         // VisitObjectPointers
   friend class HeapSnapshotWriter;  // VisitObjectPointers
+  friend class DominatorTree;       // VisitObjectPointers
   friend class Scavenger;           // VisitObjectPointers
+  friend class PageSpace;           // AbandonTLABs
   friend class HeapIterationScope;  // VisitObjectPointers
   friend class ServiceIsolate;
   friend class Thread;
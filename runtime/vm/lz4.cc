@@ -0,0 +1,189 @@
+// Copyright (c) 2019, the Dart project authors.  Please see the AUTHORS file
+// for details. All rights reserved. Use of this source code is governed by a
+// BSD-style license that can be found in the LICENSE file.
+
+#include "vm/lz4.h"
+
+#include "platform/assert.h"
+
+namespace dart {
+
+// A match is encoded as a 16-bit offset and a length of at least 4.
+static const intptr_t kMinMatch = 4;
+static const intptr_t kMaxOffset = 0xFFFF;
+
+// The format requires the last match to start at least 12 bytes before the
+// end of the block, and the last 5 bytes to be literals.
+static const intptr_t kMatchFindLimit = 12;
+static const intptr_t kLastLiterals = 5;
+
+// Lengths of 15 or more spill into extra bytes after the token.
+static const intptr_t kRunMask = 0xF;
+
+static const intptr_t kHashLog = 12;
+static const intptr_t kHashSize = 1 << kHashLog;
+
+// Give up on incompressible input gradually by skipping further ahead after
+// every 2^kSkipTrigger consecutive misses.
+static const intptr_t kSkipTrigger = 6;
+
+static inline uint32_t Read32(const uint8_t* p) {
+  uint32_t value;
+  memmove(&value, p, sizeof(value));
+  return value;
+}
+
+static inline intptr_t Hash(uint32_t sequence) {
+  return (sequence * 2654435761U) >> (32 - kHashLog);
+}
+
+static inline uint8_t* WriteLength(uint8_t* out, intptr_t length) {
+  while (length >= 255) {
+    *out++ = 255;
+    length -= 255;
+  }
+  *out++ = static_cast<uint8_t>(length);
+  return out;
+}
+
+static uint8_t* WriteSequence(uint8_t* out,
+                              const uint8_t* literals,
+                              intptr_t literal_length,
+                              intptr_t offset,
+                              intptr_t match_length) {
+  uint8_t* token = out++;
+  if (literal_length >= kRunMask) {
+    *token = kRunMask << 4;
+    out = WriteLength(out, literal_length - kRunMask);
+  } else {
+    *token = literal_length << 4;
+  }
+  memmove(out, literals, literal_length);
+  out += literal_length;
+  if (match_length == 0) {
+    return out;  // The last sequence has no match.
+  }
+
+  ASSERT((offset > 0) && (offset <= kMaxOffset));
+  *out++ = offset & 0xFF;
+  *out++ = offset >> 8;
+  ASSERT(match_length >= kMinMatch);
+  match_length -= kMinMatch;
+  if (match_length >= kRunMask) {
+    *token |= kRunMask;
+    out = WriteLength(out, match_length - kRunMask);
+  } else {
+    *token |= match_length;
+  }
+  return out;
+}
+
+intptr_t LZ4::Compress(const uint8_t* src, intptr_t length, uint8_t* dst) {
+  uint8_t* out = dst;
+  intptr_t anchor = 0;
+  if (length > kMatchFindLimit) {
+    intptr_t table[kHashSize];
+    for (intptr_t i = 0; i < kHashSize; i++) {
+      table[i] = -1;
+    }
+    const intptr_t match_start_limit = length - kMatchFindLimit;
+    const intptr_t match_end_limit = length - kLastLiterals;
+    intptr_t position = 0;
+    intptr_t misses = 0;
+    while (position < match_start_limit) {
+      const uint32_t sequence = Read32(&src[position]);
+      const intptr_t hash = Hash(sequence);
+      const intptr_t candidate = table[hash];
+      table[hash] = position;
+      if ((candidate < 0) || (position - candidate > kMaxOffset) ||
+          (Read32(&src[candidate]) != sequence)) {
+        position += 1 + (misses++ >> kSkipTrigger);
+        continue;
+      }
+      misses = 0;
+
+      intptr_t match_end = position + kMinMatch;
+      while ((match_end < match_end_limit) &&
+             (src[match_end] == src[candidate + (match_end - position)])) {
+        match_end++;
+      }
+      out = WriteSequence(out, &src[anchor], position - anchor,
+                          position - candidate, match_end - position);
+      position = match_end;
+      anchor = position;
+    }
+  }
+  out = WriteSequence(out, &src[anchor], length - anchor, 0, 0);
+  ASSERT(out - dst <= CompressBound(length));
+  return out - dst;
+}
+
+// Reads the extra bytes of a length that did not fit into its token nibble.
+// Returns false if the input ends first.
+static inline bool ReadLength(const uint8_t* src,
+                              intptr_t length,
+                              intptr_t* position,
+                              intptr_t* value) {
+  uint8_t byte;
+  do {
+    if (*position >= length) {
+      return false;
+    }
+    byte = src[(*position)++];
+    *value += byte;
+  } while (byte == 255);
+  return true;
+}
+
+intptr_t LZ4::Decompress(const uint8_t* src,
+                         intptr_t length,
+                         uint8_t* dst,
+                         intptr_t capacity) {
+  intptr_t in = 0;
+  intptr_t out = 0;
+  while (in < length) {
+    const uint8_t token = src[in++];
+
+    intptr_t literal_length = token >> 4;
+    if ((literal_length == kRunMask) &&
+        !ReadLength(src, length, &in, &literal_length)) {
+      return -1;
+    }
+    if ((literal_length > length - in) || (literal_length > capacity - out)) {
+      return -1;
+    }
+    memmove(&dst[out], &src[in], literal_length);
+    in += literal_length;
+    out += literal_length;
+    if (in == length) {
+      return out;  // The last sequence has no match.
+    }
+
+    if (length - in < 2) {
+      return -1;
+    }
+    const intptr_t offset = src[in] | (src[in + 1] << 8);
+    in += 2;
+    if ((offset == 0) || (offset > out)) {
+      return -1;
+    }
+    intptr_t match_length = token & kRunMask;
+    if ((match_length == kRunMask) &&
+        !ReadLength(src, length, &in, &match_length)) {
+      return -1;
+    }
+    match_length += kMinMatch;
+    if (match_length > capacity - out) {
+      return -1;
+    }
+    // The match may overlap the bytes it produces, so copy forwards.
+    const uint8_t* match = &dst[out - offset];
+    for (intptr_t i = 0; i < match_length; i++) {
+      dst[out + i] = match[i];
+    }
+    out += match_length;
+  }
+  return -1;  // Missing the last sequence.
+}
+
+}  // namespace dart
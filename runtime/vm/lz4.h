@@ -0,0 +1,43 @@
+// Copyright (c) 2019, the Dart project authors.  Please see the AUTHORS file
+// for details. All rights reserved. Use of this source code is governed by a
+// BSD-style license that can be found in the LICENSE file.
+
+#ifndef RUNTIME_VM_LZ4_H_
+#define RUNTIME_VM_LZ4_H_
+
+#include "platform/allocation.h"
+#include "platform/globals.h"
+
+namespace dart {
+
+// Compresses and decompresses the LZ4 block format, so that the output can be
+// consumed by any standard LZ4 decoder. Favors speed over compression ratio.
+//
+// https://github.com/lz4/lz4/blob/master/doc/lz4_Block_format.md
+class LZ4 : public AllStatic {
+ public:
+  // The maximum size of the compressed form of length bytes.
+  static intptr_t CompressBound(intptr_t length) {
+    return length + (length / 255) + 16;
+  }
+
+  // The maximum size of the decompressed form of length bytes. Every byte of
+  // a block adds at most 255 bytes to the length of a match.
+  static intptr_t DecompressBound(intptr_t length) { return length * 255; }
+
+  // Compresses length bytes from src into dst, which must have room for
+  // CompressBound(length) bytes. Returns the compressed size.
+  static intptr_t Compress(const uint8_t* src, intptr_t length, uint8_t* dst);
+
+  // Decompresses a block of length bytes from src into dst. Returns the
+  // decompressed size, or -1 if the block is malformed or does not fit into
+  // capacity bytes.
+  static intptr_t Decompress(const uint8_t* src,
+                             intptr_t length,
+                             uint8_t* dst,
+                             intptr_t capacity);
+};
+
+}  // namespace dart
+
+#endif  // RUNTIME_VM_LZ4_H_
@@ -0,0 +1,75 @@
+// Copyright (c) 2019, the Dart project authors.  Please see the AUTHORS file
+// for details. All rights reserved. Use of this source code is governed by a
+// BSD-style license that can be found in the LICENSE file.
+
+#include "vm/lz4.h"
+#include "platform/assert.h"
+#include "vm/unit_test.h"
+
+namespace dart {
+
+static void RoundTrip(const uint8_t* data, intptr_t length) {
+  uint8_t* compressed =
+      reinterpret_cast<uint8_t*>(malloc(LZ4::CompressBound(length)));
+  intptr_t compressed_length = LZ4::Compress(data, length, compressed);
+  EXPECT(compressed_length <= LZ4::CompressBound(length));
+  EXPECT(length <= LZ4::DecompressBound(compressed_length));
+
+  uint8_t* decompressed = reinterpret_cast<uint8_t*>(malloc(length + 1));
+  EXPECT_EQ(length, LZ4::Decompress(compressed, compressed_length,
+                                    decompressed, length));
+  EXPECT(memcmp(data, decompressed, length) == 0);
+  if (length > 0) {
+    // Too small a destination is detected rather than overrun.
+    EXPECT_EQ(-1, LZ4::Decompress(compressed, compressed_length, decompressed,
+                                  length - 1));
+  }
+  free(decompressed);
+  free(compressed);
+}
+
+VM_UNIT_TEST_CASE(LZ4_RoundTrip) {
+  RoundTrip(NULL, 0);
+
+  const char* short_text = "dartheap";
+  RoundTrip(reinterpret_cast<const uint8_t*>(short_text), strlen(short_text));
+
+  const intptr_t kLength = 100 * KB;
+  uint8_t* data = reinterpret_cast<uint8_t*>(malloc(kLength));
+  for (intptr_t i = 0; i < kLength; i++) {
+    data[i] = (i % 7 == 0) ? (i * 31) & 0xFF : 'x';
+  }
+  RoundTrip(data, kLength);
+
+  // Repetitive data compresses.
+  uint8_t* compressed =
+      reinterpret_cast<uint8_t*>(malloc(LZ4::CompressBound(kLength)));
+  EXPECT(LZ4::Compress(data, kLength, compressed) < kLength / 4);
+  free(compressed);
+
+  uint32_t state = 1;
+  for (intptr_t i = 0; i < kLength; i++) {
+    state = state * 1103515245 + 12345;
+    data[i] = state >> 24;
+  }
+  RoundTrip(data, kLength);
+  free(data);
+}
+
+VM_UNIT_TEST_CASE(LZ4_Malformed) {
+  uint8_t buffer[32];
+  // Truncated literal run.
+  const uint8_t literals[] = {0x50, 'a', 'b'};
+  EXPECT_EQ(-1, LZ4::Decompress(literals, sizeof(literals), buffer,
+                                sizeof(buffer)));
+  // Match reaching before the start of the output.
+  const uint8_t match[] = {0x10, 'a', 0x02, 0x00, 0x00};
+  EXPECT_EQ(-1, LZ4::Decompress(match, sizeof(match), buffer, sizeof(buffer)));
+  // Overlapping match.
+  const uint8_t overlap[] = {0x14, 'a', 0x01, 0x00, 0x00};
+  EXPECT_EQ(9, LZ4::Decompress(overlap, sizeof(overlap), buffer,
+                               sizeof(buffer)));
+  EXPECT_EQ(0, memcmp(buffer, "aaaaaaaaa", 9));
+}
+
+}  // namespace dart
@@ -55,8 +55,10 @@ class Message {
           Priority priority,
           Dart_Port delivery_failure_port = kIllegalPort);
 
-  // Message objects can also carry RawObject pointers for Smis and objects in
-  // the VM heap. This is indicated by setting the len_ field to 0.
+  // Message objects can also carry RawObject pointers for Smis, objects in
+  // the VM heap and, between isolates of a group, objects for which
+  // MessageWriter::IsSharedReadOnlyObject holds. This is indicated by setting
+  // the len_ field to 0.
   Message(Dart_Port dest_port,
           RawObject* raw_obj,
           Priority priority,
@@ -13093,11 +13093,29 @@ void ExceptionHandlers::SetHandledTypes(intptr_t try_index,
 
 RawArray* ExceptionHandlers::GetHandledTypes(intptr_t try_index) const {
   ASSERT((try_index >= 0) && (try_index < num_entries()));
-  Array& array = Array::Handle(raw_ptr()->handled_types_data_);
+  RawObject* handled_types_data = raw_ptr()->handled_types_data_;
+  Array& array = Array::Handle();
+  if (handled_types_data->IsHeapObject()) {
+    array ^= handled_types_data;
+  } else {
+    // See MoveHandledTypesTo.
+    array = Isolate::Current()->object_store()->exception_handled_types();
+    array ^= array.At(Smi::Value(static_cast<RawSmi*>(handled_types_data)));
+  }
   array ^= array.At(try_index);
   return array.raw();
 }
 
+void ExceptionHandlers::MoveHandledTypesTo(
+    const GrowableObjectArray& table) const {
+  if (!raw_ptr()->handled_types_data_->IsHeapObject()) {
+    return;
+  }
+  table.Add(Array::Handle(raw_ptr()->handled_types_data_));
+  StoreSmi(reinterpret_cast<RawSmi* const*>(&raw_ptr()->handled_types_data_),
+           Smi::New(table.Length() - 1));
+}
+
 void ExceptionHandlers::set_handled_types_data(const Array& value) const {
   StorePointer(&raw_ptr()->handled_types_data_, value.raw());
 }
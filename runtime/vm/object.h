@@ -5182,6 +5182,11 @@ class ExceptionHandlers : public Object {
   void SetHandledTypes(intptr_t try_index, const Array& handled_types) const;
   bool HasCatchAll(intptr_t try_index) const;
 
+  // Appends the handled types to [table] and only keeps their index, so that
+  // the handlers no longer point into the heap. GetHandledTypes then looks
+  // them up in ObjectStore::exception_handled_types.
+  void MoveHandledTypesTo(const GrowableObjectArray& table) const;
+
   static intptr_t InstanceSize() {
     ASSERT(sizeof(RawExceptionHandlers) ==
            OFFSET_OF_RETURNED_VALUE(RawExceptionHandlers, data));
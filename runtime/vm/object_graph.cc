@@ -7,13 +7,19 @@
 #include "vm/dart.h"
 #include "vm/dart_api_state.h"
 #include "vm/growable_array.h"
+#include "vm/heap/pages.h"
+#include "vm/heap/weak_table.h"
 #include "vm/isolate.h"
+#include "vm/json_stream.h"
+#include "vm/lz4.h"
 #include "vm/native_symbol.h"
 #include "vm/object.h"
 #include "vm/object_store.h"
 #include "vm/raw_object.h"
 #include "vm/raw_object_fields.h"
 #include "vm/reusable_handles.h"
+#include "vm/thread_barrier.h"
+#include "vm/thread_pool.h"
 #include "vm/visitor.h"
 
 namespace dart {
@@ -518,12 +524,7 @@ intptr_t ObjectGraph::InboundReferences(Object* obj, const Array& references) {
   return visitor.length();
 }
 
-void HeapSnapshotWriter::EnsureAvailable(intptr_t needed) {
-  intptr_t available = capacity_ - size_;
-  if (available >= needed) {
-    return;
-  }
-
+void HeapSnapshotWriter::Grow(intptr_t needed) {
   if (buffer_ != nullptr) {
     Flush();
   }
@@ -543,6 +544,30 @@ void HeapSnapshotWriter::Flush(bool last) {
     return;
   }
 
+  // Each chunk is compressed on its own, so it can be decoded as it arrives.
+  intptr_t uncompressed_size = 0;
+  if (compress_ && (buffer_ != nullptr)) {
+    uncompressed_size = size_ - kMetadataReservation;
+    uint8_t* compressed = reinterpret_cast<uint8_t*>(malloc(
+        kMetadataReservation + LZ4::CompressBound(uncompressed_size)));
+    intptr_t compressed_size =
+        LZ4::Compress(&buffer_[kMetadataReservation], uncompressed_size,
+                      &compressed[kMetadataReservation]);
+    free(buffer_);
+    buffer_ = compressed;
+    size_ = kMetadataReservation + compressed_size;
+  }
+
+  WriteChunk(buffer_, size_, uncompressed_size, last);
+  buffer_ = nullptr;
+  size_ = 0;
+  capacity_ = 0;
+}
+
+void HeapSnapshotWriter::WriteChunk(uint8_t* buffer,
+                                    intptr_t size,
+                                    intptr_t uncompressed_size,
+                                    bool last) {
   JSONStream js;
   {
     JSONObject jsobj(&js);
@@ -558,35 +583,254 @@ void HeapSnapshotWriter::Flush(bool last) {
         event.AddProperty("isolate", thread()->isolate());
         event.AddPropertyTimeMillis("timestamp", OS::GetCurrentTimeMillis());
         event.AddProperty("last", last);
+        if (compress_) {
+          event.AddProperty("_compression", "lz4");
+          event.AddProperty64("_uncompressedLength", uncompressed_size);
+        }
       }
     }
   }
 
   Service::SendEventWithData(Service::heapsnapshot_stream.id(), "HeapSnapshot",
                              kMetadataReservation, js.buffer()->buf(),
-                             js.buffer()->length(), buffer_, size_);
-  buffer_ = nullptr;
-  size_ = 0;
-  capacity_ = 0;
+                             js.buffer()->length(), buffer, size);
 }
 
+static const intptr_t kBitVectorWordsPerBlock = 1;
+static const intptr_t kBlockSize =
+    kObjectAlignment * kBitsPerWord * kBitVectorWordsPerBlock;
+static const intptr_t kBlockMask = ~(kBlockSize - 1);
+static const intptr_t kBlocksPerPage = kPageSize / kBlockSize;
+
+// Maps the objects of one block of a page to their 0-origin index in the
+// page. Like the compactor's ForwardingBlock, it relies on objects being
+// numbered in address order: an object's index is the block's first index
+// plus the number of objects starting before it in the block.
+class CountingBlock {
+ public:
+  CountingBlock() : base_count_(0), count_bitvector_(0) {}
+
+  intptr_t Lookup(uword addr) const {
+    uword block_offset = addr & ~kBlockMask;
+    intptr_t bitvector_shift = block_offset >> kObjectAlignmentLog2;
+    ASSERT(bitvector_shift < kBitsPerWord);
+    uword preceding_bitmask = (static_cast<uword>(1) << bitvector_shift) - 1;
+    return base_count_ +
+           Utils::CountOneBitsWord(count_bitvector_ & preceding_bitmask);
+  }
+
+  void Record(uword addr, intptr_t index) {
+    if (count_bitvector_ == 0) {
+      base_count_ = index;
+    }
+    uword block_offset = addr & ~kBlockMask;
+    intptr_t bitvector_shift = block_offset >> kObjectAlignmentLog2;
+    ASSERT(bitvector_shift < kBitsPerWord);
+    count_bitvector_ |= static_cast<uword>(1) << bitvector_shift;
+  }
+
+ private:
+  intptr_t base_count_;
+  uword count_bitvector_;
+  COMPILE_ASSERT(kBitVectorWordsPerBlock == 1);
+
+  DISALLOW_COPY_AND_ASSIGN(CountingBlock);
+};
+
+// The object ids of a regular, code or large page: a bit per allocation unit
+// and a count per block. Objects on a large page start within its first
+// kPageSize bytes.
+class CountingPage {
+ public:
+  explicit CountingPage(HeapPage* page) : page_(page) {}
+  ~CountingPage() { free(encoded_); }
+
+  HeapPage* page() const { return page_; }
+  uword start() const { return reinterpret_cast<uword>(page_); }
+  uword end() const { return page_->object_end(); }
+
+  intptr_t Lookup(uword addr) const {
+    return first_id_ + BlockFor(addr)->Lookup(addr);
+  }
+  void Record(uword addr) { BlockFor(addr)->Record(addr, object_count_++); }
+
+  intptr_t object_count() const { return object_count_; }
+  intptr_t reference_count() const { return reference_count_; }
+  void CountReferences(intptr_t count) { reference_count_ += count; }
+  void set_first_id(intptr_t id) { first_id_ = id; }
+  intptr_t first_id() const { return first_id_; }
+  void set_first_reference(intptr_t index) { first_reference_ = index; }
+  intptr_t first_reference() const { return first_reference_; }
+
+  // The page's part of the object table, encoded by a helper task.
+  void SetEncoded(uint8_t* data, intptr_t size) {
+    ASSERT(encoded_ == nullptr);
+    encoded_ = data;
+    encoded_size_ = size;
+  }
+  uint8_t* encoded() const { return encoded_; }
+  intptr_t encoded_size() const { return encoded_size_; }
+  void ClearEncoded() {
+    free(encoded_);
+    encoded_ = nullptr;
+    encoded_size_ = 0;
+  }
+
+ private:
+  CountingBlock* BlockFor(uword addr) {
+    intptr_t block_number = (addr - start()) / kBlockSize;
+    ASSERT(block_number >= 0);
+    ASSERT(block_number < kBlocksPerPage);
+    return &blocks_[block_number];
+  }
+  const CountingBlock* BlockFor(uword addr) const {
+    return const_cast<CountingPage*>(this)->BlockFor(addr);
+  }
+
+  HeapPage* const page_;
+  intptr_t first_id_ = 0;
+  intptr_t first_reference_ = 0;
+  intptr_t object_count_ = 0;
+  intptr_t reference_count_ = 0;
+  uint8_t* encoded_ = nullptr;
+  intptr_t encoded_size_ = 0;
+  CountingBlock blocks_[kBlocksPerPage];
+
+  DISALLOW_COPY_AND_ASSIGN(CountingPage);
+};
+
+// A growable buffer for the encoding of one page.
+class PageEncoder : public HeapSnapshotEncoder {
+ public:
+  PageEncoder() {}
+  ~PageEncoder() { free(buffer_); }
+
+  void Steal(uint8_t** data, intptr_t* size) {
+    *data = buffer_;
+    *size = size_;
+    buffer_ = nullptr;
+    size_ = 0;
+    capacity_ = 0;
+  }
+
+ private:
+  virtual void Grow(intptr_t needed) {
+    intptr_t capacity =
+        Utils::Maximum(capacity_ * 2, static_cast<intptr_t>(KB));
+    while (capacity - size_ < needed) {
+      capacity *= 2;
+    }
+    buffer_ = reinterpret_cast<uint8_t*>(realloc(buffer_, capacity));
+    capacity_ = capacity;
+  }
+
+  DISALLOW_COPY_AND_ASSIGN(PageEncoder);
+};
+
+static int CompareCountingPages(const void* a, const void* b) {
+  uword a_start = (*static_cast<CountingPage* const*>(a))->start();
+  uword b_start = (*static_cast<CountingPage* const*>(b))->start();
+  return (a_start < b_start) ? -1 : ((a_start > b_start) ? 1 : 0);
+}
+
+// The counting pages for the regular, code and large pages of an isolate, in
+// iteration order and by address. Must be used within a HeapIterationScope.
+class CountingPageTable {
+ public:
+  explicit CountingPageTable(PageSpace* old_space) {
+    MutexLocker ml(&old_space->pages_lock_);
+    old_space->MakeIterable();
+
+    HeapPage* const lists[] = {old_space->pages_, old_space->exec_pages_,
+                               old_space->large_pages_};
+    const intptr_t kNumLists = ARRAY_SIZE(lists);
+    for (intptr_t i = 0; i < kNumLists; i++) {
+      for (HeapPage* page = lists[i]; page != nullptr; page = page->next()) {
+        length_++;
+      }
+    }
+
+    pages_ = new CountingPage*[length_];
+    sorted_pages_ = new CountingPage*[length_];
+    intptr_t index = 0;
+    for (intptr_t i = 0; i < kNumLists; i++) {
+      for (HeapPage* page = lists[i]; page != nullptr; page = page->next()) {
+        ASSERT(!page->is_image_page());
+        pages_[index] = new CountingPage(page);
+        sorted_pages_[index] = pages_[index];
+        index++;
+      }
+    }
+    ASSERT(index == length_);
+    qsort(sorted_pages_, length_, sizeof(CountingPage*),
+          CompareCountingPages);
+  }
+
+  ~CountingPageTable() {
+    for (intptr_t i = 0; i < length_; i++) {
+      delete pages_[i];
+    }
+    delete[] pages_;
+    delete[] sorted_pages_;
+  }
+
+  intptr_t length() const { return length_; }
+  CountingPage* At(intptr_t index) const { return pages_[index]; }
+
+  // The page holding obj, or nullptr if obj is not on one of these pages.
+  CountingPage* Find(RawObject* obj) const {
+    if (!obj->IsOldObject()) {
+      return nullptr;
+    }
+    const uword addr = RawObject::ToAddr(obj);
+    intptr_t lo = 0;
+    intptr_t hi = length_ - 1;
+    while (lo <= hi) {
+      intptr_t mid = lo + (hi - lo) / 2;
+      CountingPage* page = sorted_pages_[mid];
+      if (addr < page->start()) {
+        hi = mid - 1;
+      } else if (addr >= page->end()) {
+        lo = mid + 1;
+      } else {
+        return page;
+      }
+    }
+    // In the VM isolate, on an image page or a code page's executable alias.
+    return nullptr;
+  }
+
+ private:
+  CountingPage** pages_ = nullptr;
+  CountingPage** sorted_pages_ = nullptr;
+  intptr_t length_ = 0;
+
+  DISALLOW_COPY_AND_ASSIGN(CountingPageTable);
+};
+
 void HeapSnapshotWriter::AssignObjectId(RawObject* obj) {
-  // TODO(rmacnak): We're assigning IDs in iteration order, so we can use the
-  // compator's trick of using a finger table with bit counting to make the
-  // mapping much smaller.
   ASSERT(obj->IsHeapObject());
+  ASSERT(counting_pages_->Find(obj) == nullptr);
   thread()->heap()->SetObjectId(obj, ++object_count_);
 }
 
-intptr_t HeapSnapshotWriter::GetObjectId(RawObject* obj) {
+intptr_t HeapSnapshotWriter::GetObjectId(RawObject* obj) const {
   if (!obj->IsHeapObject()) {
     return 0;
   }
-  return thread()->heap()->GetObjectId(obj);
+  CountingPage* page = counting_pages_->Find(obj);
+  if (page != nullptr) {
+    return page->Lookup(RawObject::ToAddr(obj));
+  }
+  // The table is not modified once ids have been assigned.
+  WeakTable* table = obj->IsNewObject() ? new_object_ids_ : old_object_ids_;
+  return table->GetValueExclusive(obj);
 }
 
 void HeapSnapshotWriter::ClearObjectIds() {
   thread()->heap()->ResetObjectIdTable();
+  delete counting_pages_;
+  counting_pages_ = nullptr;
 }
 
 void HeapSnapshotWriter::CountReferences(intptr_t count) {
@@ -611,7 +855,7 @@ class Pass1Visitor : public ObjectVisitor,
     if (obj->IsPseudoObject()) return;
 
     writer_->AssignObjectId(obj);
-    obj->VisitPointers(this);
+    obj->VisitPointersPrecise(this);
   }
 
   void VisitPointers(RawObject** from, RawObject** to) {
@@ -636,6 +880,33 @@ class Pass1Visitor : public ObjectVisitor,
   DISALLOW_COPY_AND_ASSIGN(Pass1Visitor);
 };
 
+// Pass 1 for the objects on a counting page.
+class CountingPageVisitor : public ObjectVisitor, public ObjectPointerVisitor {
+ public:
+  CountingPageVisitor()
+      : ObjectVisitor(), ObjectPointerVisitor(Isolate::Current()) {}
+
+  void set_page(CountingPage* page) { page_ = page; }
+
+  void VisitObject(RawObject* obj) {
+    if (obj->IsPseudoObject()) return;
+
+    page_->Record(RawObject::ToAddr(obj));
+    obj->VisitPointersPrecise(this);
+  }
+
+  void VisitPointers(RawObject** from, RawObject** to) {
+    intptr_t count = to - from + 1;
+    ASSERT(count >= 0);
+    page_->CountReferences(count);
+  }
+
+ private:
+  CountingPage* page_ = nullptr;
+
+  DISALLOW_COPY_AND_ASSIGN(CountingPageVisitor);
+};
+
 enum NonReferenceDataTags {
   kNoData = 0,
   kNullData,
@@ -654,119 +925,120 @@ class Pass2Visitor : public ObjectVisitor,
                      public ObjectPointerVisitor,
                      public HandleVisitor {
  public:
-  explicit Pass2Visitor(HeapSnapshotWriter* writer)
+  Pass2Visitor(const HeapSnapshotWriter* writer, HeapSnapshotEncoder* encoder)
       : ObjectVisitor(),
         ObjectPointerVisitor(Isolate::Current()),
         HandleVisitor(Thread::Current()),
-        writer_(writer) {}
+        writer_(writer),
+        encoder_(encoder) {}
 
   void VisitObject(RawObject* obj) {
     if (obj->IsPseudoObject()) return;
 
     intptr_t cid = obj->GetClassId();
-    writer_->WriteUnsigned(cid);
-    writer_->WriteUnsigned(discount_sizes_ ? 0 : obj->HeapSize());
+    encoder_->WriteUnsigned(cid);
+    encoder_->WriteUnsigned(discount_sizes_ ? 0 : obj->HeapSize());
 
     if (cid == kNullCid) {
-      writer_->WriteUnsigned(kNullData);
+      encoder_->WriteUnsigned(kNullData);
     } else if (cid == kBoolCid) {
-      writer_->WriteUnsigned(kBoolData);
-      writer_->WriteUnsigned(
+      encoder_->WriteUnsigned(kBoolData);
+      encoder_->WriteUnsigned(
           static_cast<uintptr_t>(static_cast<RawBool*>(obj)->ptr()->value_));
     } else if (cid == kSmiCid) {
       UNREACHABLE();
     } else if (cid == kMintCid) {
-      writer_->WriteUnsigned(kIntData);
-      writer_->WriteSigned(static_cast<RawMint*>(obj)->ptr()->value_);
+      encoder_->WriteUnsigned(kIntData);
+      encoder_->WriteSigned(static_cast<RawMint*>(obj)->ptr()->value_);
     } else if (cid == kDoubleCid) {
-      writer_->WriteUnsigned(kDoubleData);
-      writer_->WriteBytes(&(static_cast<RawDouble*>(obj)->ptr()->value_),
+      encoder_->WriteUnsigned(kDoubleData);
+      encoder_->WriteBytes(&(static_cast<RawDouble*>(obj)->ptr()->value_),
                           sizeof(double));
     } else if (cid == kOneByteStringCid) {
       RawOneByteString* str = static_cast<RawOneByteString*>(obj);
       intptr_t len = Smi::Value(str->ptr()->length_);
       intptr_t trunc_len = Utils::Minimum(len, kMaxStringElements);
-      writer_->WriteUnsigned(kLatin1Data);
-      writer_->WriteUnsigned(len);
-      writer_->WriteUnsigned(trunc_len);
-      writer_->WriteBytes(&str->ptr()->data()[0], trunc_len);
+      encoder_->WriteUnsigned(kLatin1Data);
+      encoder_->WriteUnsigned(len);
+      encoder_->WriteUnsigned(trunc_len);
+      encoder_->WriteBytes(&str->ptr()->data()[0], trunc_len);
     } else if (cid == kExternalOneByteStringCid) {
       RawExternalOneByteString* str =
           static_cast<RawExternalOneByteString*>(obj);
       intptr_t len = Smi::Value(str->ptr()->length_);
       intptr_t trunc_len = Utils::Minimum(len, kMaxStringElements);
-      writer_->WriteUnsigned(kLatin1Data);
-      writer_->WriteUnsigned(len);
-      writer_->WriteUnsigned(trunc_len);
-      writer_->WriteBytes(&str->ptr()->external_data_[0], trunc_len);
+      encoder_->WriteUnsigned(kLatin1Data);
+      encoder_->WriteUnsigned(len);
+      encoder_->WriteUnsigned(trunc_len);
+      encoder_->WriteBytes(&str->ptr()->external_data_[0], trunc_len);
     } else if (cid == kTwoByteStringCid) {
       RawTwoByteString* str = static_cast<RawTwoByteString*>(obj);
       intptr_t len = Smi::Value(str->ptr()->length_);
       intptr_t trunc_len = Utils::Minimum(len, kMaxStringElements);
-      writer_->WriteUnsigned(kUTF16Data);
-      writer_->WriteUnsigned(len);
-      writer_->WriteUnsigned(trunc_len);
-      writer_->WriteBytes(&str->ptr()->data()[0], trunc_len * 2);
+      encoder_->WriteUnsigned(kUTF16Data);
+      encoder_->WriteUnsigned(len);
+      encoder_->WriteUnsigned(trunc_len);
+      encoder_->WriteBytes(&str->ptr()->data()[0], trunc_len * 2);
     } else if (cid == kExternalTwoByteStringCid) {
       RawExternalTwoByteString* str =
           static_cast<RawExternalTwoByteString*>(obj);
       intptr_t len = Smi::Value(str->ptr()->length_);
       intptr_t trunc_len = Utils::Minimum(len, kMaxStringElements);
-      writer_->WriteUnsigned(kUTF16Data);
-      writer_->WriteUnsigned(len);
-      writer_->WriteUnsigned(trunc_len);
-      writer_->WriteBytes(&str->ptr()->external_data_[0], trunc_len * 2);
+      encoder_->WriteUnsigned(kUTF16Data);
+      encoder_->WriteUnsigned(len);
+      encoder_->WriteUnsigned(trunc_len);
+      encoder_->WriteBytes(&str->ptr()->external_data_[0], trunc_len * 2);
     } else if (cid == kArrayCid || cid == kImmutableArrayCid) {
-      writer_->WriteUnsigned(kLengthData);
-      writer_->WriteUnsigned(
+      encoder_->WriteUnsigned(kLengthData);
+      encoder_->WriteUnsigned(
           Smi::Value(static_cast<RawArray*>(obj)->ptr()->length_));
     } else if (cid == kGrowableObjectArrayCid) {
-      writer_->WriteUnsigned(kLengthData);
-      writer_->WriteUnsigned(Smi::Value(
+      encoder_->WriteUnsigned(kLengthData);
+      encoder_->WriteUnsigned(Smi::Value(
           static_cast<RawGrowableObjectArray*>(obj)->ptr()->length_));
     } else if (cid == kLinkedHashMapCid) {
-      writer_->WriteUnsigned(kLengthData);
-      writer_->WriteUnsigned(
+      encoder_->WriteUnsigned(kLengthData);
+      encoder_->WriteUnsigned(
           Smi::Value(static_cast<RawLinkedHashMap*>(obj)->ptr()->used_data_));
     } else if (cid == kObjectPoolCid) {
-      writer_->WriteUnsigned(kLengthData);
-      writer_->WriteUnsigned(static_cast<RawObjectPool*>(obj)->ptr()->length_);
+      encoder_->WriteUnsigned(kLengthData);
+      encoder_->WriteUnsigned(static_cast<RawObjectPool*>(obj)->ptr()->length_);
     } else if (RawObject::IsTypedDataClassId(cid)) {
-      writer_->WriteUnsigned(kLengthData);
-      writer_->WriteUnsigned(
+      encoder_->WriteUnsigned(kLengthData);
+      encoder_->WriteUnsigned(
           Smi::Value(static_cast<RawTypedData*>(obj)->ptr()->length_));
     } else if (RawObject::IsExternalTypedDataClassId(cid)) {
-      writer_->WriteUnsigned(kLengthData);
-      writer_->WriteUnsigned(
+      encoder_->WriteUnsigned(kLengthData);
+      encoder_->WriteUnsigned(
           Smi::Value(static_cast<RawExternalTypedData*>(obj)->ptr()->length_));
     } else if (cid == kFunctionCid) {
-      writer_->WriteUnsigned(kNameData);
+      encoder_->WriteUnsigned(kNameData);
       ScrubAndWriteUtf8(static_cast<RawFunction*>(obj)->ptr()->name_);
     } else if (cid == kCodeCid) {
       RawObject* owner = static_cast<RawCode*>(obj)->ptr()->owner_;
       if (owner->IsFunction()) {
-        writer_->WriteUnsigned(kNameData);
+        encoder_->WriteUnsigned(kNameData);
         ScrubAndWriteUtf8(static_cast<RawFunction*>(owner)->ptr()->name_);
       } else if (owner->IsClass()) {
-        writer_->WriteUnsigned(kNameData);
+        encoder_->WriteUnsigned(kNameData);
         ScrubAndWriteUtf8(static_cast<RawClass*>(owner)->ptr()->name_);
       } else {
-        writer_->WriteUnsigned(kNoData);
+        encoder_->WriteUnsigned(kNoData);
       }
     } else if (cid == kFieldCid) {
-      writer_->WriteUnsigned(kNameData);
+      encoder_->WriteUnsigned(kNameData);
       ScrubAndWriteUtf8(static_cast<RawField*>(obj)->ptr()->name_);
     } else if (cid == kClassCid) {
-      writer_->WriteUnsigned(kNameData);
+      encoder_->WriteUnsigned(kNameData);
       ScrubAndWriteUtf8(static_cast<RawClass*>(obj)->ptr()->name_);
     } else if (cid == kLibraryCid) {
-      writer_->WriteUnsigned(kNameData);
+      encoder_->WriteUnsigned(kNameData);
       ScrubAndWriteUtf8(static_cast<RawLibrary*>(obj)->ptr()->url_);
     } else if (cid == kScriptCid) {
-      writer_->WriteUnsigned(kNameData);
+      encoder_->WriteUnsigned(kNameData);
       ScrubAndWriteUtf8(static_cast<RawScript*>(obj)->ptr()->url_);
     } else {
-      writer_->WriteUnsigned(kNoData);
+      encoder_->WriteUnsigned(kNoData);
     }
 
     DoCount();
@@ -777,12 +1049,12 @@ class Pass2Visitor : public ObjectVisitor,
 
   void ScrubAndWriteUtf8(RawString* str) {
     if (str == String::null()) {
-      writer_->WriteUtf8("null");
+      encoder_->WriteUtf8("null");
     } else {
       String handle;
       handle = str;
       char* value = handle.ToMallocCString();
-      writer_->ScrubAndWriteUtf8(value);
+      encoder_->ScrubAndWriteUtf8(value);
       free(value);
     }
   }
@@ -796,7 +1068,7 @@ class Pass2Visitor : public ObjectVisitor,
   }
   void DoWrite() {
     writing_ = true;
-    writer_->WriteUnsigned(counted_);
+    encoder_->WriteUnsigned(counted_);
   }
 
   void VisitPointers(RawObject** from, RawObject** to) {
@@ -805,7 +1077,7 @@ class Pass2Visitor : public ObjectVisitor,
         RawObject* target = *ptr;
         written_++;
         total_++;
-        writer_->WriteUnsigned(writer_->GetObjectId(target));
+        encoder_->WriteUnsigned(writer_->GetObjectId(target));
       }
     } else {
       intptr_t count = to - from + 1;
@@ -821,19 +1093,21 @@ class Pass2Visitor : public ObjectVisitor,
       return;  // Free handle.
     }
 
-    writer_->WriteUnsigned(writer_->GetObjectId(weak_persistent_handle->raw()));
-    writer_->WriteUnsigned(weak_persistent_handle->external_size());
+    encoder_->WriteUnsigned(
+        writer_->GetObjectId(weak_persistent_handle->raw()));
+    encoder_->WriteUnsigned(weak_persistent_handle->external_size());
     // Attempt to include a native symbol name.
     char* name = NativeSymbolResolver::LookupSymbolName(
         reinterpret_cast<uintptr_t>(weak_persistent_handle->callback()), NULL);
-    writer_->WriteUtf8((name == NULL) ? "Unknown native function" : name);
+    encoder_->WriteUtf8((name == NULL) ? "Unknown native function" : name);
     if (name != NULL) {
       NativeSymbolResolver::FreeSymbolName(name);
     }
   }
 
  private:
-  HeapSnapshotWriter* const writer_;
+  const HeapSnapshotWriter* const writer_;
+  HeapSnapshotEncoder* const encoder_;
   bool writing_ = false;
   intptr_t counted_ = 0;
   intptr_t written_ = 0;
@@ -843,6 +1117,43 @@ class Pass2Visitor : public ObjectVisitor,
   DISALLOW_COPY_AND_ASSIGN(Pass2Visitor);
 };
 
+class HeapSnapshotTask : public ThreadPool::Task {
+ public:
+  HeapSnapshotTask(Isolate* isolate,
+                   HeapSnapshotWriter* writer,
+                   ThreadBarrier* barrier)
+      : isolate_(isolate), writer_(writer), barrier_(barrier) {}
+
+  virtual void Run() {
+    bool result =
+        Thread::EnterIsolateAsHelper(isolate_, Thread::kHeapSnapshotTask, true);
+    ASSERT(result);
+
+    writer_->CountPages();
+    barrier_->Sync();
+
+    while (true) {
+      // Wait for the writer to hand out the next batch of pages.
+      barrier_->Sync();
+      if (writer_->pages_done_) {
+        break;
+      }
+      writer_->EncodePages();
+      barrier_->Sync();
+    }
+
+    Thread::ExitIsolateAsHelper(true);
+    barrier_->Exit();
+  }
+
+ private:
+  Isolate* isolate_;
+  HeapSnapshotWriter* writer_;
+  ThreadBarrier* barrier_;
+
+  DISALLOW_COPY_AND_ASSIGN(HeapSnapshotTask);
+};
+
 void HeapSnapshotWriter::Write() {
   HeapIterationScope iteration(thread());
 
@@ -963,6 +1274,15 @@ void HeapSnapshotWriter::Write() {
     }
   }
 
+  counting_pages_ = new CountingPageTable(H->old_space());
+  new_object_ids_ = H->GetWeakTable(Heap::kNew, Heap::kObjectIds);
+  old_object_ids_ = H->GetWeakTable(Heap::kOld, Heap::kObjectIds);
+  intptr_t num_tasks = FLAG_heap_snapshot_tasks;
+  if (num_tasks > counting_pages_->length()) {
+    num_tasks = counting_pages_->length();
+  }
+  ThreadBarrier barrier(num_tasks + 1, H->barrier(), H->barrier_done());
+
   {
     Pass1Visitor visitor(this);
 
@@ -971,16 +1291,26 @@ void HeapSnapshotWriter::Write() {
     isolate()->VisitObjectPointers(&visitor,
                                    ValidationPolicy::kDontValidateFrames);
 
-    // Heap objects.
+    // Heap objects not on counting pages.
     iteration.IterateVMIsolateObjects(&visitor);
-    iteration.IterateObjects(&visitor);
+    H->new_space()->VisitObjects(&visitor);
+    H->old_space()->VisitObjectsImagePages(&visitor);
 
     // External properties.
     isolate()->VisitWeakPersistentHandles(&visitor);
   }
 
+  // Heap objects on counting pages.
+  next_page_ = 0;
+  for (intptr_t i = 0; i < num_tasks; i++) {
+    Dart::thread_pool()->Run<HeapSnapshotTask>(isolate(), this, &barrier);
+  }
+  CountPages();
+  barrier.Sync();
+  AssignPageIds();
+
   {
-    Pass2Visitor visitor(this);
+    Pass2Visitor visitor(this, this);
 
     WriteUnsigned(reference_count_);
     WriteUnsigned(object_count_);
@@ -996,11 +1326,15 @@ void HeapSnapshotWriter::Write() {
     isolate()->VisitObjectPointers(&visitor,
                                    ValidationPolicy::kDontValidateFrames);
 
-    // Heap objects.
+    // Heap objects not on counting pages, in the order of pass 1.
     visitor.set_discount_sizes(true);
     iteration.IterateVMIsolateObjects(&visitor);
     visitor.set_discount_sizes(false);
-    iteration.IterateObjects(&visitor);
+    H->new_space()->VisitObjects(&visitor);
+    H->old_space()->VisitObjectsImagePages(&visitor);
+
+    // Heap objects on counting pages.
+    WritePages(&barrier, num_tasks);
 
     // External properties.
     WriteUnsigned(external_property_count_);
@@ -1011,6 +1345,679 @@ void HeapSnapshotWriter::Write() {
   Flush(true);
 }
 
+void HeapSnapshotWriter::CountPages() {
+  CountingPageVisitor visitor;
+  while (true) {
+    intptr_t index = AtomicOperations::FetchAndIncrement(&next_page_);
+    if (index >= counting_pages_->length()) {
+      break;
+    }
+    CountingPage* page = counting_pages_->At(index);
+    visitor.set_page(page);
+    page->page()->VisitObjects(&visitor);
+  }
+}
+
+void HeapSnapshotWriter::AssignPageIds() {
+  for (intptr_t i = 0; i < counting_pages_->length(); i++) {
+    CountingPage* page = counting_pages_->At(i);
+    page->set_first_id(object_count_ + 1);
+    object_count_ += page->object_count();
+    reference_count_ += page->reference_count();
+  }
+}
+
+void HeapSnapshotWriter::EncodePages() {
+  PageEncoder encoder;
+  Pass2Visitor visitor(this, &encoder);
+  while (true) {
+    intptr_t index = AtomicOperations::FetchAndIncrement(&next_page_);
+    if (index >= batch_end_) {
+      break;
+    }
+    CountingPage* page = counting_pages_->At(index);
+    page->page()->VisitObjects(&visitor);
+    uint8_t* data;
+    intptr_t size;
+    encoder.Steal(&data, &size);
+    page->SetEncoded(data, size);
+  }
+}
+
+void HeapSnapshotWriter::WritePages(ThreadBarrier* barrier,
+                                    intptr_t num_tasks) {
+  // Encoding a batch at a time bounds the memory held by encoded pages that
+  // have not been streamed out yet.
+  const intptr_t batch_size = (num_tasks + 1) * kPagesPerTaskBatch;
+  for (intptr_t batch_start = 0;; batch_start += batch_size) {
+    const intptr_t page_count = counting_pages_->length();
+    pages_done_ = batch_start >= page_count;
+    batch_end_ = Utils::Minimum(batch_start + batch_size, page_count);
+    next_page_ = batch_start;
+    barrier->Sync();
+    if (pages_done_) {
+      break;
+    }
+    EncodePages();
+    barrier->Sync();
+
+    for (intptr_t i = batch_start; i < batch_end_; i++) {
+      CountingPage* page = counting_pages_->At(i);
+      const uint8_t* data = page->encoded();
+      intptr_t remaining = page->encoded_size();
+      while (remaining > 0) {
+        intptr_t size = Utils::Minimum(remaining, kPreferredChunkSize);
+        WriteBytes(data, size);
+        data += size;
+        remaining -= size;
+      }
+      page->ClearEncoded();
+    }
+  }
+  barrier->Exit();
+}
+
+template <typename T>
+static T* AllocateZeroed(intptr_t length) {
+  T* result = reinterpret_cast<T*>(calloc(length, sizeof(T)));
+  if ((result == nullptr) && (length > 0)) {
+    OUT_OF_MEMORY();
+  }
+  return result;
+}
+
+// Numbers the objects that are not on counting pages.
+class NodeNumberingVisitor : public ObjectVisitor {
+ public:
+  NodeNumberingVisitor(Heap* heap, intptr_t count)
+      : ObjectVisitor(), heap_(heap), count_(count) {}
+
+  void VisitObject(RawObject* obj) {
+    if (obj->IsPseudoObject()) return;
+    heap_->SetObjectId(obj, ++count_);
+  }
+
+  intptr_t count() const { return count_; }
+
+ private:
+  Heap* const heap_;
+  intptr_t count_;
+
+  DISALLOW_COPY_AND_ASSIGN(NodeNumberingVisitor);
+};
+
+// Counts the edges of the root and the objects not on counting pages, or
+// numbers the objects on a counting page and counts their edges.
+class EdgeCountingVisitor : public ObjectVisitor, public ObjectPointerVisitor {
+ public:
+  explicit EdgeCountingVisitor(const DominatorTree* tree)
+      : ObjectVisitor(),
+        ObjectPointerVisitor(Isolate::Current()),
+        tree_(tree) {}
+
+  void set_page(CountingPage* page) { page_ = page; }
+  intptr_t count() const { return count_; }
+
+  void VisitObject(RawObject* obj) {
+    if (obj->IsPseudoObject()) return;
+
+    if (page_ != nullptr) {
+      page_->Record(RawObject::ToAddr(obj));
+    }
+    obj->VisitPointers(this);
+  }
+
+  void VisitPointers(RawObject** from, RawObject** to) {
+    intptr_t count = 0;
+    for (RawObject** ptr = from; ptr <= to; ptr++) {
+      if (tree_->IsNode(*ptr)) {
+        count++;
+      }
+    }
+    if (page_ != nullptr) {
+      page_->CountReferences(count);
+    } else {
+      count_ += count;
+    }
+  }
+
+ private:
+  const DominatorTree* const tree_;
+  CountingPage* page_ = nullptr;
+  intptr_t count_ = 0;
+
+  DISALLOW_COPY_AND_ASSIGN(EdgeCountingVisitor);
+};
+
+// Records the class, size and edges of consecutively numbered nodes.
+class EdgeCollectingVisitor : public ObjectVisitor,
+                              public ObjectPointerVisitor {
+ public:
+  EdgeCollectingVisitor(const DominatorTree* tree,
+                        classid_t* cids,
+                        intptr_t* sizes,
+                        intptr_t* edge_starts,
+                        DominatorTree::NodeId* edges)
+      : ObjectVisitor(),
+        ObjectPointerVisitor(Isolate::Current()),
+        tree_(tree),
+        cids_(cids),
+        sizes_(sizes),
+        edge_starts_(edge_starts),
+        edges_(edges) {}
+
+  void Reset(intptr_t first_id, intptr_t first_edge) {
+    next_id_ = first_id;
+    next_edge_ = first_edge;
+  }
+  intptr_t next_id() const { return next_id_; }
+  intptr_t next_edge() const { return next_edge_; }
+
+  void StartNode(classid_t cid, intptr_t size) {
+    cids_[next_id_] = cid;
+    sizes_[next_id_] = size;
+    edge_starts_[next_id_] = next_edge_;
+    next_id_++;
+  }
+
+  void VisitObject(RawObject* obj) {
+    if (obj->IsPseudoObject()) return;
+
+    StartNode(obj->GetClassId(), obj->HeapSize());
+    obj->VisitPointers(this);
+  }
+
+  void VisitPointers(RawObject** from, RawObject** to) {
+    for (RawObject** ptr = from; ptr <= to; ptr++) {
+      DominatorTree::NodeId id = tree_->GetNodeId(*ptr);
+      if (id != 0) {
+        edges_[next_edge_++] = id;
+      }
+    }
+  }
+
+ private:
+  const DominatorTree* const tree_;
+  classid_t* const cids_;
+  intptr_t* const sizes_;
+  intptr_t* const edge_starts_;
+  DominatorTree::NodeId* const edges_;
+  intptr_t next_id_ = 0;
+  intptr_t next_edge_ = 0;
+
+  DISALLOW_COPY_AND_ASSIGN(EdgeCollectingVisitor);
+};
+
+class DominatorTreeTask : public ThreadPool::Task {
+ public:
+  DominatorTreeTask(Isolate* isolate,
+                    DominatorTree* tree,
+                    ThreadBarrier* barrier)
+      : isolate_(isolate), tree_(tree), barrier_(barrier) {}
+
+  virtual void Run() {
+    bool result =
+        Thread::EnterIsolateAsHelper(isolate_, Thread::kHeapSnapshotTask, true);
+    ASSERT(result);
+
+    tree_->CountPages();
+    barrier_->Sync();
+    // Wait for the tree to number the pages.
+    barrier_->Sync();
+    if (!tree_->too_large_) {
+      tree_->CollectPageEdges();
+    }
+
+    Thread::ExitIsolateAsHelper(true);
+    barrier_->Exit();
+  }
+
+ private:
+  Isolate* isolate_;
+  DominatorTree* tree_;
+  ThreadBarrier* barrier_;
+
+  DISALLOW_COPY_AND_ASSIGN(DominatorTreeTask);
+};
+
+DominatorTree::DominatorTree(Thread* thread) : ThreadStackResource(thread) {}
+
+DominatorTree::~DominatorTree() {
+  free(instance_counts_);
+  free(shallow_sizes_);
+  free(retained_sizes_);
+  free(cids_);
+  free(sizes_);
+  free(edge_starts_);
+  free(edges_);
+  free(predecessor_starts_);
+  free(predecessors_);
+  free(semi_);
+  free(vertex_);
+  free(parent_);
+  free(dom_);
+}
+
+bool DominatorTree::IsNode(RawObject* obj) const {
+  if (!obj->IsHeapObject()) {
+    return false;
+  }
+  if (counting_pages_->Find(obj) != nullptr) {
+    return true;
+  }
+  WeakTable* table = obj->IsNewObject() ? new_object_ids_ : old_object_ids_;
+  return table->GetValueExclusive(obj) != 0;
+}
+
+DominatorTree::NodeId DominatorTree::GetNodeId(RawObject* obj) const {
+  if (!obj->IsHeapObject()) {
+    return 0;
+  }
+  CountingPage* page = counting_pages_->Find(obj);
+  if (page != nullptr) {
+    return page->Lookup(RawObject::ToAddr(obj));
+  }
+  // The table is not modified once nodes have been numbered.
+  WeakTable* table = obj->IsNewObject() ? new_object_ids_ : old_object_ids_;
+  return table->GetValueExclusive(obj);
+}
+
+bool DominatorTree::Compute() {
+  class_count_ = isolate()->class_table()->NumCids();
+  instance_counts_ = AllocateZeroed<intptr_t>(class_count_);
+  shallow_sizes_ = AllocateZeroed<intptr_t>(class_count_);
+  retained_sizes_ = AllocateZeroed<intptr_t>(class_count_);
+
+  if (!BuildGraph()) {
+    return false;
+  }
+  NumberDepthFirst();
+  ComputePredecessors();
+  ComputeDominators();
+  ComputeRetainedSizes();
+  SummarizeByClass();
+  return true;
+}
+
+bool DominatorTree::BuildGraph() {
+  HeapIterationScope iteration(thread());
+  Heap* heap = thread()->heap();
+  counting_pages_ = new CountingPageTable(heap->old_space());
+  new_object_ids_ = heap->GetWeakTable(Heap::kNew, Heap::kObjectIds);
+  old_object_ids_ = heap->GetWeakTable(Heap::kOld, Heap::kObjectIds);
+
+  // The root and the objects not on counting pages are numbered first.
+  NodeNumberingVisitor numbering(heap, kRootNode);
+  heap->new_space()->VisitObjects(&numbering);
+  heap->old_space()->VisitObjectsImagePages(&numbering);
+  node_count_ = numbering.count();
+
+  {
+    EdgeCountingVisitor visitor(this);
+    isolate()->VisitObjectPointers(&visitor,
+                                   ValidationPolicy::kDontValidateFrames);
+    heap->new_space()->VisitObjects(&visitor);
+    heap->old_space()->VisitObjectsImagePages(&visitor);
+    edge_count_ = visitor.count();
+  }
+  const intptr_t unpaged_edge_count = edge_count_;
+
+  intptr_t num_tasks = FLAG_heap_snapshot_tasks;
+  if (num_tasks > counting_pages_->length()) {
+    num_tasks = counting_pages_->length();
+  }
+  ThreadBarrier barrier(num_tasks + 1, heap->barrier(), heap->barrier_done());
+  next_page_ = 0;
+  for (intptr_t i = 0; i < num_tasks; i++) {
+    Dart::thread_pool()->Run<DominatorTreeTask>(isolate(), this, &barrier);
+  }
+  CountPages();
+  barrier.Sync();
+  too_large_ = !AssignPageIds();
+  next_page_ = 0;
+  barrier.Sync();
+
+  if (!too_large_) {
+    EdgeCollectingVisitor visitor(this, cids_, sizes_, edge_starts_, edges_);
+    visitor.Reset(kRootNode, 0);
+    visitor.StartNode(kIllegalCid, 0);
+    isolate()->VisitObjectPointers(&visitor,
+                                   ValidationPolicy::kDontValidateFrames);
+    heap->new_space()->VisitObjects(&visitor);
+    heap->old_space()->VisitObjectsImagePages(&visitor);
+    ASSERT(visitor.next_id() == numbering.count() + 1);
+    ASSERT(visitor.next_edge() == unpaged_edge_count);
+    CollectPageEdges();
+  }
+  barrier.Exit();
+
+  heap->ResetObjectIdTable();
+  delete counting_pages_;
+  counting_pages_ = nullptr;
+  return !too_large_;
+}
+
+void DominatorTree::CountPages() {
+  EdgeCountingVisitor visitor(this);
+  while (true) {
+    intptr_t index = AtomicOperations::FetchAndIncrement(&next_page_);
+    if (index >= counting_pages_->length()) {
+      break;
+    }
+    CountingPage* page = counting_pages_->At(index);
+    visitor.set_page(page);
+    page->page()->VisitObjects(&visitor);
+  }
+}
+
+bool DominatorTree::AssignPageIds() {
+  for (intptr_t i = 0; i < counting_pages_->length(); i++) {
+    CountingPage* page = counting_pages_->At(i);
+    page->set_first_id(node_count_ + 1);
+    page->set_first_reference(edge_count_);
+    node_count_ += page->object_count();
+    edge_count_ += page->reference_count();
+  }
+  if (static_cast<uint64_t>(node_count_) >= kMaxUint32) {
+    return false;
+  }
+
+  cids_ = AllocateZeroed<classid_t>(node_count_ + 1);
+  sizes_ = AllocateZeroed<intptr_t>(node_count_ + 1);
+  edge_starts_ = AllocateZeroed<intptr_t>(node_count_ + 2);
+  edges_ = AllocateZeroed<NodeId>(edge_count_);
+  edge_starts_[node_count_ + 1] = edge_count_;
+  return true;
+}
+
+void DominatorTree::CollectPageEdges() {
+  EdgeCollectingVisitor visitor(this, cids_, sizes_, edge_starts_, edges_);
+  while (true) {
+    intptr_t index = AtomicOperations::FetchAndIncrement(&next_page_);
+    if (index >= counting_pages_->length()) {
+      break;
+    }
+    CountingPage* page = counting_pages_->At(index);
+    visitor.Reset(page->first_id(), page->first_reference());
+    page->page()->VisitObjects(&visitor);
+    ASSERT(visitor.next_id() == page->first_id() + page->object_count());
+    ASSERT(visitor.next_edge() ==
+           page->first_reference() + page->reference_count());
+  }
+}
+
+void DominatorTree::NumberDepthFirst() {
+  semi_ = AllocateZeroed<NodeId>(node_count_ + 1);
+  vertex_ = AllocateZeroed<NodeId>(node_count_ + 1);
+  parent_ = AllocateZeroed<NodeId>(node_count_ + 1);
+
+  // An explicit stack of nodes and the index of their next edge to follow.
+  NodeId* stack = AllocateZeroed<NodeId>(node_count_ + 1);
+  intptr_t* next_edges = AllocateZeroed<intptr_t>(node_count_ + 1);
+  NodeId count = 0;
+  intptr_t depth = 0;
+
+  semi_[kRootNode] = ++count;
+  vertex_[count] = kRootNode;
+  stack[depth] = kRootNode;
+  next_edges[depth] = edge_starts_[kRootNode];
+  depth++;
+  while (depth > 0) {
+    NodeId v = stack[depth - 1];
+    intptr_t edge = next_edges[depth - 1];
+    if (edge == edge_starts_[v + 1]) {
+      depth--;
+      continue;
+    }
+    next_edges[depth - 1] = edge + 1;
+    NodeId w = edges_[edge];
+    if (semi_[w] == 0) {
+      semi_[w] = ++count;
+      vertex_[count] = w;
+      parent_[w] = v;
+      stack[depth] = w;
+      next_edges[depth] = edge_starts_[w];
+      depth++;
+    }
+  }
+  free(stack);
+  free(next_edges);
+
+  // Excluding the root.
+  reachable_count_ = count - 1;
+}
+
+void DominatorTree::ComputePredecessors() {
+  // Count the predecessors of each node, then turn the counts into the end
+  // of each node's predecessors and fill them in backwards.
+  predecessor_starts_ = AllocateZeroed<intptr_t>(node_count_ + 2);
+  for (intptr_t i = 1; i <= reachable_count_ + 1; i++) {
+    NodeId v = vertex_[i];
+    for (intptr_t e = edge_starts_[v]; e < edge_starts_[v + 1]; e++) {
+      predecessor_starts_[edges_[e]]++;
+    }
+  }
+  for (intptr_t i = 1; i <= node_count_ + 1; i++) {
+    predecessor_starts_[i] += predecessor_starts_[i - 1];
+  }
+  predecessors_ =
+      AllocateZeroed<NodeId>(predecessor_starts_[node_count_ + 1]);
+  for (intptr_t i = 1; i <= reachable_count_ + 1; i++) {
+    NodeId v = vertex_[i];
+    for (intptr_t e = edge_starts_[v]; e < edge_starts_[v + 1]; e++) {
+      predecessors_[--predecessor_starts_[edges_[e]]] = v;
+    }
+  }
+
+  // Only the predecessors are needed from here on.
+  free(edges_);
+  edges_ = nullptr;
+  free(edge_starts_);
+  edge_starts_ = nullptr;
+}
+
+// Lengauer and Tarjan, "A fast algorithm for finding dominators in a
+// flowgraph", with simple path compression.
+void DominatorTree::ComputeDominators() {
+  dom_ = AllocateZeroed<NodeId>(node_count_ + 1);
+  NodeId* ancestor = AllocateZeroed<NodeId>(node_count_ + 1);
+  NodeId* label = AllocateZeroed<NodeId>(node_count_ + 1);
+  NodeId* bucket = AllocateZeroed<NodeId>(node_count_ + 1);
+  NodeId* next_in_bucket = AllocateZeroed<NodeId>(node_count_ + 1);
+  NodeId* path = AllocateZeroed<NodeId>(node_count_ + 1);
+  for (intptr_t i = 1; i <= node_count_; i++) {
+    label[i] = i;
+  }
+
+  for (intptr_t i = reachable_count_ + 1; i >= 2; i--) {
+    NodeId w = vertex_[i];
+    for (intptr_t p = predecessor_starts_[w]; p < predecessor_starts_[w + 1];
+         p++) {
+      NodeId u = Eval(predecessors_[p], ancestor, label, path);
+      if (semi_[u] < semi_[w]) {
+        semi_[w] = semi_[u];
+      }
+    }
+    NodeId semidominator = vertex_[semi_[w]];
+    next_in_bucket[w] = bucket[semidominator];
+    bucket[semidominator] = w;
+
+    NodeId parent = parent_[w];
+    ancestor[w] = parent;
+    for (NodeId v = bucket[parent]; v != 0; v = next_in_bucket[v]) {
+      NodeId u = Eval(v, ancestor, label, path);
+      dom_[v] = (semi_[u] < semi_[v]) ? u : parent;
+    }
+    bucket[parent] = 0;
+  }
+  for (intptr_t i = 2; i <= reachable_count_ + 1; i++) {
+    NodeId w = vertex_[i];
+    if (dom_[w] != vertex_[semi_[w]]) {
+      dom_[w] = dom_[dom_[w]];
+    }
+  }
+  dom_[kRootNode] = 0;
+
+  free(ancestor);
+  free(label);
+  free(bucket);
+  free(next_in_bucket);
+  free(path);
+  free(predecessor_starts_);
+  predecessor_starts_ = nullptr;
+  free(predecessors_);
+  predecessors_ = nullptr;
+}
+
+// The node with the smallest semidominator on the path from v up to the root
+// of its tree in the forest linked so far, compressing the path.
+DominatorTree::NodeId DominatorTree::Eval(NodeId v,
+                                          NodeId* ancestor,
+                                          NodeId* label,
+                                          NodeId* path) {
+  if (ancestor[v] == 0) {
+    return v;
+  }
+  intptr_t length = 0;
+  for (NodeId x = v; ancestor[ancestor[x]] != 0; x = ancestor[x]) {
+    path[length++] = x;
+  }
+  // Compress from the top of the path down.
+  while (length > 0) {
+    NodeId x = path[--length];
+    NodeId a = ancestor[x];
+    if (semi_[label[a]] < semi_[label[x]]) {
+      label[x] = label[a];
+    }
+    ancestor[x] = ancestor[a];
+  }
+  return label[v];
+}
+
+void DominatorTree::ComputeRetainedSizes() {
+  for (intptr_t i = 2; i <= reachable_count_ + 1; i++) {
+    NodeId w = vertex_[i];
+    instance_counts_[cids_[w]]++;
+    shallow_sizes_[cids_[w]] += sizes_[w];
+  }
+  // A node comes after its dominator in preorder.
+  for (intptr_t i = reachable_count_ + 1; i >= 2; i--) {
+    NodeId w = vertex_[i];
+    sizes_[dom_[w]] += sizes_[w];
+  }
+  reachable_size_ = sizes_[kRootNode];
+}
+
+void DominatorTree::SummarizeByClass() {
+  // The children of each node in the dominator tree.
+  intptr_t* child_starts = AllocateZeroed<intptr_t>(node_count_ + 2);
+  NodeId* children = AllocateZeroed<NodeId>(reachable_count_ + 1);
+  for (intptr_t i = 2; i <= reachable_count_ + 1; i++) {
+    child_starts[dom_[vertex_[i]]]++;
+  }
+  for (intptr_t i = 1; i <= node_count_ + 1; i++) {
+    child_starts[i] += child_starts[i - 1];
+  }
+  for (intptr_t i = 2; i <= reachable_count_ + 1; i++) {
+    NodeId w = vertex_[i];
+    children[--child_starts[dom_[w]]] = w;
+  }
+
+  // Walk the dominator tree, counting an instance only if no instance of its
+  // class dominates it.
+  intptr_t* class_depths = AllocateZeroed<intptr_t>(class_count_);
+  NodeId* stack = AllocateZeroed<NodeId>(reachable_count_ + 1);
+  intptr_t* next_children = AllocateZeroed<intptr_t>(reachable_count_ + 1);
+  intptr_t depth = 0;
+  stack[depth] = kRootNode;
+  next_children[depth] = child_starts[kRootNode];
+  depth++;
+  while (depth > 0) {
+    NodeId v = stack[depth - 1];
+    intptr_t child = next_children[depth - 1];
+    if (child == child_starts[v + 1]) {
+      if (v != kRootNode) {
+        class_depths[cids_[v]]--;
+      }
+      depth--;
+      continue;
+    }
+    next_children[depth - 1] = child + 1;
+    NodeId w = children[child];
+    if (class_depths[cids_[w]]++ == 0) {
+      retained_sizes_[cids_[w]] += sizes_[w];
+    }
+    stack[depth] = w;
+    next_children[depth] = child_starts[w];
+    depth++;
+  }
+
+  free(class_depths);
+  free(stack);
+  free(next_children);
+  free(child_starts);
+  free(children);
+}
+
+intptr_t DominatorTree::InstanceCount(intptr_t cid) const {
+  return (cid < class_count_) ? instance_counts_[cid] : 0;
+}
+
+intptr_t DominatorTree::ShallowSize(intptr_t cid) const {
+  return (cid < class_count_) ? shallow_sizes_[cid] : 0;
+}
+
+intptr_t DominatorTree::RetainedSize(intptr_t cid) const {
+  return (cid < class_count_) ? retained_sizes_[cid] : 0;
+}
+
+struct ClassRetainers {
+  intptr_t cid;
+  intptr_t retained_size;
+};
+
+static int CompareClassRetainers(const void* a, const void* b) {
+  intptr_t a_size = static_cast<const ClassRetainers*>(a)->retained_size;
+  intptr_t b_size = static_cast<const ClassRetainers*>(b)->retained_size;
+  // Largest first.
+  return (a_size > b_size) ? -1 : ((a_size < b_size) ? 1 : 0);
+}
+
+void DominatorTree::PrintTopRetainersJSON(JSONStream* js,
+                                          intptr_t limit) const {
+  ClassRetainers* classes = AllocateZeroed<ClassRetainers>(class_count_);
+  intptr_t length = 0;
+  for (intptr_t cid = 1; cid < class_count_; cid++) {
+    if (retained_sizes_[cid] > 0) {
+      classes[length].cid = cid;
+      classes[length].retained_size = retained_sizes_[cid];
+      length++;
+    }
+  }
+  qsort(classes, length, sizeof(ClassRetainers), CompareClassRetainers);
+
+  JSONObject jsobj(js);
+  jsobj.AddProperty("type", "_TopRetainers");
+  jsobj.AddProperty64("objectCount", reachable_count_);
+  jsobj.AddProperty64("size", reachable_size_);
+  {
+    JSONArray members(&jsobj, "members");
+    ClassTable* class_table = isolate()->class_table();
+    Class& cls = Class::Handle(thread()->zone());
+    for (intptr_t i = 0; i < Utils::Minimum(length, limit); i++) {
+      intptr_t cid = classes[i].cid;
+      cls = class_table->At(cid);
+      JSONObject member(&members);
+      member.AddProperty("type", "_ClassRetainers");
+      member.AddProperty("class", cls);
+      member.AddProperty64("instanceCount", instance_counts_[cid]);
+      member.AddProperty64("shallowSize", shallow_sizes_[cid]);
+      member.AddProperty64("retainedSize", retained_sizes_[cid]);
+    }
+  }
+  free(classes);
+}
+
 #endif  // !defined(PRODUCT)
 
 }  // namespace dart
@@ -112,12 +112,9 @@ class ObjectGraph : public ThreadStackResource {
   DISALLOW_IMPLICIT_CONSTRUCTORS(ObjectGraph);
 };
 
-// Generates a dump of the heap, whose format is described in
-// runtime/vm/service/heap_snapshot.md.
-class HeapSnapshotWriter : public ThreadStackResource {
+// Buffers the variable-length encoding used by heap snapshots.
+class HeapSnapshotEncoder {
  public:
-  explicit HeapSnapshotWriter(Thread* thread) : ThreadStackResource(thread) {}
-
   void WriteSigned(int64_t value) {
     EnsureAvailable((sizeof(value) * kBitsPerByte) / 7 + 1);
 
@@ -173,33 +170,199 @@ class HeapSnapshotWriter : public ThreadStackResource {
     WriteBytes(value, len);
   }
 
+ protected:
+  HeapSnapshotEncoder() {}
+  virtual ~HeapSnapshotEncoder() {}
+
+  void EnsureAvailable(intptr_t needed) {
+    if (capacity_ - size_ < needed) {
+      Grow(needed);
+    }
+  }
+
+  // Makes room for at least 'needed' more bytes.
+  virtual void Grow(intptr_t needed) = 0;
+
+  uint8_t* buffer_ = nullptr;
+  intptr_t size_ = 0;
+  intptr_t capacity_ = 0;
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(HeapSnapshotEncoder);
+};
+
+class CountingPageTable;
+class JSONStream;
+class ThreadBarrier;
+class WeakTable;
+
+// Generates a dump of the heap, whose format is described in
+// runtime/vm/service/heap_snapshot.md.
+//
+// The dump is streamed out in chunks of about kPreferredChunkSize bytes,
+// optionally LZ4-compressed. Objects on the isolate's regular and large pages
+// are counted and encoded in parallel by FLAG_heap_snapshot_tasks helpers, a
+// bounded batch of pages at a time. Their ids are kept in a side table of one
+// bit per allocation unit instead of the heap's object id table.
+class HeapSnapshotWriter : public ThreadStackResource,
+                           public HeapSnapshotEncoder {
+ public:
+  explicit HeapSnapshotWriter(Thread* thread, bool compress = false)
+      : ThreadStackResource(thread), compress_(compress) {}
+
   void AssignObjectId(RawObject* obj);
-  intptr_t GetObjectId(RawObject* obj);
+  // Safe to call from helper tasks once all ids are assigned.
+  intptr_t GetObjectId(RawObject* obj) const;
   void ClearObjectIds();
   void CountReferences(intptr_t count);
   void CountExternalProperty();
 
   void Write();
 
- private:
+ protected:
   static const intptr_t kMetadataReservation = 512;
+
+  // Streams a chunk of the snapshot to the service isolate. The data starts
+  // at kMetadataReservation in buffer, which the callee takes ownership of.
+  // uncompressed_size is 0 unless the data is compressed.
+  virtual void WriteChunk(uint8_t* buffer,
+                          intptr_t size,
+                          intptr_t uncompressed_size,
+                          bool last);
+
+ private:
   static const intptr_t kPreferredChunkSize = MB;
+  static const intptr_t kPagesPerTaskBatch = 4;
 
-  void EnsureAvailable(intptr_t needed);
+  virtual void Grow(intptr_t needed);
   void Flush(bool last = false);
 
-  uint8_t* buffer_ = nullptr;
-  intptr_t size_ = 0;
-  intptr_t capacity_ = 0;
+  // Run by the writer and its helper tasks.
+  void CountPages();
+  void EncodePages();
+
+  void AssignPageIds();
+  void WritePages(ThreadBarrier* barrier, intptr_t num_tasks);
+
+  const bool compress_;
 
   intptr_t class_count_ = 0;
   intptr_t object_count_ = 0;
   intptr_t reference_count_ = 0;
   intptr_t external_property_count_ = 0;
 
+  WeakTable* new_object_ids_ = nullptr;
+  WeakTable* old_object_ids_ = nullptr;
+
+  CountingPageTable* counting_pages_ = nullptr;
+
+  // Index of the next page to claim, and the end of the current batch.
+  intptr_t next_page_ = 0;
+  intptr_t batch_end_ = 0;
+  bool pages_done_ = false;
+
+  friend class HeapSnapshotTask;
+
   DISALLOW_COPY_AND_ASSIGN(HeapSnapshotWriter);
 };
 
+// Computes the dominator tree of the objects reachable from the isolate's
+// roots with the Lengauer-Tarjan algorithm, and the memory each object
+// retains: the total size of the objects it dominates, which would become
+// unreachable without it.
+//
+// The graph is built while the heap is paused. Objects on the isolate's
+// regular and large pages are numbered and their references collected in
+// parallel by FLAG_heap_snapshot_tasks helpers, page by page. The depth-first
+// numbering and the dominator computation are sequential and run on the
+// graph alone. Objects in the VM isolate are left out, and weak persistent
+// handles do not retain their referents.
+class DominatorTree : public ThreadStackResource {
+ public:
+  explicit DominatorTree(Thread* thread);
+  ~DominatorTree();
+
+  // Returns false if the heap has too many objects to analyze.
+  bool Compute();
+
+  // The objects reachable from the roots, and their total size.
+  intptr_t reachable_count() const { return reachable_count_; }
+  intptr_t reachable_size() const { return reachable_size_; }
+
+  // The reachable instances of a class, and their total size.
+  intptr_t InstanceCount(intptr_t cid) const;
+  intptr_t ShallowSize(intptr_t cid) const;
+
+  // The memory retained by the instances of a class. Objects dominated by
+  // several of them, such as the elements of a linked list, count once.
+  intptr_t RetainedSize(intptr_t cid) const;
+
+  // Prints the 'limit' classes retaining the most memory.
+  void PrintTopRetainersJSON(JSONStream* js, intptr_t limit) const;
+
+  // Node 0 stands for references that are not edges of the graph, such as
+  // Smis. Node 1 is the root.
+  typedef uint32_t NodeId;
+
+  // Used by helper tasks while the graph is built. Objects on counting pages
+  // are only numbered once all pages have been counted.
+  bool IsNode(RawObject* obj) const;
+  NodeId GetNodeId(RawObject* obj) const;
+
+ private:
+  static const NodeId kRootNode = 1;
+
+  bool BuildGraph();
+  bool AssignPageIds();
+
+  // Run by the tree and its helper tasks.
+  void CountPages();
+  void CollectPageEdges();
+
+  void NumberDepthFirst();
+  void ComputePredecessors();
+  void ComputeDominators();
+  NodeId Eval(NodeId v, NodeId* ancestor, NodeId* label, NodeId* path);
+  void ComputeRetainedSizes();
+  void SummarizeByClass();
+
+  intptr_t class_count_ = 0;
+  intptr_t* instance_counts_ = nullptr;
+  intptr_t* shallow_sizes_ = nullptr;
+  intptr_t* retained_sizes_ = nullptr;
+  intptr_t reachable_count_ = 0;
+  intptr_t reachable_size_ = 0;
+
+  // Numbering of the heap while the graph is built.
+  CountingPageTable* counting_pages_ = nullptr;
+  WeakTable* new_object_ids_ = nullptr;
+  WeakTable* old_object_ids_ = nullptr;
+  intptr_t next_page_ = 0;
+  bool too_large_ = false;
+
+  // The graph: per node its class, its size and the start of its edges in
+  // 'edges_', all indexed by node.
+  intptr_t node_count_ = 0;
+  intptr_t edge_count_ = 0;
+  classid_t* cids_ = nullptr;
+  intptr_t* sizes_ = nullptr;
+  intptr_t* edge_starts_ = nullptr;
+  NodeId* edges_ = nullptr;
+  intptr_t* predecessor_starts_ = nullptr;
+  NodeId* predecessors_ = nullptr;
+
+  // The depth-first spanning tree: the preorder number of each node, or 0 if
+  // it is unreachable, and the nodes in preorder.
+  NodeId* semi_ = nullptr;
+  NodeId* vertex_ = nullptr;
+  NodeId* parent_ = nullptr;
+  NodeId* dom_ = nullptr;
+
+  friend class DominatorTreeTask;
+
+  DISALLOW_COPY_AND_ASSIGN(DominatorTree);
+};
+
 #endif  // !defined(PRODUCT)
 
 }  // namespace dart
@@ -4,6 +4,7 @@
 
 #include "vm/object_graph.h"
 #include "platform/assert.h"
+#include "vm/lz4.h"
 #include "vm/unit_test.h"
 
 namespace dart {
@@ -194,6 +195,382 @@ ISOLATE_UNIT_TEST_CASE(RetainingPathGCRoot) {
   EXPECT_STREQ(result.gc_root_type, "local handle");
 }
 
+// Runs test once without helper tasks and once with two of them.
+template <typename Test>
+static void ForEachHeapSnapshotTaskCount(const Test& test) {
+  for (int tasks = 0; tasks <= 2; tasks += 2) {
+    SetFlagScope<int> sfs(&FLAG_heap_snapshot_tasks, tasks);
+    test();
+  }
+}
+
+// Collects the uncompressed data of a heap snapshot instead of streaming it
+// to the service isolate.
+class CollectingHeapSnapshotWriter : public HeapSnapshotWriter {
+ public:
+  CollectingHeapSnapshotWriter(Thread* thread, bool compress)
+      : HeapSnapshotWriter(thread, compress), compress_(compress) {}
+
+  const MallocGrowableArray<uint8_t>& data() const { return data_; }
+  bool done() const { return done_; }
+
+ protected:
+  virtual void WriteChunk(uint8_t* buffer,
+                          intptr_t size,
+                          intptr_t uncompressed_size,
+                          bool last) {
+    EXPECT(!done_);
+    done_ = last;
+    if (buffer == nullptr) {
+      return;
+    }
+    const uint8_t* chunk = &buffer[kMetadataReservation];
+    const intptr_t length = size - kMetadataReservation;
+    if (compress_) {
+      uint8_t* decompressed =
+          reinterpret_cast<uint8_t*>(malloc(uncompressed_size));
+      EXPECT_EQ(uncompressed_size, LZ4::Decompress(chunk, length, decompressed,
+                                                   uncompressed_size));
+      Append(decompressed, uncompressed_size);
+      free(decompressed);
+    } else {
+      Append(chunk, length);
+    }
+    free(buffer);
+  }
+
+ private:
+  void Append(const uint8_t* bytes, intptr_t length) {
+    for (intptr_t i = 0; i < length; i++) {
+      data_.Add(bytes[i]);
+    }
+  }
+
+  const bool compress_;
+  MallocGrowableArray<uint8_t> data_;
+  bool done_ = false;
+};
+
+// Decodes the objects of a heap snapshot, as described in
+// runtime/vm/service/heap_snapshot.md.
+class HeapSnapshotReader : public ValueObject {
+ public:
+  explicit HeapSnapshotReader(const MallocGrowableArray<uint8_t>& data)
+      : data_(data), position_(0) {}
+
+  void Read() {
+    const char* magic = "dartheap";
+    for (intptr_t i = 0; i < 8; i++) {
+      EXPECT_EQ(magic[i], static_cast<char>(ReadByte()));
+    }
+    ReadUnsigned();  // Flags.
+    SkipUtf8();      // Name.
+    ReadUnsigned();  // Shallow size.
+    ReadUnsigned();  // Capacity.
+    ReadUnsigned();  // External size.
+
+    const intptr_t class_count = ReadUnsigned();
+    for (intptr_t cid = 1; cid <= class_count; cid++) {
+      ReadUnsigned();  // Flags.
+      if (cid == kArrayCid) {
+        array_class_name_ = ReadUtf8();
+      } else {
+        SkipUtf8();
+      }
+      SkipUtf8();  // Library name.
+      SkipUtf8();  // Library uri.
+      SkipUtf8();  // Reserved.
+      const intptr_t field_count = ReadUnsigned();
+      for (intptr_t i = 0; i < field_count; i++) {
+        ReadUnsigned();  // Flags.
+        ReadUnsigned();  // Index.
+        SkipUtf8();      // Name.
+        SkipUtf8();      // Reserved.
+      }
+    }
+
+    reference_count_ = ReadUnsigned();
+    const intptr_t object_count = ReadUnsigned();
+    for (intptr_t id = 1; id <= object_count; id++) {
+      cids_.Add(ReadUnsigned());
+      sizes_.Add(ReadUnsigned());
+      lengths_.Add(ReadData());
+      first_references_.Add(references_.length());
+      const intptr_t count = ReadUnsigned();
+      for (intptr_t i = 0; i < count; i++) {
+        references_.Add(ReadUnsigned());
+      }
+    }
+    first_references_.Add(references_.length());
+
+    const intptr_t external_property_count = ReadUnsigned();
+    for (intptr_t i = 0; i < external_property_count; i++) {
+      const intptr_t id = ReadUnsigned();
+      EXPECT(id > 0 && id <= object_count);
+      ReadUnsigned();  // External size.
+      SkipUtf8();      // Name.
+    }
+    EXPECT_EQ(data_.length(), position_);
+  }
+
+  intptr_t object_count() const { return cids_.length(); }
+  intptr_t reference_count() const { return reference_count_; }
+  const char* array_class_name() const { return array_class_name_; }
+
+  // Objects are identified by their 1-origin id.
+  intptr_t ClassId(intptr_t id) const { return cids_[id - 1]; }
+  intptr_t ShallowSize(intptr_t id) const { return sizes_[id - 1]; }
+  // The length of a string or list, or -1 if the object has no length.
+  intptr_t Length(intptr_t id) const { return lengths_[id - 1]; }
+  intptr_t ReferenceCount(intptr_t id) const {
+    return first_references_[id] - first_references_[id - 1];
+  }
+  intptr_t Reference(intptr_t id, intptr_t index) const {
+    return references_[first_references_[id - 1] + index];
+  }
+
+  // The id of element [index] of an Array.
+  intptr_t ArrayElement(intptr_t id, intptr_t index) const {
+    // Preceded by the type arguments and the length.
+    return Reference(id, index + 2);
+  }
+
+ private:
+  uint8_t ReadByte() {
+    EXPECT(position_ < data_.length());
+    return data_[position_++];
+  }
+
+  uintptr_t ReadUnsigned() {
+    uintptr_t value = 0;
+    intptr_t shift = 0;
+    uint8_t part;
+    do {
+      part = ReadByte();
+      value |= static_cast<uintptr_t>(part & 0x7F) << shift;
+      shift += 7;
+    } while ((part & 0x80) != 0);
+    return value;
+  }
+
+  int64_t ReadSigned() {
+    uint64_t value = 0;
+    intptr_t shift = 0;
+    uint8_t part;
+    do {
+      part = ReadByte();
+      value |= static_cast<uint64_t>(part & 0x7F) << shift;
+      shift += 7;
+    } while ((part & 0x80) != 0);
+    if ((shift < 64) && ((part & 0x40) != 0)) {
+      value |= ~static_cast<uint64_t>(0) << shift;
+    }
+    return static_cast<int64_t>(value);
+  }
+
+  void Skip(intptr_t length) {
+    EXPECT(position_ + length <= data_.length());
+    position_ += length;
+  }
+
+  void SkipUtf8() { Skip(ReadUnsigned()); }
+
+  const char* ReadUtf8() {
+    const intptr_t length = ReadUnsigned();
+    char* result = Thread::Current()->zone()->Alloc<char>(length + 1);
+    for (intptr_t i = 0; i < length; i++) {
+      result[i] = ReadByte();
+    }
+    result[length] = '\0';
+    return result;
+  }
+
+  // Returns the length of the object, if any.
+  intptr_t ReadData() {
+    switch (ReadUnsigned()) {
+      case 0:  // NoData.
+      case 1:  // NullData.
+        return -1;
+      case 2:  // BoolData.
+        ReadUnsigned();
+        return -1;
+      case 3:  // IntegerData.
+        ReadSigned();
+        return -1;
+      case 4:  // DoubleData.
+        Skip(sizeof(double));
+        return -1;
+      case 5: {  // Latin1StringData.
+        const intptr_t length = ReadUnsigned();
+        Skip(ReadUnsigned());
+        return length;
+      }
+      case 6: {  // Utf16StringData.
+        const intptr_t length = ReadUnsigned();
+        Skip(ReadUnsigned() * 2);
+        return length;
+      }
+      case 7:  // LengthData.
+        return ReadUnsigned();
+      case 8:  // NameData.
+        SkipUtf8();
+        return -1;
+      default:
+        UNREACHABLE();
+        return -1;
+    }
+  }
+
+  const MallocGrowableArray<uint8_t>& data_;
+  intptr_t position_;
+
+  const char* array_class_name_ = nullptr;
+  intptr_t reference_count_ = 0;
+  MallocGrowableArray<intptr_t> cids_;
+  MallocGrowableArray<intptr_t> sizes_;
+  MallocGrowableArray<intptr_t> lengths_;
+  MallocGrowableArray<intptr_t> first_references_;
+  MallocGrowableArray<intptr_t> references_;
+
+  DISALLOW_COPY_AND_ASSIGN(HeapSnapshotReader);
+};
+
+// Returns the id of the Array of [length] elements whose first element is
+// [element], or 0 if there is not exactly one such array.
+static intptr_t FindArray(const HeapSnapshotReader& snapshot,
+                          intptr_t length,
+                          intptr_t element) {
+  intptr_t result = 0;
+  for (intptr_t id = 1; id <= snapshot.object_count(); id++) {
+    if ((snapshot.ClassId(id) == kArrayCid) &&
+        (snapshot.Length(id) == length) &&
+        (snapshot.ArrayElement(id, 0) == element)) {
+      if (result != 0) {
+        return 0;
+      }
+      result = id;
+    }
+  }
+  return result;
+}
+
+ISOLATE_UNIT_TEST_CASE(HeapSnapshotWriter) {
+  // Objects on regular, large and new-space pages, which point to each
+  // other in a cycle.
+  const Array& old_array = Array::Handle(Array::New(100, Heap::kOld));
+  const intptr_t large_length = kPageSize / kWordSize;
+  const Array& large_array =
+      Array::Handle(Array::New(large_length, Heap::kOld));
+  const Array& new_array = Array::Handle(Array::New(10, Heap::kNew));
+  for (intptr_t i = 0; i < old_array.Length(); i++) {
+    old_array.SetAt(i, String::Handle(String::New("old", Heap::kOld)));
+  }
+  large_array.SetAt(0, old_array);
+  new_array.SetAt(0, large_array);
+  old_array.SetAt(0, new_array);
+  const intptr_t string_size = old_array.At(1)->HeapSize();
+
+  ForEachHeapSnapshotTaskCount([&]() {
+    for (intptr_t compress = 0; compress < 2; compress++) {
+      CollectingHeapSnapshotWriter writer(thread, compress != 0);
+      writer.Write();
+      EXPECT(writer.done());
+
+      HeapSnapshotReader snapshot(writer.data());
+      snapshot.Read();
+      EXPECT_STREQ("_List", snapshot.array_class_name());
+
+      // The root comes first.
+      EXPECT_EQ(0, snapshot.ClassId(1));
+      EXPECT_EQ(0, snapshot.ShallowSize(1));
+
+      intptr_t references = 0;
+      for (intptr_t id = 1; id <= snapshot.object_count(); id++) {
+        for (intptr_t i = 0; i < snapshot.ReferenceCount(id); i++) {
+          const intptr_t target = snapshot.Reference(id, i);
+          EXPECT(target >= 0 && target <= snapshot.object_count());
+        }
+        references += snapshot.ReferenceCount(id);
+      }
+      EXPECT_EQ(references, snapshot.reference_count());
+
+      // Follow the cycle through the ids of the references.
+      intptr_t new_id = 0;
+      for (intptr_t id = 1; id <= snapshot.object_count(); id++) {
+        if ((snapshot.ClassId(id) == kArrayCid) &&
+            (snapshot.Length(id) == 100)) {
+          const intptr_t large_id = FindArray(snapshot, large_length, id);
+          if (large_id != 0) {
+            new_id = FindArray(snapshot, 10, large_id);
+            if (new_id != 0) {
+              break;
+            }
+          }
+        }
+      }
+      EXPECT(new_id != 0);
+      if (new_id == 0) {
+        continue;
+      }
+      const intptr_t large_id = snapshot.ArrayElement(new_id, 0);
+      const intptr_t old_id = snapshot.ArrayElement(large_id, 0);
+      EXPECT_EQ(new_id, snapshot.ArrayElement(old_id, 0));
+      EXPECT_EQ(new_array.Length() + 2, snapshot.ReferenceCount(new_id));
+      EXPECT_EQ(large_length + 2, snapshot.ReferenceCount(large_id));
+      EXPECT_EQ(old_array.Length() + 2, snapshot.ReferenceCount(old_id));
+
+      EXPECT_EQ(new_array.raw()->HeapSize(), snapshot.ShallowSize(new_id));
+      EXPECT_EQ(large_array.raw()->HeapSize(), snapshot.ShallowSize(large_id));
+      EXPECT_EQ(old_array.raw()->HeapSize(), snapshot.ShallowSize(old_id));
+
+      for (intptr_t i = 1; i < old_array.Length(); i++) {
+        const intptr_t string_id = snapshot.ArrayElement(old_id, i);
+        EXPECT_EQ(kOneByteStringCid, snapshot.ClassId(string_id));
+        EXPECT_EQ(3, snapshot.Length(string_id));
+        EXPECT_EQ(string_size, snapshot.ShallowSize(string_id));
+      }
+    }
+  });
+}
+
+ISOLATE_UNIT_TEST_CASE(DominatorTree) {
+  // Only 'outer' and 'shared' are held by handles:
+  //  outer->inner->array+->100 strings
+  //                     |
+  //                     +->shared
+  MirrorReference& outer = MirrorReference::Handle();
+  const Array& shared = Array::Handle(Array::New(1));
+  intptr_t retained_size = 0;
+  {
+    HANDLESCOPE(thread);
+    const Array& array = Array::Handle(Array::New(101, Heap::kOld));
+    String& str = String::Handle();
+    for (intptr_t i = 0; i < 100; i++) {
+      str = String::New("retained", Heap::kOld);
+      array.SetAt(i, str);
+      retained_size += str.raw()->HeapSize();
+    }
+    array.SetAt(100, shared);
+    const MirrorReference& inner =
+        MirrorReference::Handle(MirrorReference::New(array, Heap::kOld));
+    outer = MirrorReference::New(inner);
+    retained_size += array.raw()->HeapSize() + inner.raw()->HeapSize() +
+                     outer.raw()->HeapSize();
+  }
+
+  ForEachHeapSnapshotTaskCount([&]() {
+    DominatorTree tree(thread);
+    EXPECT(tree.Compute());
+    EXPECT_EQ(2, tree.InstanceCount(kMirrorReferenceCid));
+    EXPECT_EQ(2 * MirrorReference::InstanceSize(),
+              tree.ShallowSize(kMirrorReferenceCid));
+    // 'inner' is dominated by 'outer', so it is not counted twice.
+    EXPECT_EQ(retained_size, tree.RetainedSize(kMirrorReferenceCid));
+    EXPECT_LE(retained_size, tree.reachable_size());
+    EXPECT_LE(tree.InstanceCount(kArrayCid), tree.reachable_count());
+  });
+}
+
 #endif  // !defined(PRODUCT)
 
 }  // namespace dart
@@ -59,6 +59,12 @@ void ObjectStore::PrintToJSONObject(JSONObject* jsobj) {
 }
 #endif  // !PRODUCT
 
+void ObjectStore::ResetIsolateListeners() {
+  this->resume_capabilities_ = GrowableObjectArray::New();
+  this->exit_listeners_ = GrowableObjectArray::New();
+  this->error_listeners_ = GrowableObjectArray::New();
+}
+
 static RawInstance* AllocateObjectByClassName(const Library& library,
                                               const String& class_name) {
   const Class& cls = Class::Handle(library.LookupClassAllowPrivate(class_name));
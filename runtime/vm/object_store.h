@@ -135,10 +135,13 @@ class ObjectPointerVisitor;
   RW(Code, stack_overflow_stub_without_fpu_regs_stub)                          \
   RW(Code, write_barrier_wrappers_stub)                                        \
   RW(Code, array_write_barrier_stub)                                           \
+  RW(Array, exception_handled_types)                                           \
   R_(Code, megamorphic_miss_code)                                              \
   R_(Function, megamorphic_miss_function)                                      \
   RW(Array, code_order_table)                                                  \
   RW(Array, obfuscation_map)                                                   \
+  RW(Array, aot_profile)                                                       \
+  RW(Array, pending_type_feedback)                                             \
   RW(Class, ffi_pointer_class)                                                 \
   RW(Class, ffi_native_type_class)                                             \
   RW(Class, ffi_struct_class)                                                  \
@@ -211,6 +214,11 @@ class ObjectStore {
   // a null object is returned.
   RawError* PreallocateObjects();
 
+  // Replaces the lists of resume capabilities and exit and error listeners
+  // read from an isolate group's template (see Dart_SetIsolateGroupTemplate)
+  // with empty ones, as they belong to the template isolate.
+  void ResetIsolateListeners();
+
   void InitKnownObjects();
 
   static void Init(Isolate* isolate);
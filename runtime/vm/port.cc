@@ -284,6 +284,19 @@ Isolate* PortMap::GetIsolate(Dart_Port id) {
   return handler->isolate();
 }
 
+bool PortMap::IsPortInIsolateGroup(Dart_Port id, IsolateGroup* group) {
+  MutexLocker ml(mutex_);
+  intptr_t index = FindPort(id);
+  if (index < 0) {
+    // Port does not exist.
+    return false;
+  }
+
+  // The isolate cannot be shut down while the port is in the map.
+  Isolate* isolate = map_[index].handler->isolate();
+  return (isolate != NULL) && (isolate->group() == group);
+}
+
 void PortMap::Init() {
   if (mutex_ == NULL) {
     mutex_ = new Mutex();
@@ -16,6 +16,7 @@
 namespace dart {
 
 class Isolate;
+class IsolateGroup;
 class Message;
 class MessageHandler;
 class Mutex;
@@ -57,6 +58,9 @@ class PortMap : public AllStatic {
   // Returns the owning Isolate for port 'id'.
   static Isolate* GetIsolate(Dart_Port id);
 
+  // Returns whether port 'id' is owned by an isolate of 'group'.
+  static bool IsPortInIsolateGroup(Dart_Port id, IsolateGroup* group);
+
   static void Init();
   static void Cleanup();
 
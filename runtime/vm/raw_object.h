@@ -371,6 +371,14 @@ class RawObject {
   intptr_t HeapSize() const {
     ASSERT(IsHeapObject());
     uint32_t tags = ptr()->tags_;
+    return HeapSize(tags);
+  }
+
+  // Computes the size from previously loaded 'tags' instead of re-reading the
+  // header, which a parallel scavenger may concurrently replace with a
+  // forwarding pointer.
+  intptr_t HeapSize(uint32_t tags) const {
+    ASSERT(IsHeapObject());
     intptr_t result = SizeTag::decode(tags);
     if (result != 0) {
 #if defined(DEBUG)
@@ -379,16 +387,16 @@ class RawObject {
       // leading to inconsistency between HeapSizeFromClass() and
       // SizeTag::decode(tags). We are working around it by reloading tags_ and
       // recomputing size from tags.
-      const intptr_t size_from_class = HeapSizeFromClass();
-      if ((result > size_from_class) && (GetClassId() == kArrayCid) &&
-          (ptr()->tags_ != tags)) {
+      const intptr_t size_from_class = HeapSizeFromClass(tags);
+      if ((result > size_from_class) &&
+          (ClassIdTag::decode(tags) == kArrayCid) && (ptr()->tags_ != tags)) {
         result = SizeTag::decode(ptr()->tags_);
       }
       ASSERT(result == size_from_class);
 #endif
       return result;
     }
-    result = HeapSizeFromClass();
+    result = HeapSizeFromClass(tags);
     ASSERT(result > SizeTag::kMaxSizeTag);
     return result;
   }
@@ -512,7 +520,10 @@ class RawObject {
   intptr_t VisitPointersPredefined(ObjectPointerVisitor* visitor,
                                    intptr_t class_id);
 
-  intptr_t HeapSizeFromClass() const;
+  intptr_t HeapSizeFromClass() const {
+    return HeapSizeFromClass(ptr()->tags_);
+  }
+  intptr_t HeapSizeFromClass(uint32_t tags) const;
 
   void SetClassId(intptr_t new_cid) {
     uint32_t tags = ptr()->tags_;
@@ -689,7 +700,8 @@ class RawObject {
   friend class OneByteString;  // StoreSmi
   friend class RawInstance;
   friend class Scavenger;
-  friend class ScavengerVisitor;
+  template <bool>
+  friend class ScavengerVisitorBase;
   friend class ImageReader;  // tags_ check
   friend class ImageWriter;
   friend class AssemblyImageWriter;
@@ -1708,7 +1720,9 @@ class RawExceptionHandlers : public RawObject {
   int32_t num_entries_;
 
   // Array with [num_entries_] entries. Each entry is an array of all handled
-  // exception types.
+  // exception types. A Smi index into ObjectStore::exception_handled_types
+  // for handlers left in a read-only AOT snapshot image (see
+  // ExceptionHandlers::MoveHandledTypesTo).
   VISIT_FROM(RawObject*, handled_types_data_)
   RawArray* handled_types_data_;
   VISIT_TO_LENGTH(RawObject*, &ptr()->handled_types_data_);
@@ -1722,6 +1736,7 @@ class RawExceptionHandlers : public RawObject {
   }
 
   friend class Object;
+  friend class ImageWriter;
 };
 
 class RawContext : public RawObject {
@@ -2306,7 +2321,8 @@ class RawTypedDataView : public RawTypedDataBase {
   friend class ObjectPoolSerializationCluster;
   friend class RawObjectPool;
   friend class GCCompactor;
-  friend class ScavengerVisitor;
+  template <bool>
+  friend class ScavengerVisitorBase;
   friend class SnapshotReader;
 };
 
@@ -2592,7 +2608,8 @@ class RawWeakProperty : public RawInstance {
   template <bool>
   friend class MarkingVisitorBase;
   friend class Scavenger;
-  friend class ScavengerVisitor;
+  template <bool>
+  friend class ScavengerVisitorBase;
 };
 
 // MirrorReferences are used by mirrors to hold reflectees that are VM
@@ -13,6 +13,7 @@
 
 #include "platform/unicode.h"
 #include "vm/base64.h"
+#include "vm/compiler/compiler_pass.h"
 #include "vm/compiler/jit/compiler.h"
 #include "vm/cpu.h"
 #include "vm/dart_api_impl.h"
@@ -2274,6 +2275,26 @@ static bool GetReachableSize(Thread* thread, JSONStream* js) {
   return true;
 }
 
+static const MethodParameter* get_top_retainers_params[] = {
+    RUNNABLE_ISOLATE_PARAMETER, new UIntParameter("limit", false), NULL,
+};
+
+static bool GetTopRetainers(Thread* thread, JSONStream* js) {
+  intptr_t limit = 20;
+  const char* limit_param = js->LookupParam("limit");
+  if (limit_param != NULL) {
+    limit = UIntParameter::Parse(limit_param);
+  }
+  DominatorTree tree(thread);
+  if (!tree.Compute()) {
+    js->PrintError(kInternalError, "%s: too many objects in the heap",
+                   js->method());
+    return true;
+  }
+  tree.PrintTopRetainersJSON(js, limit);
+  return true;
+}
+
 static const MethodParameter* invoke_params[] = {
     RUNNABLE_ISOLATE_PARAMETER,
     NULL,
@@ -3889,6 +3910,38 @@ static bool GetAllocationProfileImpl(Thread* thread,
   return true;
 }
 
+static const MethodParameter* get_compiler_pass_stats_params[] = {
+    RUNNABLE_ISOLATE_PARAMETER,
+    NULL,
+};
+
+static bool GetCompilerPassStats(Thread* thread, JSONStream* js) {
+#if defined(DART_PRECOMPILED_RUNTIME)
+  js->PrintError(kFeatureDisabled, "Compiler is disabled in AOT mode.");
+  return true;
+#else
+  bool should_reset = false;
+  if (js->HasParam("reset")) {
+    if (js->ParamIs("reset", "true")) {
+      should_reset = true;
+    } else {
+      PrintInvalidParamError(js, "reset");
+      return true;
+    }
+  }
+  CompilerPassStats* stats = thread->isolate()->compiler_pass_stats();
+  {
+    JSONObject obj(js);
+    obj.AddProperty("type", "_CompilerPassStats");
+    stats->PrintToJSONObject(&obj);
+  }
+  if (should_reset) {
+    stats->Reset();
+  }
+  return true;
+#endif  // defined(DART_PRECOMPILED_RUNTIME)
+}
+
 static const MethodParameter* get_allocation_profile_params[] = {
     RUNNABLE_ISOLATE_PARAMETER,
     NULL,
@@ -3936,14 +3989,27 @@ static bool GetHeapMap(Thread* thread, JSONStream* js) {
   return true;
 }
 
+static const MethodParameter* get_gc_controller_state_params[] = {
+    ISOLATE_PARAMETER,
+    NULL,
+};
+
+static bool GetGCControllerState(Thread* thread, JSONStream* js) {
+  thread->isolate()->heap()->PrintGCControllerStateJSON(js);
+  return true;
+}
+
 static const MethodParameter* request_heap_snapshot_params[] = {
     RUNNABLE_ISOLATE_PARAMETER,
+    new BoolParameter("_compress", false),
     NULL,
 };
 
 static bool RequestHeapSnapshot(Thread* thread, JSONStream* js) {
   if (Service::heapsnapshot_stream.enabled()) {
-    HeapSnapshotWriter writer(thread);
+    const bool compress =
+        BoolParameter::Parse(js->LookupParam("_compress"), false);
+    HeapSnapshotWriter writer(thread, compress);
     writer.Write();
   }
   // TODO(koda): Provide some id that ties this request to async response(s).
@@ -4673,10 +4739,14 @@ static const ServiceMethodDescriptor service_methods_[] = {
       get_native_allocation_samples_params },
   { "getClassList", GetClassList,
     get_class_list_params },
+  { "_getCompilerPassStats", GetCompilerPassStats,
+    get_compiler_pass_stats_params },
   { "getCpuSamples", GetCpuSamples,
     get_cpu_samples_params },
   { "getFlagList", GetFlagList,
     get_flag_list_params },
+  { "_getGCControllerState", GetGCControllerState,
+    get_gc_controller_state_params },
   { "_getHeapMap", GetHeapMap,
     get_heap_map_params },
   { "getInboundReferences", GetInboundReferences,
@@ -4713,6 +4783,8 @@ static const ServiceMethodDescriptor service_methods_[] = {
     get_stack_params },
   { "_getTagProfile", GetTagProfile,
     get_tag_profile_params },
+  { "_getTopRetainers", GetTopRetainers,
+    get_top_retainers_params },
   { "_getTypeArgumentsList", GetTypeArgumentsList,
     get_type_arguments_list_params },
   { "getVersion", GetVersion,
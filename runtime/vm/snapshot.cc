@@ -744,6 +744,14 @@ RawObject* SnapshotReader::ReadVMIsolateObject(intptr_t header_value) {
     return Double::New(ReadDouble());
   }
 
+  // Check if it is an object passed by reference.
+  if (object_id == kSharedReadOnlyObject) {
+    ASSERT(kind_ == Snapshot::kMessage);
+    RawObject* raw = reinterpret_cast<RawObject*>(Read<int64_t>());
+    ASSERT(MessageWriter::IsSharedReadOnlyObject(isolate(), raw));
+    return raw;
+  }
+
   // Check it is a singleton class object.
   intptr_t class_id = ClassIdFromObjectId(object_id);
   if (IsSingletonClassId(class_id)) {
@@ -817,7 +825,8 @@ SnapshotWriter::SnapshotWriter(Thread* thread,
                                DeAlloc dealloc,
                                intptr_t initial_size,
                                ForwardList* forward_list,
-                               bool can_send_any_object)
+                               bool can_send_any_object,
+                               bool can_share_read_only_objects)
     : BaseWriter(alloc, dealloc, initial_size),
       thread_(thread),
       kind_(kind),
@@ -826,7 +835,8 @@ SnapshotWriter::SnapshotWriter(Thread* thread,
       forward_list_(forward_list),
       exception_type_(Exceptions::kNone),
       exception_msg_(NULL),
-      can_send_any_object_(can_send_any_object) {
+      can_send_any_object_(can_send_any_object),
+      can_share_read_only_objects_(can_share_read_only_objects) {
   ASSERT(forward_list_ != NULL);
 }
 
@@ -1029,6 +1039,14 @@ bool SnapshotWriter::CheckAndWritePredefinedObject(RawObject* rawobj) {
     return true;
   }
 
+  if (can_share_read_only_objects_ &&
+      MessageWriter::IsSharedReadOnlyObject(isolate(), rawobj)) {
+    ASSERT(kind_ == Snapshot::kMessage);
+    WriteVMIsolateObject(kSharedReadOnlyObject);
+    Write<int64_t>(reinterpret_cast<intptr_t>(rawobj));
+    return true;
+  }
+
   // Check if object has already been serialized, in that case just write
   // the object id out.
   intptr_t object_id = forward_list_->FindObject(rawobj);
@@ -1471,14 +1489,16 @@ static void malloc_deallocator(uint8_t* ptr) {
   free(reinterpret_cast<void*>(ptr));
 }
 
-MessageWriter::MessageWriter(bool can_send_any_object)
+MessageWriter::MessageWriter(bool can_send_any_object,
+                             bool can_share_read_only_objects)
     : SnapshotWriter(Thread::Current(),
                      Snapshot::kMessage,
                      malloc_allocator,
                      malloc_deallocator,
                      kInitialSize,
                      &forward_list_,
-                     can_send_any_object),
+                     can_send_any_object,
+                     can_share_read_only_objects),
       forward_list_(thread(), kMaxPredefinedObjectIds),
       finalizable_data_(new MessageFinalizableData()) {}
 
@@ -1486,6 +1506,19 @@ MessageWriter::~MessageWriter() {
   delete finalizable_data_;
 }
 
+bool MessageWriter::IsSharedReadOnlyObject(Isolate* isolate, RawObject* raw) {
+  if (!raw->IsHeapObject() || raw->IsNewObject()) {
+    return false;
+  }
+  // Only strings are both instances and kept in read-only snapshot data.
+  const intptr_t cid = raw->GetClassId();
+  if ((cid != kOneByteStringCid) && (cid != kTwoByteStringCid)) {
+    return false;
+  }
+  return raw->InVMIsolateHeap() ||
+         isolate->heap()->old_space()->IsObjectFromImagePages(raw);
+}
+
 std::unique_ptr<Message> MessageWriter::WriteMessage(
     const Object& obj,
     Dart_Port dest_port,
@@ -629,7 +629,8 @@ class SnapshotWriter : public BaseWriter {
                  DeAlloc dealloc,
                  intptr_t initial_size,
                  ForwardList* forward_list,
-                 bool can_send_any_object);
+                 bool can_send_any_object,
+                 bool can_share_read_only_objects = false);
 
  public:
   // Snapshot kind.
@@ -703,6 +704,8 @@ class SnapshotWriter : public BaseWriter {
   Exceptions::ExceptionType exception_type_;  // Exception type.
   const char* exception_msg_;  // Message associated with exception.
   bool can_send_any_object_;   // True if any Dart instance can be sent.
+  // True if shared read-only objects can be passed by reference.
+  bool can_share_read_only_objects_;
 
   friend class RawArray;
   friend class RawClass;
@@ -757,9 +760,18 @@ class SerializedObjectBuffer : public StackResource {
 class MessageWriter : public SnapshotWriter {
  public:
   static const intptr_t kInitialSize = 512;
-  explicit MessageWriter(bool can_send_any_object);
+  // If [can_share_read_only_objects] is true, the message is received by an
+  // isolate of the sender's isolate group and objects for which
+  // IsSharedReadOnlyObject holds are written as references.
+  explicit MessageWriter(bool can_send_any_object,
+                         bool can_share_read_only_objects = false);
   ~MessageWriter();
 
+  // Returns whether [raw] is deeply immutable and lives in memory shared by
+  // all isolates of the group of [isolate], which never moves or frees it:
+  // the VM isolate heap and the read-only data of the group's snapshot.
+  static bool IsSharedReadOnlyObject(Isolate* isolate, RawObject* raw);
+
   std::unique_ptr<Message> WriteMessage(const Object& obj,
                                         Dart_Port dest_port,
                                         Message::Priority priority);
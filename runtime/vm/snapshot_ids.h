@@ -21,6 +21,9 @@ enum {
   kFalseValue,
   // Marker for special encoding of double objects in message snapshots.
   kDoubleObject,
+  // Marker for objects passed by reference in message snapshots (see
+  // MessageWriter::IsSharedReadOnlyObject).
+  kSharedReadOnlyObject,
   // Object id has been optimized away; reader should use next available id.
   kOmittedObjectId,
 
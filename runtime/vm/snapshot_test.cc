@@ -22,6 +22,8 @@
 
 namespace dart {
 
+DECLARE_FLAG(bool, compress_snapshot_data);
+
 // Check if serialized and deserialized objects are equal.
 static bool Equals(const Object& expected, const Object& actual) {
   if (expected.IsNull()) {
@@ -467,6 +469,31 @@ ISOLATE_UNIT_TEST_CASE(SerializeArray) {
   CheckEncodeDecodeMessage(root);
 }
 
+ISOLATE_UNIT_TEST_CASE(SerializeSharedReadOnlyStrings) {
+  const String& shared = Symbols::Dot();
+  const String& local = String::Handle(String::New("not shared"));
+  EXPECT(MessageWriter::IsSharedReadOnlyObject(thread->isolate(),
+                                               shared.raw()));
+  EXPECT(!MessageWriter::IsSharedReadOnlyObject(thread->isolate(),
+                                                local.raw()));
+  const Array& array = Array::Handle(Array::New(2));
+  array.SetAt(0, shared);
+  array.SetAt(1, local);
+
+  // Shared strings are passed by reference, other objects are copied.
+  MessageWriter writer(true, /*can_share_read_only_objects=*/true);
+  std::unique_ptr<Message> message =
+      writer.WriteMessage(array, ILLEGAL_PORT, Message::kNormalPriority);
+  MessageSnapshotReader reader(message.get(), thread);
+  Array& serialized_array = Array::Handle();
+  serialized_array ^= reader.ReadObject();
+  EXPECT_EQ(2, serialized_array.Length());
+  EXPECT(serialized_array.At(0) == shared.raw());
+  EXPECT(serialized_array.At(1) != local.raw());
+  EXPECT(String::Handle(String::RawCast(serialized_array.At(1)))
+             .Equals(local));
+}
+
 ISOLATE_UNIT_TEST_CASE(SerializeArrayWithTypeArgument) {
   // Write snapshot with object content.
   const int kArrayLength = 10;
@@ -698,7 +725,7 @@ ISOLATE_UNIT_TEST_CASE(SerializeEmptyByteArray) {
   CheckEncodeDecodeMessage(root);
 }
 
-VM_UNIT_TEST_CASE(FullSnapshot) {
+static void TestFullSnapshot() {
   const char* kScriptChars =
       "class Fields  {\n"
       "  Fields(int i, int j) : fld1 = i, fld2 = j {}\n"
@@ -775,6 +802,15 @@ VM_UNIT_TEST_CASE(FullSnapshot) {
   free(isolate_snapshot_data_buffer);
 }
 
+VM_UNIT_TEST_CASE(FullSnapshot) {
+  TestFullSnapshot();
+}
+
+VM_UNIT_TEST_CASE(FullSnapshotCompressed) {
+  SetFlagScope<bool> sfs(&FLAG_compress_snapshot_data, true);
+  TestFullSnapshot();
+}
+
 // Helper function to call a top level Dart function and serialize the result.
 static std::unique_ptr<Message> GetSerialized(Dart_Handle lib,
                                               const char* dart_function) {
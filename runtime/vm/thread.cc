@@ -35,6 +35,8 @@ Thread::~Thread() {
   ASSERT(isolate_ == NULL);
   ASSERT(store_buffer_block_ == NULL);
   ASSERT(marking_stack_block_ == NULL);
+  ASSERT(old_tlab_->IsEmpty());
+  delete old_tlab_;
 #if !defined(DART_PRECOMPILED_RUNTIME)
   delete interpreter_;
   interpreter_ = nullptr;
@@ -95,6 +97,7 @@ Thread::Thread(bool is_vm_isolate)
       deferred_interrupts_(0),
       stack_overflow_count_(0),
       bump_allocate_(false),
+      old_tlab_(new OldTLAB()),
       hierarchy_info_(NULL),
       type_usage_info_(NULL),
       pending_functions_(GrowableObjectArray::null()),
@@ -283,6 +286,12 @@ const char* Thread::TaskKindToCString(TaskKind kind) {
       return "kSweeperTask";
     case kMarkerTask:
       return "kMarkerTask";
+    case kCompactorTask:
+      return "kCompactorTask";
+    case kScavengerTask:
+      return "kScavengerTask";
+    case kHeapSnapshotTask:
+      return "kHeapSnapshotTask";
     default:
       UNREACHABLE();
       return "";
@@ -338,6 +347,7 @@ void Thread::ExitIsolate() {
     thread->DeferredMarkingStackRelease();
   }
   thread->StoreBufferRelease();
+  thread->heap()->old_space()->ReleaseTLAB(thread->old_tlab());
   if (isolate->is_runnable()) {
     thread->set_vm_tag(VMTag::kIdleTagId);
   } else {
@@ -387,6 +397,7 @@ void Thread::ExitIsolateAsHelper(bool bypass_safepoint) {
   }
   thread->StoreBufferRelease();
   thread->heap()->AbandonRemainingTLAB(thread);
+  thread->heap()->old_space()->ReleaseTLAB(thread->old_tlab());
   Isolate* isolate = thread->isolate();
   ASSERT(isolate != NULL);
   const bool kIsNotMutatorThread = false;
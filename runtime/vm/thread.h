@@ -47,6 +47,7 @@ class Isolate;
 class IsolateGroup;
 class Library;
 class Object;
+class OldTLAB;
 class OSThread;
 class JSONObject;
 class PcDescriptors;
@@ -228,6 +229,8 @@ class Thread : public ThreadState {
     kMarkerTask = 0x4,
     kSweeperTask = 0x8,
     kCompactorTask = 0x10,
+    kScavengerTask = 0x20,
+    kHeapSnapshotTask = 0x40,
   };
   // Converts a TaskKind to its corresponding C-String name.
   static const char* TaskKindToCString(TaskKind kind);
@@ -482,6 +485,9 @@ class Thread : public ThreadState {
   bool bump_allocate() const { return bump_allocate_; }
   void set_bump_allocate(bool b) { bump_allocate_ = b; }
 
+  // Buffer for old-space allocation, released when leaving the isolate.
+  OldTLAB* old_tlab() const { return old_tlab_; }
+
   int32_t no_safepoint_scope_depth() const {
 #if defined(DEBUG)
     return no_safepoint_scope_depth_;
@@ -916,6 +922,7 @@ class Thread : public ThreadState {
   uint16_t deferred_interrupts_;
   int32_t stack_overflow_count_;
   bool bump_allocate_;
+  OldTLAB* old_tlab_;
 
   // Compiler state:
   CompilerState* compiler_state_ = nullptr;
@@ -59,6 +59,7 @@ class ThreadRegistry {
 
   friend class Isolate;
   friend class IsolateGroup;
+  friend class PageSpace;
   friend class SafepointHandler;
   friend class Scavenger;
   DISALLOW_COPY_AND_ASSIGN(ThreadRegistry);
@@ -57,6 +57,19 @@ class VirtualMemory {
                                         bool is_executable,
                                         const char* name);
 
+  // Reserves and commits a non-executable segment for Dart heap objects. With
+  // --heap_huge_pages or --heap_hugetlb, a segment whose size is a multiple of
+  // kHugePageSize is aligned to it and backed by huge pages; explicitly
+  // reserved huge pages are only used if the segment is never truncated. A
+  // non-negative numa_node binds the segment to that NUMA node.
+  static VirtualMemory* AllocateHeap(intptr_t size,
+                                     intptr_t alignment,
+                                     bool truncatable,
+                                     intptr_t numa_node,
+                                     const char* name);
+
+  static const intptr_t kHugePageSize = 2 * MB;
+
   static intptr_t PageSize() {
     ASSERT(page_size_ != 0);
     ASSERT(Utils::IsPowerOfTwo(page_size_));
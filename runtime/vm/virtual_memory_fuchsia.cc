@@ -150,6 +150,15 @@ VirtualMemory* VirtualMemory::AllocateAligned(intptr_t size,
   return result;
 }
 
+VirtualMemory* VirtualMemory::AllocateHeap(intptr_t size,
+                                           intptr_t alignment,
+                                           bool truncatable,
+                                           intptr_t numa_node,
+                                           const char* name) {
+  // Huge pages and NUMA binding are only supported on Linux.
+  return AllocateAligned(size, alignment, /* is_executable */ false, name);
+}
+
 VirtualMemory::~VirtualMemory() {
   // Reserved region may be empty due to VirtualMemory::Truncate.
   if (vm_owns_region() && reserved_.size() != 0) {
@@ -236,6 +236,99 @@ VirtualMemory* VirtualMemory::AllocateAligned(intptr_t size,
   return new VirtualMemory(region, region);
 }
 
+#if defined(HOST_OS_LINUX)
+#if !defined(MPOL_BIND)
+#define MPOL_BIND 2
+#endif
+
+// Wrapper to call mbind syscall without depending on libnuma.
+static inline int mbind(void* start,
+                        uword len,
+                        int mode,
+                        const unsigned long* nodemask,  // NOLINT
+                        uword maxnode,
+                        unsigned flags) {
+#if !defined(__NR_mbind)
+  errno = ENOSYS;
+  return -1;
+#else
+  return syscall(__NR_mbind, start, len, mode, nodemask, maxnode, flags);
+#endif
+}
+
+static void BindToNumaNode(void* address, intptr_t size, intptr_t node) {
+  if ((node < 0) || (node >= kBitsPerWord)) {
+    return;
+  }
+  const unsigned long nodemask = 1UL << node;  // NOLINT
+  // The kernel reads maxnode - 1 bits of the mask.
+  if (mbind(address, size, MPOL_BIND, &nodemask, kBitsPerWord + 1, 0) != 0) {
+    LOG_INFO("mbind(%p, 0x%" Px ", node %" Pd ") failed: %d\n", address, size,
+             node, errno);
+  }
+}
+
+// Maps size bytes of explicitly reserved huge pages, or returns NULL if the
+// system has not reserved enough of them.
+static void* MapHugeTLB(intptr_t size, intptr_t alignment) {
+#if defined(MAP_HUGETLB)
+  void* address = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+  LOG_INFO("mmap(NULL, 0x%" Px ", ..., MAP_HUGETLB): %p\n", size, address);
+  if (address == MAP_FAILED) {
+    return NULL;
+  }
+  const uword base = reinterpret_cast<uword>(address);
+  if (!Utils::IsAligned(base, alignment)) {
+    unmap(base, base + size);
+    return NULL;
+  }
+  return address;
+#else
+  return NULL;
+#endif  // defined(MAP_HUGETLB)
+}
+#endif  // defined(HOST_OS_LINUX)
+
+VirtualMemory* VirtualMemory::AllocateHeap(intptr_t size,
+                                           intptr_t alignment,
+                                           bool truncatable,
+                                           intptr_t numa_node,
+                                           const char* name) {
+#if defined(HOST_OS_LINUX)
+  const bool huge = Utils::IsAligned(size, kHugePageSize);
+  // Truncating a hugetlbfs mapping would have to unmap whole huge pages.
+  if (huge && FLAG_heap_hugetlb && !truncatable) {
+    void* address = MapHugeTLB(size, alignment);
+    if (address != NULL) {
+      BindToNumaNode(address, size, numa_node);
+      MemoryRegion region(address, size);
+      return new VirtualMemory(region, region);
+    }
+  }
+  const bool transparent = huge && (FLAG_heap_huge_pages || FLAG_heap_hugetlb);
+  if (transparent) {
+    alignment = Utils::Maximum(alignment, kHugePageSize);
+  }
+  VirtualMemory* result =
+      AllocateAligned(size, alignment, /* is_executable */ false, name);
+  if (result == NULL) {
+    return NULL;
+  }
+#if defined(MADV_HUGEPAGE)
+  // Fails harmlessly if transparent huge pages are disabled.
+  if (transparent && (madvise(result->address(), size, MADV_HUGEPAGE) != 0)) {
+    LOG_INFO("madvise(%p, 0x%" Px ", MADV_HUGEPAGE) failed: %d\n",
+             result->address(), size, errno);
+  }
+#endif  // defined(MADV_HUGEPAGE)
+  BindToNumaNode(result->address(), size, numa_node);
+  return result;
+#else
+  return AllocateAligned(size, alignment, /* is_executable */ false, name);
+#endif  // defined(HOST_OS_LINUX)
+}
+
 VirtualMemory::~VirtualMemory() {
   if (vm_owns_region()) {
     unmap(reserved_.start(), reserved_.end());
@@ -64,6 +64,40 @@ VM_UNIT_TEST_CASE(AllocateAlignedVirtualMemory) {
   }
 }
 
+VM_UNIT_TEST_CASE(AllocateHeapVirtualMemory) {
+  const bool saved_huge_pages = FLAG_heap_huge_pages;
+  const bool saved_hugetlb = FLAG_heap_hugetlb;
+  FLAG_heap_huge_pages = true;
+  for (intptr_t hugetlb = 0; hugetlb < 2; hugetlb++) {
+    FLAG_heap_hugetlb = hugetlb != 0;
+    for (intptr_t truncatable = 0; truncatable < 2; truncatable++) {
+      const intptr_t kSize = 2 * VirtualMemory::kHugePageSize;
+      VirtualMemory* vm = VirtualMemory::AllocateHeap(
+          kSize, kPageSize, truncatable != 0, /* numa_node */ 0, NULL);
+      EXPECT(vm != NULL);
+      EXPECT_EQ(kSize, vm->size());
+#if defined(HOST_OS_LINUX)
+      EXPECT(Utils::IsAligned(vm->start(), VirtualMemory::kHugePageSize));
+#else
+      EXPECT(Utils::IsAligned(vm->start(), kPageSize));
+#endif
+      char* buf = reinterpret_cast<char*>(vm->address());
+      EXPECT(IsZero(buf, buf + vm->size()));
+      buf[0] = 'a';
+      buf[kSize - 1] = 'z';
+      EXPECT_EQ('a', buf[0]);
+      EXPECT_EQ('z', buf[kSize - 1]);
+      if (truncatable != 0) {
+        vm->Truncate(kSize / 2 + kPageSize);
+        EXPECT_EQ(kSize / 2 + kPageSize, vm->size());
+      }
+      delete vm;
+    }
+  }
+  FLAG_heap_huge_pages = saved_huge_pages;
+  FLAG_heap_hugetlb = saved_hugetlb;
+}
+
 VM_UNIT_TEST_CASE(FreeVirtualMemory) {
   // Reservations should always be handed back to OS upon destruction.
   const intptr_t kVirtualMemoryBlockSize = 10 * MB;
@@ -60,6 +60,15 @@ VirtualMemory* VirtualMemory::AllocateAligned(intptr_t size,
   return new VirtualMemory(region, reserved);
 }
 
+VirtualMemory* VirtualMemory::AllocateHeap(intptr_t size,
+                                           intptr_t alignment,
+                                           bool truncatable,
+                                           intptr_t numa_node,
+                                           const char* name) {
+  // Huge pages and NUMA binding are only supported on Linux.
+  return AllocateAligned(size, alignment, /* is_executable */ false, name);
+}
+
 VirtualMemory::~VirtualMemory() {
   // Note that the size of the reserved region might be set to 0 by
   // Truncate(0, true) but that does not actually release the mapping